@@ -729,9 +729,18 @@ class CompactBlocksTest(BitcoinTestFramework):
         for tx in block.vtx[1:]:
             assert(tx.hash in mempool)
 
+        metrics = node.getmetrics("cmpctblock_")
+        reconstructed = metrics["counters"].get("cmpctblock_reconstructed", 0)
+        samples = metrics["histograms"].get("cmpctblock_reconstruct", {"count": 0})["count"]
+
         delivery_peer.send_and_ping(msg_cmpctblock(cmpct_block.to_p2p()))
         assert_equal(int(node.getbestblockhash(), 16), block.sha256)
 
+        # The block was rebuilt from the mempool without a round trip, and its latency recorded
+        metrics = node.getmetrics("cmpctblock_")
+        assert_equal(metrics["counters"]["cmpctblock_reconstructed"], reconstructed + 1)
+        assert_equal(metrics["histograms"]["cmpctblock_reconstruct"]["count"], samples + 1)
+
         self.utxos.append([block.vtx[-1].sha256, 0, block.vtx[-1].vout[0].nValue])
 
         # Now test that delivering an invalid compact block won't break relay
@@ -39,6 +39,23 @@ benchmark::BenchRunner::RunAll(double elapsedTimeForOne)
     perf_fini();
 }
 
+void benchmark::State::PauseTiming()
+{
+    pauseTime = gettimedouble();
+    pauseCycles = perf_cpucycles();
+}
+
+void benchmark::State::ResumeTiming()
+{
+    // move the start of the current measurement forward by the paused time
+    double pausedTime = gettimedouble() - pauseTime;
+    uint64_t pausedCycles = perf_cpucycles() - pauseCycles;
+    beginTime += pausedTime;
+    lastTime += pausedTime;
+    beginCycles += pausedCycles;
+    lastCycles += pausedCycles;
+}
+
 bool benchmark::State::KeepRunning()
 {
     if (count & countMask) {
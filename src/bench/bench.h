@@ -47,6 +47,8 @@ namespace benchmark {
         uint64_t lastCycles;
         uint64_t minCycles;
         uint64_t maxCycles;
+        double pauseTime;
+        uint64_t pauseCycles;
     public:
         State(std::string _name, double _maxElapsed) : name(_name), maxElapsed(_maxElapsed), count(0) {
             minTime = std::numeric_limits<double>::max();
@@ -57,6 +59,10 @@ namespace benchmark {
             countMaskInv = 1./(countMask + 1);
         }
         bool KeepRunning();
+
+        // Excludes the code between PauseTiming and ResumeTiming (e.g. resetting caches) from the measurement
+        void PauseTiming();
+        void ResumeTiming();
     };
 
     typedef boost::function<void(State&)> BenchFunction;
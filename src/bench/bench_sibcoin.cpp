@@ -4,6 +4,7 @@
 
 #include "bench.h"
 
+#include "crypto/sha256.h"
 #include "key.h"
 #include "validation.h"
 #include "util.h"
@@ -16,6 +17,7 @@ void CleanupBLSDkgTests();
 int
 main(int argc, char** argv)
 {
+    SHA256AutoDetect();
     ECC_Start();
     ECCVerifyHandle verifyHandle;
 
@@ -4,6 +4,7 @@
 
 #include "bench.h"
 #include "random.h"
+#include "bls/bls_batchverifier.h"
 #include "bls/bls_worker.h"
 #include "utiltime.h"
 
@@ -101,6 +102,10 @@ static void BLSVerify_Normal(benchmark::State& state)
     // Benchmark.
     size_t i = 0;
     while (state.KeepRunning()) {
+        // measure the actual verification, not the cache
+        state.PauseTiming();
+        blsVerifiedSigsCache.Clear();
+        state.ResumeTiming();
         bool valid = sigs[i].VerifyInsecure(pubKeys[i], msgHashes[i]);
         if (valid && invalid[i]) {
             std::cout << "expected invalid but it is valid" << std::endl;
@@ -114,6 +119,61 @@ static void BLSVerify_Normal(benchmark::State& state)
 }
 
 
+static void BLSPubKeyDeserialize(benchmark::State& state, bool cached)
+{
+    BLSPublicKeyVector pubKeys;
+    BLSSecretKeyVector secKeys;
+    BLSSignatureVector sigs;
+    std::vector<uint256> msgHashes;
+    std::vector<bool> invalid;
+    BuildTestVectors(1000, 0, pubKeys, secKeys, sigs, msgHashes, invalid);
+
+    std::vector<std::vector<unsigned char>> bufs(pubKeys.size());
+    for (size_t i = 0; i < pubKeys.size(); i++) {
+        pubKeys[i].GetBuf(bufs[i]);
+    }
+
+    // Benchmark.
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        if (!cached) {
+            blsPublicKeyCache.Clear();
+        }
+        CBLSPublicKey pubKey;
+        pubKey.SetBuf(bufs[i]);
+        assert(pubKey.IsValid());
+        i = (i + 1) % bufs.size();
+    }
+}
+
+static void BLSPubKeyDeserialize_Uncached(benchmark::State& state)
+{
+    BLSPubKeyDeserialize(state, false);
+}
+
+static void BLSPubKeyDeserialize_Cached(benchmark::State& state)
+{
+    BLSPubKeyDeserialize(state, true);
+}
+
+static void BLSVerify_Cached(benchmark::State& state)
+{
+    BLSPublicKeyVector pubKeys;
+    BLSSecretKeyVector secKeys;
+    BLSSignatureVector sigs;
+    std::vector<uint256> msgHashes;
+    std::vector<bool> invalid;
+    BuildTestVectors(1000, 0, pubKeys, secKeys, sigs, msgHashes, invalid);
+
+    // Benchmark. Only the first round actually verifies signatures, see BLSVerify_Normal for uncached verification
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        bool valid = sigs[i].VerifyInsecure(pubKeys[i], msgHashes[i]);
+        assert(valid);
+        i = (i + 1) % pubKeys.size();
+    }
+}
+
 static void BLSVerify_LargeBlock(size_t txCount, benchmark::State& state)
 {
     BLSPublicKeyVector pubKeys;
@@ -125,6 +185,9 @@ static void BLSVerify_LargeBlock(size_t txCount, benchmark::State& state)
 
     // Benchmark.
     while (state.KeepRunning()) {
+        state.PauseTiming();
+        blsVerifiedSigsCache.Clear();
+        state.ResumeTiming();
         for (size_t i = 0; i < pubKeys.size(); i++) {
             sigs[i].VerifyInsecure(pubKeys[i], msgHashes[i]);
         }
@@ -152,6 +215,9 @@ static void BLSVerify_LargeBlockSelfAggregated(size_t txCount, benchmark::State&
 
     // Benchmark.
     while (state.KeepRunning()) {
+        state.PauseTiming();
+        blsVerifiedSigsCache.Clear();
+        state.ResumeTiming();
         CBLSSignature aggSig = CBLSSignature::AggregateInsecure(sigs);
         aggSig.VerifyInsecureAggregated(pubKeys, msgHashes);
     }
@@ -167,7 +233,7 @@ static void BLSVerify_LargeBlockSelfAggregated10000(benchmark::State& state)
     BLSVerify_LargeBlockSelfAggregated(10000, state);
 }
 
-static void BLSVerify_LargeAggregatedBlock(size_t txCount, benchmark::State& state)
+static void BLSVerify_LargeAggregatedBlock(size_t txCount, bool cached, benchmark::State& state)
 {
     BLSPublicKeyVector pubKeys;
     BLSSecretKeyVector secKeys;
@@ -178,20 +244,30 @@ static void BLSVerify_LargeAggregatedBlock(size_t txCount, benchmark::State& sta
 
     CBLSSignature aggSig = CBLSSignature::AggregateInsecure(sigs);
 
-    // Benchmark.
+    // Benchmark. The cached variant only verifies in the first round
     while (state.KeepRunning()) {
+        if (!cached) {
+            state.PauseTiming();
+            blsVerifiedSigsCache.Clear();
+            state.ResumeTiming();
+        }
         aggSig.VerifyInsecureAggregated(pubKeys, msgHashes);
     }
 }
 
 static void BLSVerify_LargeAggregatedBlock1000(benchmark::State& state)
 {
-    BLSVerify_LargeAggregatedBlock(1000, state);
+    BLSVerify_LargeAggregatedBlock(1000, false, state);
 }
 
 static void BLSVerify_LargeAggregatedBlock10000(benchmark::State& state)
 {
-    BLSVerify_LargeAggregatedBlock(10000, state);
+    BLSVerify_LargeAggregatedBlock(10000, false, state);
+}
+
+static void BLSVerify_LargeAggregatedBlock1000Cached(benchmark::State& state)
+{
+    BLSVerify_LargeAggregatedBlock(1000, true, state);
 }
 
 static void BLSVerify_LargeAggregatedBlock1000PreVerified(benchmark::State& state)
@@ -217,6 +293,10 @@ static void BLSVerify_LargeAggregatedBlock1000PreVerified(benchmark::State& stat
 
     // Benchmark.
     while (state.KeepRunning()) {
+        state.PauseTiming();
+        blsVerifiedSigsCache.Clear();
+        state.ResumeTiming();
+
         BLSPublicKeyVector nonvalidatedPubKeys;
         std::vector<uint256> nonvalidatedHashes;
         nonvalidatedPubKeys.reserve(pubKeys.size());
@@ -259,6 +339,10 @@ static void BLSVerify_Batched(benchmark::State& state)
             continue;
         }
 
+        state.PauseTiming();
+        blsVerifiedSigsCache.Clear();
+        state.ResumeTiming();
+
         BLSPublicKeyVector testPubKeys;
         BLSSignatureVector testSigs;
         std::vector<uint256> testMsgHashes;
@@ -296,6 +380,53 @@ static void BLSVerify_Batched(benchmark::State& state)
     }
 }
 
+static void BLSVerify_BatchedBisect(benchmark::State& state)
+{
+    BLSPublicKeyVector pubKeys;
+    BLSSecretKeyVector secKeys;
+    BLSSignatureVector sigs;
+    std::vector<uint256> msgHashes;
+    std::vector<bool> invalid;
+    BuildTestVectors(1000, 10, pubKeys, secKeys, sigs, msgHashes, invalid);
+
+    // Benchmark.
+    size_t i = 0;
+    size_t j = 0;
+    size_t batchSize = 16;
+    while (state.KeepRunning()) {
+        j++;
+        if ((j % batchSize) != 0) {
+            continue;
+        }
+
+        state.PauseTiming();
+        blsVerifiedSigsCache.Clear();
+        state.ResumeTiming();
+
+        BLSPublicKeyVector testPubKeys;
+        BLSSignatureVector testSigs;
+        std::vector<uint256> testMsgHashes;
+        testPubKeys.reserve(batchSize);
+        testSigs.reserve(batchSize);
+        testMsgHashes.reserve(batchSize);
+        size_t startI = i;
+        for (size_t k = 0; k < batchSize; k++) {
+            testPubKeys.emplace_back(pubKeys[i]);
+            testSigs.emplace_back(sigs[i]);
+            testMsgHashes.emplace_back(msgHashes[i]);
+            i = (i + 1) % pubKeys.size();
+        }
+
+        auto valid = BLSVerifyBatch(testSigs, testPubKeys, testMsgHashes);
+        for (size_t k = 0; k < batchSize; k++) {
+            if (valid[k] == invalid[(startI + k) % pubKeys.size()]) {
+                std::cout << "unexpected verification result" << std::endl;
+                assert(false);
+            }
+        }
+    }
+}
+
 static void BLSVerify_BatchedParallel(benchmark::State& state)
 {
     BLSPublicKeyVector pubKeys;
@@ -347,11 +478,16 @@ BENCHMARK(BLSPubKeyAggregate_Normal)
 BENCHMARK(BLSSecKeyAggregate_Normal)
 BENCHMARK(BLSSign_Normal)
 BENCHMARK(BLSVerify_Normal)
+BENCHMARK(BLSPubKeyDeserialize_Uncached)
+BENCHMARK(BLSPubKeyDeserialize_Cached)
+BENCHMARK(BLSVerify_Cached)
 BENCHMARK(BLSVerify_LargeBlock1000)
 BENCHMARK(BLSVerify_LargeBlockSelfAggregated1000)
 BENCHMARK(BLSVerify_LargeBlockSelfAggregated10000)
 BENCHMARK(BLSVerify_LargeAggregatedBlock1000)
 BENCHMARK(BLSVerify_LargeAggregatedBlock10000)
+BENCHMARK(BLSVerify_LargeAggregatedBlock1000Cached)
 BENCHMARK(BLSVerify_LargeAggregatedBlock1000PreVerified)
 BENCHMARK(BLSVerify_Batched)
+BENCHMARK(BLSVerify_BatchedBisect)
 BENCHMARK(BLSVerify_BatchedParallel)
@@ -5,6 +5,8 @@
 #include "bench.h"
 #include "random.h"
 #include "bls/bls_worker.h"
+#include "ctpl.h"
+#include "workstealingpool.h"
 
 extern CBLSWorker blsWorker;
 
@@ -112,7 +114,9 @@ struct DKG
 };
 
 std::shared_ptr<DKG> dkg10;
+std::shared_ptr<DKG> dkg50;
 std::shared_ptr<DKG> dkg100;
+std::shared_ptr<DKG> dkg200;
 std::shared_ptr<DKG> dkg400;
 
 void InitIfNeeded()
@@ -120,9 +124,15 @@ void InitIfNeeded()
     if (dkg10 == nullptr) {
         dkg10 = std::make_shared<DKG>(10);
     }
+    if (dkg50 == nullptr) {
+        dkg50 = std::make_shared<DKG>(50);
+    }
     if (dkg100 == nullptr) {
         dkg100 = std::make_shared<DKG>(100);
     }
+    if (dkg200 == nullptr) {
+        dkg200 = std::make_shared<DKG>(200);
+    }
     if (dkg400 == nullptr) {
         dkg400 = std::make_shared<DKG>(400);
     }
@@ -131,10 +141,91 @@ void InitIfNeeded()
 void CleanupBLSDkgTests()
 {
     dkg10.reset();
+    dkg50.reset();
     dkg100.reset();
+    dkg200.reset();
     dkg400.reset();
 }
 
+///////////////////////////////
+
+// Compares the old ctpl::thread_pool with CWorkStealingPool on the kind of fan-out CBLSWorker does when building the
+// quorum verification vector: every column of the vvecs is aggregated in batches of 8, one small job per batch
+static const int POOL_BENCH_THREADS = 4;
+
+template <typename F>
+static std::future<CBLSPublicKey> PushToPool(ctpl::thread_pool& pool, F&& f)
+{
+    return pool.push(f);
+}
+
+template <typename F>
+static std::future<CBLSPublicKey> PushToPool(CWorkStealingPool& pool, F&& f)
+{
+    return pool.Push(f);
+}
+
+template <typename Pool>
+static void FanOutAggregateVvecs(Pool& pool, const std::vector<BLSVerificationVectorPtr>& vvecs)
+{
+    const size_t batchSize = 8;
+    size_t columns = vvecs[0]->size();
+
+    std::vector<std::future<CBLSPublicKey> > futures;
+    futures.reserve(columns * (vvecs.size() / batchSize + 1));
+    for (size_t i = 0; i < columns; i++) {
+        for (size_t start = 0; start < vvecs.size(); start += batchSize) {
+            size_t count = std::min(batchSize, vvecs.size() - start);
+            futures.emplace_back(PushToPool(pool, [&vvecs, i, start, count](int threadId) {
+                CBLSPublicKey r = (*vvecs[start])[i];
+                for (size_t j = 1; j < count; j++) {
+                    r.AggregateInsecure((*vvecs[start + j])[i]);
+                }
+                return r;
+            }));
+        }
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
+}
+
+static void BenchPoolFanOut_ctpl(benchmark::State& state, DKG& dkg)
+{
+    dkg.ReceiveVvecs();
+    ctpl::thread_pool pool(POOL_BENCH_THREADS);
+    while (state.KeepRunning()) {
+        FanOutAggregateVvecs(pool, dkg.receivedVvecs);
+    }
+    pool.stop(true);
+}
+
+static void BenchPoolFanOut_workstealing(benchmark::State& state, DKG& dkg)
+{
+    dkg.ReceiveVvecs();
+    CWorkStealingPool pool;
+    pool.Start(POOL_BENCH_THREADS, "bench-pool");
+    while (state.KeepRunning()) {
+        FanOutAggregateVvecs(pool, dkg.receivedVvecs);
+    }
+    pool.Stop(true);
+}
+
+#define BENCH_PoolFanOut(pool, quorumSize) \
+    static void BLSDKG_PoolFanOut_##pool##_##quorumSize(benchmark::State& state) \
+    { \
+        InitIfNeeded(); \
+        BenchPoolFanOut_##pool(state, *dkg##quorumSize); \
+    } \
+    BENCHMARK(BLSDKG_PoolFanOut_##pool##_##quorumSize)
+
+BENCH_PoolFanOut(ctpl, 50)
+BENCH_PoolFanOut(ctpl, 200)
+BENCH_PoolFanOut(ctpl, 400)
+BENCH_PoolFanOut(workstealing, 50)
+BENCH_PoolFanOut(workstealing, 200)
+BENCH_PoolFanOut(workstealing, 400)
+
 
 
 #define BENCH_BuildQuorumVerificationVectors(name, quorumSize, parallel) \
@@ -146,10 +237,14 @@ void CleanupBLSDkgTests()
     BENCHMARK(BLSDKG_BuildQuorumVerificationVectors_##name##_##quorumSize)
 
 BENCH_BuildQuorumVerificationVectors(simple, 10, false)
+BENCH_BuildQuorumVerificationVectors(simple, 50, false)
 BENCH_BuildQuorumVerificationVectors(simple, 100, false)
+BENCH_BuildQuorumVerificationVectors(simple, 200, false)
 BENCH_BuildQuorumVerificationVectors(simple, 400, false)
 BENCH_BuildQuorumVerificationVectors(parallel, 10, true)
+BENCH_BuildQuorumVerificationVectors(parallel, 50, true)
 BENCH_BuildQuorumVerificationVectors(parallel, 100, true)
+BENCH_BuildQuorumVerificationVectors(parallel, 200, true)
 BENCH_BuildQuorumVerificationVectors(parallel, 400, true)
 
 ///////////////////////////////
@@ -173,9 +268,13 @@ BENCH_VerifyContributionShares(aggregated, 100, 5, false, true)
 BENCH_VerifyContributionShares(aggregated, 400, 5, false, true)
 
 BENCH_VerifyContributionShares(parallel, 10, 5, true, false)
+BENCH_VerifyContributionShares(parallel, 50, 5, true, false)
 BENCH_VerifyContributionShares(parallel, 100, 5, true, false)
+BENCH_VerifyContributionShares(parallel, 200, 5, true, false)
 BENCH_VerifyContributionShares(parallel, 400, 5, true, false)
 
 BENCH_VerifyContributionShares(parallel_aggregated, 10, 5, true, true)
+BENCH_VerifyContributionShares(parallel_aggregated, 50, 5, true, true)
 BENCH_VerifyContributionShares(parallel_aggregated, 100, 5, true, true)
+BENCH_VerifyContributionShares(parallel_aggregated, 200, 5, true, true)
 BENCH_VerifyContributionShares(parallel_aggregated, 400, 5, true, true)
@@ -5,6 +5,7 @@
 #include "bench.h"
 #include "wallet/wallet.h"
 #include "masternode.h"
+#include "random.h"
 
 #include <boost/foreach.hpp>
 #include <set>
@@ -58,4 +59,47 @@ static void CoinSelection(benchmark::State& state)
     }
 }
 
+// Big wallets: nCoins coins of random value in one tx, target is the sum of three of them so that there is a set
+// which needs no change. Every iteration builds the sorted index once (like SelectCoins does) and selects from it.
+static void CoinSelectionBig(benchmark::State& state, size_t nCoins)
+{
+    const CWallet wallet;
+    LOCK(wallet.cs_wallet);
+
+    FastRandomContext rand(true);
+    CMutableTransaction tx;
+    tx.vout.resize(nCoins);
+    for (auto& txout : tx.vout) {
+        txout.nValue = 1000 + rand.rand32() % COIN;
+    }
+    CAmount nTarget = tx.vout[0].nValue + tx.vout[nCoins / 2].nValue + tx.vout[nCoins - 1].nValue;
+    CWalletTx wtx(&wallet, MakeTransactionRef(std::move(tx)));
+
+    std::vector<COutput> vCoins;
+    vCoins.reserve(nCoins);
+    for (size_t i = 0; i < nCoins; i++) {
+        vCoins.emplace_back(&wtx, i, 6 * 24, true, true);
+    }
+
+    // exact matches only, like the branch and bound search without fees
+    CCoinSelectionParams params;
+    params.nMaxExcess = 0;
+
+    while (state.KeepRunning()) {
+        std::set<std::pair<const CWalletTx*, unsigned int> > setCoinsRet;
+        CAmount nValueRet;
+        CCoinSelectionIndex coins(vCoins);
+        bool success = wallet.SelectCoinsMinConf(nTarget, 1, 6, 0, coins, setCoinsRet, nValueRet, ALL_COINS, false, params);
+        assert(success);
+        assert(nValueRet >= nTarget);
+    }
+}
+
+static void CoinSelection_10k(benchmark::State& state) { CoinSelectionBig(state, 10000); }
+static void CoinSelection_100k(benchmark::State& state) { CoinSelectionBig(state, 100000); }
+static void CoinSelection_1M(benchmark::State& state) { CoinSelectionBig(state, 1000000); }
+
 BENCHMARK(CoinSelection);
+BENCHMARK(CoinSelection_10k);
+BENCHMARK(CoinSelection_100k);
+BENCHMARK(CoinSelection_1M);
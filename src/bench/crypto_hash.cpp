@@ -70,6 +70,37 @@ static void HASH_DSHA256_0032b(benchmark::State& state)
     }
 }
 
+/* Runs a SHA256 benchmark with the backends restricted to impl, the name says which backend was requested.
+   If the CPU or the build lacks it the benchmark measures the best of what is left. */
+template<sha256_implementation::UseImplementation impl>
+static void HASH_SHA256_Backend(benchmark::State& state)
+{
+    SHA256AutoDetect(impl);
+    uint8_t hash[CSHA256::OUTPUT_SIZE];
+    std::vector<uint8_t> in(BUFFER_SIZE,0);
+    while (state.KeepRunning())
+        CSHA256().Write(in.data(), in.size()).Finalize(hash);
+    SHA256AutoDetect();
+}
+
+template<sha256_implementation::UseImplementation impl>
+static void HASH_SHA256D64_1024_Backend(benchmark::State& state)
+{
+    SHA256AutoDetect(impl);
+    std::vector<uint8_t> in(64 * 1024, 0);
+    while (state.KeepRunning())
+        SHA256D64(in.data(), in.data(), 1024);
+    SHA256AutoDetect();
+}
+
+static void HASH_SHA256_standard(benchmark::State& state) { HASH_SHA256_Backend<sha256_implementation::STANDARD>(state); }
+static void HASH_SHA256_shani(benchmark::State& state) { HASH_SHA256_Backend<sha256_implementation::USE_SHANI>(state); }
+static void HASH_SHA256D64_1024_standard(benchmark::State& state) { HASH_SHA256D64_1024_Backend<sha256_implementation::STANDARD>(state); }
+static void HASH_SHA256D64_1024_sse4(benchmark::State& state) { HASH_SHA256D64_1024_Backend<sha256_implementation::USE_SSE4>(state); }
+static void HASH_SHA256D64_1024_avx2(benchmark::State& state) { HASH_SHA256D64_1024_Backend<sha256_implementation::USE_AVX2>(state); }
+static void HASH_SHA256D64_1024_shani(benchmark::State& state) { HASH_SHA256D64_1024_Backend<sha256_implementation::USE_SHANI>(state); }
+static void HASH_SHA256D64_1024(benchmark::State& state) { HASH_SHA256D64_1024_Backend<sha256_implementation::USE_ALL>(state); }
+
 static void HASH_SHA512(benchmark::State& state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -193,6 +224,14 @@ BENCHMARK(HASH_DSHA256);
 BENCHMARK(HASH_SHA512);
 BENCHMARK(HASH_X11);
 
+BENCHMARK(HASH_SHA256_standard);
+BENCHMARK(HASH_SHA256_shani);
+BENCHMARK(HASH_SHA256D64_1024_standard);
+BENCHMARK(HASH_SHA256D64_1024_sse4);
+BENCHMARK(HASH_SHA256D64_1024_avx2);
+BENCHMARK(HASH_SHA256D64_1024_shani);
+BENCHMARK(HASH_SHA256D64_1024);
+
 BENCHMARK(HASH_SHA256_0032b);
 BENCHMARK(HASH_DSHA256_0032b);
 BENCHMARK(HASH_SipHash_0032b);
@@ -0,0 +1,84 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "random.h"
+#include "evo/deterministicmns.h"
+
+static CDeterministicMNList BuildMNList(size_t count)
+{
+    CDeterministicMNList mnList(GetRandHash(), 1);
+    for (size_t i = 0; i < count; i++) {
+        auto dmn = std::make_shared<CDeterministicMN>();
+        dmn->proTxHash = GetRandHash();
+        dmn->collateralOutpoint = COutPoint(GetRandHash(), 0);
+        dmn->nOperatorReward = 0;
+
+        auto state = std::make_shared<CDeterministicMNState>();
+        state->nRegisteredHeight = 1;
+        uint256 ownerHash = GetRandHash();
+        state->keyIDOwner = CKeyID(uint160(std::vector<unsigned char>(ownerHash.begin(), ownerHash.begin() + 20)));
+        state->UpdateConfirmedHash(dmn->proTxHash, GetRandHash());
+        dmn->pdmnState = state;
+
+        mnList.AddMN(dmn);
+    }
+    return mnList;
+}
+
+static void CalculateQuorum(benchmark::State& state, size_t mnCount, size_t quorumSize, bool sameModifier)
+{
+    auto mnList = BuildMNList(mnCount);
+    uint256 modifier = GetRandHash();
+
+    while (state.KeepRunning()) {
+        if (!sameModifier) {
+            modifier = GetRandHash();
+        }
+        auto quorum = mnList.CalculateQuorum(quorumSize, modifier);
+        assert(quorum.size() == std::min(mnCount, quorumSize));
+    }
+}
+
+static void CalculateScores(benchmark::State& state, size_t mnCount, bool sameModifier)
+{
+    auto mnList = BuildMNList(mnCount);
+    uint256 modifier = GetRandHash();
+
+    while (state.KeepRunning()) {
+        if (!sameModifier) {
+            modifier = GetRandHash();
+        }
+        auto scores = mnList.CalculateScores(modifier);
+        assert(scores.size() == mnCount);
+    }
+}
+
+#define BENCH_CalculateQuorum(name, mnCount, quorumSize, sameModifier) \
+    static void DMN_CalculateQuorum_##name##_##mnCount##_##quorumSize(benchmark::State& state) \
+    { \
+        CalculateQuorum(state, mnCount, quorumSize, sameModifier); \
+    } \
+    BENCHMARK(DMN_CalculateQuorum_##name##_##mnCount##_##quorumSize)
+
+#define BENCH_CalculateScores(name, mnCount, sameModifier) \
+    static void DMN_CalculateScores_##name##_##mnCount(benchmark::State& state) \
+    { \
+        CalculateScores(state, mnCount, sameModifier); \
+    } \
+    BENCHMARK(DMN_CalculateScores_##name##_##mnCount)
+
+BENCH_CalculateQuorum(uncached, 1000, 50, false)
+BENCH_CalculateQuorum(uncached, 1000, 400, false)
+BENCH_CalculateQuorum(uncached, 10000, 50, false)
+BENCH_CalculateQuorum(uncached, 10000, 400, false)
+BENCH_CalculateQuorum(cached, 1000, 50, true)
+BENCH_CalculateQuorum(cached, 1000, 400, true)
+BENCH_CalculateQuorum(cached, 10000, 50, true)
+BENCH_CalculateQuorum(cached, 10000, 400, true)
+
+BENCH_CalculateScores(uncached, 1000, false)
+BENCH_CalculateScores(uncached, 10000, false)
+BENCH_CalculateScores(cached, 1000, true)
+BENCH_CalculateScores(cached, 10000, true)
@@ -0,0 +1,96 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "instantx.h"
+#include "random.h"
+#include "shardedmap.h"
+#include "sync.h"
+#include "util.h"
+
+#include <thread>
+
+// Replays a synthetic stream of TXLOCKVOTEs the way peers deliver them: for every vote a node sees the inv
+// (AlreadyHave), the vote itself (dedup insert into mapTxLockVotes) and getdata requests from other peers it relays
+// the vote to (GetTxLockVote). Every vote is delivered by several peers and all message handling threads replay the
+// stream concurrently. Divide VOTES by the time per iteration to get votes/s.
+static const size_t VOTES = 20000;
+static const int PEERS_PER_VOTE = 3;
+static const int MIN_THREADS = 2;
+
+static std::vector<std::pair<uint256, CTxLockVote> > CreateVotes()
+{
+    std::vector<std::pair<uint256, CTxLockVote> > vecVotes;
+    vecVotes.reserve(VOTES);
+    for (size_t i = 0; i < VOTES; i++) {
+        // 10 votes per tx input, 2 inputs per tx, similar to what a quorum sends for a real lock request
+        uint256 txHash = ArithToUint256(arith_uint256(i / 20 + 1));
+        CTxLockVote vote(txHash, COutPoint(txHash, (i / 10) % 2), COutPoint(GetRandHash(), 0), uint256(), uint256());
+        vecVotes.emplace_back(vote.GetHash(), vote);
+    }
+    return vecVotes;
+}
+
+template<typename ProcessVote>
+static void ReplayVotes(const std::vector<std::pair<uint256, CTxLockVote> >& vecVotes, ProcessVote&& processVote)
+{
+    int nThreads = std::max(MIN_THREADS, GetNumCores());
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++) {
+        threads.emplace_back([&, t] {
+            for (int nPeer = 0; nPeer < PEERS_PER_VOTE; nPeer++) {
+                for (size_t i = t; i < vecVotes.size(); i += nThreads) {
+                    processVote(vecVotes[i].first, vecVotes[i].second);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+static void InstantSendVotes_Sharded(benchmark::State& state)
+{
+    auto vecVotes = CreateVotes();
+    CShardedMap<uint256, CTxLockVote, SaltedTxidHasher> mapTxLockVotes;
+
+    while (state.KeepRunning()) {
+        ReplayVotes(vecVotes, [&](const uint256& nVoteHash, const CTxLockVote& vote) {
+            if (mapTxLockVotes.HasKey(nVoteHash)) return;
+            if (!mapTxLockVotes.Insert(nVoteHash, vote)) return;
+            CTxLockVote voteRelayed;
+            mapTxLockVotes.Get(nVoteHash, voteRelayed);
+        });
+        mapTxLockVotes.Clear();
+    }
+}
+
+// Same stream against a std::map protected by a single lock, which is how CInstantSend stored votes before
+static void InstantSendVotes_SingleLock(benchmark::State& state)
+{
+    auto vecVotes = CreateVotes();
+    CCriticalSection cs;
+    std::map<uint256, CTxLockVote> mapTxLockVotes;
+
+    while (state.KeepRunning()) {
+        ReplayVotes(vecVotes, [&](const uint256& nVoteHash, const CTxLockVote& vote) {
+            {
+                LOCK(cs);
+                if (mapTxLockVotes.count(nVoteHash)) return;
+            }
+            {
+                LOCK(cs);
+                if (!mapTxLockVotes.emplace(nVoteHash, vote).second) return;
+            }
+            LOCK(cs);
+            CTxLockVote voteRelayed = mapTxLockVotes.find(nVoteHash)->second;
+        });
+        LOCK(cs);
+        mapTxLockVotes.clear();
+    }
+}
+
+BENCHMARK(InstantSendVotes_Sharded);
+BENCHMARK(InstantSendVotes_SingleLock);
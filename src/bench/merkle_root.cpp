@@ -0,0 +1,29 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "consensus/merkle.h"
+#include "crypto/common.h"
+#include "random.h"
+#include "uint256.h"
+
+static void MerkleRoot(benchmark::State& state)
+{
+    FastRandomContext rng(true);
+    std::vector<uint256> leaves;
+    leaves.resize(9001);
+    for (auto& item : leaves) {
+        for (unsigned char* p = item.begin(); p < item.end(); p += 4) {
+            WriteLE32(p, rng.rand32());
+        }
+    }
+    while (state.KeepRunning()) {
+        bool mutated = false;
+        uint256 hash = ComputeMerkleRoot(leaves, &mutated);
+        leaves[mutated] = hash;
+    }
+}
+
+BENCHMARK(MerkleRoot);
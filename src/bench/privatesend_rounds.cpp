@@ -0,0 +1,72 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "privatesend.h"
+#include "privatesend-client.h"
+#include "random.h"
+#include "wallet/wallet.h"
+
+// A mixing wallet with 100k denominated outputs: CHAINS chains of MAX_PRIVATESEND_ROUNDS txs, every tx spends the
+// previous output of its chain (plus an input of another participant) and creates one denominated output, so the
+// outputs are spread evenly over all possible round counts.
+static const int CHAINS = 100000 / MAX_PRIVATESEND_ROUNDS;
+
+static std::vector<COutPoint> CreateMixingWallet(CWallet& wallet)
+{
+    CPrivateSend::InitStandardDenominations();
+
+    CKey key;
+    key.MakeNewKey(true);
+    wallet.AddKeyPubKey(key, key.GetPubKey());
+    CScript scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+
+    std::vector<COutPoint> vOutpoints;
+    for (int nChain = 0; nChain < CHAINS; nChain++) {
+        COutPoint prevout(GetRandHash(), 0);
+        for (int nRound = 0; nRound < MAX_PRIVATESEND_ROUNDS; nRound++) {
+            CMutableTransaction tx;
+            tx.vin.emplace_back(prevout);
+            tx.vin.emplace_back(COutPoint(GetRandHash(), 0));
+            tx.vout.emplace_back(CPrivateSend::GetSmallestDenomination(), scriptPubKey);
+            CWalletTx wtx(&wallet, MakeTransactionRef(std::move(tx)));
+            wallet.LoadToWallet(wtx);
+            prevout = COutPoint(wtx.GetHash(), 0);
+            vOutpoints.push_back(prevout);
+        }
+    }
+    return vOutpoints;
+}
+
+// What happens on wallet load
+static void PrivateSendRounds_Bulk(benchmark::State& state)
+{
+    CWallet wallet;
+    LOCK(wallet.cs_wallet);
+    auto vOutpoints = CreateMixingWallet(wallet);
+
+    while (state.KeepRunning()) {
+        wallet.CalculatePrivateSendRounds();
+    }
+}
+
+// What AvailableCoins(ONLY_DENOMINATED) and the anonymized balances pay per output afterwards
+static void PrivateSendRounds_Cached(benchmark::State& state)
+{
+    CWallet wallet;
+    LOCK(wallet.cs_wallet);
+    auto vOutpoints = CreateMixingWallet(wallet);
+    wallet.CalculatePrivateSendRounds();
+
+    while (state.KeepRunning()) {
+        int nTotal = 0;
+        for (const auto& outpoint : vOutpoints) {
+            nTotal += wallet.GetRealOutpointPrivateSendRounds(outpoint);
+        }
+        assert(nTotal > 0);
+    }
+}
+
+BENCHMARK(PrivateSendRounds_Bulk);
+BENCHMARK(PrivateSendRounds_Cached);
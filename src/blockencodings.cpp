@@ -7,14 +7,13 @@
 #include "consensus/validation.h"
 #include "chainparams.h"
 #include "hash.h"
+#include "metrics.h"
 #include "random.h"
 #include "streams.h"
 #include "txmempool.h"
 #include "validation.h"
 #include "util.h"
 
-#include <unordered_map>
-
 #define MIN_TRANSACTION_SIZE (::GetSerializeSize(CTransaction(), SER_NETWORK, PROTOCOL_VERSION))
 
 CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block) :
@@ -47,7 +46,50 @@ uint64_t CBlockHeaderAndShortTxIDs::GetShortID(const uint256& txhash) const {
 
 
 
-ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn) {
+const uint64_t ShortTxIDTable::EMPTY;
+
+ShortTxIDTable::ShortTxIDTable(size_t nElements) :
+        salt(GetRand(std::numeric_limits<uint64_t>::max())) {
+    // Keep the load factor at or below 1/4 so that natural probe sequences stay far below MAX_PROBE
+    int bits = 4;
+    while (((size_t)1 << bits) < 4 * nElements)
+        bits++;
+    keys.assign((size_t)1 << bits, EMPTY);
+    values.resize((size_t)1 << bits);
+    shift = 64 - bits;
+}
+
+bool ShortTxIDTable::Insert(uint64_t shortid, uint16_t index) {
+    size_t mask = keys.size() - 1;
+    size_t slot = Slot(shortid);
+    for (size_t i = 0; i < MAX_PROBE; i++, slot = (slot + 1) & mask) {
+        if (keys[slot] == shortid)
+            return false;
+        if (keys[slot] == EMPTY) {
+            keys[slot] = shortid;
+            values[slot] = index;
+            count++;
+            return true;
+        }
+    }
+    return false;
+}
+
+int ShortTxIDTable::Find(uint64_t shortid) const {
+    size_t mask = keys.size() - 1;
+    size_t slot = Slot(shortid);
+    for (size_t i = 0; i < MAX_PROBE; i++, slot = (slot + 1) & mask) {
+        if (keys[slot] == shortid)
+            return values[slot];
+        if (keys[slot] == EMPTY)
+            return -1;
+    }
+    return -1;
+}
+
+
+
+ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const ExtraTxnList& extra_txn, const ExtraTxnList& lock_txn) {
     if (cmpctblock.header.IsNull() || (cmpctblock.shorttxids.empty() && cmpctblock.prefilledtxn.empty()))
         return READ_STATUS_INVALID;
     if (cmpctblock.shorttxids.size() + cmpctblock.prefilledtxn.size() > MaxBlockSize(true) / MIN_TRANSACTION_SIZE)
@@ -79,29 +121,20 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     // Because well-formed cmpctblock messages will have a (relatively) uniform distribution
     // of short IDs, any highly-uneven distribution of elements can be safely treated as a
     // READ_STATUS_FAILED.
-    std::unordered_map<uint64_t, uint16_t> shorttxids(cmpctblock.shorttxids.size());
+    ShortTxIDTable shorttxids(cmpctblock.shorttxids.size());
     uint16_t index_offset = 0;
     for (size_t i = 0; i < cmpctblock.shorttxids.size(); i++) {
         while (txn_available[i + index_offset])
             index_offset++;
-        shorttxids[cmpctblock.shorttxids[i]] = i + index_offset;
-        // To determine the chance that the number of entries in a bucket exceeds N,
-        // we use the fact that the number of elements in a single bucket is
-        // binomially distributed (with n = the number of shorttxids S, and p =
-        // 1 / the number of buckets), that in the worst case the number of buckets is
-        // equal to S (due to std::unordered_map having a default load factor of 1.0),
-        // and that the chance for any bucket to exceed N elements is at most
-        // buckets * (the chance that any given bucket is above N elements).
-        // Thus: P(max_elements_per_bucket > N) <= S * (1 - cdf(binomial(n=S,p=1/S), N)).
-        // If we assume blocks of up to 16000, allowing 12 elements per bucket should
-        // only fail once per ~1 million block transfers (per peer and connection).
-        if (shorttxids.bucket_size(shorttxids.bucket(cmpctblock.shorttxids[i])) > 12)
+        // The table is at most a quarter full, so with uniformly distributed short IDs the
+        // chance that any insert needs more than MAX_PROBE (32) probes is negligible even
+        // for blocks of 16000 transactions. A failed insert is either a short ID collision
+        // or a deliberately uneven set of short IDs.
+        // TODO: in the shortid-collision case, we should instead request both transactions
+        // which collided. Falling back to full-block-request here is overkill.
+        if (!shorttxids.Insert(cmpctblock.shorttxids[i], i + index_offset))
             return READ_STATUS_FAILED;
     }
-    // TODO: in the shortid-collision case, we should instead request both transactions
-    // which collided. Falling back to full-block-request here is overkill.
-    if (shorttxids.size() != cmpctblock.shorttxids.size())
-        return READ_STATUS_FAILED; // Short ID collision
 
     std::vector<bool> have_txn(txn_available.size());
     {
@@ -109,18 +142,18 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     const std::vector<std::pair<uint256, CTxMemPool::txiter> >& vTxHashes = pool->vTxHashes;
     for (size_t i = 0; i < vTxHashes.size(); i++) {
         uint64_t shortid = cmpctblock.GetShortID(vTxHashes[i].first);
-        std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
-        if (idit != shorttxids.end()) {
-            if (!have_txn[idit->second]) {
-                txn_available[idit->second] = vTxHashes[i].second->GetSharedTx();
-                have_txn[idit->second]  = true;
+        int idx = shorttxids.Find(shortid);
+        if (idx >= 0) {
+            if (!have_txn[idx]) {
+                txn_available[idx] = vTxHashes[i].second->GetSharedTx();
+                have_txn[idx]  = true;
                 mempool_count++;
             } else {
                 // If we find two mempool txn that match the short id, just request it.
                 // This should be rare enough that the extra bandwidth doesn't matter,
                 // but eating a round-trip due to FillBlock failure would be annoying
-                if (txn_available[idit->second]) {
-                    txn_available[idit->second].reset();
+                if (txn_available[idx]) {
+                    txn_available[idx].reset();
                     mempool_count--;
                 }
             }
@@ -133,15 +166,31 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     }
     }
 
+    extra_count = AddExtraTxn(cmpctblock, shorttxids, have_txn, extra_txn);
+    lock_count = AddExtraTxn(cmpctblock, shorttxids, have_txn, lock_txn);
+
+    LogPrint("cmpctblock", "Initialized PartiallyDownloadedBlock for block %s using a cmpctblock of size %lu\n", cmpctblock.header.GetHash().ToString(), GetSerializeSize(cmpctblock, SER_NETWORK, PROTOCOL_VERSION));
+
+    return READ_STATUS_OK;
+}
+
+size_t PartiallyDownloadedBlock::AddExtraTxn(const CBlockHeaderAndShortTxIDs& cmpctblock, const ShortTxIDTable& shorttxids, std::vector<bool>& have_txn, const ExtraTxnList& extra_txn) {
+    size_t count = 0;
     for (size_t i = 0; i < extra_txn.size(); i++) {
+        // Every time we run out of mempool entries we stop, see below
+        if (mempool_count == shorttxids.size())
+            break;
+        // Unused slots of a ring buffer
+        if (!extra_txn[i].second)
+            continue;
         uint64_t shortid = cmpctblock.GetShortID(extra_txn[i].first);
-        std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
-        if (idit != shorttxids.end()) {
-            if (!have_txn[idit->second]) {
-                txn_available[idit->second] = extra_txn[i].second;
-                have_txn[idit->second]  = true;
+        int idx = shorttxids.Find(shortid);
+        if (idx >= 0) {
+            if (!have_txn[idx]) {
+                txn_available[idx] = extra_txn[i].second;
+                have_txn[idx]  = true;
                 mempool_count++;
-                extra_count++;
+                count++;
             } else {
                 // If we find two mempool/extra txn that match the short id, just
                 // request it.
@@ -149,24 +198,19 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
                 // but eating a round-trip due to FillBlock failure would be annoying
                 // Note that we dont want duplication between extra_txn and mempool to
                 // trigger this case, so we compare hashes first
-                if (txn_available[idit->second] &&
-                        txn_available[idit->second]->GetHash() != extra_txn[i].second->GetHash()) {
-                    txn_available[idit->second].reset();
+                if (txn_available[idx] &&
+                        txn_available[idx]->GetHash() != extra_txn[i].second->GetHash()) {
+                    txn_available[idx].reset();
                     mempool_count--;
-                    extra_count--;
+                    // the dropped tx may have come from the mempool or an earlier list,
+                    // the counts only feed logs and metrics
+                    if (count)
+                        count--;
                 }
             }
         }
-        // Though ideally we'd continue scanning for the two-txn-match-shortid case,
-        // the performance win of an early exit here is too good to pass up and worth
-        // the extra risk.
-        if (mempool_count == shorttxids.size())
-            break;
     }
-
-    LogPrint("cmpctblock", "Initialized PartiallyDownloadedBlock for block %s using a cmpctblock of size %lu\n", cmpctblock.header.GetHash().ToString(), GetSerializeSize(cmpctblock, SER_NETWORK, PROTOCOL_VERSION));
-
-    return READ_STATUS_OK;
+    return count;
 }
 
 bool PartiallyDownloadedBlock::IsTxAvailable(size_t index) const {
@@ -209,7 +253,18 @@ ReadStatus PartiallyDownloadedBlock::FillBlock(CBlock& block, const std::vector<
         return READ_STATUS_CHECKBLOCK_FAILED;
     }
 
-    LogPrint("cmpctblock", "Successfully reconstructed block %s with %lu txn prefilled, %lu txn from mempool (incl at least %lu from extra pool) and %lu txn requested\n", hash.ToString(), prefilled_count, mempool_count, extra_count, vtx_missing.size());
+    static CMetricCounter& counterPrefilled = GetMetrics().Counter("cmpctblock_txn_prefilled");
+    static CMetricCounter& counterMempool = GetMetrics().Counter("cmpctblock_txn_mempool");
+    static CMetricCounter& counterExtra = GetMetrics().Counter("cmpctblock_txn_extra");
+    static CMetricCounter& counterLock = GetMetrics().Counter("cmpctblock_txn_lockpool");
+    static CMetricCounter& counterRequested = GetMetrics().Counter("cmpctblock_txn_requested");
+    counterPrefilled.Inc(prefilled_count);
+    counterMempool.Inc(mempool_count > extra_count + lock_count ? mempool_count - extra_count - lock_count : 0);
+    counterExtra.Inc(extra_count);
+    counterLock.Inc(lock_count);
+    counterRequested.Inc(vtx_missing.size());
+
+    LogPrint("cmpctblock", "Successfully reconstructed block %s with %lu txn prefilled, %lu txn from mempool (incl at least %lu from extra pool and %lu from lock pool) and %lu txn requested\n", hash.ToString(), prefilled_count, mempool_count, extra_count, lock_count, vtx_missing.size());
     if (vtx_missing.size() < 5) {
         for (const auto& tx : vtx_missing)
             LogPrint("cmpctblock", "Reconstructed block %s required tx %s\n", hash.ToString(), tx->GetHash().ToString());
@@ -191,17 +191,56 @@ public:
     }
 };
 
+/**
+ * Flat open addressing table from short ids to their index in the block, looked up once per mempool
+ * entry while reconstructing. Short ids are picked by the sender, so slots are chosen with a randomly
+ * salted mixing function, and an insert that would probe more than MAX_PROBE slots fails.
+ */
+class ShortTxIDTable {
+private:
+    static const uint64_t EMPTY = ~(uint64_t)0; // never a 48-bit short id
+    std::vector<uint64_t> keys;
+    std::vector<uint16_t> values;
+    uint64_t salt;
+    int shift;
+    size_t count = 0;
+
+    size_t Slot(uint64_t shortid) const {
+        // splitmix64 finalizer over the salted short id
+        uint64_t x = shortid ^ salt;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return (x ^ (x >> 31)) >> shift;
+    }
+public:
+    static const size_t MAX_PROBE = 32;
+
+    explicit ShortTxIDTable(size_t nElements);
+
+    // Fails if shortid is already present or its probe sequence is too long
+    bool Insert(uint64_t shortid, uint16_t index);
+    // Index stored for shortid, or -1
+    int Find(uint64_t shortid) const;
+    size_t size() const { return count; }
+};
+
+typedef std::vector<std::pair<uint256, CTransactionRef>> ExtraTxnList;
+
 class PartiallyDownloadedBlock {
 protected:
     std::vector<CTransactionRef> txn_available;
-    size_t prefilled_count = 0, mempool_count = 0, extra_count = 0;
+    size_t prefilled_count = 0, mempool_count = 0, extra_count = 0, lock_count = 0;
     CTxMemPool* pool;
+
+    size_t AddExtraTxn(const CBlockHeaderAndShortTxIDs& cmpctblock, const ShortTxIDTable& shorttxids, std::vector<bool>& have_txn, const ExtraTxnList& extra_txn);
 public:
     CBlockHeader header;
     PartiallyDownloadedBlock(CTxMemPool* poolIn) : pool(poolIn) {}
 
-    // extra_txn is a list of extra transactions to look at, in <hash, reference> form
-    ReadStatus InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn);
+    // extra_txn is a list of extra transactions to look at, in <hash, reference> form.
+    // lock_txn is the same for recently seen InstantSend lock requests and PrivateSend dstx
+    // transactions, which may have been rejected from or evicted out of the mempool.
+    ReadStatus InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const ExtraTxnList& extra_txn, const ExtraTxnList& lock_txn = ExtraTxnList());
     bool IsTxAvailable(size_t index) const;
     ReadStatus FillBlock(CBlock& block, const std::vector<CTransactionRef>& vtx_missing);
 };
@@ -15,6 +15,33 @@
 #include <assert.h>
 #include <string.h>
 
+// operator keys of all masternodes plus quorum/DKG keys comfortably fit into these
+CBLSCache<CBLSPublicKeyBytes, bls::PublicKey> blsPublicKeyCache(100000);
+CBLSCache<uint256, bool> blsVerifiedSigsCache(100000);
+
+uint256 GetBLSVerifiedSigCacheKey(const CBLSSignature& sig, const std::vector<CBLSPublicKey>& pubKeys, const std::vector<uint256>& hashes)
+{
+    assert(pubKeys.size() == hashes.size());
+
+    CHashWriter hw(SER_GETHASH, 0);
+    hw << sig.GetHash();
+    for (size_t i = 0; i < pubKeys.size(); i++) {
+        hw << pubKeys[i].GetHash();
+        hw << hashes[i];
+    }
+    return hw.GetHash();
+}
+
+uint256 GetBLSVerifiedSigCacheKey(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& hash)
+{
+    // same as for a single element vector
+    CHashWriter hw(SER_GETHASH, 0);
+    hw << sig.GetHash();
+    hw << pubKey.GetHash();
+    hw << hash;
+    return hw.GetHash();
+}
+
 bool CBLSId::InternalSetBuf(const void* buf)
 {
     memcpy(impl.begin(), buf, sizeof(uint256));
@@ -174,12 +201,21 @@ CBLSSignature CBLSSecretKey::Sign(const uint256& hash) const
 
 bool CBLSPublicKey::InternalSetBuf(const void* buf)
 {
+    // parsing a public key involves point decompression and is expensive, while the same operator keys are
+    // deserialized over and over again (votes, commitments, MN lists)
+    CBLSPublicKeyBytes key;
+    memcpy(key.data(), buf, key.size());
+    if (blsPublicKeyCache.Get(key, impl)) {
+        return true;
+    }
+
     try {
         impl = bls::PublicKey::FromBytes((const uint8_t*)buf);
-        return true;
     } catch (...) {
         return false;
     }
+    blsPublicKeyCache.Insert(key, impl);
+    return true;
 }
 
 bool CBLSPublicKey::InternalGetBuf(void* buf) const
@@ -338,11 +374,23 @@ bool CBLSSignature::VerifyInsecure(const CBLSPublicKey& pubKey, const uint256& h
         return false;
     }
 
+    uint256 cacheKey = GetBLSVerifiedSigCacheKey(*this, pubKey, hash);
+
+    bool tmp;
+    if (blsVerifiedSigsCache.Get(cacheKey, tmp)) {
+        return true;
+    }
+
+    bool valid;
     try {
-        return impl.Verify({(const uint8_t*)hash.begin()}, {pubKey.impl});
+        valid = impl.Verify({(const uint8_t*)hash.begin()}, {pubKey.impl});
     } catch (...) {
         return false;
     }
+    if (valid) {
+        blsVerifiedSigsCache.Insert(cacheKey, true);
+    }
+    return valid;
 }
 
 bool CBLSSignature::VerifyInsecureAggregated(const std::vector<CBLSPublicKey>& pubKeys, const std::vector<uint256>& hashes) const
@@ -365,11 +413,23 @@ bool CBLSSignature::VerifyInsecureAggregated(const std::vector<CBLSPublicKey>& p
         hashes2.push_back((uint8_t*)hashes[i].begin());
     }
 
+    uint256 cacheKey = GetBLSVerifiedSigCacheKey(*this, pubKeys, hashes);
+
+    bool tmp;
+    if (blsVerifiedSigsCache.Get(cacheKey, tmp)) {
+        return true;
+    }
+
+    bool valid;
     try {
-        return impl.Verify(hashes2, pubKeyVec);
+        valid = impl.Verify(hashes2, pubKeyVec);
     } catch (...) {
         return false;
     }
+    if (valid) {
+        blsVerifiedSigsCache.Insert(cacheKey, true);
+    }
+    return valid;
 }
 
 bool CBLSSignature::VerifySecureAggregated(const std::vector<CBLSPublicKey>& pks, const uint256& hash) const
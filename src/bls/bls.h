@@ -18,6 +18,10 @@
 #undef DOUBLE
 
 #include <array>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
 #include <unistd.h>
 
 // reversed BLS12-381
@@ -307,6 +311,90 @@ typedef std::shared_ptr<BLSPublicKeyVector> BLSPublicKeyVectorPtr;
 typedef std::shared_ptr<BLSSecretKeyVector> BLSSecretKeyVectorPtr;
 typedef std::shared_ptr<BLSSignatureVector> BLSSignatureVectorPtr;
 
+/**
+ * Bounded, thread safe cache used to avoid repeating expensive BLS operations. Keys are split into shards by their
+ * first byte so that concurrent users rarely contend on the same lock. Each shard evicts its oldest entries first.
+ */
+template <typename K, typename V>
+class CBLSCache
+{
+private:
+    static const size_t SHARD_COUNT = 16;
+
+    struct Shard {
+        std::mutex mutex;
+        std::map<K, V> entries;
+        std::deque<K> insertionOrder;
+    };
+
+    const size_t nMaxShardSize;
+    std::array<Shard, SHARD_COUNT> shards;
+
+    std::atomic<uint64_t> nHits{0};
+    std::atomic<uint64_t> nMisses{0};
+
+    Shard& GetShard(const K& key)
+    {
+        return shards[*key.begin() % SHARD_COUNT];
+    }
+
+public:
+    explicit CBLSCache(size_t nMaxSize) :
+        nMaxShardSize(std::max(nMaxSize / SHARD_COUNT, (size_t)1))
+    {
+    }
+
+    bool Get(const K& key, V& valueRet)
+    {
+        Shard& shard = GetShard(key);
+        std::unique_lock<std::mutex> l(shard.mutex);
+        auto it = shard.entries.find(key);
+        if (it == shard.entries.end()) {
+            nMisses++;
+            return false;
+        }
+        nHits++;
+        valueRet = it->second;
+        return true;
+    }
+
+    void Insert(const K& key, const V& value)
+    {
+        Shard& shard = GetShard(key);
+        std::unique_lock<std::mutex> l(shard.mutex);
+        if (!shard.entries.emplace(key, value).second) {
+            return;
+        }
+        shard.insertionOrder.emplace_back(key);
+        if (shard.insertionOrder.size() > nMaxShardSize) {
+            shard.entries.erase(shard.insertionOrder.front());
+            shard.insertionOrder.pop_front();
+        }
+    }
+
+    void Clear()
+    {
+        for (auto& shard : shards) {
+            std::unique_lock<std::mutex> l(shard.mutex);
+            shard.entries.clear();
+            shard.insertionOrder.clear();
+        }
+    }
+
+    uint64_t GetHits() const { return nHits; }
+    uint64_t GetMisses() const { return nMisses; }
+};
+
+// parsed public keys, keyed by their serialized form
+typedef std::array<uint8_t, BLS_CURVE_PUBKEY_SIZE> CBLSPublicKeyBytes;
+extern CBLSCache<CBLSPublicKeyBytes, bls::PublicKey> blsPublicKeyCache;
+// keys of signatures which were successfully verified, see GetBLSVerifiedSigCacheKey
+extern CBLSCache<uint256, bool> blsVerifiedSigsCache;
+
+// key of a signature over the given messages in blsVerifiedSigsCache, pubKeys and hashes must have the same size
+uint256 GetBLSVerifiedSigCacheKey(const CBLSSignature& sig, const std::vector<CBLSPublicKey>& pubKeys, const std::vector<uint256>& hashes);
+uint256 GetBLSVerifiedSigCacheKey(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& hash);
+
 bool BLSInit();
 
 #endif // DASH_CRYPTO_BLS_H
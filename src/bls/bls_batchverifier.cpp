@@ -0,0 +1,101 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bls_batchverifier.h"
+
+#include "utiltime.h"
+
+CBLSSigVerifyStats blsSigVerifyStats;
+
+void CBLSSigVerifyStats::AddBatch(size_t nBatchSize, size_t nChecks, size_t nInvalid, int64_t nTimeMicros)
+{
+    nBatches++;
+    nSigs += nBatchSize;
+    nInvalidSigs += nInvalid;
+    nAggregatedChecks += nChecks;
+    nTotalTimeMicros += nTimeMicros;
+
+    uint64_t nMax = nMaxBatchSize;
+    while (nBatchSize > nMax && !nMaxBatchSize.compare_exchange_weak(nMax, nBatchSize)) {
+    }
+}
+
+static void VerifyBatchRange(const std::vector<CBLSSignature>& sigs, const std::vector<CBLSPublicKey>& pubKeys, const std::vector<uint256>& msgHashes,
+                             const std::vector<size_t>& indexes, size_t start, size_t count,
+                             std::vector<bool>& result, size_t& nChecksRet)
+{
+    nChecksRet++;
+
+    if (count == 1) {
+        size_t idx = indexes[start];
+        result[idx] = sigs[idx].VerifyInsecure(pubKeys[idx], msgHashes[idx]);
+        return;
+    }
+
+    CBLSSignature aggSig = sigs[indexes[start]];
+    std::vector<CBLSPublicKey> pubKeys2;
+    std::vector<uint256> msgHashes2;
+    pubKeys2.reserve(count);
+    msgHashes2.reserve(count);
+    for (size_t i = start; i < start + count; i++) {
+        size_t idx = indexes[i];
+        if (i != start) {
+            aggSig.AggregateInsecure(sigs[idx]);
+        }
+        pubKeys2.emplace_back(pubKeys[idx]);
+        msgHashes2.emplace_back(msgHashes[idx]);
+    }
+
+    if (aggSig.VerifyInsecureAggregated(pubKeys2, msgHashes2)) {
+        // a passing aggregate is no proof for the single signatures, as two invalid signatures can cancel each other
+        // out. This would need random coefficients per signature, which the BLS wrapper can't apply (no scalar
+        // multiplication), so every signature of a passing range is still verified alone
+        for (size_t i = start; i < start + count; i++) {
+            size_t idx = indexes[i];
+            result[idx] = sigs[idx].VerifyInsecure(pubKeys[idx], msgHashes[idx]);
+        }
+        return;
+    }
+
+    // at least one sig is invalid, bisect to find it
+    size_t half = count / 2;
+    VerifyBatchRange(sigs, pubKeys, msgHashes, indexes, start, half, result, nChecksRet);
+    VerifyBatchRange(sigs, pubKeys, msgHashes, indexes, start + half, count - half, result, nChecksRet);
+}
+
+std::vector<bool> BLSVerifyBatch(const std::vector<CBLSSignature>& sigs, const std::vector<CBLSPublicKey>& pubKeys, const std::vector<uint256>& msgHashes)
+{
+    assert(sigs.size() == pubKeys.size() && sigs.size() == msgHashes.size());
+
+    int64_t nStartTime = GetTimeMicros();
+
+    std::vector<bool> result(sigs.size(), false);
+
+    // invalid (unparsable) keys and sigs can't be aggregated, so they are marked as invalid right away. Signatures
+    // which were verified before don't need to be part of the aggregated verification. Only signatures verified
+    // alone are added to the cache and marked as valid, see VerifyBatchRange.
+    std::vector<size_t> indexes;
+    indexes.reserve(sigs.size());
+    for (size_t i = 0; i < sigs.size(); i++) {
+        if (!sigs[i].IsValid() || !pubKeys[i].IsValid()) {
+            continue;
+        }
+        bool tmp;
+        if (blsVerifiedSigsCache.Get(GetBLSVerifiedSigCacheKey(sigs[i], pubKeys[i], msgHashes[i]), tmp)) {
+            result[i] = true;
+        } else {
+            indexes.emplace_back(i);
+        }
+    }
+
+    size_t nChecks = 0;
+    if (!indexes.empty()) {
+        VerifyBatchRange(sigs, pubKeys, msgHashes, indexes, 0, indexes.size(), result, nChecks);
+    }
+
+    size_t nInvalid = std::count(result.begin(), result.end(), false);
+    blsSigVerifyStats.AddBatch(sigs.size(), nChecks, nInvalid, GetTimeMicros() - nStartTime);
+
+    return result;
+}
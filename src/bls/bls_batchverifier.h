@@ -0,0 +1,112 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DASH_CRYPTO_BLS_BATCHVERIFIER_H
+#define DASH_CRYPTO_BLS_BATCHVERIFIER_H
+
+#include "bls.h"
+
+#include <atomic>
+#include <map>
+#include <set>
+#include <vector>
+
+// Process wide counters for batched BLS signature verification
+struct CBLSSigVerifyStats
+{
+    std::atomic<uint64_t> nBatches{0};
+    std::atomic<uint64_t> nSigs{0};
+    std::atomic<uint64_t> nInvalidSigs{0};
+    // number of aggregated verifications (pairing checks), including the ones done while bisecting failed batches
+    std::atomic<uint64_t> nAggregatedChecks{0};
+    std::atomic<uint64_t> nMaxBatchSize{0};
+    std::atomic<uint64_t> nTotalTimeMicros{0};
+
+    void AddBatch(size_t nBatchSize, size_t nChecks, size_t nInvalid, int64_t nTimeMicros);
+};
+
+extern CBLSSigVerifyStats blsSigVerifyStats;
+
+// Verifies the signatures of a batch and returns which of them are valid. The aggregated verification (a single
+// multi-pairing over different messages) is only used as a filter: if it fails, the batch is split in halves
+// recursively to find the invalid signatures. A signature is only reported as valid after it was verified alone
+// (or was found in blsVerifiedSigsCache), as invalid signatures can cancel each other out in the aggregate.
+// The message hashes must be unique inside the batch, see CBLSBatchVerifier for a version that handles duplicates.
+std::vector<bool> BLSVerifyBatch(const std::vector<CBLSSignature>& sigs, const std::vector<CBLSPublicKey>& pubKeys, const std::vector<uint256>& msgHashes);
+
+// Collects signatures of different messages from different sources and verifies them all at once
+// Call Verify() after all messages were pushed. Afterwards badSources and badMessages contain the ids of all sources
+// and messages which had at least one invalid signature
+template <typename SourceId, typename MessageId>
+class CBLSBatchVerifier
+{
+private:
+    struct Message {
+        SourceId sourceId;
+        MessageId msgId;
+        uint256 msgHash;
+        CBLSSignature sig;
+        CBLSPublicKey pubKey;
+    };
+
+    std::vector<Message> messages;
+
+public:
+    std::set<SourceId> badSources;
+    std::set<MessageId> badMessages;
+
+public:
+    void PushMessage(const SourceId& sourceId, const MessageId& msgId, const uint256& msgHash, const CBLSSignature& sig, const CBLSPublicKey& pubKey)
+    {
+        messages.emplace_back(Message{sourceId, msgId, msgHash, sig, pubKey});
+    }
+
+    size_t GetMessageCount() const
+    {
+        return messages.size();
+    }
+
+    void Verify()
+    {
+        // aggregated verification does not allow duplicate message hashes, so we split the messages into as many
+        // batches as needed to keep every hash unique inside its batch. In most cases there is only one batch
+        std::vector<std::vector<size_t> > batches;
+        std::map<uint256, size_t> nextBatchForHash;
+        for (size_t i = 0; i < messages.size(); i++) {
+            size_t& batchIdx = nextBatchForHash[messages[i].msgHash];
+            if (batchIdx == batches.size()) {
+                batches.emplace_back();
+            }
+            batches[batchIdx].emplace_back(i);
+            batchIdx++;
+        }
+
+        for (const auto& batch : batches) {
+            std::vector<CBLSSignature> sigs;
+            std::vector<CBLSPublicKey> pubKeys;
+            std::vector<uint256> msgHashes;
+            sigs.reserve(batch.size());
+            pubKeys.reserve(batch.size());
+            msgHashes.reserve(batch.size());
+            for (size_t idx : batch) {
+                sigs.emplace_back(messages[idx].sig);
+                pubKeys.emplace_back(messages[idx].pubKey);
+                msgHashes.emplace_back(messages[idx].msgHash);
+            }
+
+            auto valid = BLSVerifyBatch(sigs, pubKeys, msgHashes);
+            for (size_t i = 0; i < batch.size(); i++) {
+                if (!valid[i]) {
+                    auto& m = messages[batch[i]];
+                    badSources.emplace(m.sourceId);
+                    badMessages.emplace(m.msgId);
+                }
+            }
+        }
+
+        messages.clear();
+    }
+};
+
+#endif //DASH_CRYPTO_BLS_BATCHVERIFIER_H
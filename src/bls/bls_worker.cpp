@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "bls_worker.h"
+#include "bls_batchverifier.h"
 #include "hash.h"
 #include "serialize.h"
 
@@ -53,9 +54,7 @@ CBLSWorker::CBLSWorker()
 {
     int workerCount = std::thread::hardware_concurrency() / 2;
     workerCount = std::max(std::min(1, workerCount), 4);
-    workerPool.resize(workerCount);
-
-    RenameThreadPool(workerPool, "bls-worker");
+    workerPool.Start(workerCount, "bls-worker");
 }
 
 CBLSWorker::~CBLSWorker()
@@ -65,8 +64,7 @@ CBLSWorker::~CBLSWorker()
 
 void CBLSWorker::Stop()
 {
-    workerPool.clear_queue();
-    workerPool.stop(true);
+    workerPool.Stop(false);
 }
 
 bool CBLSWorker::GenerateContributions(int quorumThreshold, const BLSIdVector& ids, BLSVerificationVectorPtr& vvecRet, BLSSecretKeyVector& skShares)
@@ -90,7 +88,7 @@ bool CBLSWorker::GenerateContributions(int quorumThreshold, const BLSIdVector& i
             }
             return true;
         };
-        futures.emplace_back(workerPool.push(f));
+        futures.emplace_back(workerPool.Push(f));
     }
 
     for (size_t i = 0; i < ids.size(); i += batchSize) {
@@ -104,7 +102,7 @@ bool CBLSWorker::GenerateContributions(int quorumThreshold, const BLSIdVector& i
             }
             return true;
         };
-        futures.emplace_back(workerPool.push(f));
+        futures.emplace_back(workerPool.Push(f));
     }
     bool success = true;
     for (auto& f : futures) {
@@ -131,7 +129,7 @@ struct Aggregator {
     std::shared_ptr<std::vector<const T*> > inputVec;
 
     bool parallel;
-    ctpl::thread_pool& workerPool;
+    CWorkStealingPool& workerPool;
 
     std::mutex m;
     // items in the queue are all intermediate aggregation results of finished batches.
@@ -150,7 +148,7 @@ struct Aggregator {
     Aggregator(const std::vector<TP>& _inputVec,
                size_t start, size_t count,
                bool _parallel,
-               ctpl::thread_pool& _workerPool,
+               CWorkStealingPool& _workerPool,
                DoneCallback _doneCallback) :
             workerPool(_workerPool),
             parallel(_parallel),
@@ -311,7 +309,7 @@ struct Aggregator {
     template <typename Callable>
     void PushWork(Callable&& f)
     {
-        workerPool.push(f);
+        workerPool.Push(f);
     }
 };
 
@@ -339,7 +337,7 @@ struct VectorAggregator {
     size_t start;
     size_t count;
     bool parallel;
-    ctpl::thread_pool& workerPool;
+    CWorkStealingPool& workerPool;
 
     std::atomic<size_t> doneCount;
 
@@ -348,7 +346,7 @@ struct VectorAggregator {
 
     VectorAggregator(const VectorVectorType& _vecs,
                      size_t _start, size_t _count,
-                     bool _parallel, ctpl::thread_pool& _workerPool,
+                     bool _parallel, CWorkStealingPool& _workerPool,
                      DoneCallback _doneCallback) :
             vecs(_vecs),
             parallel(_parallel),
@@ -419,7 +417,7 @@ struct ContributionVerifier {
     bool parallel;
     bool aggregated;
 
-    ctpl::thread_pool& workerPool;
+    CWorkStealingPool& workerPool;
 
     size_t batchCount;
     size_t verifyCount;
@@ -430,7 +428,7 @@ struct ContributionVerifier {
 
     ContributionVerifier(const CBLSId& _forId, const std::vector<BLSVerificationVectorPtr>& _vvecs,
                          const BLSSecretKeyVector& _skShares, size_t _batchSize,
-                         bool _parallel, bool _aggregated, ctpl::thread_pool& _workerPool,
+                         bool _parallel, bool _aggregated, CWorkStealingPool& _workerPool,
                          std::function<void(const std::vector<bool>&)> _doneCallback) :
         forId(_forId),
         vvecs(_vvecs),
@@ -587,7 +585,7 @@ struct ContributionVerifier {
     void PushOrDoWork(Callable&& f)
     {
         if (parallel) {
-            workerPool.push(std::move(f));
+            workerPool.Push(std::move(f));
         } else {
             f(0);
         }
@@ -629,7 +627,7 @@ BLSVerificationVectorPtr CBLSWorker::BuildQuorumVerificationVector(const std::ve
 }
 
 template <typename T>
-void AsyncAggregateHelper(ctpl::thread_pool& workerPool,
+void AsyncAggregateHelper(CWorkStealingPool& workerPool,
                           const std::vector<T>& vec, size_t start, size_t count, bool parallel,
                           std::function<void(const T&)> doneCallback)
 {
@@ -767,7 +765,7 @@ std::future<bool> CBLSWorker::AsyncVerifyContributionShare(const CBLSId& forId,
         CBLSPublicKey pk2 = skContribution.GetPublicKey();
         return pk1 == pk2;
     };
-    return workerPool.push(f);
+    return workerPool.Push(f);
 }
 
 bool CBLSWorker::VerifyContributionShare(const CBLSId& forId, const BLSVerificationVectorPtr& vvec,
@@ -829,7 +827,7 @@ bool CBLSWorker::VerifySignatureVector(const BLSSignatureVector& sigs, size_t st
 
 void CBLSWorker::AsyncSign(const CBLSSecretKey& secKey, const uint256& msgHash, CBLSWorker::SignDoneCallback doneCallback)
 {
-    workerPool.push([secKey, msgHash, doneCallback](int threadId) {
+    workerPool.Push([secKey, msgHash, doneCallback](int threadId) {
         doneCallback(secKey.Sign(msgHash));
     });
 }
@@ -889,25 +887,13 @@ void CBLSWorker::PushSigVerifyBatch()
 {
     auto f = [this](int threadId, std::shared_ptr<std::vector<SigVerifyJob> > _jobs) {
         auto& jobs = *_jobs;
-        if (jobs.size() == 1) {
-            auto& job = jobs[0];
-            if (!job.cancelCond()) {
-                bool valid = job.sig.VerifyInsecure(job.pubKey, job.msgHash);
-                job.doneCallback(valid);
-            }
-            std::unique_lock<std::mutex> l(sigVerifyMutex);
-            sigVerifyBatchesInProgress--;
-            if (!sigVerifyQueue.empty()) {
-                PushSigVerifyBatch();
-            }
-            return;
-        }
 
-        CBLSSignature aggSig;
         std::vector<size_t> indexes;
+        std::vector<CBLSSignature> sigs;
         std::vector<CBLSPublicKey> pubKeys;
         std::vector<uint256> msgHashes;
         indexes.reserve(jobs.size());
+        sigs.reserve(jobs.size());
         pubKeys.reserve(jobs.size());
         msgHashes.reserve(jobs.size());
         for (size_t i = 0; i < jobs.size(); i++) {
@@ -915,30 +901,17 @@ void CBLSWorker::PushSigVerifyBatch()
             if (job.cancelCond()) {
                 continue;
             }
-            if (pubKeys.empty()) {
-                aggSig = job.sig;
-            } else {
-                aggSig.AggregateInsecure(job.sig);
-            }
             indexes.emplace_back(i);
+            sigs.emplace_back(job.sig);
             pubKeys.emplace_back(job.pubKey);
             msgHashes.emplace_back(job.msgHash);
         }
 
-        if (!pubKeys.empty()) {
-            bool allValid = aggSig.VerifyInsecureAggregated(pubKeys, msgHashes);
-            if (allValid) {
-                for (size_t i = 0; i < pubKeys.size(); i++) {
-                    jobs[indexes[i]].doneCallback(true);
-                }
-            } else {
-                // one or more sigs were not valid, revert to per-sig verification
-                // TODO this could be improved if we would cache pairing results in some way as the previous aggregated verification already calculated all the pairings for the hashes
-                for (size_t i = 0; i < pubKeys.size(); i++) {
-                    auto& job = jobs[indexes[i]];
-                    bool valid = job.sig.VerifyInsecure(job.pubKey, job.msgHash);
-                    job.doneCallback(valid);
-                }
+        if (!indexes.empty()) {
+            // aggregated verification, bisects the batch if one or more sigs are invalid
+            auto valid = BLSVerifyBatch(sigs, pubKeys, msgHashes);
+            for (size_t i = 0; i < indexes.size(); i++) {
+                jobs[indexes[i]].doneCallback(valid[i]);
             }
         }
 
@@ -953,5 +926,5 @@ void CBLSWorker::PushSigVerifyBatch()
     sigVerifyQueue.reserve(SIG_VERIFY_BATCH_SIZE);
 
     sigVerifyBatchesInProgress++;
-    workerPool.push(f, batch);
+    workerPool.Push(f, batch);
 }
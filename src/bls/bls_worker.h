@@ -7,7 +7,7 @@
 
 #include "bls.h"
 
-#include "ctpl.h"
+#include "workstealingpool.h"
 
 #include <future>
 #include <mutex>
@@ -26,7 +26,7 @@ public:
     typedef std::function<bool()> CancelCond;
 
 private:
-    ctpl::thread_pool workerPool;
+    CWorkStealingPool workerPool;
 
     static const int SIG_VERIFY_BATCH_SIZE = 8;
     struct SigVerifyJob {
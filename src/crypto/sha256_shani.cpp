@@ -0,0 +1,94 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// SHA-256 transform using the Intel SHA extensions, following the layout of Intel's reference implementation.
+// This file is compiled with -msse4 -msha and only called after runtime detection (see SHA256AutoDetect).
+
+#ifdef ENABLE_SHANI
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace sha256_shani {
+namespace {
+
+alignas(16) static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+/** Four rounds with message words m, state0 holds ABEF and state1 CDGH */
+void inline QuadRound(__m128i& state0, __m128i& state1, __m128i m, int q)
+{
+    __m128i msg = _mm_add_epi32(m, _mm_load_si128((const __m128i*)(K + 4 * q)));
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+    state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+}
+
+/** Message words 16..63: m0 becomes the next four words from m0..m3 */
+void inline Schedule(__m128i& m0, __m128i m2, __m128i m3)
+{
+    m0 = _mm_sha256msg2_epu32(_mm_add_epi32(m0, _mm_alignr_epi8(m3, m2, 4)), m3);
+}
+
+} // namespace
+
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // rearrange the state into the ABEF/CDGH order expected by sha256rnds2
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)s), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(s + 4)), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    while (blocks--) {
+        const __m128i save0 = state0, save1 = state1;
+        __m128i m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)chunk), MASK);
+        __m128i m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + 16)), MASK);
+        __m128i m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + 32)), MASK);
+        __m128i m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + 48)), MASK);
+
+        QuadRound(state0, state1, m0, 0);
+        QuadRound(state0, state1, m1, 1);
+        m0 = _mm_sha256msg1_epu32(m0, m1);
+        QuadRound(state0, state1, m2, 2);
+        m1 = _mm_sha256msg1_epu32(m1, m2);
+        for (int q = 3; q < 15; q += 4) {
+            QuadRound(state0, state1, m3, q);
+            Schedule(m0, m2, m3);
+            m2 = _mm_sha256msg1_epu32(m2, m3);
+            QuadRound(state0, state1, m0, q + 1);
+            Schedule(m1, m3, m0);
+            m3 = _mm_sha256msg1_epu32(m3, m0);
+            QuadRound(state0, state1, m1, q + 2);
+            Schedule(m2, m0, m1);
+            if (q + 2 <= 12) m0 = _mm_sha256msg1_epu32(m0, m1);
+            QuadRound(state0, state1, m2, q + 3);
+            Schedule(m3, m1, m2);
+            if (q + 3 <= 12) m1 = _mm_sha256msg1_epu32(m1, m2);
+        }
+        QuadRound(state0, state1, m3, 15);
+
+        state0 = _mm_add_epi32(state0, save0);
+        state1 = _mm_add_epi32(state1, save1);
+        chunk += 64;
+    }
+
+    // back to ABCD/EFGH
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    _mm_storeu_si128((__m128i*)s, _mm_blend_epi16(tmp, state1, 0xF0));
+    _mm_storeu_si128((__m128i*)(s + 4), _mm_alignr_epi8(state1, tmp, 8));
+}
+
+} // namespace sha256_shani
+
+#endif
@@ -157,7 +157,11 @@ CDBWrapper::~CDBWrapper()
 
 bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
 {
-    leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
+    leveldb::Status status;
+    {
+        CScopedLatency latency(dbwrapper_private::histogramWrite);
+        status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
+    }
     dbwrapper_private::HandleError(status);
     return true;
 }
@@ -196,6 +200,9 @@ void CDBIterator::Next() { piter->Next(); }
 
 namespace dbwrapper_private {
 
+CLatencyHistogram& histogramRead = GetMetrics().Histogram("leveldb_read");
+CLatencyHistogram& histogramWrite = GetMetrics().Histogram("leveldb_write_batch");
+
 void HandleError(const leveldb::Status& status)
 {
     if (status.ok())
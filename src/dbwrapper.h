@@ -6,6 +6,7 @@
 #define BITCOIN_DBWRAPPER_H
 
 #include "clientversion.h"
+#include "metrics.h"
 #include "serialize.h"
 #include "streams.h"
 #include "util.h"
@@ -44,6 +45,10 @@ void HandleError(const leveldb::Status& status);
  */
 const std::vector<unsigned char>& GetObfuscateKey(const CDBWrapper &w);
 
+/** Latencies of LevelDB point reads (Read/Exists) and batch writes, shared by all databases */
+extern CLatencyHistogram& histogramRead;
+extern CLatencyHistogram& histogramWrite;
+
 };
 
 /** Batch of changes queued to be written to a CDBWrapper */
@@ -234,7 +239,11 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status;
+        {
+            CScopedLatency latency(dbwrapper_private::histogramRead);
+            status = pdb->Get(readoptions, slKey, &strValue);
+        }
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -268,7 +277,11 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status;
+        {
+            CScopedLatency latency(dbwrapper_private::histogramRead);
+            status = pdb->Get(readoptions, slKey, &strValue);
+        }
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
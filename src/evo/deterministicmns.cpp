@@ -223,22 +223,57 @@ std::vector<CDeterministicMNCPtr> CDeterministicMNList::GetProjectedMNPayees(int
     return result;
 }
 
-std::vector<CDeterministicMNCPtr> CDeterministicMNList::CalculateQuorum(size_t maxSize, const uint256& modifier) const
+CDeterministicMNScoresCache::ScoreVec CDeterministicMNScoresCache::GetTopScores(const uint256& modifier, size_t nCount, const std::function<ScoreVec()>& calcScores)
 {
-    auto scores = CalculateScores(modifier);
+    EntryPtr entry;
+    {
+        LOCK(cs);
+        mapEntries.Get(modifier, entry);
+    }
 
-    // sort is descending order
-    std::sort(scores.rbegin(), scores.rend(), [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
-        if (a.first == b.first) {
-            // this should actually never happen, but we should stay compatible with how the non deterministic MNs did the sorting
-            return a.second->collateralOutpoint < b.second->collateralOutpoint;
+    if (!entry) {
+        // hashing is done without holding the lock, concurrent callers might do the same work but only one wins
+        auto newEntry = std::make_shared<Entry>();
+        newEntry->scores = calcScores();
+
+        LOCK(cs);
+        if (!mapEntries.Get(modifier, entry)) {
+            entry = newEntry;
+            mapEntries.Insert(modifier, entry);
         }
-        return a.first < b.first;
-    });
+    }
+
+    LOCK(cs);
+    auto& scores = entry->scores;
+    nCount = std::min(nCount, scores.size());
+    if (entry->nSorted < nCount) {
+        // everything before nSorted is already >= everything after it, so we only need to order the remainder
+        if (nCount == scores.size()) {
+            std::sort(scores.begin() + entry->nSorted, scores.end(), CompareScoresDescending);
+        } else {
+            std::partial_sort(scores.begin() + entry->nSorted, scores.begin() + nCount, scores.end(), CompareScoresDescending);
+        }
+        entry->nSorted = nCount;
+    }
+    return ScoreVec(scores.begin(), scores.begin() + nCount);
+}
+
+bool CDeterministicMNScoresCache::CompareScoresDescending(const ScorePair& a, const ScorePair& b)
+{
+    if (a.first == b.first) {
+        // this should actually never happen, but we should stay compatible with how the non deterministic MNs did the sorting
+        return b.second->collateralOutpoint < a.second->collateralOutpoint;
+    }
+    return b.first < a.first;
+}
+
+std::vector<CDeterministicMNCPtr> CDeterministicMNList::CalculateQuorum(size_t maxSize, const uint256& modifier) const
+{
+    auto scores = CalculateTopScores(maxSize, modifier);
 
     // take top maxSize entries and return it
     std::vector<CDeterministicMNCPtr> result;
-    result.resize(std::min(maxSize, scores.size()));
+    result.resize(scores.size());
     for (size_t i = 0; i < result.size(); i++) {
         result[i] = std::move(scores[i].second);
     }
@@ -246,6 +281,18 @@ std::vector<CDeterministicMNCPtr> CDeterministicMNList::CalculateQuorum(size_t m
 }
 
 std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> CDeterministicMNList::CalculateScores(const uint256& modifier) const
+{
+    return CalculateTopScores(std::numeric_limits<size_t>::max(), modifier);
+}
+
+std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> CDeterministicMNList::CalculateTopScores(size_t nCount, const uint256& modifier) const
+{
+    return scoresCache->GetTopScores(modifier, nCount, [&]() {
+        return CalculateScoresUncached(modifier);
+    });
+}
+
+std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> CDeterministicMNList::CalculateScoresUncached(const uint256& modifier) const
 {
     std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> scores;
     scores.reserve(GetAllMNsCount());
@@ -359,7 +406,8 @@ CSimplifiedMNListDiff CDeterministicMNList::BuildSimplifiedDiff(const CDetermini
         auto fromPtr = GetMN(toPtr->proTxHash);
         if (fromPtr == nullptr) {
             diffRet.mnList.emplace_back(*toPtr);
-        } else {
+        } else if (fromPtr->pdmnState != toPtr->pdmnState) {
+            // states are immutable and shared between lists, so only compare entries if the state object changed
             CSimplifiedMNListEntry sme1(*toPtr);
             CSimplifiedMNListEntry sme2(*fromPtr);
             if (sme1 != sme2) {
@@ -402,6 +450,7 @@ void CDeterministicMNList::AddMN(const CDeterministicMNCPtr& dmn)
 {
     assert(!mnMap.find(dmn->proTxHash));
     mnMap = mnMap.set(dmn->proTxHash, dmn);
+    InvalidateScoresCache();
     AddUniqueProperty(dmn, dmn->collateralOutpoint);
     if (dmn->pdmnState->addr != CService()) {
         AddUniqueProperty(dmn, dmn->pdmnState->addr);
@@ -420,6 +469,7 @@ void CDeterministicMNList::UpdateMN(const uint256& proTxHash, const CDeterminist
     auto oldState = dmn->pdmnState;
     dmn->pdmnState = pdmnState;
     mnMap = mnMap.set(proTxHash, dmn);
+    InvalidateScoresCache();
 
     UpdateUniqueProperty(dmn, oldState->addr, pdmnState->addr);
     UpdateUniqueProperty(dmn, oldState->keyIDOwner, pdmnState->keyIDOwner);
@@ -439,6 +489,7 @@ void CDeterministicMNList::RemoveMN(const uint256& proTxHash)
         DeleteUniqueProperty(dmn, dmn->pdmnState->pubKeyOperator);
     }
     mnMap = mnMap.erase(proTxHash);
+    InvalidateScoresCache();
 }
 
 CDeterministicMNManager::CDeterministicMNManager(CEvoDB& _evoDb) :
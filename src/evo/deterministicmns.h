@@ -7,6 +7,7 @@
 
 #include "arith_uint256.h"
 #include "bls/bls.h"
+#include "cachemap.h"
 #include "dbwrapper.h"
 #include "evodb.h"
 #include "providertx.h"
@@ -16,6 +17,7 @@
 #include "immer/map.hpp"
 #include "immer/map_transient.hpp"
 
+#include <functional>
 #include <map>
 
 class CBlock;
@@ -195,6 +197,46 @@ void UnserializeImmerMap(Stream& is, immer::map<K, T, Hash, Equal>& m)
     }
 }
 
+/**
+ * Memoizes MN score vectors per modifier. One instance is shared by all copies of a CDeterministicMNList and is
+ * replaced as soon as the list is modified, so cached entries never need to be invalidated individually.
+ * Score vectors are only sorted as far as they were requested, which keeps "top N" queries (quorums) cheap.
+ */
+class CDeterministicMNScoresCache
+{
+public:
+    typedef std::pair<arith_uint256, CDeterministicMNCPtr> ScorePair;
+    typedef std::vector<ScorePair> ScoreVec;
+
+    static const size_t MAX_CACHED_MODIFIERS = 64;
+
+private:
+    struct Entry {
+        ScoreVec scores;
+        // number of entries at the front of scores which are already in their final order
+        size_t nSorted{0};
+    };
+    typedef std::shared_ptr<Entry> EntryPtr;
+
+    CCriticalSection cs;
+    CacheMap<uint256, EntryPtr> mapEntries;
+
+public:
+    CDeterministicMNScoresCache() :
+        mapEntries(MAX_CACHED_MODIFIERS)
+    {
+    }
+
+    /**
+     * Returns the nCount highest scores for the given modifier, sorted in descending order. If the modifier is not
+     * cached yet, calcScores is invoked (without holding the cache lock) to calculate the unsorted scores.
+     */
+    ScoreVec GetTopScores(const uint256& modifier, size_t nCount, const std::function<ScoreVec()>& calcScores);
+
+    static bool CompareScoresDescending(const ScorePair& a, const ScorePair& b);
+};
+typedef std::shared_ptr<CDeterministicMNScoresCache> CDeterministicMNScoresCachePtr;
+
 class CDeterministicMNList
 {
 public:
@@ -211,6 +253,9 @@ private:
     // the entries in the map are ref counted as some properties might appear multiple times per MN (e.g. operator/owner keys)
     MnUniquePropertyMap mnUniquePropertyMap;
 
+    // shared between copies of this list, replaced on every modification
+    CDeterministicMNScoresCachePtr scoresCache{std::make_shared<CDeterministicMNScoresCache>()};
+
 public:
     CDeterministicMNList() {}
     explicit CDeterministicMNList(const uint256& _blockHash, int _height) :
@@ -229,6 +274,7 @@ public:
         if (ser_action.ForRead()) {
             UnserializeImmerMap(s, mnMap);
             UnserializeImmerMap(s, mnUniquePropertyMap);
+            InvalidateScoresCache();
         } else {
             SerializeImmerMap(s, mnMap);
             SerializeImmerMap(s, mnUniquePropertyMap);
@@ -310,7 +356,17 @@ public:
      * @return
      */
     std::vector<CDeterministicMNCPtr> CalculateQuorum(size_t maxSize, const uint256& modifier) const;
+    /**
+     * Calculates the scores of all valid and confirmed MNs for the given modifier. The result is sorted by score in
+     * descending order and memoized per modifier until this list is modified.
+     * @param modifier
+     * @return
+     */
     std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> CalculateScores(const uint256& modifier) const;
+    /**
+     * Same as CalculateScores, but only returns the nCount highest scores. Only the requested part is sorted.
+     */
+    std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> CalculateTopScores(size_t nCount, const uint256& modifier) const;
 
     /**
      * Calculates the maximum penalty which is allowed at the height of this MN list. It is dynamic and might change
@@ -369,6 +425,13 @@ public:
     }
 
 private:
+    std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> CalculateScoresUncached(const uint256& modifier) const;
+
+    void InvalidateScoresCache()
+    {
+        scoresCache = std::make_shared<CDeterministicMNScoresCache>();
+    }
+
     template <typename T>
     void AddUniqueProperty(const CDeterministicMNCPtr& dmn, const T& v)
     {
@@ -11,9 +11,14 @@
 #include "base58.h"
 #include "chainparams.h"
 #include "consensus/merkle.h"
+#include "crypto/sha256.h"
 #include "univalue.h"
 #include "validation.h"
 
+CSimplifiedMNListEntryHashCache smlEntryHashCache;
+CSimplifiedMNListMerkleCache smlMerkleCache;
+CSimplifiedMNListDiffCache mnListDiffCache;
+
 CSimplifiedMNListEntry::CSimplifiedMNListEntry(const CDeterministicMN& dmn) :
     proRegTxHash(dmn.proTxHash),
     confirmedHash(dmn.pdmnState->confirmedHash),
@@ -49,6 +54,96 @@ void CSimplifiedMNListEntry::ToJson(UniValue& obj) const
     obj.push_back(Pair("isValid", isValid));
 }
 
+uint256 CSimplifiedMNListEntryHashCache::GetEntryHash(const CDeterministicMN& dmn)
+{
+    const CDeterministicMNState* key = dmn.pdmnState.get();
+
+    {
+        LOCK(cs);
+        auto it = curGeneration.find(key);
+        if (it != curGeneration.end() && it->second.proTxHash == dmn.proTxHash) {
+            return it->second.entryHash;
+        }
+        it = prevGeneration.find(key);
+        if (it != prevGeneration.end() && it->second.proTxHash == dmn.proTxHash) {
+            // move it into the current generation so that it survives the next rotation
+            CacheEntry e = it->second;
+            prevGeneration.erase(it);
+            curGeneration[key] = e;
+            return e.entryHash;
+        }
+    }
+
+    CacheEntry e;
+    e.state = dmn.pdmnState;
+    e.proTxHash = dmn.proTxHash;
+    e.entryHash = CSimplifiedMNListEntry(dmn).CalcHash();
+
+    LOCK(cs);
+    if (curGeneration.size() >= MAX_GENERATION_SIZE) {
+        prevGeneration = std::move(curGeneration);
+        curGeneration = CacheGeneration();
+    }
+    curGeneration[key] = e;
+    return e.entryHash;
+}
+
+uint256 CSimplifiedMNListMerkleCache::CalcMerkleRoot(std::vector<uint256> leaves, bool* pmutated)
+{
+    LOCK(cs);
+
+    std::vector<std::vector<uint256>> newLevels;
+    newLevels.emplace_back(std::move(leaves));
+
+    // same rules as ComputeMerkleRoot, an odd last node is hashed with itself
+    bool mutation = false;
+    std::vector<uint256> toHash;
+    std::vector<size_t> toHashPos;
+    for (size_t l = 0; newLevels[l].size() > 1; l++) {
+        const std::vector<uint256>& level = newLevels[l];
+        const std::vector<uint256>* oldLevel = l + 1 < levels.size() ? &levels[l] : nullptr;
+        std::vector<uint256> parents((level.size() + 1) / 2);
+
+        toHash.clear();
+        toHashPos.clear();
+        for (size_t i = 0; i < parents.size(); i++) {
+            const uint256& left = level[2 * i];
+            const uint256& right = 2 * i + 1 < level.size() ? level[2 * i + 1] : left;
+            if (2 * i + 1 < level.size() && left == right) {
+                mutation = true;
+            }
+            if (oldLevel && 2 * i < oldLevel->size() && i < levels[l + 1].size()) {
+                const uint256& oldLeft = (*oldLevel)[2 * i];
+                const uint256& oldRight = 2 * i + 1 < oldLevel->size() ? (*oldLevel)[2 * i + 1] : oldLeft;
+                if (left == oldLeft && right == oldRight) {
+                    parents[i] = levels[l + 1][i];
+                    continue;
+                }
+            }
+            toHash.emplace_back(left);
+            toHash.emplace_back(right);
+            toHashPos.emplace_back(i);
+        }
+
+        if (!toHash.empty()) {
+            SHA256D64(toHash[0].begin(), toHash[0].begin(), toHashPos.size());
+            for (size_t j = 0; j < toHashPos.size(); j++) {
+                parents[toHashPos[j]] = toHash[j];
+            }
+        }
+        newLevels.emplace_back(std::move(parents));
+    }
+
+    levels = std::move(newLevels);
+    if (pmutated) {
+        *pmutated = mutation;
+    }
+    if (levels.back().empty()) {
+        return uint256();
+    }
+    return levels.back()[0];
+}
+
 CSimplifiedMNList::CSimplifiedMNList(const std::vector<CSimplifiedMNListEntry>& smlEntries)
 {
     mnList = smlEntries;
@@ -60,25 +155,37 @@ CSimplifiedMNList::CSimplifiedMNList(const std::vector<CSimplifiedMNListEntry>&
 
 CSimplifiedMNList::CSimplifiedMNList(const CDeterministicMNList& dmnList)
 {
-    mnList.reserve(dmnList.GetAllMNsCount());
+    std::vector<std::pair<CDeterministicMNCPtr, uint256>> dmns;
+    dmns.reserve(dmnList.GetAllMNsCount());
 
-    dmnList.ForEachMN(false, [this](const CDeterministicMNCPtr& dmn) {
-        mnList.emplace_back(*dmn);
+    dmnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+        dmns.emplace_back(dmn, smlEntryHashCache.GetEntryHash(*dmn));
     });
 
-    std::sort(mnList.begin(), mnList.end(), [&](const CSimplifiedMNListEntry& a, const CSimplifiedMNListEntry& b) {
-        return a.proRegTxHash.Compare(b.proRegTxHash) < 0;
+    std::sort(dmns.begin(), dmns.end(), [&](const std::pair<CDeterministicMNCPtr, uint256>& a, const std::pair<CDeterministicMNCPtr, uint256>& b) {
+        return a.first->proTxHash.Compare(b.first->proTxHash) < 0;
     });
+
+    mnList.reserve(dmns.size());
+    mnListHashes.reserve(dmns.size());
+    for (const auto& p : dmns) {
+        mnList.emplace_back(*p.first);
+        mnListHashes.emplace_back(p.second);
+    }
 }
 
 uint256 CSimplifiedMNList::CalcMerkleRoot(bool* pmutated) const
 {
+    if (mnListHashes.size() == mnList.size()) {
+        return smlMerkleCache.CalcMerkleRoot(mnListHashes, pmutated);
+    }
+
     std::vector<uint256> leaves;
     leaves.reserve(mnList.size());
     for (const auto& e : mnList) {
         leaves.emplace_back(e.CalcHash());
     }
-    return ComputeMerkleRoot(leaves, pmutated);
+    return ComputeMerkleRoot(std::move(leaves), pmutated);
 }
 
 void CSimplifiedMNListDiff::ToJson(UniValue& obj) const
@@ -114,6 +221,40 @@ void CSimplifiedMNListDiff::ToJson(UniValue& obj) const
     }
 }
 
+bool CSimplifiedMNListDiffCache::Get(const uint256& baseBlockHash, const uint256& blockHash, CSimplifiedMNListDiffCPtr& diffRet)
+{
+    LOCK(cs);
+    std::pair<CSimplifiedMNListDiffCPtr, size_t> p;
+    if (!mapDiffs.Get(std::make_pair(baseBlockHash, blockHash), p)) {
+        return false;
+    }
+    diffRet = p.first;
+    return true;
+}
+
+void CSimplifiedMNListDiffCache::Add(const uint256& baseBlockHash, const uint256& blockHash, const CSimplifiedMNListDiffCPtr& diff)
+{
+    size_t nSize = ::GetSerializeSize(*diff, SER_NETWORK, PROTOCOL_VERSION);
+    if (nSize > MAX_CACHE_BYTES / 4) {
+        return;
+    }
+
+    LOCK(cs);
+    auto key = std::make_pair(baseBlockHash, blockHash);
+    if (mapDiffs.HasKey(key)) {
+        return;
+    }
+    // evict the oldest diffs, including the one Insert would prune when the count limit is reached
+    while (!mapDiffs.GetItemList().empty() &&
+           (nCacheBytes + nSize > MAX_CACHE_BYTES || mapDiffs.GetSize() >= mapDiffs.GetMaxSize())) {
+        const auto& oldest = mapDiffs.GetItemList().back();
+        nCacheBytes -= oldest.value.second;
+        mapDiffs.Erase(oldest.key);
+    }
+    mapDiffs.Insert(key, std::make_pair(diff, nSize));
+    nCacheBytes += nSize;
+}
+
 bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& blockHash, CSimplifiedMNListDiff& mnListDiffRet, std::string& errorRet)
 {
     AssertLockHeld(cs_main);
@@ -144,6 +285,12 @@ bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& bloc
         return false;
     }
 
+    CSimplifiedMNListDiffCPtr cachedDiff;
+    if (mnListDiffCache.Get(baseBlockHash, blockHash, cachedDiff)) {
+        mnListDiffRet = *cachedDiff;
+        return true;
+    }
+
     LOCK(deterministicMNManager->cs);
 
     auto baseDmnList = deterministicMNManager->GetListForBlock(baseBlockHash);
@@ -167,5 +314,10 @@ bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& bloc
     vMatch[0] = true; // only coinbase matches
     mnListDiffRet.cbTxMerkleTree = CPartialMerkleTree(vHashes, vMatch);
 
+    // diffs from a null or genesis base are full lists which every new SPV client requests for a different tip
+    if (baseBlockIndex != chainActive.Genesis()) {
+        mnListDiffCache.Add(baseBlockHash, blockHash, std::make_shared<CSimplifiedMNListDiff>(mnListDiffRet));
+    }
+
     return true;
 }
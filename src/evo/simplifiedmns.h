@@ -6,14 +6,19 @@
 #define DASH_SIMPLIFIEDMNS_H
 
 #include "bls/bls.h"
+#include "cachemap.h"
 #include "merkleblock.h"
 #include "netaddress.h"
 #include "pubkey.h"
 #include "serialize.h"
+#include "sync.h"
+
+#include <unordered_map>
 
 class UniValue;
 class CDeterministicMNList;
 class CDeterministicMN;
+class CDeterministicMNState;
 
 class CSimplifiedMNListEntry
 {
@@ -65,11 +70,61 @@ public:
     void ToJson(UniValue& obj) const;
 };
 
+/**
+ * Caches the hashes of CSimplifiedMNListEntry objects per deterministic MN state. MN states are immutable and shared
+ * between consecutive MN lists, so only the entries of MNs which changed in a block need to be rehashed when
+ * calculating merkleRootMNList. The cache holds references to the states, so their addresses can't be reused while
+ * they are cached.
+ */
+class CSimplifiedMNListEntryHashCache
+{
+private:
+    // every generation holds at most this many entries, the previous generation is dropped when a new one begins
+    static const size_t MAX_GENERATION_SIZE = 20000;
+
+    struct CacheEntry {
+        std::shared_ptr<const CDeterministicMNState> state;
+        uint256 proTxHash;
+        uint256 entryHash;
+    };
+    typedef std::unordered_map<const CDeterministicMNState*, CacheEntry> CacheGeneration;
+
+    CCriticalSection cs;
+    CacheGeneration curGeneration;
+    CacheGeneration prevGeneration;
+
+public:
+    uint256 GetEntryHash(const CDeterministicMN& dmn);
+};
+
+extern CSimplifiedMNListEntryHashCache smlEntryHashCache;
+
+/**
+ * Keeps all levels of the last calculated SML merkle tree. Consecutive MN lists mostly differ in a few entries, so
+ * only the inner nodes above changed (or shifted) leaves need to be hashed again.
+ */
+class CSimplifiedMNListMerkleCache
+{
+private:
+    CCriticalSection cs;
+    // levels[0] are the leaves, the last level holds the root
+    std::vector<std::vector<uint256>> levels;
+
+public:
+    uint256 CalcMerkleRoot(std::vector<uint256> leaves, bool* pmutated = NULL);
+};
+
+extern CSimplifiedMNListMerkleCache smlMerkleCache;
+
 class CSimplifiedMNList
 {
 public:
     std::vector<CSimplifiedMNListEntry> mnList;
 
+private:
+    // hashes of the entries in mnList, only filled when constructed from a CDeterministicMNList
+    std::vector<uint256> mnListHashes;
+
 public:
     CSimplifiedMNList() {}
     CSimplifiedMNList(const std::vector<CSimplifiedMNListEntry>& smlEntries);
@@ -125,6 +180,38 @@ public:
     void ToJson(UniValue& obj) const;
 };
 
+typedef std::shared_ptr<const CSimplifiedMNListDiff> CSimplifiedMNListDiffCPtr;
+
+/**
+ * Keeps recently served mnlistdiffs. A diff is fully determined by its base and target block hashes, so entries never
+ * become invalid, they are only evicted when the cache is full. Diffs from a null or genesis base contain the whole
+ * list and are rarely requested twice for the same target, so they are not cached.
+ */
+class CSimplifiedMNListDiffCache
+{
+private:
+    static const size_t MAX_CACHE_SIZE = 1000;
+    // serialized size of all cached diffs
+    static const size_t MAX_CACHE_BYTES = 16 * 1024 * 1024;
+
+    CCriticalSection cs;
+    // the diffs with their serialized sizes
+    CacheMap<std::pair<uint256, uint256>, std::pair<CSimplifiedMNListDiffCPtr, size_t>> mapDiffs;
+    size_t nCacheBytes;
+
+public:
+    CSimplifiedMNListDiffCache() :
+        mapDiffs(MAX_CACHE_SIZE),
+        nCacheBytes(0)
+    {
+    }
+
+    bool Get(const uint256& baseBlockHash, const uint256& blockHash, CSimplifiedMNListDiffCPtr& diffRet);
+    void Add(const uint256& baseBlockHash, const uint256& blockHash, const CSimplifiedMNListDiffCPtr& diff);
+};
+
+extern CSimplifiedMNListDiffCache mnListDiffCache;
+
 bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& blockHash, CSimplifiedMNListDiff& mnListDiffRet, std::string& errorRet);
 
 #endif //DASH_SIMPLIFIEDMNS_H
@@ -9,10 +9,13 @@
 #include "clientversion.h"
 #include "hash.h"
 #include "streams.h"
+#include "sync.h"
 #include "util.h"
 
 #include <boost/filesystem.hpp>
 
+#include <functional>
+
 /** 
 *   Generic Dumping and Loading
 *   ---------------------------
@@ -37,47 +40,66 @@ private:
     std::string strFilename;
     std::string strMagicMessage;
 
-    bool Write(const T& objToSave)
+    static CCriticalSection& GetWriteLock()
     {
-        // LOCK(objToSave.cs);
+        // all instances for the same type write the same file
+        static CCriticalSection cs;
+        return cs;
+    }
 
+    // Writes into a temporary file which then replaces the old one, so that a crash while writing never leaves a
+    // truncated file behind. The hash is calculated while writing, so the object is never serialized into memory
+    // as a whole unless fSnapshot is set.
+    bool Write(T& objToSave, bool fSnapshot)
+    {
         int64_t nStart = GetTimeMillis();
 
-        // serialize, checksum data up to that point, then append checksum
-        CDataStream ssObj(SER_DISK, CLIENT_VERSION);
-        ssObj << strMagicMessage; // specific magic message for this type of object
-        ssObj << FLATDATA(Params().MessageStart()); // network specific magic number
-        ssObj << objToSave;
-        uint256 hash = Hash(ssObj.begin(), ssObj.end());
-        ssObj << hash;
+        CDataStream ssSnapshot(SER_DISK, CLIENT_VERSION);
+        if (fSnapshot) {
+            // serializing into memory only holds the object's lock for a short time, file IO happens afterwards
+            ssSnapshot << objToSave;
+        }
+
+        LOCK(GetWriteLock());
+
+        boost::filesystem::path pathTmp = pathDB.string() + ".new";
 
         // open output file, and associate with CAutoFile
-        FILE *file = fopen(pathDB.string().c_str(), "wb");
+        FILE *file = fopen(pathTmp.string().c_str(), "wb");
         CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
         if (fileout.IsNull())
-            return error("%s: Failed to open file %s", __func__, pathDB.string());
+            return error("%s: Failed to open file %s", __func__, pathTmp.string());
 
-        // Write and commit header, data
+        // serialize and checksum data up to that point, then append checksum
         try {
-            fileout << ssObj;
+            CHashSink<CAutoFile> hashout(&fileout);
+            hashout << strMagicMessage; // specific magic message for this type of object
+            hashout << FLATDATA(Params().MessageStart()); // network specific magic number
+            if (fSnapshot) {
+                hashout.write((const char*)ssSnapshot.data(), ssSnapshot.size());
+            } else {
+                hashout << objToSave;
+            }
+            fileout << hashout.GetHash();
+            FileCommit(fileout.Get());
         }
         catch (std::exception &e) {
             return error("%s: Serialize or I/O error - %s", __func__, e.what());
         }
         fileout.fclose();
 
+        if (!RenameOver(pathTmp, pathDB))
+            return error("%s: Rename-into-place failed", __func__);
+
         LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToSave.ToString());
 
         return true;
     }
 
-    ReadResult Read(T& objToLoad, bool fDryRun = false)
+    // Streams the file through the hasher in fixed size chunks, so it never has to be in memory as a whole
+    ReadResult VerifyHash()
     {
-        //LOCK(objToLoad.cs);
-
-        int64_t nStart = GetTimeMillis();
-        // open input file, and associate with CAutoFile
         FILE *file = fopen(pathDB.string().c_str(), "rb");
         CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
         if (filein.IsNull())
@@ -86,43 +108,62 @@ private:
             return FileError;
         }
 
-        // use file size to size memory buffer
-        int fileSize = boost::filesystem::file_size(pathDB);
-        int dataSize = fileSize - sizeof(uint256);
-        // Don't try to resize to a negative number if file is small
-        if (dataSize < 0)
-            dataSize = 0;
-        std::vector<unsigned char> vchData;
-        vchData.resize(dataSize);
+        uint64_t fileSize = boost::filesystem::file_size(pathDB);
+        uint64_t dataSize = fileSize > sizeof(uint256) ? fileSize - sizeof(uint256) : 0;
+        CHashWriter hasher(SER_GETHASH, 0);
+        std::vector<char> vchBuf(std::min<uint64_t>(dataSize, 1 << 16));
         uint256 hashIn;
 
         // read data and checksum from file
         try {
-            filein.read((char *)&vchData[0], dataSize);
+            while (dataSize > 0) {
+                size_t nChunk = std::min<uint64_t>(dataSize, vchBuf.size());
+                filein.read(vchBuf.data(), nChunk);
+                hasher.write(vchBuf.data(), nChunk);
+                dataSize -= nChunk;
+            }
             filein >> hashIn;
         }
         catch (std::exception &e) {
             error("%s: Deserialize or I/O error - %s", __func__, e.what());
             return HashReadError;
         }
-        filein.fclose();
-
-        CDataStream ssObj(vchData, SER_DISK, CLIENT_VERSION);
 
         // verify stored checksum matches input data
-        uint256 hashTmp = Hash(ssObj.begin(), ssObj.end());
-        if (hashIn != hashTmp)
+        if (hashIn != hasher.GetHash())
         {
             error("%s: Checksum mismatch, data corrupted", __func__);
             return IncorrectHash;
         }
 
+        return Ok;
+    }
+
+    ReadResult Read(T& objToLoad, bool fDryRun = false)
+    {
+        //LOCK(objToLoad.cs);
+
+        int64_t nStart = GetTimeMillis();
+
+        // the checksum is verified in a first pass, so that corrupted data is never deserialized
+        ReadResult hashResult = VerifyHash();
+        if (hashResult != Ok)
+            return hashResult;
+
+        // open input file, and associate with CAutoFile
+        FILE *file = fopen(pathDB.string().c_str(), "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+        {
+            error("%s: Failed to open file %s", __func__, pathDB.string());
+            return FileError;
+        }
 
         unsigned char pchMsgTmp[4];
         std::string strMagicMessageTmp;
         try {
             // de-serialize file header (file specific magic message) and ..
-            ssObj >> strMagicMessageTmp;
+            filein >> strMagicMessageTmp;
 
             // ... verify the message matches predefined one
             if (strMagicMessage != strMagicMessageTmp)
@@ -133,7 +174,7 @@ private:
 
 
             // de-serialize file header (network specific magic number) and ..
-            ssObj >> FLATDATA(pchMsgTmp);
+            filein >> FLATDATA(pchMsgTmp);
 
             // ... verify the network matches ours
             if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
@@ -142,14 +183,15 @@ private:
                 return IncorrectMagicNumber;
             }
 
-            // de-serialize data into T object
-            ssObj >> objToLoad;
+            // de-serialize data into T object, directly from the file
+            filein >> objToLoad;
         }
         catch (std::exception &e) {
             objToLoad.Clear();
             error("%s: Deserialize or I/O error - %s", __func__, e.what());
             return IncorrectFormat;
         }
+        filein.fclose();
 
         LogPrintf("Loaded info from %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToLoad.ToString());
@@ -217,12 +259,285 @@ public:
         }
 
         LogPrintf("Writing info to %s...\n", strFilename);
-        Write(objToSave);
+        Write(objToSave, false);
         LogPrintf("%s dump finished  %dms\n", strFilename, GetTimeMillis() - nStart);
 
         return true;
     }
 
+    // Writes the object without verifying the existing file first, as it was already checked by Load. The object is
+    // serialized into memory before writing, so its lock is not held during file IO. Only safe for objects which lock
+    // themselves in SerializationOp, as it is meant for periodic dumps from the scheduler thread.
+    bool DumpSnapshot(T& objToSave)
+    {
+        return Write(objToSave, true);
+    }
+
+};
+
+
+
+/**
+*   Append-only key/value log
+*   -------------------------
+*
+*   Alternative to CFlatDB for caches which change a few entries at a time. Every change is appended as a small
+*   checksummed record instead of rewriting the whole file, and the log is replayed record by record on startup.
+*   A crash can only leave an incomplete record at the end of the file, which is cut off on the next start.
+*   The owner is expected to call Compact with its live entries once NeedsCompaction returns true, which rewrites
+*   the log with one record per entry. Not thread-safe, calls must be guarded by the owner's lock.
+*/
+
+template<typename K, typename V>
+class CFlatDBLog
+{
+private:
+    enum RecordType : uint8_t {
+        RECORD_WRITE = 1,
+        RECORD_ERASE = 2
+    };
+
+    // don't compact small logs, and only compact once most records are obsolete
+    static const size_t MIN_RECORDS_FOR_COMPACTION = 1000;
+    static const size_t COMPACTION_RATIO = 4;
+    // buffer size used when compacting
+    static const size_t COMPACTION_BUFFER_SIZE = 1 << 20;
+
+    boost::filesystem::path pathLog;
+    std::string strFilename;
+    std::string strMagicMessage;
+
+    FILE* file;
+    size_t nRecords;
+
+    void SerializeHeader(CDataStream& ss) const
+    {
+        ss << strMagicMessage; // specific magic message for this type of object
+        ss << FLATDATA(Params().MessageStart()); // network specific magic number
+    }
+
+    static void SerializeRecord(CDataStream& ss, RecordType type, const K& key, const V* value)
+    {
+        CDataStream ssRecord(SER_DISK, CLIENT_VERSION);
+        ssRecord << (uint8_t)type << key;
+        if (value) {
+            ssRecord << *value;
+        }
+        uint32_t nChecksum = (uint32_t)Hash(ssRecord.begin(), ssRecord.end()).GetCheapHash();
+
+        WriteCompactSize(ss, ssRecord.size());
+        ss.write((const char*)ssRecord.data(), ssRecord.size());
+        ss << nChecksum;
+    }
+
+    static bool WriteStream(FILE* f, CDataStream& ss)
+    {
+        if (ss.empty())
+            return true;
+        bool fRet = fwrite(ss.data(), 1, ss.size(), f) == ss.size();
+        ss.clear();
+        return fRet;
+    }
+
+    bool Append(RecordType type, const K& key, const V* value)
+    {
+        if (!file)
+            return error("%s: %s is not open", __func__, strFilename);
+
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        SerializeRecord(ss, type, key, value);
+        if (!WriteStream(file, ss))
+            return error("%s: Failed to append to %s", __func__, strFilename);
+        nRecords++;
+        return true;
+    }
+
+public:
+    CFlatDBLog(std::string strFilenameIn, std::string strMagicMessageIn) :
+        pathLog(GetDataDir() / strFilenameIn),
+        strFilename(strFilenameIn),
+        strMagicMessage(strMagicMessageIn),
+        file(nullptr),
+        nRecords(0)
+    {}
+
+    ~CFlatDBLog()
+    {
+        Close();
+    }
+
+    CFlatDBLog(const CFlatDBLog&) = delete;
+    CFlatDBLog& operator=(const CFlatDBLog&) = delete;
+
+    bool Exists() const { return boost::filesystem::exists(pathLog); }
+    bool IsOpen() const { return file != nullptr; }
+    size_t GetRecordCount() const { return nRecords; }
+
+    // Replays all records in the log by calling onWrite/onErase for each of them and opens the log for appending.
+    // Creates an empty log if the file does not exist. Returns false if the file belongs to a different cache or
+    // network.
+    bool Open(const std::function<void(K&&, V&&)>& onWrite, const std::function<void(K&&)>& onErase)
+    {
+        Close();
+
+        int64_t nStart = GetTimeMillis();
+        nRecords = 0;
+
+        if (!Exists()) {
+            LogPrintf("Missing file %s, will try to recreate\n", strFilename);
+            file = fopen(pathLog.string().c_str(), "wb");
+            if (!file)
+                return error("%s: Failed to open file %s", __func__, pathLog.string());
+            CDataStream ss(SER_DISK, CLIENT_VERSION);
+            SerializeHeader(ss);
+            if (!WriteStream(file, ss) || !Flush(true))
+                return error("%s: Failed to write header to %s", __func__, strFilename);
+            return true;
+        }
+
+        FILE *fileRaw = fopen(pathLog.string().c_str(), "rb");
+        CAutoFile filein(fileRaw, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("%s: Failed to open file %s", __func__, pathLog.string());
+
+        unsigned char pchMsgTmp[4];
+        std::string strMagicMessageTmp;
+        try {
+            filein >> strMagicMessageTmp;
+            filein >> FLATDATA(pchMsgTmp);
+        }
+        catch (std::exception &e) {
+            return error("%s: Failed to read header of %s - %s", __func__, strFilename, e.what());
+        }
+        if (strMagicMessage != strMagicMessageTmp)
+            return error("%s: Invalid magic message", __func__);
+        if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
+            return error("%s: Invalid network magic number", __func__);
+
+        long nGoodPos = ftell(filein.Get());
+        std::vector<char> vchRecord;
+        while (true) {
+            try {
+                uint64_t nSize = ReadCompactSize(filein);
+                vchRecord.resize(nSize);
+                filein.read(vchRecord.data(), nSize);
+                uint32_t nChecksum;
+                filein >> nChecksum;
+                if (nChecksum != (uint32_t)Hash(vchRecord.begin(), vchRecord.end()).GetCheapHash()) {
+                    break;
+                }
+
+                CDataStream ssRecord(vchRecord.data(), vchRecord.data() + vchRecord.size(), SER_DISK, CLIENT_VERSION);
+                uint8_t type;
+                K key;
+                ssRecord >> type >> key;
+                if (type == RECORD_WRITE) {
+                    V value;
+                    ssRecord >> value;
+                    onWrite(std::move(key), std::move(value));
+                } else if (type == RECORD_ERASE) {
+                    onErase(std::move(key));
+                } else {
+                    break;
+                }
+            }
+            catch (std::exception &e) {
+                // end of file or incomplete record
+                break;
+            }
+            nGoodPos = ftell(filein.Get());
+            nRecords++;
+        }
+        filein.fclose();
+
+        uint64_t fileSize = boost::filesystem::file_size(pathLog);
+        if (nGoodPos >= 0 && (uint64_t)nGoodPos < fileSize) {
+            // only the last record can be incomplete, a crash happened while appending it
+            LogPrintf("%s: Dropping %d bytes of incomplete or corrupted records at the end of %s\n", __func__, fileSize - nGoodPos, strFilename);
+            boost::filesystem::resize_file(pathLog, nGoodPos);
+        }
+
+        file = fopen(pathLog.string().c_str(), "ab");
+        if (!file)
+            return error("%s: Failed to open file %s", __func__, pathLog.string());
+
+        LogPrintf("Loaded %d records from %s  %dms\n", nRecords, strFilename, GetTimeMillis() - nStart);
+        return true;
+    }
+
+    bool Write(const K& key, const V& value)
+    {
+        return Append(RECORD_WRITE, key, &value);
+    }
+
+    bool Erase(const K& key)
+    {
+        return Append(RECORD_ERASE, key, nullptr);
+    }
+
+    bool Flush(bool fSync = false)
+    {
+        if (!file)
+            return false;
+        if (fSync) {
+            FileCommit(file);
+            return true;
+        }
+        return fflush(file) == 0;
+    }
+
+    bool NeedsCompaction(size_t nLiveRecords) const
+    {
+        return nRecords >= MIN_RECORDS_FOR_COMPACTION && nRecords > nLiveRecords * COMPACTION_RATIO;
+    }
+
+    // Rewrites the log with one record per live entry. mapLive must iterate over pairs of K and V
+    template<typename Map>
+    bool Compact(const Map& mapLive)
+    {
+        int64_t nStart = GetTimeMillis();
+
+        boost::filesystem::path pathTmp = pathLog.string() + ".new";
+        FILE* fileTmp = fopen(pathTmp.string().c_str(), "wb");
+        if (!fileTmp)
+            return error("%s: Failed to open file %s", __func__, pathTmp.string());
+
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        SerializeHeader(ss);
+        bool fOk = true;
+        for (const auto& p : mapLive) {
+            SerializeRecord(ss, RECORD_WRITE, p.first, &p.second);
+            if (ss.size() >= COMPACTION_BUFFER_SIZE) {
+                fOk &= WriteStream(fileTmp, ss);
+            }
+        }
+        fOk &= WriteStream(fileTmp, ss);
+        FileCommit(fileTmp);
+        fclose(fileTmp);
+        if (!fOk)
+            return error("%s: Failed to write %s", __func__, pathTmp.string());
+
+        Close();
+        if (!RenameOver(pathTmp, pathLog))
+            return error("%s: Rename-into-place failed", __func__);
+
+        file = fopen(pathLog.string().c_str(), "ab");
+        if (!file)
+            return error("%s: Failed to open file %s", __func__, pathLog.string());
+        nRecords = mapLive.size();
+
+        LogPrintf("Compacted %s to %d records  %dms\n", strFilename, nRecords, GetTimeMillis() - nStart);
+        return true;
+    }
+
+    void Close()
+    {
+        if (file) {
+            FileCommit(file);
+            fclose(file);
+            file = nullptr;
+        }
+    }
 };
 
 
@@ -0,0 +1,171 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-db.h"
+
+#include "util.h"
+
+CGovernanceDB* governanceDb;
+
+const std::string CGovernanceDB::SERIALIZATION_VERSION_STRING = "CGovernanceDB-Version-1";
+
+const char CGovernanceDB::DB_VERSION = 'V';
+const char CGovernanceDB::DB_MANAGER_STATE = 'M';
+const char CGovernanceDB::DB_OBJECT = 'o';
+const char CGovernanceDB::DB_CURRENT_VOTES = 'c';
+const char CGovernanceDB::DB_VOTE = 'v';
+
+CGovernanceDB::CGovernanceDB(size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(fMemory ? "" : (GetDataDir() / "governance"), nCacheSize, fMemory, fWipe)
+{
+}
+
+bool CGovernanceDB::VerifyVersion()
+{
+    std::string strVersion;
+    if (db.Read(DB_VERSION, strVersion)) {
+        return strVersion == SERIALIZATION_VERSION_STRING;
+    }
+    // a new database
+    return db.IsEmpty();
+}
+
+bool CGovernanceDB::WriteVersion()
+{
+    return db.Write(DB_VERSION, SERIALIZATION_VERSION_STRING, true);
+}
+
+void CGovernanceDB::WriteObject(CDBBatch& batch, const CGovernanceObject& obj)
+{
+    batch.Write(std::make_pair(DB_OBJECT, obj.GetHash()), ObjectRecord(const_cast<CGovernanceObject&>(obj)));
+}
+
+void CGovernanceDB::EraseObject(CDBBatch& batch, const uint256& nHash)
+{
+    batch.Erase(std::make_pair(DB_OBJECT, nHash));
+    EraseByPrefix<COutPoint>(batch, DB_CURRENT_VOTES, nHash);
+    EraseByPrefix<uint256>(batch, DB_VOTE, nHash);
+}
+
+void CGovernanceDB::WriteCurrentVotes(CDBBatch& batch, const uint256& nParentHash, const COutPoint& outpoint, const vote_rec_t& voteRecord)
+{
+    batch.Write(std::make_pair(DB_CURRENT_VOTES, std::make_pair(nParentHash, outpoint)), voteRecord);
+}
+
+void CGovernanceDB::EraseCurrentVotes(CDBBatch& batch, const uint256& nParentHash, const COutPoint& outpoint)
+{
+    batch.Erase(std::make_pair(DB_CURRENT_VOTES, std::make_pair(nParentHash, outpoint)));
+}
+
+void CGovernanceDB::WriteVote(CDBBatch& batch, const CGovernanceVote& vote)
+{
+    batch.Write(std::make_pair(DB_VOTE, std::make_pair(vote.GetParentHash(), vote.GetHash())), vote);
+}
+
+void CGovernanceDB::EraseVote(CDBBatch& batch, const uint256& nParentHash, const uint256& nVoteHash)
+{
+    batch.Erase(std::make_pair(DB_VOTE, std::make_pair(nParentHash, nVoteHash)));
+}
+
+bool CGovernanceDB::LoadObjects(std::function<void(CGovernanceObject&&)>&& callback)
+{
+    // current vote records are sorted by object hash, just like the objects, so both can be read in one pass
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    std::unique_ptr<CDBIterator> pcursorVotes(db.NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_OBJECT, uint256()));
+    pcursorVotes->Seek(std::make_pair(DB_CURRENT_VOTES, uint256()));
+
+    while (pcursor->Valid()) {
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_OBJECT) {
+            break;
+        }
+
+        CGovernanceObject obj;
+        ObjectRecord record(obj);
+        if (!pcursor->GetValue(record)) {
+            return error("CGovernanceDB::%s -- failed to read object %s", __func__, key.second.ToString());
+        }
+        if (obj.GetHash() != key.second) {
+            return error("CGovernanceDB::%s -- hash mismatch for object %s", __func__, key.second.ToString());
+        }
+
+        while (pcursorVotes->Valid()) {
+            std::pair<char, std::pair<uint256, COutPoint> > voteKey;
+            if (!pcursorVotes->GetKey(voteKey) || voteKey.first != DB_CURRENT_VOTES || key.second < voteKey.second.first) {
+                break;
+            }
+            if (voteKey.second.first == key.second) {
+                vote_rec_t voteRecord;
+                if (!pcursorVotes->GetValue(voteRecord)) {
+                    return error("CGovernanceDB::%s -- failed to read current votes for object %s", __func__, key.second.ToString());
+                }
+                obj.mapCurrentMNVotes.emplace(voteKey.second.second, std::move(voteRecord));
+            }
+            pcursorVotes->Next();
+        }
+
+        obj.RebuildVoteTally();
+        // the vote file is loaded lazily
+        obj.fVotesLoaded = false;
+
+        callback(std::move(obj));
+        pcursor->Next();
+    }
+
+    return true;
+}
+
+bool CGovernanceDB::LoadVotes(const uint256& nParentHash, CGovernanceObjectVoteFile& fileVotes)
+{
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(std::make_pair(DB_VOTE, nParentHash));
+
+    while (pcursor->Valid()) {
+        std::pair<char, std::pair<uint256, uint256> > key;
+        if (!pcursor->GetKey(key) || key.first != DB_VOTE || key.second.first != nParentHash) {
+            break;
+        }
+        CGovernanceVote vote;
+        if (!pcursor->GetValue(vote)) {
+            return error("CGovernanceDB::%s -- failed to read vote %s", __func__, key.second.second.ToString());
+        }
+        fileVotes.AddVote(vote);
+        pcursor->Next();
+    }
+    return true;
+}
+
+void CGovernanceDB::ForEachVoteHash(std::function<void(const uint256&, const uint256&)>&& callback)
+{
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(std::make_pair(DB_VOTE, uint256()));
+
+    while (pcursor->Valid()) {
+        std::pair<char, std::pair<uint256, uint256> > key;
+        if (!pcursor->GetKey(key) || key.first != DB_VOTE) {
+            break;
+        }
+        callback(key.second.first, key.second.second);
+        pcursor->Next();
+    }
+}
+
+template <typename K>
+void CGovernanceDB::EraseByPrefix(CDBBatch& batch, char prefix, const uint256& nParentHash)
+{
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    // (prefix, nParentHash) sorts before all longer keys starting with it
+    pcursor->Seek(std::make_pair(prefix, nParentHash));
+
+    while (pcursor->Valid()) {
+        std::pair<char, std::pair<uint256, K> > key;
+        if (!pcursor->GetKey(key) || key.first != prefix || key.second.first != nParentHash) {
+            break;
+        }
+        batch.Erase(key);
+        pcursor->Next();
+    }
+}
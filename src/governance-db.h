@@ -0,0 +1,108 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef GOVERNANCE_DB_H
+#define GOVERNANCE_DB_H
+
+#include "dbwrapper.h"
+#include "governance-object.h"
+
+#include <functional>
+
+/**
+ * Persistent storage for governance objects and votes (replaces governance.dat)
+ *
+ * Objects, the current vote records of each masternode and all individual votes are stored under separate keys, so
+ * that every accepted/removed vote only results in a few small writes. Votes are only read when an object's vote file
+ * is needed (see CGovernanceObject::LoadVotesIfNeeded), which is why startup doesn't have to deserialize them.
+ * The remaining manager state (erased object hashes, invalid/orphan votes, ...) is written as a whole on every flush.
+ */
+class CGovernanceDB
+{
+public:
+    static const std::string SERIALIZATION_VERSION_STRING;
+
+private:
+    CDBWrapper db;
+
+    // Serializes an object without its current votes and vote file, as these are stored separately
+    struct ObjectRecord {
+        CGovernanceObject& obj;
+
+        ObjectRecord(CGovernanceObject& _obj) : obj(_obj) {}
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action)
+        {
+            READWRITE(obj.nHashParent);
+            READWRITE(obj.nRevision);
+            READWRITE(obj.nTime);
+            READWRITE(obj.nCollateralHash);
+            READWRITE(obj.vchData);
+            READWRITE(obj.nObjectType);
+            READWRITE(obj.masternodeOutpoint);
+            READWRITE(obj.vchSig);
+            READWRITE(obj.nDeletionTime);
+            READWRITE(obj.fExpired);
+        }
+    };
+
+public:
+    CGovernanceDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    bool IsEmpty() { return db.IsEmpty(); }
+
+    // Returns false if the DB was written by an incompatible version and needs to be wiped
+    bool VerifyVersion();
+    bool WriteVersion();
+
+    // Writes the object without its votes
+    void WriteObject(CDBBatch& batch, const CGovernanceObject& obj);
+    // Erases the object together with all its current vote records and votes
+    void EraseObject(CDBBatch& batch, const uint256& nHash);
+
+    void WriteCurrentVotes(CDBBatch& batch, const uint256& nParentHash, const COutPoint& outpoint, const vote_rec_t& voteRecord);
+    void EraseCurrentVotes(CDBBatch& batch, const uint256& nParentHash, const COutPoint& outpoint);
+
+    void WriteVote(CDBBatch& batch, const CGovernanceVote& vote);
+    void EraseVote(CDBBatch& batch, const uint256& nParentHash, const uint256& nVoteHash);
+
+    // Loads all objects including their current vote records, but without the vote files
+    bool LoadObjects(std::function<void(CGovernanceObject&&)>&& callback);
+    bool LoadVotes(const uint256& nParentHash, CGovernanceObjectVoteFile& fileVotes);
+    // Calls the callback with the parent and vote hash of all stored votes, without deserializing the votes
+    void ForEachVoteHash(std::function<void(const uint256&, const uint256&)>&& callback);
+
+    template <typename T>
+    bool ReadManagerState(T& state)
+    {
+        return db.Read(DB_MANAGER_STATE, state);
+    }
+
+    template <typename T>
+    void WriteManagerState(CDBBatch& batch, const T& state)
+    {
+        batch.Write(DB_MANAGER_STATE, state);
+    }
+
+    CDBBatch CreateBatch() { return CDBBatch(db); }
+    bool WriteBatch(CDBBatch& batch, bool fSync = false) { return db.WriteBatch(batch, fSync); }
+
+private:
+    static const char DB_VERSION;
+    static const char DB_MANAGER_STATE;
+    static const char DB_OBJECT;
+    static const char DB_CURRENT_VOTES;
+    static const char DB_VOTE;
+
+    // Erases all keys of the form (prefix, (nParentHash, K))
+    template <typename K>
+    void EraseByPrefix(CDBBatch& batch, char prefix, const uint256& nParentHash);
+};
+
+extern CGovernanceDB* governanceDb;
+
+#endif
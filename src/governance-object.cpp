@@ -5,6 +5,7 @@
 #include "governance-object.h"
 #include "core_io.h"
 #include "governance-classes.h"
+#include "governance-db.h"
 #include "governance-validators.h"
 #include "governance-vote.h"
 #include "governance.h"
@@ -17,6 +18,8 @@
 #include <string>
 #include <univalue.h>
 
+bool fCheckGovernanceVoteTallies = false;
+
 CGovernanceObject::CGovernanceObject() :
     cs(),
     nObjectType(GOVERNANCE_OBJECT_UNKNOWN),
@@ -38,8 +41,10 @@ CGovernanceObject::CGovernanceObject() :
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    voteTally(),
     cmmapOrphanVotes(),
-    fileVotes()
+    fileVotes(),
+    fVotesLoaded(true)
 {
     // PARSE JSON DATA STORAGE (VCHDATA)
     LoadData();
@@ -66,8 +71,10 @@ CGovernanceObject::CGovernanceObject(const uint256& nHashParentIn, int nRevision
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    voteTally(),
     cmmapOrphanVotes(),
-    fileVotes()
+    fileVotes(),
+    fVotesLoaded(true)
 {
     // PARSE JSON DATA STORAGE (VCHDATA)
     LoadData();
@@ -94,8 +101,10 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other) :
     fExpired(other.fExpired),
     fUnparsable(other.fUnparsable),
     mapCurrentMNVotes(other.mapCurrentMNVotes),
+    voteTally(other.voteTally),
     cmmapOrphanVotes(other.cmmapOrphanVotes),
-    fileVotes(other.fileVotes)
+    fileVotes(other.fileVotes),
+    fVotesLoaded(other.fVotesLoaded)
 {
 }
 
@@ -106,6 +115,8 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
 {
     LOCK(cs);
 
+    LoadVotesIfNeeded();
+
     // do not process already known valid votes twice
     if (fileVotes.HasVote(vote.GetHash())) {
         // nothing to do here, not an error
@@ -217,9 +228,18 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         return false;
     }
 
+    UpdateVoteTally(eSignal, voteInstanceRef.eOutcome, -1);
     voteInstanceRef = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp());
+    UpdateVoteTally(eSignal, voteInstanceRef.eOutcome, 1);
     fileVotes.AddVote(vote);
     fDirtyCache = true;
+
+    if (governanceDb) {
+        CDBBatch batch = governanceDb->CreateBatch();
+        governanceDb->WriteVote(batch, vote);
+        governanceDb->WriteCurrentVotes(batch, vote.GetParentHash(), vote.GetMasternodeOutpoint(), voteRecordRef);
+        governanceDb->WriteBatch(batch);
+    }
     return true;
 }
 
@@ -227,15 +247,35 @@ void CGovernanceObject::ClearMasternodeVotes()
 {
     LOCK(cs);
 
+    uint256 nParentHash = GetHash();
+    std::unique_ptr<CDBBatch> batch;
+    if (governanceDb) {
+        batch.reset(new CDBBatch(governanceDb->CreateBatch()));
+    }
+
     vote_m_it it = mapCurrentMNVotes.begin();
     while (it != mapCurrentMNVotes.end()) {
         if (!mnodeman.Has(it->first)) {
-            fileVotes.RemoveVotesFromMasternode(it->first);
+            LoadVotesIfNeeded();
+            auto removed = fileVotes.RemoveVotesFromMasternode(it->first);
+            for (const auto& p : it->second.mapInstances) {
+                UpdateVoteTally(p.first, p.second.eOutcome, -1);
+            }
+            if (batch) {
+                for (const auto& voteHash : removed) {
+                    governanceDb->EraseVote(*batch, nParentHash, voteHash);
+                }
+                governanceDb->EraseCurrentVotes(*batch, nParentHash, it->first);
+            }
             mapCurrentMNVotes.erase(it++);
         } else {
             ++it;
         }
     }
+
+    if (batch) {
+        governanceDb->WriteBatch(*batch);
+    }
 }
 
 std::set<uint256> CGovernanceObject::RemoveInvalidProposalVotes(const COutPoint& mnOutpoint)
@@ -252,6 +292,8 @@ std::set<uint256> CGovernanceObject::RemoveInvalidProposalVotes(const COutPoint&
         return {};
     }
 
+    LoadVotesIfNeeded();
+
     auto removedVotes = fileVotes.RemoveInvalidProposalVotes(mnOutpoint);
     if (removedVotes.empty()) {
         return {};
@@ -262,6 +304,7 @@ std::set<uint256> CGovernanceObject::RemoveInvalidProposalVotes(const COutPoint&
         CGovernanceVote tmpVote(mnOutpoint, nParentHash, (vote_signal_enum_t)jt->first, jt->second.eOutcome);
         tmpVote.SetTime(jt->second.nCreationTime);
         if (removedVotes.count(tmpVote.GetHash())) {
+            UpdateVoteTally(jt->first, jt->second.eOutcome, -1);
             jt = it->second.mapInstances.erase(jt);
         } else {
             ++jt;
@@ -271,6 +314,15 @@ std::set<uint256> CGovernanceObject::RemoveInvalidProposalVotes(const COutPoint&
         mapCurrentMNVotes.erase(it);
     }
 
+    if (governanceDb) {
+        CDBBatch batch = governanceDb->CreateBatch();
+        for (const auto& voteHash : removedVotes) {
+            governanceDb->EraseVote(batch, nParentHash, voteHash);
+        }
+        WriteCurrentVotesToDB(batch, mnOutpoint);
+        governanceDb->WriteBatch(batch);
+    }
+
     if (!removedVotes.empty()) {
         std::string removedStr;
         for (auto& h : removedVotes) {
@@ -726,6 +778,23 @@ int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote
 {
     LOCK(cs);
 
+    if (eVoteSignalIn <= VOTE_SIGNAL_NONE || eVoteSignalIn > MAX_SUPPORTED_VOTE_SIGNAL ||
+        eVoteOutcomeIn <= VOTE_OUTCOME_NONE || eVoteOutcomeIn > VOTE_OUTCOME_ABSTAIN) {
+        // not tallied
+        return CountMatchingVotesUncached(eVoteSignalIn, eVoteOutcomeIn);
+    }
+
+    int nCount = voteTally[eVoteSignalIn][eVoteOutcomeIn];
+    if (fCheckGovernanceVoteTallies) {
+        assert(nCount == CountMatchingVotesUncached(eVoteSignalIn, eVoteOutcomeIn));
+    }
+    return nCount;
+}
+
+int CGovernanceObject::CountMatchingVotesUncached(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const
+{
+    AssertLockHeld(cs);
+
     int nCount = 0;
     for (const auto& votepair : mapCurrentMNVotes) {
         const vote_rec_t& recVote = votepair.second;
@@ -737,6 +806,55 @@ int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote
     return nCount;
 }
 
+void CGovernanceObject::UpdateVoteTally(int nSignal, vote_outcome_enum_t eOutcome, int nDelta)
+{
+    AssertLockHeld(cs);
+
+    if (nSignal <= VOTE_SIGNAL_NONE || nSignal > MAX_SUPPORTED_VOTE_SIGNAL ||
+        eOutcome <= VOTE_OUTCOME_NONE || eOutcome > VOTE_OUTCOME_ABSTAIN) {
+        return;
+    }
+    voteTally[nSignal][eOutcome] += nDelta;
+}
+
+void CGovernanceObject::RebuildVoteTally()
+{
+    LOCK(cs);
+
+    voteTally = vote_tally_t();
+    for (const auto& votepair : mapCurrentMNVotes) {
+        for (const auto& p : votepair.second.mapInstances) {
+            UpdateVoteTally(p.first, p.second.eOutcome, 1);
+        }
+    }
+}
+
+void CGovernanceObject::LoadVotesIfNeeded() const
+{
+    LOCK(cs);
+
+    if (fVotesLoaded) {
+        return;
+    }
+    fVotesLoaded = true;
+
+    if (governanceDb && !governanceDb->LoadVotes(GetHash(), fileVotes)) {
+        LogPrintf("CGovernanceObject::%s -- failed to load votes for %s\n", __func__, GetHash().ToString());
+    }
+}
+
+void CGovernanceObject::WriteCurrentVotesToDB(CDBBatch& batch, const COutPoint& mnOutpoint) const
+{
+    AssertLockHeld(cs);
+
+    auto it = mapCurrentMNVotes.find(mnOutpoint);
+    if (it == mapCurrentMNVotes.end()) {
+        governanceDb->EraseCurrentVotes(batch, GetHash(), mnOutpoint);
+    } else {
+        governanceDb->WriteCurrentVotes(batch, GetHash(), mnOutpoint, it->second);
+    }
+}
+
 /**
 *   Get specific vote counts for each outcome (funding, validity, etc)
 */
@@ -858,6 +976,8 @@ std::vector<uint256> CGovernanceObject::RemoveOldVotes(unsigned int nMinTime)
 {
     LOCK(cs);
 
+    LoadVotesIfNeeded();
+
     // Drop pre-DIP3 votes from vote db
     auto removed = fileVotes.RemoveOldVotes(nMinTime);
 
@@ -870,18 +990,26 @@ std::vector<uint256> CGovernanceObject::RemoveOldVotes(unsigned int nMinTime)
         fDirtyCache = true;
     }
 
+    std::vector<COutPoint> changedMNs;
+
     // Same for current votes per MN for this specific object
     auto itMnPair = mapCurrentMNVotes.begin();
     while (itMnPair != mapCurrentMNVotes.end()) {
         auto& miRef = itMnPair->second.mapInstances;
         auto itVotePair = miRef.begin();
+        bool fChanged = false;
         while (itVotePair != miRef.end()) {
             if (itVotePair->second.nCreationTime < nMinTime) {
+                UpdateVoteTally(itVotePair->first, itVotePair->second.eOutcome, -1);
                 miRef.erase(itVotePair++);
+                fChanged = true;
             } else {
                 ++itVotePair;
             }
         }
+        if (fChanged) {
+            changedMNs.emplace_back(itMnPair->first);
+        }
         if (miRef.empty()) {
             mapCurrentMNVotes.erase(itMnPair++);
         } else {
@@ -889,5 +1017,17 @@ std::vector<uint256> CGovernanceObject::RemoveOldVotes(unsigned int nMinTime)
         }
     }
 
+    if (governanceDb && (!removed.empty() || !changedMNs.empty())) {
+        uint256 nParentHash = GetHash();
+        CDBBatch batch = governanceDb->CreateBatch();
+        for (const auto& voteHash : removed) {
+            governanceDb->EraseVote(batch, nParentHash, voteHash);
+        }
+        for (const auto& outpoint : changedMNs) {
+            WriteCurrentVotesToDB(batch, outpoint);
+        }
+        governanceDb->WriteBatch(batch);
+    }
+
     return removed;
 }
@@ -20,6 +20,10 @@
 
 #include <univalue.h>
 
+#include <array>
+
+class CDBBatch;
+class CGovernanceDB;
 class CGovernanceManager;
 class CGovernanceTriggerManager;
 class CGovernanceObject;
@@ -52,6 +56,9 @@ static const int SEEN_OBJECT_UNKNOWN = 4;  // the default
 
 typedef std::pair<CGovernanceVote, int64_t> vote_time_pair_t;
 
+/// When set, every vote count returned from the tallies is compared against a full scan of the current votes
+extern bool fCheckGovernanceVoteTallies;
+
 inline bool operator<(const vote_time_pair_t& p1, const vote_time_pair_t& p2)
 {
     return (p1.first < p2.first);
@@ -109,6 +116,7 @@ struct vote_rec_t {
 
 class CGovernanceObject
 {
+    friend class CGovernanceDB;
     friend class CGovernanceManager;
     friend class CGovernanceTriggerManager;
     friend class CSuperblock;
@@ -122,6 +130,9 @@ public: // Types
 
     typedef CacheMultiMap<COutPoint, vote_time_pair_t> vote_cmm_t;
 
+    /// Number of current MN votes per signal (first index) and outcome (second index)
+    typedef std::array<std::array<int, VOTE_OUTCOME_ABSTAIN + 1>, MAX_SUPPORTED_VOTE_SIGNAL + 1> vote_tally_t;
+
 private:
     /// critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -182,10 +193,17 @@ private:
 
     vote_m_t mapCurrentMNVotes;
 
+    /// Tallies of mapCurrentMNVotes, updated whenever a vote instance is added, replaced or removed
+    vote_tally_t voteTally;
+
     /// Limited map of votes orphaned by MN
     vote_cmm_t cmmapOrphanVotes;
 
-    CGovernanceObjectVoteFile fileVotes;
+    /// Loaded lazily from governanceDb, see LoadVotesIfNeeded
+    mutable CGovernanceObjectVoteFile fileVotes;
+
+    /// false if fileVotes still needs to be loaded from governanceDb
+    mutable bool fVotesLoaded;
 
 public:
     CGovernanceObject();
@@ -251,8 +269,15 @@ public:
         return fExpired;
     }
 
+    bool AreVotesLoaded() const
+    {
+        LOCK(cs);
+        return fVotesLoaded;
+    }
+
     const CGovernanceObjectVoteFile& GetVoteFile() const
     {
+        LoadVotesIfNeeded();
         return fileVotes;
     }
 
@@ -329,7 +354,15 @@ public:
             READWRITE(nDeletionTime);
             READWRITE(fExpired);
             READWRITE(mapCurrentMNVotes);
+            if (ser_action.ForRead()) {
+                RebuildVoteTally();
+            } else {
+                LoadVotesIfNeeded();
+            }
             READWRITE(fileVotes);
+            if (ser_action.ForRead()) {
+                fVotesLoaded = true;
+            }
             LogPrint("gobject", "CGovernanceObject::SerializationOp hash = %s, vote count = %d\n", GetHash().ToString(), fileVotes.GetVoteCount());
         }
 
@@ -337,6 +370,16 @@ public:
     }
 
 private:
+    int CountMatchingVotesUncached(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const;
+
+    // Adds nDelta to the tally of the given signal/outcome. Signals/outcomes which are not tallied are ignored
+    void UpdateVoteTally(int nSignal, vote_outcome_enum_t eOutcome, int nDelta);
+    void RebuildVoteTally();
+
+    void LoadVotesIfNeeded() const;
+    // Writes the current votes of the masternode to governanceDb or erases them if there are none left
+    void WriteCurrentVotesToDB(CDBBatch& batch, const COutPoint& mnOutpoint) const;
+
     // FUNCTIONS FOR DEALING WITH DATA STRING
     void LoadData();
     void GetData(UniValue& objResult);
@@ -238,6 +238,16 @@ bool CGovernanceVote::CheckSignature(const CBLSPublicKey& pubKey) const
 }
 
 bool CGovernanceVote::IsValid(bool useVotingKey) const
+{
+    return IsValid(useVotingKey, nullptr);
+}
+
+bool CGovernanceVote::IsValid(bool useVotingKey, CGovernanceVoteBatchVerifier& batchVerifier) const
+{
+    return IsValid(useVotingKey, &batchVerifier);
+}
+
+bool CGovernanceVote::IsValid(bool useVotingKey, CGovernanceVoteBatchVerifier* pBatchVerifier) const
 {
     if (nTime > GetAdjustedTime() + (60 * 60)) {
         LogPrint("gobject", "CGovernanceVote::IsValid -- vote is too far ahead of current time - %s - nTime %lli - Max Time %lli\n", GetHash().ToString(), nTime, GetAdjustedTime() + (60 * 60));
@@ -266,6 +276,12 @@ bool CGovernanceVote::IsValid(bool useVotingKey) const
         return CheckSignature(infoMn.keyIDVoting);
     } else {
         if (deterministicMNManager->IsDeterministicMNsSporkActive()) {
+            if (pBatchVerifier) {
+                CBLSSignature sig;
+                sig.SetBuf(vchSig);
+                pBatchVerifier->PushMessage(masternodeOutpoint, GetHash(), GetSignatureHash(), sig, infoMn.blsPubKeyOperator);
+                return true;
+            }
             return CheckSignature(infoMn.blsPubKeyOperator);
         } else {
             return CheckSignature(infoMn.legacyKeyIDOperator);
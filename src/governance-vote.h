@@ -8,10 +8,14 @@
 #include "key.h"
 #include "primitives/transaction.h"
 #include "bls/bls.h"
+#include "bls/bls_batchverifier.h"
 
 class CGovernanceVote;
 class CConnman;
 
+// BLS signed votes keyed by masternode outpoint (source) and vote hash (message)
+typedef CBLSBatchVerifier<COutPoint, uint256> CGovernanceVoteBatchVerifier;
+
 // INTENTION OF MASTERNODES REGARDING ITEM
 enum vote_outcome_enum_t {
     VOTE_OUTCOME_NONE      = 0,
@@ -71,6 +75,8 @@ private:
     const uint256 hash;
     void UpdateHash() const;
 
+    bool IsValid(bool useVotingKey, CGovernanceVoteBatchVerifier* pBatchVerifier) const;
+
 public:
     CGovernanceVote();
     CGovernanceVote(const COutPoint& outpointMasternodeIn, const uint256& nParentHashIn, vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn);
@@ -100,6 +106,9 @@ public:
     bool Sign(const CBLSSecretKey& key);
     bool CheckSignature(const CBLSPublicKey& pubKey) const;
     bool IsValid(bool useVotingKey) const;
+    // Same as above, but BLS signatures are only pushed to the batch verifier instead of being verified directly.
+    // The vote must be considered invalid if batchVerifier.badMessages contains its hash after verification
+    bool IsValid(bool useVotingKey, CGovernanceVoteBatchVerifier& batchVerifier) const;
     void Relay(CConnman& connman) const;
 
     const COutPoint& GetMasternodeOutpoint() const { return masternodeOutpoint; }
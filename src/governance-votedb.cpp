@@ -54,18 +54,22 @@ std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
     return vecResult;
 }
 
-void CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const COutPoint& outpointMasternode)
+std::vector<uint256> CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const COutPoint& outpointMasternode)
 {
+    std::vector<uint256> removedVotes;
     vote_l_it it = listVotes.begin();
     while (it != listVotes.end()) {
         if (it->GetMasternodeOutpoint() == outpointMasternode) {
             --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
+            uint256 nHash = it->GetHash();
+            mapVoteIndex.erase(nHash);
+            removedVotes.emplace_back(nHash);
             listVotes.erase(it++);
         } else {
             ++it;
         }
     }
+    return removedVotes;
 }
 
 std::set<uint256> CGovernanceObjectVoteFile::RemoveInvalidProposalVotes(const COutPoint& outpointMasternode)
@@ -72,7 +72,7 @@ public:
 
     std::vector<CGovernanceVote> GetVotes() const;
 
-    void RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
+    std::vector<uint256> RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
     std::set<uint256> RemoveInvalidProposalVotes(const COutPoint& outpointMasternode);
 
     // TODO can be removed after full DIP3 deployment
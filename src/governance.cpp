@@ -5,6 +5,7 @@
 #include "governance.h"
 #include "consensus/validation.h"
 #include "governance-classes.h"
+#include "governance-db.h"
 #include "governance-object.h"
 #include "governance-validators.h"
 #include "governance-vote.h"
@@ -39,6 +40,7 @@ CGovernanceManager::CGovernanceManager() :
     mapLastMasternodeObject(),
     setRequestedObjects(),
     fRateChecksEnabled(true),
+    nPreDIP3VotesClearedTime(0),
     cs()
 {
 }
@@ -331,6 +333,12 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
         return;
     }
 
+    if (governanceDb) {
+        CDBBatch batch = governanceDb->CreateBatch();
+        WriteObjectToDB(batch, objpair.first->second);
+        governanceDb->WriteBatch(batch);
+    }
+
     // SHOULD WE ADD THIS OBJECT TO ANY OTHER MANANGERS?
 
     DBG(std::cout << "CGovernanceManager::AddGovernanceObject Before trigger block, GetDataAsPlainString = "
@@ -362,8 +370,9 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
 
     // WE MIGHT HAVE PENDING/ORPHAN VOTES FOR THIS OBJECT
 
+    // votes must end up in the stored object, not in the passed in copy
     CGovernanceException exception;
-    CheckOrphanVotes(govobj, exception, connman);
+    CheckOrphanVotes(objpair.first->second, exception, connman);
 
     // SEND NOTIFICATION TO SCRIPT/ZMQ
     GetMainSignals().NotifyGovernanceObject(govobj);
@@ -453,6 +462,12 @@ void CGovernanceManager::UpdateCachesAndClean()
             }
 
             mapErasedGovernanceObjects.insert(std::make_pair(nHash, nTimeExpired));
+            if (governanceDb) {
+                CDBBatch batch = governanceDb->CreateBatch();
+                governanceDb->EraseObject(batch, nHash);
+                governanceDb->WriteBatch(batch);
+            }
+            mapStoredObjectStates.erase(nHash);
             mapObjects.erase(it++);
         } else {
             // NOTE: triggers are handled via triggerman
@@ -480,6 +495,8 @@ void CGovernanceManager::UpdateCachesAndClean()
         }
     }
 
+    FlushToDB();
+
     LogPrintf("CGovernanceManager::UpdateCachesAndClean -- %s\n", ToString());
 }
 
@@ -684,12 +701,25 @@ void CGovernanceManager::SyncSingleObjAndItsVotes(CNode* pnode, const uint256& n
 
     auto fileVotes = govobj.GetVoteFile();
 
+    // BLS signatures of all votes are verified at once after the loop
+    CGovernanceVoteBatchVerifier batchVerifier;
+    std::vector<uint256> vecVoteHashes;
+
     for (const auto& vote : fileVotes.GetVotes()) {
         uint256 nVoteHash = vote.GetHash();
 
         bool onlyVotingKeyAllowed = govobj.GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL && vote.GetSignal() == VOTE_SIGNAL_FUNDING;
 
-        if (filter.contains(nVoteHash) || !vote.IsValid(onlyVotingKeyAllowed)) {
+        if (filter.contains(nVoteHash) || !vote.IsValid(onlyVotingKeyAllowed, batchVerifier)) {
+            continue;
+        }
+        vecVoteHashes.emplace_back(nVoteHash);
+    }
+
+    batchVerifier.Verify();
+
+    for (const auto& nVoteHash : vecVoteHashes) {
+        if (batchVerifier.badMessages.count(nVoteHash)) {
             continue;
         }
         pnode->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, nVoteHash));
@@ -1188,6 +1218,18 @@ void CGovernanceManager::RebuildIndexes()
     LOCK(cs);
 
     cmapVoteToObject.Clear();
+
+    if (governanceDb) {
+        // all votes are in governanceDb, so there is no need to load them
+        governanceDb->ForEachVoteHash([&](const uint256& nParentHash, const uint256& nVoteHash) {
+            object_m_it it = mapObjects.find(nParentHash);
+            if (it != mapObjects.end()) {
+                cmapVoteToObject.Insert(nVoteHash, &it->second);
+            }
+        });
+        return;
+    }
+
     for (auto& objPair : mapObjects) {
         CGovernanceObject& govobj = objPair.second;
         std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
@@ -1228,6 +1270,110 @@ void CGovernanceManager::InitOnLoad()
     LogPrintf("     %s\n", ToString());
 }
 
+void CGovernanceManager::WriteObjectToDB(CDBBatch& batch, const CGovernanceObject& govobj)
+{
+    AssertLockHeld(cs);
+
+    governanceDb->WriteObject(batch, govobj);
+    mapStoredObjectStates[govobj.GetHash()] = std::make_pair(govobj.GetDeletionTime(), govobj.IsSetExpired());
+}
+
+bool CGovernanceManager::LoadFromDB()
+{
+    LOCK(cs);
+
+    int64_t nStart = GetTimeMillis();
+
+    Clear();
+
+    DBState state(*this);
+    if (!governanceDb->ReadManagerState(state)) {
+        LogPrintf("CGovernanceManager::%s -- no manager state in governance database\n", __func__);
+    }
+
+    bool fOk = governanceDb->LoadObjects([&](CGovernanceObject&& govobj) {
+        uint256 nHash = govobj.GetHash();
+        mapStoredObjectStates[nHash] = std::make_pair(govobj.GetDeletionTime(), govobj.IsSetExpired());
+        mapObjects.emplace(nHash, std::move(govobj));
+    });
+    if (!fOk) {
+        Clear();
+        return false;
+    }
+
+    LogPrintf("Loaded governance objects from database  %dms\n", GetTimeMillis() - nStart);
+    LogPrintf("     %s\n", ToString());
+
+    LogPrintf("%s: Cleaning....\n", __func__);
+    CheckAndRemove();
+    LogPrintf("     %s\n", ToString());
+
+    return true;
+}
+
+bool CGovernanceManager::WriteAllToDB()
+{
+    LOCK(cs);
+
+    int64_t nStart = GetTimeMillis();
+
+    CDBBatch batch = governanceDb->CreateBatch();
+    for (const auto& objPair : mapObjects) {
+        const CGovernanceObject& govobj = objPair.second;
+        LOCK(govobj.cs);
+
+        WriteObjectToDB(batch, govobj);
+        for (const auto& votePair : govobj.mapCurrentMNVotes) {
+            governanceDb->WriteCurrentVotes(batch, objPair.first, votePair.first, votePair.second);
+        }
+        for (const auto& vote : govobj.GetVoteFile().GetVotes()) {
+            governanceDb->WriteVote(batch, vote);
+        }
+
+        // same as in CCoinsViewDB::BatchWrite, don't let the batch grow too large
+        if (batch.SizeEstimate() > 16 * 1024 * 1024) {
+            if (!governanceDb->WriteBatch(batch)) {
+                return false;
+            }
+            batch.Clear();
+        }
+    }
+    governanceDb->WriteManagerState(batch, DBState(*this));
+    if (!governanceDb->WriteBatch(batch, true)) {
+        return false;
+    }
+
+    LogPrintf("Written governance objects to database  %dms\n", GetTimeMillis() - nStart);
+    return true;
+}
+
+bool CGovernanceManager::FlushToDB()
+{
+    if (!governanceDb) {
+        return true;
+    }
+
+    LOCK(cs);
+
+    CDBBatch batch = governanceDb->CreateBatch();
+    int nObjectsWritten = 0;
+    for (const auto& objPair : mapObjects) {
+        const CGovernanceObject& govobj = objPair.second;
+        auto it = mapStoredObjectStates.find(objPair.first);
+        if (it != mapStoredObjectStates.end() &&
+            it->second == std::make_pair(govobj.GetDeletionTime(), govobj.IsSetExpired())) {
+            continue;
+        }
+        WriteObjectToDB(batch, govobj);
+        nObjectsWritten++;
+    }
+    governanceDb->WriteManagerState(batch, DBState(*this));
+
+    LogPrint("gobject", "CGovernanceManager::%s -- wrote %d changed objects\n", __func__, nObjectsWritten);
+
+    return governanceDb->WriteBatch(batch, true);
+}
+
 std::string CGovernanceManager::ToString() const
 {
     LOCK(cs);
@@ -1417,8 +1563,16 @@ void CGovernanceManager::ClearPreDIP3Votes()
     unsigned int minVoteTime = GetMinVoteTime();
 
     LOCK(cs);
+
+    // Votes which are still only in governanceDb were already cleared in an earlier run. Votes older than minVoteTime
+    // are not accepted anymore, so there is no need to load them again
+    bool fSkipStoredVotes = governanceDb && minVoteTime == nPreDIP3VotesClearedTime;
+
     for (auto& p : mapObjects) {
         auto& obj = p.second;
+        if (fSkipStoredVotes && !obj.AreVotesLoaded()) {
+            continue;
+        }
         auto removed = obj.RemoveOldVotes(minVoteTime);
         if (removed.empty()) {
             continue;
@@ -1430,4 +1584,6 @@ void CGovernanceManager::ClearPreDIP3Votes()
             setRequestedVotes.erase(voteHash);
         }
     }
+
+    nPreDIP3VotesClearedTime = minVoteTime;
 }
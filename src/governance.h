@@ -266,6 +266,33 @@ private:
     // used to check for changed voting keys
     CDeterministicMNList lastMNListForVotingKeys;
 
+    // deletion time and expired flag of every object as last written to governanceDb. Objects are only rewritten on
+    // flush when one of these changed
+    std::map<uint256, std::pair<int64_t, bool> > mapStoredObjectStates;
+
+    // min vote time of the last ClearPreDIP3Votes run. Votes stored in governanceDb are already cleared up to it
+    unsigned int nPreDIP3VotesClearedTime;
+
+    // Everything except the objects, stored by governanceDb as a single record
+    struct DBState {
+        CGovernanceManager& man;
+
+        DBState(CGovernanceManager& _man) : man(_man) {}
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action)
+        {
+            READWRITE(man.mapErasedGovernanceObjects);
+            READWRITE(man.cmapInvalidVotes);
+            READWRITE(man.cmmapOrphanVotes);
+            READWRITE(man.mapLastMasternodeObject);
+            READWRITE(man.lastMNListForVotingKeys);
+            READWRITE(man.nPreDIP3VotesClearedTime);
+        }
+    };
+
     class ScopedLockBool
     {
         bool& ref;
@@ -332,6 +359,7 @@ public:
         cmapInvalidVotes.Clear();
         cmmapOrphanVotes.Clear();
         mapLastMasternodeObject.clear();
+        mapStoredObjectStates.clear();
     }
 
     std::string ToString() const;
@@ -419,6 +447,13 @@ public:
 
     void InitOnLoad();
 
+    // Loads all objects (without their votes, which are loaded when needed) and the manager state from governanceDb
+    bool LoadFromDB();
+    // Writes everything to governanceDb, used when migrating from governance.dat
+    bool WriteAllToDB();
+    // Writes the manager state and all objects which changed since the last flush to governanceDb
+    bool FlushToDB();
+
     int RequestGovernanceObjectVotes(CNode* pnode, CConnman& connman);
     int RequestGovernanceObjectVotes(const std::vector<CNode*>& vNodesCopy, CConnman& connman);
 
@@ -447,6 +482,8 @@ private:
 
     void CheckOrphanVotes(CGovernanceObject& govobj, CGovernanceException& exception, CConnman& connman);
 
+    void WriteObjectToDB(CDBBatch& batch, const CGovernanceObject& govobj);
+
     void RebuildIndexes();
 
     void AddCachedTriggers();
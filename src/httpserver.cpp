@@ -6,6 +6,7 @@
 
 #include "chainparamsbase.h"
 #include "compat.h"
+#include "metrics.h"
 #include "util.h"
 #include "netbase.h"
 #include "rpc/protocol.h" // For HTTP status codes
@@ -657,6 +658,27 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod()
     }
 }
 
+static bool HTTPReq_Metrics(HTTPRequest* req, const std::string&)
+{
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "Only GET requests allowed");
+        return false;
+    }
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, GetMetrics().ToPrometheus("sibcoin_"));
+    return true;
+}
+
+void StartHTTPMetrics()
+{
+    RegisterHTTPHandler("/metrics", true, HTTPReq_Metrics);
+}
+
+void StopHTTPMetrics()
+{
+    UnregisterHTTPHandler("/metrics", true);
+}
+
 void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
 {
     LogPrint("http", "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
@@ -12,6 +12,7 @@
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
+static const bool DEFAULT_HTTP_METRICS=false;
 
 struct evhttp_request;
 struct event_base;
@@ -32,6 +33,11 @@ void InterruptHTTPServer();
 /** Stop HTTP server */
 void StopHTTPServer();
 
+/** Serve all metrics (see metrics.h) in the Prometheus text format on /metrics */
+void StartHTTPMetrics();
+/** Stop serving /metrics */
+void StopHTTPMetrics();
+
 /** Handler for requests to a certain HTTP path */
 typedef std::function<bool(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
 /** Register handler for prefix.
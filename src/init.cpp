@@ -19,6 +19,7 @@
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/validation.h"
+#include "crypto/sha256.h"
 #include "httpserver.h"
 #include "httprpc.h"
 #include "key.h"
@@ -51,6 +52,7 @@
 #include "dsnotificationinterface.h"
 #include "flat-database.h"
 #include "governance.h"
+#include "governance-db.h"
 #include "instantx.h"
 #ifdef ENABLE_WALLET
 #include "keepass.h"
@@ -107,6 +109,7 @@ static const bool DEFAULT_PROXYRANDOMIZE = true;
 static const bool DEFAULT_REST_ENABLE = false;
 static const bool DEFAULT_DISABLE_SAFEMODE = false;
 static const bool DEFAULT_STOPAFTERBLOCKIMPORT = false;
+static const int DEFAULT_CACHEDUMPINTERVAL = 0;
 
 
 std::unique_ptr<CConnman> g_connman;
@@ -238,9 +241,14 @@ void PrepareShutdown()
     /// Be sure that anything that writes files or flushes caches only does this if the respective
     /// module was initialized.
     RenameThread("sibcoin-shutoff");
+    // The scheduler threads are stopped by now, deliver what asynchronous listeners still have queued from here
+    // and notify them synchronously from now on
+    GetMainSignals().UnregisterBackgroundSignalScheduler();
+    GetMainSignals().FlushBackgroundCallbacks();
     mempool.AddTransactionsUpdated(1);
     StopHTTPRPC();
     StopREST();
+    StopHTTPMetrics();
     StopRPC();
     StopHTTPServer();
 
@@ -266,6 +274,8 @@ void PrepareShutdown()
     MapPort(false);
     UnregisterValidationInterface(peerLogic.get());
     peerLogic.reset();
+    // releases the nodes referenced by queued masternode messages, must happen before the nodes are deleted
+    mnodeman.StopSigCheckThreads();
     if (g_connman) {
         // make sure to stop all threads before g_connman is reset to nullptr as these threads might still be accessing it
         g_connman->Stop();
@@ -278,10 +288,8 @@ void PrepareShutdown()
         flatdb1.Dump(mnodeman);
         CFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
         flatdb2.Dump(mnpayments);
-        CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
-        flatdb3.Dump(governance);
-        CFlatDB<CNetFulfilledRequestManager> flatdb4("netfulfilled.dat", "magicFulfilledCache");
-        flatdb4.Dump(netfulfilledman);
+        governance.FlushToDB();
+        netfulfilledman.CloseLog();
         if(fEnableInstantSend)
         {
             CFlatDB<CInstantSend> flatdb5("instantsend.dat", "magicInstantSendCache");
@@ -325,6 +333,8 @@ void PrepareShutdown()
         delete evoDb;
         evoDb = NULL;
     }
+    delete governanceDb;
+    governanceDb = NULL;
 #ifdef ENABLE_WALLET
     if (pwalletMain)
         pwalletMain->Flush(true);
@@ -385,6 +395,7 @@ void Shutdown()
     globalVerifyHandle.reset();
     ECC_Stop();
     LogPrintf("%s: done\n", __func__);
+    StopAsyncDebugLog();
 }
 
 /**
@@ -462,6 +473,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf(_("Keep the transaction memory pool below <n> megabytes (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE));
     strUsage += HelpMessageOpt("-mempoolexpiry=<n>", strprintf(_("Do not keep transactions in the mempool longer than <n> hours (default: %u)"), DEFAULT_MEMPOOL_EXPIRY));
     strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
+    strUsage += HelpMessageOpt("-blockreconstructionlocktxn=<n>", strprintf(_("Recent InstantSend and PrivateSend transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_LOCK_TXN));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
 #ifndef WIN32
@@ -499,6 +511,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXRECEIVEBUFFER));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXSENDBUFFER));
     strUsage += HelpMessageOpt("-maxtimeadjustment", strprintf(_("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)"), DEFAULT_MAX_TIME_ADJUSTMENT));
+    strUsage += HelpMessageOpt("-msghandthreads=<n>", strprintf(_("Number of threads handling peer messages, peers are partitioned across them (1 to %d, default: %d)"), MAX_MSGHAND_THREADS, DEFAULT_MSGHAND_THREADS));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), DEFAULT_PERMIT_BAREMULTISIG));
@@ -552,6 +565,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), DEFAULT_CHECKLEVEL));
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
+        strUsage += HelpMessageOpt("-checkgovernancetallies", strprintf("Compare governance vote tallies against a full scan of the current votes on every query (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
         strUsage += HelpMessageOpt("-disablesafemode", strprintf("Disable safemode, override a real safe mode event (default: %u)", DEFAULT_DISABLE_SAFEMODE));
         strUsage += HelpMessageOpt("-testsafemode", strprintf("Force safe mode (default: %u)", DEFAULT_TESTSAFEMODE));
@@ -579,11 +593,16 @@ std::string HelpMessage(HelpMessageMode mode)
     {
         strUsage += HelpMessageOpt("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS));
         strUsage += HelpMessageOpt("-logthreadnames", strprintf("Add thread names to debug messages (default: %u)", DEFAULT_LOGTHREADNAMES));
+        strUsage += HelpMessageOpt("-logasync", strprintf("Write debug.log from a background thread, lines are dropped instead of blocking when the buffer is full (default: %u)", DEFAULT_LOGASYNC));
+        strUsage += HelpMessageOpt("-logbuffersize=<n>", strprintf("Number of lines buffered with -logasync (default: %u)", DEFAULT_LOGBUFFERSIZE));
+        strUsage += HelpMessageOpt("-logflushinterval=<n>", strprintf("Flush debug.log at most every <n> milliseconds with -logasync (default: %u)", DEFAULT_LOGFLUSHINTERVAL));
+        strUsage += HelpMessageOpt("-logratelimit=<n>", strprintf("Log at most <n> debug messages per category and second, 0 = unlimited (default: %u)", DEFAULT_LOGRATELIMIT));
         strUsage += HelpMessageOpt("-mocktime=<n>", "Replace actual time with <n> seconds since epoch (default: 0)");
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default: %u)", DEFAULT_LIMITFREERELAY));
         strUsage += HelpMessageOpt("-relaypriority", strprintf("Require high priority for relaying free or low-fee transactions (default: %u)", DEFAULT_RELAYPRIORITY));
         strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE));
         strUsage += HelpMessageOpt("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE));
+        strUsage += HelpMessageOpt("-schedulerthreads=<n>", strprintf("Number of threads running periodic maintenance tasks (1 to %d, default: %d)", MAX_SCHEDULER_THREADS, DEFAULT_SCHEDULER_THREADS));
     }
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(_("Fees (in %s/kB) smaller than this are considered zero fee for relaying, mining and transaction creation (default: %s)"),
         CURRENCY_UNIT, FormatMoney(DEFAULT_MIN_RELAY_TX_FEE)));
@@ -607,6 +626,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-mnconflock=<n>", strprintf(_("Lock masternodes from masternode configuration file (default: %u)"), 1));
     strUsage += HelpMessageOpt("-masternodeprivkey=<n>", _("Set the masternode private key"));
     strUsage += HelpMessageOpt("-masternodeblsprivkey=<hex>", _("Set the masternode BLS private key"));
+    strUsage += HelpMessageOpt("-cachedumpinterval=<n>", strprintf(_("Write masternode, payment, InstantSend and spork caches to disk every <n> seconds in the background, 0 to only write them on shutdown (default: %u)"), DEFAULT_CACHEDUMPINTERVAL));
 
 #ifdef ENABLE_WALLET
     strUsage += HelpMessageGroup(_("PrivateSend options:"));
@@ -644,6 +664,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageGroup(_("RPC server options:"));
     strUsage += HelpMessageOpt("-server", _("Accept command line and JSON-RPC commands"));
     strUsage += HelpMessageOpt("-rest", strprintf(_("Accept public REST requests (default: %u)"), DEFAULT_REST_ENABLE));
+    strUsage += HelpMessageOpt("-metricsendpoint", strprintf(_("Serve internal metrics in the Prometheus text format on /metrics of the RPC port, without authentication (default: %u)"), DEFAULT_HTTP_METRICS));
     strUsage += HelpMessageOpt("-rpcbind=<addr>", _("Bind to given address to listen for JSON-RPC connections. Use [host]:port notation for IPv6. This option can be specified multiple times (default: bind to all interfaces)"));
     strUsage += HelpMessageOpt("-rpccookiefile=<loc>", _("Location of the auth cookie (default: data dir)"));
     strUsage += HelpMessageOpt("-rpcuser=<user>", _("Username for JSON-RPC connections"));
@@ -693,6 +714,25 @@ static void BlockNotifyCallback(bool initialSync, const CBlockIndex *pBlockIndex
     boost::thread t(runCommand, strCmd); // thread runs free
 }
 
+// Periodic dumps of the masternode caches. Each cache takes its own lock in SerializationOp, so it is only held
+// while serializing into memory and the files are written afterwards.
+static void DumpCacheSnapshots()
+{
+    if (ShutdownRequested()) return;
+
+    CFlatDB<CMasternodeMan> flatdb1("mncache.dat", "magicMasternodeCache");
+    flatdb1.DumpSnapshot(mnodeman);
+    CFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
+    flatdb2.DumpSnapshot(mnpayments);
+    if(fEnableInstantSend)
+    {
+        CFlatDB<CInstantSend> flatdb5("instantsend.dat", "magicInstantSendCache");
+        flatdb5.DumpSnapshot(instantsend);
+    }
+    CFlatDB<CSporkManager> flatdb6("sporks.dat", "magicSporkCache");
+    flatdb6.DumpSnapshot(sporkManager);
+}
+
 static bool fHaveGenesis = false;
 static boost::mutex cs_GenesisWait;
 static CConditionVariable condvar_GenesisWait;
@@ -819,7 +859,7 @@ void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
 
     // scan for better chains in the block chain database, that are not yet connected in the active best chain
     CValidationState state;
-    if (!ActivateBestChain(state, chainparams)) {
+    if (!ActivateBestChain(state, chainparams, std::shared_ptr<const CBlock>(), true)) {
         LogPrintf("Failed to connect best block");
         StartShutdown();
     }
@@ -890,6 +930,8 @@ bool AppInitServers(boost::thread_group& threadGroup)
         return false;
     if (GetBoolArg("-rest", DEFAULT_REST_ENABLE) && !StartREST())
         return false;
+    if (GetBoolArg("-metricsendpoint", DEFAULT_HTTP_METRICS))
+        StartHTTPMetrics();
     if (!StartHTTPServer())
         return false;
     return true;
@@ -1017,6 +1059,7 @@ void InitLogging()
     fLogTimeMicros = GetBoolArg("-logtimemicros", DEFAULT_LOGTIMEMICROS);
     fLogThreadNames = GetBoolArg("-logthreadnames", DEFAULT_LOGTHREADNAMES);
     fLogIPs = GetBoolArg("-logips", DEFAULT_LOGIPS);
+    nLogRateLimit = GetArg("-logratelimit", DEFAULT_LOGRATELIMIT);
 
     LogPrintf("\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n");
     LogPrintf("Sibcoin Core version %s\n", FormatFullVersion());
@@ -1181,6 +1224,7 @@ bool AppInitParameterInteraction()
         mempool.setSanityCheck(1.0 / ratio);
     }
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
+    fCheckGovernanceVoteTallies = GetBoolArg("-checkgovernancetallies", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
 
     hashAssumeValid = uint256S(GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
@@ -1401,6 +1445,9 @@ bool AppInitSanityChecks()
 {
     // ********************************************************* Step 4: sanity checks
 
+    std::string sha256_algo = SHA256AutoDetect();
+    LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+
     // Initialize elliptic curve code
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1434,8 +1481,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         ShrinkDebugFile();
     }
 
-    if (fPrintToDebugLog)
+    if (fPrintToDebugLog) {
         OpenDebugLog();
+        if (GetBoolArg("-logasync", DEFAULT_LOGASYNC))
+            StartAsyncDebugLog(std::max<int64_t>(GetArg("-logbuffersize", DEFAULT_LOGBUFFERSIZE), 1),
+                               std::max<int64_t>(GetArg("-logflushinterval", DEFAULT_LOGFLUSHINTERVAL), 0));
+    }
 
     if (!fLogTimestamps)
         LogPrintf("Startup time: %s\n", DateTimeStrFormat("%Y-%m-%d %H:%M:%S", GetTime()));
@@ -1476,9 +1527,14 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         }
     }
 
-    // Start the lightweight task scheduler thread
+    // Start the lightweight task scheduler threads
+    int nSchedulerThreads = std::max(1, std::min<int>(GetArg("-schedulerthreads", DEFAULT_SCHEDULER_THREADS), MAX_SCHEDULER_THREADS));
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
-    threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    for (int i = 0; i < nSchedulerThreads; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+
+    // Asynchronous validation interface listeners are notified from the scheduler threads
+    GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
 
     /* Start the RPC server already.  It will be started in "warmup" mode
      * and not really process calls already (but it will signify connections
@@ -1656,7 +1712,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     pzmqNotificationInterface = CZMQNotificationInterface::Create();
 
     if (pzmqNotificationInterface) {
-        RegisterValidationInterface(pzmqNotificationInterface);
+        RegisterValidationInterface(pzmqNotificationInterface, "zmq");
     }
 #endif
 
@@ -2083,6 +2139,18 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
             return InitError(_("Failed to load masternode cache from") + "\n" + (pathDB / strDBName).string());
         }
 
+        // Governance objects and votes are written to the database as they change. It's wiped when the masternode cache
+        // is empty, same as governance.dat was not loaded in that case
+        int64_t nGovernanceDbCache = 1024 * 1024 * 8;
+        governanceDb = new CGovernanceDB(nGovernanceDbCache, false, mnodeman.size() == 0);
+        if (!governanceDb->VerifyVersion()) {
+            LogPrintf("Governance database has an incompatible format, wiping it\n");
+            delete governanceDb;
+            governanceDb = new CGovernanceDB(nGovernanceDbCache, false, true);
+        }
+        bool fNewGovernanceDb = governanceDb->IsEmpty();
+        governanceDb->WriteVersion();
+
         if(mnodeman.size()) {
             strDBName = "mnpayments.dat";
             uiInterface.InitMessage(_("Loading masternode payment cache..."));
@@ -2091,21 +2159,32 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 return InitError(_("Failed to load masternode payments cache from") + "\n" + (pathDB / strDBName).string());
             }
 
-            strDBName = "governance.dat";
             uiInterface.InitMessage(_("Loading governance cache..."));
-            CFlatDB<CGovernanceManager> flatdb3(strDBName, "magicGovernanceCache");
-            if(!flatdb3.Load(governance)) {
-                return InitError(_("Failed to load governance cache from") + "\n" + (pathDB / strDBName).string());
+            if (fNewGovernanceDb && boost::filesystem::exists(pathDB / "governance.dat")) {
+                // migrate from the old flat file
+                strDBName = "governance.dat";
+                CFlatDB<CGovernanceManager> flatdb3(strDBName, "magicGovernanceCache");
+                if(!flatdb3.Load(governance) || !governance.WriteAllToDB()) {
+                    return InitError(_("Failed to load governance cache from") + "\n" + (pathDB / strDBName).string());
+                }
+            } else if (!governance.LoadFromDB()) {
+                return InitError(_("Failed to load governance cache from") + "\n" + (pathDB / "governance").string());
             }
             governance.InitOnLoad();
         } else {
             uiInterface.InitMessage(_("Masternode cache is empty, skipping payments and governance cache..."));
         }
 
-        strDBName = "netfulfilled.dat";
+        strDBName = "netfulfilled.log";
         uiInterface.InitMessage(_("Loading fulfilled requests cache..."));
-        CFlatDB<CNetFulfilledRequestManager> flatdb4(strDBName, "magicFulfilledCache");
-        if(!flatdb4.Load(netfulfilledman)) {
+        if (!boost::filesystem::exists(pathDB / strDBName)) {
+            // the log is created from the old cache file on first start
+            CFlatDB<CNetFulfilledRequestManager> flatdb4("netfulfilled.dat", "magicFulfilledCache");
+            if(!flatdb4.Load(netfulfilledman)) {
+                return InitError(_("Failed to load fulfilled requests cache from") + "\n" + (pathDB / "netfulfilled.dat").string());
+            }
+        }
+        if(!netfulfilledman.OpenLog(strDBName)) {
             return InitError(_("Failed to load fulfilled requests cache from") + "\n" + (pathDB / strDBName).string());
         }
 
@@ -2121,23 +2200,31 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     }
 
     // ********************************************************* Step 11c: schedule Dash-specific tasks
+    // Tasks of one subsystem share a serial queue, different subsystems can run in parallel
 
     if (!fLiteMode) {
-        scheduler.scheduleEvery(boost::bind(&CNetFulfilledRequestManager::DoMaintenance, boost::ref(netfulfilledman)), 60);
-        scheduler.scheduleEvery(boost::bind(&CMasternodeSync::DoMaintenance, boost::ref(masternodeSync), boost::ref(*g_connman)), 1);
-        scheduler.scheduleEvery(boost::bind(&CMasternodeMan::DoMaintenance, boost::ref(mnodeman), boost::ref(*g_connman)), 1);
-        scheduler.scheduleEvery(boost::bind(&CActiveLegacyMasternodeManager::DoMaintenance, boost::ref(legacyActiveMasternodeManager), boost::ref(*g_connman)), MASTERNODE_MIN_MNP_SECONDS);
+        mnodeman.StartSigCheckThreads();
+
+        scheduler.scheduleEvery(boost::bind(&CNetFulfilledRequestManager::DoMaintenance, boost::ref(netfulfilledman)), 60, "netfulfilled");
+        scheduler.scheduleEvery(boost::bind(&CMasternodeSync::DoMaintenance, boost::ref(masternodeSync), boost::ref(*g_connman)), 1, "masternode");
+        scheduler.scheduleEvery(boost::bind(&CMasternodeMan::DoMaintenance, boost::ref(mnodeman), boost::ref(*g_connman)), 1, "masternode");
+        scheduler.scheduleEvery(boost::bind(&CActiveLegacyMasternodeManager::DoMaintenance, boost::ref(legacyActiveMasternodeManager), boost::ref(*g_connman)), MASTERNODE_MIN_MNP_SECONDS, "masternode");
 
-        scheduler.scheduleEvery(boost::bind(&CMasternodePayments::DoMaintenance, boost::ref(mnpayments)), 60);
-        scheduler.scheduleEvery(boost::bind(&CGovernanceManager::DoMaintenance, boost::ref(governance), boost::ref(*g_connman)), 60 * 5);
+        scheduler.scheduleEvery(boost::bind(&CMasternodePayments::DoMaintenance, boost::ref(mnpayments)), 60, "masternode");
+        scheduler.scheduleEvery(boost::bind(&CGovernanceManager::DoMaintenance, boost::ref(governance), boost::ref(*g_connman)), 60 * 5, "governance");
 
-        scheduler.scheduleEvery(boost::bind(&CInstantSend::DoMaintenance, boost::ref(instantsend)), 60);
+        scheduler.scheduleEvery(boost::bind(&CInstantSend::DoMaintenance, boost::ref(instantsend)), 60, "instantsend");
+
+        int nCacheDumpInterval = GetArg("-cachedumpinterval", DEFAULT_CACHEDUMPINTERVAL);
+        if (nCacheDumpInterval > 0) {
+            scheduler.scheduleEvery(boost::bind(&DumpCacheSnapshots), nCacheDumpInterval, "cachedump");
+        }
 
         if (fMasternodeMode)
-            scheduler.scheduleEvery(boost::bind(&CPrivateSendServer::DoMaintenance, boost::ref(privateSendServer), boost::ref(*g_connman)), 1);
+            scheduler.scheduleEvery(boost::bind(&CPrivateSendServer::DoMaintenance, boost::ref(privateSendServer), boost::ref(*g_connman)), 1, "privatesend");
 #ifdef ENABLE_WALLET
         else
-            scheduler.scheduleEvery(boost::bind(&CPrivateSendClientManager::DoMaintenance, boost::ref(privateSendClient), boost::ref(*g_connman)), 1);
+            scheduler.scheduleEvery(boost::bind(&CPrivateSendClientManager::DoMaintenance, boost::ref(privateSendClient), boost::ref(*g_connman)), 1, "privatesend");
 #endif // ENABLE_WALLET
     }
 
@@ -2166,6 +2253,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     connOptions.uiInterface = &uiInterface;
     connOptions.nSendBufferMaxSize = 1000*GetArg("-maxsendbuffer", DEFAULT_MAXSENDBUFFER);
     connOptions.nReceiveFloodSize = 1000*GetArg("-maxreceivebuffer", DEFAULT_MAXRECEIVEBUFFER);
+    connOptions.nMessageHandlerThreads = GetArg("-msghandthreads", DEFAULT_MSGHAND_THREADS);
 
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
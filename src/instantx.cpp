@@ -82,11 +82,8 @@ void CInstantSend::ProcessMessage(CNode* pfrom, const std::string& strCommand, C
         // Ignore any InstantSend messages until masternode list is synced
         if (!masternodeSync.IsMasternodeListSynced()) return;
 
-        {
-            LOCK(cs_instantsend);
-            auto ret = mapTxLockVotes.emplace(nVoteHash, vote);
-            if (!ret.second) return;
-        }
+        // only the vote's shard is locked here, so duplicate votes are dropped without waiting for cs_instantsend
+        if (!mapTxLockVotes.Insert(nVoteHash, vote)) return;
 
         ProcessNewTxLockVote(pfrom, vote, connman);
 
@@ -106,11 +103,11 @@ bool CInstantSend::ProcessTxLockRequest(const CTxLockRequest& txLockRequest, CCo
 
     // Check to see if we conflict with existing completed lock
     for (const auto& txin : txLockRequest.tx->vin) {
-        std::map<COutPoint, uint256>::iterator it = mapLockedOutpoints.find(txin.prevout);
-        if (it != mapLockedOutpoints.end() && it->second != txLockRequest.GetHash()) {
+        uint256 hashLocked;
+        if (mapLockedOutpoints.Get(txin.prevout, hashLocked) && hashLocked != txLockRequest.GetHash()) {
             // Conflicting with complete lock, proceed to see if we should cancel them both
             LogPrintf("CInstantSend::ProcessTxLockRequest -- WARNING: Found conflicting completed Transaction Lock, txid=%s, completed lock txid=%s\n",
-                    txLockRequest.GetHash().ToString(), it->second.ToString());
+                    txLockRequest.GetHash().ToString(), hashLocked.ToString());
         }
     }
 
@@ -231,7 +228,7 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate, CConnman& connman)
 
     uint256 txHash = txLockCandidate.GetHash();
     // We should never vote on a Transaction Lock Request that was not (yet) accepted by the mempool
-    if (mapLockRequestAccepted.find(txHash) == mapLockRequestAccepted.end()) return;
+    if (!mapLockRequestAccepted.HasKey(txHash)) return;
     // check if we need to vote on this candidate's outpoints,
     // it's possible that we need to vote for several of them
     for (auto& outpointLockPair : txLockCandidate.mapOutPointLocks) {
@@ -300,7 +297,7 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate, CConnman& connman)
 
         // vote constructed sucessfully, let's store and relay it
         uint256 nVoteHash = vote.GetHash();
-        mapTxLockVotes.insert(std::make_pair(nVoteHash, vote));
+        mapTxLockVotes.Insert(nVoteHash, vote);
         if (outpointLockPair.second.AddVote(vote)) {
             LogPrintf("CInstantSend::Vote -- Vote created successfully, relaying: txHash=%s, outpoint=%s, vote=%s\n",
                     txHash.ToString(), outpointLockPair.first.ToStringShort(), nVoteHash.ToString());
@@ -560,18 +557,15 @@ void CInstantSend::LockTransactionInputs(const CTxLockCandidate& txLockCandidate
     if (!txLockCandidate.IsAllOutPointsReady()) return;
 
     for (const auto& pair : txLockCandidate.mapOutPointLocks) {
-        mapLockedOutpoints.insert(std::make_pair(pair.first, txHash));
+        mapLockedOutpoints.Insert(pair.first, txHash);
     }
     LogPrint("instantsend", "CInstantSend::LockTransactionInputs -- done, txid=%s\n", txHash.ToString());
 }
 
 bool CInstantSend::GetLockedOutPointTxHash(const COutPoint& outpoint, uint256& hashRet)
 {
-    LOCK(cs_instantsend);
-    std::map<COutPoint, uint256>::iterator it = mapLockedOutpoints.find(outpoint);
-    if (it == mapLockedOutpoints.end()) return false;
-    hashRet = it->second;
-    return true;
+    // no cs_instantsend here, see mapLockedOutpoints
+    return mapLockedOutpoints.Get(outpoint, hashRet);
 }
 
 bool CInstantSend::ResolveConflicts(const CTxLockCandidate& txLockCandidate)
@@ -607,8 +601,8 @@ bool CInstantSend::ResolveConflicts(const CTxLockCandidate& txLockCandidate)
             itLockCandidateConflicting->second.SetConfirmedHeight(0); // expired
             CheckAndRemove(); // clean up
             // AlreadyHave should still return "true" for both of them
-            mapLockRequestRejected.insert(std::make_pair(txHash, txLockRequest));
-            mapLockRequestRejected.insert(std::make_pair(hashConflicting, txLockRequestConflicting));
+            mapLockRequestRejected.Insert(txHash, txLockRequest);
+            mapLockRequestRejected.Insert(hashConflicting, txLockRequestConflicting);
 
             // TODO: clean up mapLockRequestRejected later somehow
             //       (not a big issue since we already PoSe ban malicious masternodes
@@ -680,11 +674,11 @@ void CInstantSend::CheckAndRemove()
             LogPrintf("CInstantSend::CheckAndRemove -- Removing expired Transaction Lock Candidate: txid=%s\n", txHash.ToString());
 
             for (const auto& pair : txLockCandidate.mapOutPointLocks) {
-                mapLockedOutpoints.erase(pair.first);
+                mapLockedOutpoints.Erase(pair.first);
                 mapVotedOutpoints.erase(pair.first);
             }
-            mapLockRequestAccepted.erase(txHash);
-            mapLockRequestRejected.erase(txHash);
+            mapLockRequestAccepted.Erase(txHash);
+            mapLockRequestRejected.Erase(txHash);
             mapTxLockCandidates.erase(itLockCandidate++);
         } else {
             ++itLockCandidate;
@@ -692,16 +686,12 @@ void CInstantSend::CheckAndRemove()
     }
 
     // remove expired votes
-    std::map<uint256, CTxLockVote>::iterator itVote = mapTxLockVotes.begin();
-    while (itVote != mapTxLockVotes.end()) {
-        if (itVote->second.IsExpired(nCachedBlockHeight)) {
-            LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing expired vote: txid=%s  masternode=%s\n",
-                    itVote->second.GetTxHash().ToString(), itVote->second.GetMasternodeOutpoint().ToStringShort());
-            mapTxLockVotes.erase(itVote++);
-        } else {
-            ++itVote;
-        }
-    }
+    mapTxLockVotes.EraseIf([&](const uint256& nVoteHash, const CTxLockVote& vote) {
+        if (!vote.IsExpired(nCachedBlockHeight)) return false;
+        LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing expired vote: txid=%s  masternode=%s\n",
+                vote.GetTxHash().ToString(), vote.GetMasternodeOutpoint().ToStringShort());
+        return true;
+    });
 
     // remove timed out orphan votes
     std::map<uint256, CTxLockVote>::iterator itOrphanVote = mapTxLockVotesOrphan.begin();
@@ -709,7 +699,7 @@ void CInstantSend::CheckAndRemove()
         if (itOrphanVote->second.IsTimedOut()) {
             LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing timed out orphan vote: txid=%s  masternode=%s\n",
                     itOrphanVote->second.GetTxHash().ToString(), itOrphanVote->second.GetMasternodeOutpoint().ToStringShort());
-            mapTxLockVotes.erase(itOrphanVote->first);
+            mapTxLockVotes.Erase(itOrphanVote->first);
             mapTxLockVotesOrphan.erase(itOrphanVote++);
         } else {
             ++itOrphanVote;
@@ -717,16 +707,12 @@ void CInstantSend::CheckAndRemove()
     }
 
     // remove invalid votes and votes for failed lock attempts
-    itVote = mapTxLockVotes.begin();
-    while (itVote != mapTxLockVotes.end()) {
-        if (itVote->second.IsFailed()) {
-            LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing vote for failed lock attempt: txid=%s  masternode=%s\n",
-                    itVote->second.GetTxHash().ToString(), itVote->second.GetMasternodeOutpoint().ToStringShort());
-            mapTxLockVotes.erase(itVote++);
-        } else {
-            ++itVote;
-        }
-    }
+    mapTxLockVotes.EraseIf([&](const uint256& nVoteHash, const CTxLockVote& vote) {
+        if (!vote.IsFailed()) return false;
+        LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing vote for failed lock attempt: txid=%s  masternode=%s\n",
+                vote.GetTxHash().ToString(), vote.GetMasternodeOutpoint().ToStringShort());
+        return true;
+    });
 
     // remove timed out masternode orphan votes (DOS protection)
     std::map<COutPoint, int64_t>::iterator itMasternodeOrphan = mapMasternodeOrphanVotes.begin();
@@ -744,22 +730,22 @@ void CInstantSend::CheckAndRemove()
 
 bool CInstantSend::AlreadyHave(const uint256& hash)
 {
-    LOCK(cs_instantsend);
-    return mapLockRequestAccepted.count(hash) ||
-            mapLockRequestRejected.count(hash) ||
-            mapTxLockVotes.count(hash);
+    // no cs_instantsend here, see mapLockRequestAccepted/mapLockRequestRejected/mapTxLockVotes
+    return mapLockRequestAccepted.HasKey(hash) ||
+            mapLockRequestRejected.HasKey(hash) ||
+            mapTxLockVotes.HasKey(hash);
 }
 
 void CInstantSend::AcceptLockRequest(const CTxLockRequest& txLockRequest)
 {
     LOCK(cs_instantsend);
-    mapLockRequestAccepted.insert(std::make_pair(txLockRequest.GetHash(), txLockRequest));
+    mapLockRequestAccepted.Insert(txLockRequest.GetHash(), txLockRequest);
 }
 
 void CInstantSend::RejectLockRequest(const CTxLockRequest& txLockRequest)
 {
     LOCK(cs_instantsend);
-    mapLockRequestRejected.insert(std::make_pair(txLockRequest.GetHash(), txLockRequest));
+    mapLockRequestRejected.Insert(txLockRequest.GetHash(), txLockRequest);
 }
 
 bool CInstantSend::HasTxLockRequest(const uint256& txHash)
@@ -781,26 +767,20 @@ bool CInstantSend::GetTxLockRequest(const uint256& txHash, CTxLockRequest& txLoc
 
 bool CInstantSend::GetTxLockVote(const uint256& hash, CTxLockVote& txLockVoteRet)
 {
-    LOCK(cs_instantsend);
-
-    std::map<uint256, CTxLockVote>::iterator it = mapTxLockVotes.find(hash);
-    if (it == mapTxLockVotes.end()) return false;
-    txLockVoteRet = it->second;
-
-    return true;
+    return mapTxLockVotes.Get(hash, txLockVoteRet);
 }
 
 void CInstantSend::Clear()
 {
     LOCK(cs_instantsend);
 
-    mapLockRequestAccepted.clear();
-    mapLockRequestRejected.clear();
-    mapTxLockVotes.clear();
+    mapLockRequestAccepted.Clear();
+    mapLockRequestRejected.Clear();
+    mapTxLockVotes.Clear();
     mapTxLockVotesOrphan.clear();
     mapTxLockCandidates.clear();
     mapVotedOutpoints.clear();
-    mapLockedOutpoints.clear();
+    mapLockedOutpoints.Clear();
     mapMasternodeOrphanVotes.clear();
     nCachedBlockHeight = 0;
 }
@@ -903,10 +883,9 @@ void CInstantSend::SyncTransaction(const CTransaction& tx, const CBlockIndex *pi
                 uint256 nVoteHash = vote.GetHash();
                 LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d vote %s updated\n",
                         txHash.ToString(), nHeightNew, nVoteHash.ToString());
-                const auto& it = mapTxLockVotes.find(nVoteHash);
-                if (it != mapTxLockVotes.end()) {
-                    it->second.SetConfirmedHeight(nHeightNew);
-                }
+                mapTxLockVotes.Update(nVoteHash, [&](CTxLockVote& voteStored) {
+                    voteStored.SetConfirmedHeight(nHeightNew);
+                });
             }
         }
     }
@@ -916,7 +895,9 @@ void CInstantSend::SyncTransaction(const CTransaction& tx, const CBlockIndex *pi
         if (pair.second.GetTxHash() == txHash) {
             LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d vote %s updated\n",
                     txHash.ToString(), nHeightNew, pair.first.ToString());
-            mapTxLockVotes[pair.first].SetConfirmedHeight(nHeightNew);
+            mapTxLockVotes.Update(pair.first, [&](CTxLockVote& voteStored) {
+                voteStored.SetConfirmedHeight(nHeightNew);
+            });
         }
     }
 }
@@ -924,7 +905,7 @@ void CInstantSend::SyncTransaction(const CTransaction& tx, const CBlockIndex *pi
 std::string CInstantSend::ToString() const
 {
     LOCK(cs_instantsend);
-    return strprintf("Lock Candidates: %llu, Votes %llu", mapTxLockCandidates.size(), mapTxLockVotes.size());
+    return strprintf("Lock Candidates: %llu, Votes %llu", mapTxLockCandidates.size(), mapTxLockVotes.Size());
 }
 
 void CInstantSend::DoMaintenance()
@@ -5,8 +5,11 @@
 #define INSTANTX_H
 
 #include "chain.h"
+#include "coins.h"
 #include "net.h"
 #include "primitives/transaction.h"
+#include "shardedmap.h"
+#include "txmempool.h"
 
 #include "evo/deterministicmns.h"
 
@@ -55,15 +58,20 @@ private:
     int nCachedBlockHeight;
 
     // maps for AlreadyHave
-    std::map<uint256, CTxLockRequest> mapLockRequestAccepted; ///< Tx hash - Tx
-    std::map<uint256, CTxLockRequest> mapLockRequestRejected; ///< Tx hash - Tx
-    std::map<uint256, CTxLockVote> mapTxLockVotes; ///< Vote hash - Vote
+    // NOTE: these are sharded and can be read without holding cs_instantsend, which keeps AlreadyHave and
+    // GetTxLockVote off the lock while vote floods are processed. Entries are still only added/removed under
+    // cs_instantsend (except for the initial vote dedup in ProcessMessage), so they stay consistent with the
+    // lock candidates.
+    CShardedMap<uint256, CTxLockRequest, SaltedTxidHasher> mapLockRequestAccepted; ///< Tx hash - Tx
+    CShardedMap<uint256, CTxLockRequest, SaltedTxidHasher> mapLockRequestRejected; ///< Tx hash - Tx
+    CShardedMap<uint256, CTxLockVote, SaltedTxidHasher> mapTxLockVotes; ///< Vote hash - Vote
     std::map<uint256, CTxLockVote> mapTxLockVotesOrphan; ///< Vote hash - Vote
 
     std::map<uint256, CTxLockCandidate> mapTxLockCandidates; ///< Tx hash - Lock candidate
 
     std::map<COutPoint, std::set<uint256> > mapVotedOutpoints; ///< UTXO - Tx hash set
-    std::map<COutPoint, uint256> mapLockedOutpoints; ///< UTXO - Tx hash
+    /// Sharded for the same reason, GetLockedOutPointTxHash is called for every input in ConnectBlock/ATMP
+    CShardedMap<COutPoint, uint256, SaltedOutpointHasher> mapLockedOutpoints; ///< UTXO - Tx hash
 
     /// Track masternodes who voted with no txlockrequest (for DOS protection)
     std::map<COutPoint, int64_t> mapMasternodeOrphanVotes; ///< MN outpoint - Time
@@ -93,6 +101,7 @@ public:
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
+        LOCK(cs_instantsend);
         std::string strVersion;
         if(ser_action.ForRead()) {
             READWRITE(strVersion);
@@ -0,0 +1,134 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "logwriter.h"
+
+#include "tinyformat.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <chrono>
+
+// upper limit for a single write, so that a busy ring is still flushed regularly
+static const size_t MAX_WRITE_BATCH_SIZE = 1 << 20;
+// how long the writer sleeps when there is nothing to write or flush, a push wakes it up earlier
+static const int64_t IDLE_WAIT_MS = 100;
+
+CAsyncLogWriter::CAsyncLogWriter(size_t nBufferSize) :
+    ring(nBufferSize)
+{
+}
+
+CAsyncLogWriter::~CAsyncLogWriter()
+{
+    Stop();
+}
+
+void CAsyncLogWriter::Start(const WriteFunc& write, const FlushFunc& flush, int64_t nFlushIntervalMsIn)
+{
+    assert(!thread.joinable());
+
+    writeFunc = write;
+    flushFunc = flush;
+    nFlushIntervalMs = nFlushIntervalMsIn;
+    fStopping = false;
+    thread = std::thread(&CAsyncLogWriter::WriterThread, this);
+    fRunning = true;
+}
+
+void CAsyncLogWriter::Stop()
+{
+    if (!thread.joinable()) {
+        return;
+    }
+    // new lines are written by the callers again, wait for the ones which already decided to push
+    fRunning = false;
+    while (nPushing > 0) {
+        std::this_thread::yield();
+    }
+    {
+        std::unique_lock<std::mutex> l(mutex);
+        fStopping = true;
+    }
+    cond.notify_one();
+    thread.join();
+}
+
+bool CAsyncLogWriter::Push(std::string&& str)
+{
+    nPushing++;
+    if (!fRunning) {
+        nPushing--;
+        return false;
+    }
+    if (!ring.TryPush(std::move(str))) {
+        nDropped++;
+    }
+    nPushing--;
+    if (fWriterSleeping) {
+        cond.notify_one();
+    }
+    return true;
+}
+
+bool CAsyncLogWriter::Drain()
+{
+    std::string strBatch;
+    std::string str;
+    while (strBatch.size() < MAX_WRITE_BATCH_SIZE && ring.TryPop(str)) {
+        strBatch += str;
+    }
+
+    uint64_t nDroppedNow = nDropped;
+    if (nDroppedNow != nDroppedReported) {
+        strBatch += strprintf("%s *** %d log messages dropped, log buffer full ***\n",
+                              DateTimeStrFormat("%Y-%m-%d %H:%M:%S", GetTime()), nDroppedNow - nDroppedReported);
+        nDroppedReported = nDroppedNow;
+    }
+
+    if (strBatch.empty()) {
+        return false;
+    }
+    writeFunc(strBatch);
+    return true;
+}
+
+void CAsyncLogWriter::WriterThread()
+{
+    RenameThread("sibcoin-logwriter");
+
+    int64_t nLastFlush = GetTimeMillis();
+    bool fFlushPending = false;
+    while (true) {
+        bool fWritten = Drain();
+        fFlushPending |= fWritten;
+
+        int64_t nNow = GetTimeMillis();
+        if (fFlushPending && nNow - nLastFlush >= nFlushIntervalMs) {
+            flushFunc();
+            fFlushPending = false;
+            nLastFlush = nNow;
+        }
+        if (fWritten) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> l(mutex);
+        if (fStopping) {
+            break;
+        }
+        // producers don't take the mutex, so a push might slip in between the check above and waiting. The timeout
+        // bounds the delay such a line sees
+        fWriterSleeping = true;
+        if (ring.Empty()) {
+            int64_t nWait = fFlushPending ? nFlushIntervalMs - (nNow - nLastFlush) : IDLE_WAIT_MS;
+            cond.wait_for(l, std::chrono::milliseconds(std::max<int64_t>(nWait, 1)));
+        }
+        fWriterSleeping = false;
+    }
+
+    // Stop() made sure nobody pushes anymore
+    while (Drain()) {}
+    flushFunc();
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DASH_LOGWRITER_H
+#define DASH_LOGWRITER_H
+
+#include "ringbuffer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * Writes log lines from a dedicated thread.
+ *
+ * Logging threads only move the formatted line into a lock-free ring buffer (see CRingBuffer). The writer thread
+ * drains it, hands the lines to the write callback in batches and calls the flush callback at most every
+ * nFlushIntervalMs milliseconds (and when stopping). If the ring is full, lines are dropped and counted instead of
+ * blocking the logging thread. The writer reports the number of dropped lines in the log itself once there is room
+ * again.
+ */
+class CAsyncLogWriter
+{
+public:
+    typedef std::function<void(const std::string&)> WriteFunc;
+    typedef std::function<void()> FlushFunc;
+
+private:
+    CRingBuffer<std::string> ring;
+    WriteFunc writeFunc;
+    FlushFunc flushFunc;
+    int64_t nFlushIntervalMs{0};
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::atomic<bool> fRunning{false};
+    std::atomic<bool> fStopping{false};
+    std::atomic<bool> fWriterSleeping{false};
+    // number of threads currently between checking fRunning and pushing, Stop() waits for them
+    std::atomic<int> nPushing{0};
+
+    std::atomic<uint64_t> nDropped{0};
+    uint64_t nDroppedReported{0};
+
+    void WriterThread();
+    // Writes out everything currently queued. Returns true if anything was written
+    bool Drain();
+
+public:
+    explicit CAsyncLogWriter(size_t nBufferSize);
+    ~CAsyncLogWriter();
+
+    CAsyncLogWriter(const CAsyncLogWriter&) = delete;
+    CAsyncLogWriter& operator=(const CAsyncLogWriter&) = delete;
+
+    void Start(const WriteFunc& write, const FlushFunc& flush, int64_t nFlushIntervalMsIn);
+    // Writes and flushes everything pushed before Stop() returns
+    void Stop();
+
+    // Queues str for writing. Returns false if the writer is not running, in which case the caller must write
+    // str itself. Returns true if str was queued or dropped because the buffer is full
+    bool Push(std::string&& str);
+
+    uint64_t GetDroppedCount() const { return nDropped; }
+};
+
+#endif // DASH_LOGWRITER_H
@@ -28,6 +28,7 @@ static const int MIN_MASTERNODE_PAYMENT_PROTO_VERSION_2 = 70210;
 
 extern CCriticalSection cs_vecPayees;
 extern CCriticalSection cs_mapMasternodeBlocks;
+extern CCriticalSection cs_mapMasternodePaymentVotes;
 
 extern CMasternodePayments mnpayments;
 
@@ -91,6 +92,7 @@ public:
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
+        LOCK(cs_vecPayees);
         READWRITE(nBlockHeight);
         READWRITE(vecPayees);
     }
@@ -183,6 +185,7 @@ public:
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
+        LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
         READWRITE(mapMasternodePaymentVotes);
         READWRITE(mapMasternodeBlocks);
     }
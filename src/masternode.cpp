@@ -4,6 +4,7 @@
 
 #include "activemasternode.h"
 #include "base58.h"
+#include "cachemap.h"
 #include "clientversion.h"
 #include "init.h"
 #include "netbase.h"
@@ -22,6 +23,24 @@
 
 #include <string>
 
+// Results of mnb/mnp signature checks, so that messages which were already verified (in parallel by CMasternodeMan, or
+// when received from multiple peers) are not verified again. Keyed by everything the result depends on
+static const size_t MAX_SIG_CHECK_RESULTS = 50000;
+static CCriticalSection cs_mapSigCheckResults;
+static CacheMap<uint256, bool> mapSigCheckResults(MAX_SIG_CHECK_RESULTS);
+
+static bool GetCachedSigCheckResult(const uint256& hashCheck, bool& fValidRet)
+{
+    LOCK(cs_mapSigCheckResults);
+    return mapSigCheckResults.Get(hashCheck, fValidRet);
+}
+
+static void CacheSigCheckResult(const uint256& hashCheck, bool fValid)
+{
+    LOCK(cs_mapSigCheckResults);
+    mapSigCheckResults.Insert(hashCheck, fValid);
+}
+
 
 CMasternode::CMasternode() :
     masternode_info_t{ MASTERNODE_ENABLED, PROTOCOL_VERSION, GetAdjustedTime()}
@@ -687,32 +706,48 @@ bool CMasternodeBroadcast::CheckSignature(int& nDos) const
     std::string strError = "";
     nDos = 0;
 
-    if (sporkManager.IsSporkActive(SPORK_6_NEW_SIGS)) {
-        uint256 hash = GetSignatureHash();
+    bool fNewSigs = sporkManager.IsSporkActive(SPORK_6_NEW_SIGS);
+    uint256 hash = GetSignatureHash();
 
-        if (!CHashSigner::VerifyHash(hash, keyIDCollateralAddress, vchSig, strError)) {
+    // the signature hash covers all fields of the old message format too
+    CHashWriter hwCheck(SER_GETHASH, 0);
+    hwCheck << hash << keyIDCollateralAddress << vchSig << fNewSigs;
+    uint256 hashCheck = hwCheck.GetHash();
+
+    bool fValid;
+    if (GetCachedSigCheckResult(hashCheck, fValid)) {
+        if (!fValid) {
+            LogPrint("masternode", "CMasternodeBroadcast::CheckSignature -- Got bad Masternode announce signature (cached), masternode=%s\n", outpoint.ToStringShort());
+            nDos = 100;
+        }
+        return fValid;
+    }
+
+    if (fNewSigs) {
+        fValid = CHashSigner::VerifyHash(hash, keyIDCollateralAddress, vchSig, strError);
+        if (!fValid) {
             // maybe it's in old format
             std::string strMessage = addr.ToString(false) + std::to_string(sigTime) +
                             keyIDCollateralAddress.ToString() + legacyKeyIDOperator.ToString() +
                             std::to_string(nProtocolVersion);
 
-            if (!CMessageSigner::VerifyMessage(keyIDCollateralAddress, vchSig, strMessage, strError)){
-                // nope, not in old format either
-                LogPrintf("CMasternodeBroadcast::CheckSignature -- Got bad Masternode announce signature, error: %s\n", strError);
-                nDos = 100;
-                return false;
-            }
+            // nope, not in old format either
+            fValid = CMessageSigner::VerifyMessage(keyIDCollateralAddress, vchSig, strMessage, strError);
         }
     } else {
         std::string strMessage = addr.ToString(false) + std::to_string(sigTime) +
                         keyIDCollateralAddress.ToString() + legacyKeyIDOperator.ToString() +
                         std::to_string(nProtocolVersion);
 
-        if(!CMessageSigner::VerifyMessage(keyIDCollateralAddress, vchSig, strMessage, strError)){
-            LogPrintf("CMasternodeBroadcast::CheckSignature -- Got bad Masternode announce signature, error: %s\n", strError);
-            nDos = 100;
-            return false;
-        }
+        fValid = CMessageSigner::VerifyMessage(keyIDCollateralAddress, vchSig, strMessage, strError);
+    }
+
+    CacheSigCheckResult(hashCheck, fValid);
+
+    if (!fValid) {
+        LogPrintf("CMasternodeBroadcast::CheckSignature -- Got bad Masternode announce signature, error: %s\n", strError);
+        nDos = 100;
+        return false;
     }
 
     return true;
@@ -807,28 +842,46 @@ bool CMasternodePing::CheckSignature(CKeyID& keyIDOperator, int &nDos) const
     std::string strError = "";
     nDos = 0;
 
-    if (sporkManager.IsSporkActive(SPORK_6_NEW_SIGS)) {
+    bool fNewSigs = sporkManager.IsSporkActive(SPORK_6_NEW_SIGS);
+
+    // GetHash() doesn't cover all signed fields when the old format is used
+    CHashWriter hwCheck(SER_GETHASH, 0);
+    hwCheck << masternodeOutpoint << blockHash << sigTime << fSentinelIsCurrent << nSentinelVersion << nDaemonVersion;
+    hwCheck << keyIDOperator << vchSig << fNewSigs;
+    uint256 hashCheck = hwCheck.GetHash();
+
+    bool fValid;
+    if (GetCachedSigCheckResult(hashCheck, fValid)) {
+        if (!fValid) {
+            LogPrint("masternode", "CMasternodePing::CheckSignature -- Got bad Masternode ping signature (cached), masternode=%s\n", masternodeOutpoint.ToStringShort());
+            nDos = 33;
+        }
+        return fValid;
+    }
+
+    if (fNewSigs) {
         uint256 hash = GetSignatureHash();
 
-        if (!CHashSigner::VerifyHash(hash, keyIDOperator, vchSig, strError)) {
+        fValid = CHashSigner::VerifyHash(hash, keyIDOperator, vchSig, strError);
+        if (!fValid) {
             std::string strMessage = CTxIn(masternodeOutpoint).ToString() + blockHash.ToString() +
                         std::to_string(sigTime);
 
-            if(!CMessageSigner::VerifyMessage(keyIDOperator, vchSig, strMessage, strError)) {
-                LogPrintf("CMasternodePing::CheckSignature -- Got bad Masternode ping signature, masternode=%s, error: %s\n", masternodeOutpoint.ToStringShort(), strError);
-                nDos = 33;
-                return false;
-            }
+            fValid = CMessageSigner::VerifyMessage(keyIDOperator, vchSig, strMessage, strError);
         }
     } else {
         std::string strMessage = CTxIn(masternodeOutpoint).ToString() + blockHash.ToString() +
                     std::to_string(sigTime);
 
-        if (!CMessageSigner::VerifyMessage(keyIDOperator, vchSig, strMessage, strError)) {
-            LogPrintf("CMasternodePing::CheckSignature -- Got bad Masternode ping signature, masternode=%s, error: %s\n", masternodeOutpoint.ToStringShort(), strError);
-            nDos = 33;
-            return false;
-        }
+        fValid = CMessageSigner::VerifyMessage(keyIDOperator, vchSig, strMessage, strError);
+    }
+
+    CacheSigCheckResult(hashCheck, fValid);
+
+    if (!fValid) {
+        LogPrintf("CMasternodePing::CheckSignature -- Got bad Masternode ping signature, masternode=%s, error: %s\n", masternodeOutpoint.ToStringShort(), strError);
+        nDos = 33;
+        return false;
     }
 
     return true;
@@ -31,15 +31,6 @@ CMasternodeMan mnodeman;
 const std::string CMasternodeMan::SERIALIZATION_VERSION_STRING = "CMasternodeMan-Version-12";
 const int CMasternodeMan::LAST_PAID_SCAN_BLOCKS = 100;
 
-struct CompareLastPaidBlock
-{
-    bool operator()(const std::pair<int, const CMasternode*>& t1,
-                    const std::pair<int, const CMasternode*>& t2) const
-    {
-        return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->outpoint < t2.second->outpoint);
-    }
-};
-
 struct CompareScoreMN
 {
     bool operator()(const std::pair<arith_uint256, const CMasternode*>& t1,
@@ -49,16 +40,6 @@ struct CompareScoreMN
     }
 };
 
-struct CompareByAddr
-
-{
-    bool operator()(const CMasternode* t1,
-                    const CMasternode* t2) const
-    {
-        return t1->addr < t2->addr;
-    }
-};
-
 CMasternodeMan::CMasternodeMan():
     cs(),
     mapMasternodes(),
@@ -69,6 +50,7 @@ CMasternodeMan::CMasternodeMan():
     mMnbRecoveryRequests(),
     mMnbRecoveryGoodReplies(),
     listScheduledMnbRequestConnections(),
+    fSigCheckThreadsActive(false),
     fMasternodesAdded(false),
     fMasternodesRemoved(false),
     vecDirtyGovernanceObjectHashes(),
@@ -88,11 +70,60 @@ bool CMasternodeMan::Add(CMasternode &mn)
     if (Has(mn.outpoint)) return false;
 
     LogPrint("masternode", "CMasternodeMan::Add -- Adding new Masternode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
-    mapMasternodes[mn.outpoint] = mn;
+    AddToIndexes(mapMasternodes.emplace(mn.outpoint, mn).first->second);
     fMasternodesAdded = true;
     return true;
 }
 
+template <typename K>
+static void EraseFromIndex(std::map<K, std::set<COutPoint> >& mapIndex, const K& key, const COutPoint& outpoint)
+{
+    auto it = mapIndex.find(key);
+    if (it == mapIndex.end()) return;
+    it->second.erase(outpoint);
+    if (it->second.empty()) {
+        mapIndex.erase(it);
+    }
+}
+
+void CMasternodeMan::AddToIndexes(const CMasternode& mn)
+{
+    AssertLockHeld(cs);
+    mapIndexByAddr[mn.addr].insert(mn.outpoint);
+    mapIndexByOperatorKey[mn.legacyKeyIDOperator].insert(mn.outpoint);
+    mapIndexByCollateralKey[mn.keyIDCollateralAddress].insert(mn.outpoint);
+    setIndexByLastPaid.emplace(mn.GetLastPaidBlock(), mn.outpoint);
+}
+
+void CMasternodeMan::RemoveFromIndexes(const CMasternode& mn)
+{
+    AssertLockHeld(cs);
+
+    EraseFromIndex(mapIndexByAddr, mn.addr, mn.outpoint);
+    EraseFromIndex(mapIndexByOperatorKey, mn.legacyKeyIDOperator, mn.outpoint);
+    EraseFromIndex(mapIndexByCollateralKey, mn.keyIDCollateralAddress, mn.outpoint);
+    setIndexByLastPaid.erase(std::make_pair(mn.GetLastPaidBlock(), mn.outpoint));
+}
+
+void CMasternodeMan::RebuildIndexes()
+{
+    LOCK(cs);
+    mapIndexByAddr.clear();
+    mapIndexByOperatorKey.clear();
+    mapIndexByCollateralKey.clear();
+    setIndexByLastPaid.clear();
+    for (const auto& mnpair : mapMasternodes) {
+        AddToIndexes(mnpair.second);
+    }
+}
+
+std::map<COutPoint, CMasternode>::iterator CMasternodeMan::Erase(std::map<COutPoint, CMasternode>::iterator it)
+{
+    AssertLockHeld(cs);
+    RemoveFromIndexes(it->second);
+    return mapMasternodes.erase(it);
+}
+
 void CMasternodeMan::AskForMN(CNode* pnode, const COutPoint& outpoint, CConnman& connman)
 {
     if(!pnode) return;
@@ -217,7 +248,7 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
 
                 // and finally remove it from the list
                 it->second.FlagGovernanceItemsAsDirty();
-                mapMasternodes.erase(it++);
+                it = Erase(it);
                 fMasternodesRemoved = true;
             } else {
                 bool fAsk = (nAskForMnbRecovery > 0) &&
@@ -386,6 +417,7 @@ void CMasternodeMan::AddDeterministicMasternodes()
             auto mn = Find(dmn->collateralOutpoint);
             assert(mn);
 
+            RemoveFromIndexes(*mn);
             // make sure we use the splitted keys from now on
             mn->keyIDOwner = dmn->pdmnState->keyIDOwner;
             mn->blsPubKeyOperator = dmn->pdmnState->pubKeyOperator;
@@ -395,6 +427,7 @@ void CMasternodeMan::AddDeterministicMasternodes()
 
             // If it appeared in the valid list, it is enabled no matter what
             mn->nActiveState = CMasternode::MASTERNODE_ENABLED;
+            AddToIndexes(*mn);
         });
 
         added = oldMnCount != mapMasternodes.size();
@@ -421,7 +454,7 @@ void CMasternodeMan::RemoveNonDeterministicMasternodes()
         auto it = mapMasternodes.begin();
         while (it != mapMasternodes.end()) {
             if (!mnSet.count(it->second.outpoint)) {
-                mapMasternodes.erase(it++);
+                it = Erase(it);
                 erased = true;
             } else {
                 ++it;
@@ -437,6 +470,10 @@ void CMasternodeMan::Clear()
 {
     LOCK(cs);
     mapMasternodes.clear();
+    mapIndexByAddr.clear();
+    mapIndexByOperatorKey.clear();
+    mapIndexByCollateralKey.clear();
+    setIndexByLastPaid.clear();
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
@@ -553,6 +590,7 @@ CMasternode* CMasternodeMan::Find(const COutPoint &outpoint)
             // MN is not in mapMasternodes but in the deterministic list. Create an entry in mapMasternodes for compatibility with legacy code
             CMasternode mn(outpoint.hash, dmn);
             it = mapMasternodes.emplace(outpoint, mn).first;
+            AddToIndexes(it->second);
             return &(it->second);
         }
     } else {
@@ -590,18 +628,29 @@ bool CMasternodeMan::GetMasternodeInfo(const COutPoint& outpoint, masternode_inf
     return true;
 }
 
+CMasternode* CMasternodeMan::FindInIndex(const std::map<CKeyID, std::set<COutPoint> >& mapIndex, const CKeyID& keyID)
+{
+    AssertLockHeld(cs);
+    auto it = mapIndex.find(keyID);
+    if (it == mapIndex.end()) {
+        return nullptr;
+    }
+    auto itMn = mapMasternodes.find(*it->second.begin());
+    assert(itMn != mapMasternodes.end());
+    return &itMn->second;
+}
+
 bool CMasternodeMan::GetMasternodeInfo(const CKeyID& keyIDOperator, masternode_info_t& mnInfoRet) {
     LOCK(cs);
     if (deterministicMNManager->IsDeterministicMNsSporkActive()) {
         return false;
     } else {
-        for (const auto& mnpair : mapMasternodes) {
-            if (mnpair.second.legacyKeyIDOperator == keyIDOperator) {
-                mnInfoRet = mnpair.second.GetInfo();
-                return true;
-            }
+        CMasternode* pmn = FindInIndex(mapIndexByOperatorKey, keyIDOperator);
+        if (!pmn) {
+            return false;
         }
-        return false;
+        mnInfoRet = pmn->GetInfo();
+        return true;
     }
 }
 
@@ -619,13 +668,12 @@ bool CMasternodeMan::GetMasternodeInfo(const CScript& payee, masternode_info_t&
             return false;
         CKeyID keyId = *boost::get<CKeyID>(&dest);
         LOCK(cs);
-        for (const auto& mnpair : mapMasternodes) {
-            if (mnpair.second.keyIDCollateralAddress == keyId) {
-                mnInfoRet = mnpair.second.GetInfo();
-                return true;
-            }
+        CMasternode* pmn = FindInIndex(mapIndexByCollateralKey, keyId);
+        if (!pmn) {
+            return false;
         }
-        return false;
+        mnInfoRet = pmn->GetInfo();
+        return true;
     }
 }
 
@@ -667,27 +715,34 @@ bool CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool f
     std::vector<std::pair<int, const CMasternode*> > vecMasternodeLastPaid;
 
     /*
-        Make a vector with all of the last paid times
+        Make a vector with all of the last paid times, sorted low to high already as it's built from the index
     */
 
     int nMnCount = CountMasternodes();
 
-    for (const auto& mnpair : mapMasternodes) {
-        if(!mnpair.second.IsValidForPayment()) continue;
+    for (const auto& p : setIndexByLastPaid) {
+        auto it = mapMasternodes.find(p.second);
+        if (it == mapMasternodes.end()) {
+            // stale index entry, must not happen as the index is updated together with mapMasternodes
+            LogPrintf("CMasternodeMan::GetNextMasternodeInQueueForPayment -- ERROR: indexed masternode not found, masternode=%s\n", p.second.ToStringShort());
+            continue;
+        }
+        const CMasternode& mn = it->second;
+        if(!mn.IsValidForPayment()) continue;
 
         //check protocol version
-        if(mnpair.second.nProtocolVersion < mnpayments.GetMinMasternodePaymentsProto()) continue;
+        if(mn.nProtocolVersion < mnpayments.GetMinMasternodePaymentsProto()) continue;
 
         //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
-        if(mnpayments.IsScheduled(mnpair.second, nBlockHeight)) continue;
+        if(mnpayments.IsScheduled(mn, nBlockHeight)) continue;
 
         //it's too new, wait for a cycle
-        if(fFilterSigTime && mnpair.second.sigTime + (nMnCount*2.6*60) > GetAdjustedTime()) continue;
+        if(fFilterSigTime && mn.sigTime + (nMnCount*2.6*60) > GetAdjustedTime()) continue;
 
         //make sure it has at least as many confirmations as there are masternodes
-        if(GetUTXOConfirmations(mnpair.first) < nMnCount) continue;
+        if(GetUTXOConfirmations(p.second) < nMnCount) continue;
 
-        vecMasternodeLastPaid.push_back(std::make_pair(mnpair.second.GetLastPaidBlock(), &mnpair.second));
+        vecMasternodeLastPaid.push_back(std::make_pair(p.first, &mn));
     }
 
     nCountRet = (int)vecMasternodeLastPaid.size();
@@ -696,9 +751,6 @@ bool CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool f
     if(fFilterSigTime && nCountRet < nMnCount/3)
         return GetNextMasternodeInQueueForPayment(nBlockHeight, false, nCountRet, mnInfoRet);
 
-    // Sort them low to high
-    sort(vecMasternodeLastPaid.begin(), vecMasternodeLastPaid.end(), CompareLastPaidBlock());
-
     uint256 blockHash;
     if(!GetBlockHash(blockHash, nBlockHeight - 101)) {
         LogPrintf("CMasternode::GetNextMasternodeInQueueForPayment -- ERROR: GetBlockHash() failed at nBlockHeight %d\n", nBlockHeight - 101);
@@ -741,6 +793,7 @@ masternode_info_t CMasternodeMan::FindRandomNotInVec(const std::vector<COutPoint
 
     // fill a vector of pointers
     std::vector<const CMasternode*> vpMasternodesShuffled;
+    vpMasternodesShuffled.reserve(mapMasternodes.size());
     for (const auto& mnpair : mapMasternodes) {
         vpMasternodesShuffled.push_back(&mnpair.second);
     }
@@ -748,19 +801,12 @@ masternode_info_t CMasternodeMan::FindRandomNotInVec(const std::vector<COutPoint
     FastRandomContext insecure_rand;
     // shuffle pointers
     std::random_shuffle(vpMasternodesShuffled.begin(), vpMasternodesShuffled.end(), insecure_rand);
-    bool fExclude;
+    std::set<COutPoint> setToExclude(vecToExclude.begin(), vecToExclude.end());
 
     // loop through
     for (const auto& pmn : vpMasternodesShuffled) {
         if(pmn->nProtocolVersion < nProtocolVersion || !pmn->IsEnabled()) continue;
-        fExclude = false;
-        for (const auto& outpointToExclude : vecToExclude) {
-            if(pmn->outpoint == outpointToExclude) {
-                fExclude = true;
-                break;
-            }
-        }
-        if(fExclude) continue;
+        if(setToExclude.count(pmn->outpoint)) continue;
         if (deterministicMNManager->IsDeterministicMNsSporkActive() && !deterministicMNManager->HasValidMNCollateralAtChainTip(pmn->outpoint))
             continue;
         // found the one not in vecToExclude
@@ -799,7 +845,9 @@ bool CMasternodeMan::GetMasternodeScores(const uint256& nBlockHash, CMasternodeM
 
     if (deterministicMNManager->IsDeterministicMNsSporkActive()) {
         auto mnList = deterministicMNManager->GetListAtChainTip();
+        // scores are memoized per list and already sorted in the same order as CompareScoreMN would sort them
         auto scores = mnList.CalculateScores(nBlockHash);
+        vecMasternodeScoresRet.reserve(scores.size());
         for (const auto& p : scores) {
             auto* mn = Find(p.second->collateralOutpoint);
             vecMasternodeScoresRet.emplace_back(p.first, mn);
@@ -817,8 +865,8 @@ bool CMasternodeMan::GetMasternodeScores(const uint256& nBlockHash, CMasternodeM
                 vecMasternodeScoresRet.push_back(std::make_pair(mnpair.second.CalculateScore(nBlockHash), &mnpair.second));
             }
         }
+        sort(vecMasternodeScoresRet.rbegin(), vecMasternodeScoresRet.rend(), CompareScoreMN());
     }
-    sort(vecMasternodeScoresRet.rbegin(), vecMasternodeScoresRet.rend(), CompareScoreMN());
     return !vecMasternodeScoresRet.empty();
 }
 
@@ -1007,19 +1055,11 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
 
         LogPrint("masternode", "MNANNOUNCE -- Masternode announce, masternode=%s\n", mnb.outpoint.ToStringShort());
 
-        int nDos = 0;
-
-        if (CheckMnbAndUpdateMasternodeList(pfrom, mnb, nDos, connman)) {
-            // use announced Masternode as a peer
-            connman.AddNewAddress(CAddress(mnb.addr, NODE_NETWORK), pfrom->addr, 2*60*60);
-        } else if(nDos > 0) {
-            LOCK(cs_main);
-            Misbehaving(pfrom->GetId(), nDos);
+        if(!PushPendingSigCheck(pfrom, mnb, CMasternodePing(), false)) {
+            ProcessMasternodeBroadcast(pfrom, mnb, connman);
         }
+        ProcessPendingSigChecks(connman);
 
-        if(fMasternodesAdded) {
-            NotifyMasternodeUpdates(connman);
-        }
     } else if (strCommand == NetMsgType::MNPING) { //Masternode Ping
 
         CMasternodePing mnp;
@@ -1036,37 +1076,15 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
 
         LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s\n", mnp.masternodeOutpoint.ToStringShort());
 
-        // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
-        LOCK2(cs_main, cs);
-
-        if(mapSeenMasternodePing.count(nHash)) return; //seen
-        mapSeenMasternodePing.insert(std::make_pair(nHash, mnp));
-
-        LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s new\n", mnp.masternodeOutpoint.ToStringShort());
-
-        // see if we have this Masternode
-        CMasternode* pmn = Find(mnp.masternodeOutpoint);
-
-        if(pmn && mnp.fSentinelIsCurrent)
-            UpdateLastSentinelPingTime();
-
-        // too late, new MNANNOUNCE is required
-        if(pmn && pmn->IsNewStartRequired()) return;
-
-        int nDos = 0;
-        if(mnp.CheckAndUpdate(pmn, false, nDos, connman)) return;
-
-        if(nDos > 0) {
-            // if anything significant failed, mark that node
-            Misbehaving(pfrom->GetId(), nDos);
-        } else if(pmn != nullptr) {
-            // nothing significant failed, mn is a known one too
-            return;
+        {
+            LOCK(cs);
+            if(mapSeenMasternodePing.count(nHash)) return; //seen
         }
 
-        // something significant is broken or mn is unknown,
-        // we might have to ask for a masternode entry once
-        AskForMN(pfrom, mnp.masternodeOutpoint, connman);
+        if(!PushPendingSigCheck(pfrom, CMasternodeBroadcast(), mnp, true)) {
+            ProcessMasternodePing(pfrom, mnp, connman);
+        }
+        ProcessPendingSigChecks(connman);
 
     } else if (strCommand == NetMsgType::DSEG) { //Get Masternode list or specific entry
         // Ignore such requests until we are fully synced.
@@ -1187,6 +1205,197 @@ void CMasternodeMan::PushDsegInvs(CNode* pnode, const CMasternode& mn)
 
 // Verification of masternodes via unique direct requests.
 
+void CMasternodeMan::ProcessMasternodeBroadcast(CNode* pfrom, CMasternodeBroadcast& mnb, CConnman& connman)
+{
+    int nDos = 0;
+
+    if (CheckMnbAndUpdateMasternodeList(pfrom, mnb, nDos, connman)) {
+        // use announced Masternode as a peer
+        connman.AddNewAddress(CAddress(mnb.addr, NODE_NETWORK), pfrom->addr, 2*60*60);
+    } else if(nDos > 0) {
+        LOCK(cs_main);
+        Misbehaving(pfrom->GetId(), nDos);
+    }
+
+    if(fMasternodesAdded) {
+        NotifyMasternodeUpdates(connman);
+    }
+}
+
+void CMasternodeMan::ProcessMasternodePing(CNode* pfrom, const CMasternodePing& mnpIn, CConnman& connman)
+{
+    CMasternodePing mnp = mnpIn;
+    uint256 nHash = mnp.GetHash();
+
+    // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
+    LOCK2(cs_main, cs);
+
+    if(mapSeenMasternodePing.count(nHash)) return; //seen
+    mapSeenMasternodePing.insert(std::make_pair(nHash, mnp));
+
+    LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s new\n", mnp.masternodeOutpoint.ToStringShort());
+
+    // see if we have this Masternode
+    CMasternode* pmn = Find(mnp.masternodeOutpoint);
+
+    if(pmn && mnp.fSentinelIsCurrent)
+        UpdateLastSentinelPingTime();
+
+    // too late, new MNANNOUNCE is required
+    if(pmn && pmn->IsNewStartRequired()) return;
+
+    int nDos = 0;
+    if(mnp.CheckAndUpdate(pmn, false, nDos, connman)) return;
+
+    if(nDos > 0) {
+        // if anything significant failed, mark that node
+        Misbehaving(pfrom->GetId(), nDos);
+    } else if(pmn != nullptr) {
+        // nothing significant failed, mn is a known one too
+        return;
+    }
+
+    // something significant is broken or mn is unknown,
+    // we might have to ask for a masternode entry once
+    AskForMN(pfrom, mnp.masternodeOutpoint, connman);
+}
+
+void CMasternodeMan::StartSigCheckThreads()
+{
+    LOCK(cs_pendingSigChecks);
+    if (fSigCheckThreadsActive) return;
+
+    int nThreads = std::max(1, std::min(GetNumCores() - 1, MAX_SIG_CHECK_THREADS));
+    sigCheckPool.Start(nThreads, "mn-sigcheck");
+    fSigCheckThreadsActive = true;
+}
+
+void CMasternodeMan::StopSigCheckThreads()
+{
+    {
+        LOCK(cs_pendingSigChecks);
+        if (!fSigCheckThreadsActive) return;
+        fSigCheckThreadsActive = false;
+    }
+
+    sigCheckPool.Stop(false);
+
+    // the messages are dropped, same as if they were still in the receive buffer
+    LOCK(cs_pendingSigChecks);
+    for (auto& p : dequePendingSigChecks) {
+        p.pfrom->Release();
+    }
+    dequePendingSigChecks.clear();
+    setPendingSigCheckHashes.clear();
+    mapPendingSigChecksPerPeer.clear();
+}
+
+bool CMasternodeMan::PushPendingSigCheck(CNode* pfrom, const CMasternodeBroadcast& mnb, const CMasternodePing& mnp, bool fPing)
+{
+    // find out which key the ping must be signed with, it's verified against the MN's current key when processing.
+    // If the key changes in the meantime, the signature is simply verified again at that point
+    CKeyID keyIDOperator;
+    bool fVerify;
+    if (fPing) {
+        LOCK(cs);
+        CMasternode* pmn = Find(mnp.masternodeOutpoint);
+        fVerify = pmn != nullptr;
+        if (pmn) {
+            keyIDOperator = pmn->legacyKeyIDOperator;
+        }
+    } else {
+        LOCK(cs);
+        // seen broadcasts are not verified again, unless they are recovery replies
+        fVerify = !mapSeenMasternodeBroadcast.count(mnb.GetHash()) || mnb.fRecovery;
+    }
+
+    uint256 hash = fPing ? mnp.GetHash() : mnb.GetHash();
+
+    LOCK(cs_pendingSigChecks);
+    if (!fSigCheckThreadsActive) {
+        return false;
+    }
+    // recovery replies are counted per peer in mMnbRecoveryGoodReplies, so they are never treated as copies
+    if ((fPing || !mnb.fRecovery) && setPendingSigCheckHashes.count(hash)) {
+        LogPrint("masternode", "CMasternodeMan::%s -- %s already queued, peer=%d\n", __func__, hash.ToString(), pfrom->id);
+        return true;
+    }
+    if (dequePendingSigChecks.size() >= MAX_PENDING_SIG_CHECKS) {
+        LogPrint("masternode", "CMasternodeMan::%s -- queue full, dropping %s from peer=%d\n", __func__, hash.ToString(), pfrom->id);
+        return true;
+    }
+
+    PendingSigCheck p;
+    p.pfrom = pfrom->AddRef();
+    p.fPing = fPing;
+    p.hash = hash;
+    if (fPing) {
+        p.mnp = mnp;
+    } else {
+        p.mnb = mnb;
+    }
+    if (!fVerify) {
+        std::promise<void> promise;
+        promise.set_value();
+        p.future = promise.get_future();
+    } else if (fPing) {
+        p.future = sigCheckPool.Push([mnp, keyIDOperator](int threadId) {
+            CKeyID keyID = keyIDOperator;
+            int nDos;
+            mnp.CheckSignature(keyID, nDos);
+        });
+    } else {
+        p.future = sigCheckPool.Push([mnb](int threadId) {
+            int nDos;
+            mnb.CheckSignature(nDos);
+        });
+    }
+    dequePendingSigChecks.emplace_back(std::move(p));
+    setPendingSigCheckHashes.insert(hash);
+    mapPendingSigChecksPerPeer[pfrom->id]++;
+    return true;
+}
+
+bool CMasternodeMan::HasTooManyPendingSigChecks(NodeId nodeid)
+{
+    LOCK(cs_pendingSigChecks);
+    auto it = mapPendingSigChecksPerPeer.find(nodeid);
+    return it != mapPendingSigChecksPerPeer.end() && it->second >= MAX_PENDING_SIG_CHECKS_PER_PEER;
+}
+
+void CMasternodeMan::ProcessPendingSigChecks(CConnman& connman)
+{
+    while (true) {
+        PendingSigCheck p;
+        {
+            LOCK(cs_pendingSigChecks);
+            // keep the order of messages, stop at the first one which is not verified yet
+            if (dequePendingSigChecks.empty() ||
+                dequePendingSigChecks.front().future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                return;
+            }
+            p = std::move(dequePendingSigChecks.front());
+            dequePendingSigChecks.pop_front();
+            auto it = mapPendingSigChecksPerPeer.find(p.pfrom->id);
+            if (--it->second == 0)
+                mapPendingSigChecksPerPeer.erase(it);
+        }
+
+        // CheckSignature finds the results of the verification in its cache now
+        if (p.fPing) {
+            ProcessMasternodePing(p.pfrom, p.mnp, connman);
+        } else {
+            ProcessMasternodeBroadcast(p.pfrom, p.mnb, connman);
+        }
+        {
+            // it's in mapSeenMasternodePing/mapSeenMasternodeBroadcast now
+            LOCK(cs_pendingSigChecks);
+            setPendingSigCheckHashes.erase(p.hash);
+        }
+        p.pfrom->Release();
+    }
+}
+
 void CMasternodeMan::DoFullVerificationStep(CConnman& connman)
 {
     if (deterministicMNManager->IsDeterministicMNsSporkActive())
@@ -1275,31 +1484,34 @@ void CMasternodeMan::CheckSameAddr()
     if(!masternodeSync.IsSynced() || mapMasternodes.empty()) return;
 
     std::vector<CMasternode*> vBan;
-    std::vector<CMasternode*> vSortedByAddr;
 
     {
         LOCK(cs);
 
-        CMasternode* pprevMasternode = nullptr;
-        CMasternode* pverifiedMasternode = nullptr;
-
-        for (auto& mnpair : mapMasternodes) {
-            vSortedByAddr.push_back(&mnpair.second);
-        }
+        // only addresses shared by multiple masternodes need to be looked at
+        for (const auto& p : mapIndexByAddr) {
+            if (p.second.size() < 2) continue;
 
-        sort(vSortedByAddr.begin(), vSortedByAddr.end(), CompareByAddr());
+            CMasternode* pprevMasternode = nullptr;
+            CMasternode* pverifiedMasternode = nullptr;
 
-        for (const auto& pmn : vSortedByAddr) {
-            // check only (pre)enabled masternodes
-            if(!pmn->IsEnabled() && !pmn->IsPreEnabled()) continue;
-            // initial step
-            if(!pprevMasternode) {
-                pprevMasternode = pmn;
-                pverifiedMasternode = pmn->IsPoSeVerified() ? pmn : nullptr;
-                continue;
-            }
-            // second+ step
-            if(pmn->addr == pprevMasternode->addr) {
+            for (const auto& outpoint : p.second) {
+                auto it = mapMasternodes.find(outpoint);
+                if (it == mapMasternodes.end()) {
+                    // stale index entry, must not happen as the index is updated together with mapMasternodes
+                    LogPrintf("CMasternodeMan::CheckSameAddr -- ERROR: indexed masternode not found, masternode=%s\n", outpoint.ToStringShort());
+                    continue;
+                }
+                CMasternode* pmn = &it->second;
+                // check only (pre)enabled masternodes
+                if(!pmn->IsEnabled() && !pmn->IsPreEnabled()) continue;
+                // initial step
+                if(!pprevMasternode) {
+                    pprevMasternode = pmn;
+                    pverifiedMasternode = pmn->IsPoSeVerified() ? pmn : nullptr;
+                    continue;
+                }
+                // second+ step
                 if(pverifiedMasternode) {
                     // another masternode with the same ip is verified, ban this one
                     vBan.push_back(pmn);
@@ -1309,10 +1521,8 @@ void CMasternodeMan::CheckSameAddr()
                     // and keep a reference to be able to ban following masternodes with the same ip
                     pverifiedMasternode = pmn;
                 }
-            } else {
-                pverifiedMasternode = pmn->IsPoSeVerified() ? pmn : nullptr;
+                pprevMasternode = pmn;
             }
-            pprevMasternode = pmn;
         }
     }
 
@@ -1778,7 +1988,11 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
         CMasternode* pmn = Find(mnb.outpoint);
         if(pmn) {
             CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
-            if(!mnb.Update(pmn, nDos, connman)) {
+            // the broadcast can change the address and keys
+            RemoveFromIndexes(*pmn);
+            bool fUpdated = mnb.Update(pmn, nDos, connman);
+            AddToIndexes(*pmn);
+            if(!fUpdated) {
                 LogPrint("masternode", "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- Update() failed, masternode=%s\n", mnb.outpoint.ToStringShort());
                 return false;
             }
@@ -1831,7 +2045,12 @@ void CMasternodeMan::UpdateLastPaid(const CBlockIndex* pindex)
                             nCachedBlockHeight, nLastRunBlockHeight, nMaxBlocksToScanBack);
 
     for (auto& mnpair : mapMasternodes) {
+        int nLastPaidOld = mnpair.second.GetLastPaidBlock();
         mnpair.second.UpdateLastPaid(pindex, nMaxBlocksToScanBack);
+        if (mnpair.second.GetLastPaidBlock() != nLastPaidOld) {
+            setIndexByLastPaid.erase(std::make_pair(nLastPaidOld, mnpair.first));
+            setIndexByLastPaid.emplace(mnpair.second.GetLastPaidBlock(), mnpair.first);
+        }
     }
 
     nLastRunBlockHeight = nCachedBlockHeight;
@@ -1876,11 +2095,9 @@ void CMasternodeMan::CheckMasternode(const CKeyID& keyIDOperator, bool fForce)
     LOCK2(cs_main, cs);
     if (deterministicMNManager->IsDeterministicMNsSporkActive())
         return;
-    for (auto& mnpair : mapMasternodes) {
-        if (mnpair.second.legacyKeyIDOperator == keyIDOperator) {
-            mnpair.second.Check(fForce);
-            return;
-        }
+    CMasternode* pmn = FindInIndex(mapIndexByOperatorKey, keyIDOperator);
+    if (pmn) {
+        pmn->Check(fForce);
     }
 }
 
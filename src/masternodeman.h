@@ -7,6 +7,10 @@
 
 #include "masternode.h"
 #include "sync.h"
+#include "workstealingpool.h"
+
+#include <deque>
+#include <future>
 
 class CMasternodeMan;
 class CConnman;
@@ -39,6 +43,12 @@ private:
     static const int MNB_RECOVERY_WAIT_SECONDS      = 60;
     static const int MNB_RECOVERY_RETRY_SECONDS     = 3 * 60 * 60;
 
+    static const int MAX_SIG_CHECK_THREADS          = 4;
+    // a peer's messages are not processed while this many of its mnb/mnp wait for signature checks
+    static const int MAX_PENDING_SIG_CHECKS_PER_PEER = 1000;
+    // above this many mnb/mnp in total new ones are dropped
+    static const int MAX_PENDING_SIG_CHECKS         = 20000;
+
 
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -48,6 +58,14 @@ private:
 
     // map to hold all MNs
     std::map<COutPoint, CMasternode> mapMasternodes;
+
+    // Secondary indexes into mapMasternodes. They are keyed by the fields of the MNs at the time they were indexed,
+    // so every change to these fields must be surrounded by RemoveFromIndexes/AddToIndexes
+    std::map<CService, std::set<COutPoint> > mapIndexByAddr;
+    std::map<CKeyID, std::set<COutPoint> > mapIndexByOperatorKey;
+    std::map<CKeyID, std::set<COutPoint> > mapIndexByCollateralKey;
+    // sorted the same way as GetNextMasternodeInQueueForPayment needs it (last paid block, then outpoint)
+    std::set<std::pair<int, COutPoint> > setIndexByLastPaid;
     // who's asked for the Masternode list and the last time
     std::map<CService, int64_t> mAskedUsForMasternodeList;
     // who we asked for the Masternode list and the last time
@@ -66,6 +84,25 @@ private:
     std::map<CService, std::pair<int64_t, CMasternodeVerification> > mapPendingMNV;
     CCriticalSection cs_mapPendingMNV;
 
+    // Incoming mnb/mnp messages in the order they were received. Their signatures are verified on sigCheckPool (which
+    // caches the results), then ProcessPendingSigChecks processes them in order on the message handler thread.
+    // pfrom is kept alive with AddRef until the message is processed.
+    struct PendingSigCheck {
+        CNode* pfrom;
+        bool fPing;
+        uint256 hash;
+        CMasternodeBroadcast mnb;
+        CMasternodePing mnp;
+        std::future<void> future;
+    };
+    CCriticalSection cs_pendingSigChecks;
+    std::deque<PendingSigCheck> dequePendingSigChecks;
+    // hashes of the queued messages, copies arriving before the first one is processed are dropped
+    std::set<uint256> setPendingSigCheckHashes;
+    std::map<NodeId, int> mapPendingSigChecksPerPeer;
+    bool fSigCheckThreadsActive;
+    CWorkStealingPool sigCheckPool;
+
     /// Set when masternodes are added, cleared when CGovernanceManager is notified
     bool fMasternodesAdded;
 
@@ -79,6 +116,13 @@ private:
     friend class CMasternodeSync;
     /// Find an entry
     CMasternode* Find(const COutPoint& outpoint);
+    /// Find the first entry (by outpoint) in one of the indexes
+    CMasternode* FindInIndex(const std::map<CKeyID, std::set<COutPoint> >& mapIndex, const CKeyID& keyID);
+
+    void AddToIndexes(const CMasternode& mn);
+    void RemoveFromIndexes(const CMasternode& mn);
+    void RebuildIndexes();
+    std::map<COutPoint, CMasternode>::iterator Erase(std::map<COutPoint, CMasternode>::iterator it);
 
     bool GetMasternodeScores(const uint256& nBlockHash, score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol = 0);
 
@@ -87,6 +131,12 @@ private:
 
     void PushDsegInvs(CNode* pnode, const CMasternode& mn);
 
+    /// Queues the message for parallel signature verification (or drops a copy of a queued one or when the queue is
+    /// full), returns false if it must be processed right away
+    bool PushPendingSigCheck(CNode* pfrom, const CMasternodeBroadcast& mnb, const CMasternodePing& mnp, bool fPing);
+    void ProcessMasternodeBroadcast(CNode* pfrom, CMasternodeBroadcast& mnb, CConnman& connman);
+    void ProcessMasternodePing(CNode* pfrom, const CMasternodePing& mnp, CConnman& connman);
+
 public:
     // Keep track of all broadcasts I've seen
     std::map<uint256, std::pair<int64_t, CMasternodeBroadcast> > mapSeenMasternodeBroadcast;
@@ -113,6 +163,9 @@ public:
         }
 
         READWRITE(mapMasternodes);
+        if(ser_action.ForRead()) {
+            RebuildIndexes();
+        }
         READWRITE(mAskedUsForMasternodeList);
         READWRITE(mWeAskedForMasternodeList);
         READWRITE(mWeAskedForMasternodeListEntry);
@@ -195,6 +248,15 @@ public:
 
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
 
+    /// Start/stop verifying the signatures of incoming mnb/mnp messages in parallel
+    void StartSigCheckThreads();
+    void StopSigCheckThreads();
+    /// Process queued mnb/mnp messages whose signatures were verified already, must be called regularly from the
+    /// message handler thread
+    void ProcessPendingSigChecks(CConnman& connman);
+    /// Whether the messages of the peer should wait until more of its mnb/mnp are processed
+    bool HasTooManyPendingSigChecks(NodeId nodeid);
+
     void DoFullVerificationStep(CConnman& connman);
     void CheckSameAddr();
     bool CheckVerifyRequestAddr(const CAddress& addr, CConnman& connman);
@@ -0,0 +1,210 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "metrics.h"
+
+#include "tinyformat.h"
+
+#include <algorithm>
+
+static std::atomic<size_t> nNextMetricsShard{0};
+
+size_t GetMetricsShard()
+{
+    static thread_local size_t nShard = nNextMetricsShard++ % METRICS_NUM_SHARDS;
+    return nShard;
+}
+
+uint64_t CMetricCounter::Get() const
+{
+    uint64_t n = 0;
+    for (const auto& shard : shards) {
+        n += shard.nValue.load(std::memory_order_relaxed);
+    }
+    return n;
+}
+
+CLatencyHistogram::Shard::Shard()
+{
+    for (auto& bucket : vBuckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+int CLatencyHistogram::BucketIndex(int64_t nValue)
+{
+    if (nValue < SUB_BUCKETS) {
+        return nValue < 0 ? 0 : (int)nValue;
+    }
+    int nExp = 63 - __builtin_clzll((uint64_t)nValue);
+    if (nExp > MAX_EXPONENT) {
+        return NUM_BUCKETS - 1;
+    }
+    int nSub = (int)((nValue >> (nExp - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return (nExp - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + nSub;
+}
+
+int64_t CLatencyHistogram::BucketUpperBound(int idx)
+{
+    if (idx < SUB_BUCKETS) {
+        return idx;
+    }
+    int nExp = idx / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    int64_t nSub = idx % SUB_BUCKETS;
+    return ((SUB_BUCKETS + nSub + 1) << (nExp - SUB_BUCKET_BITS)) - 1;
+}
+
+void CLatencyHistogram::Record(int64_t nMicros)
+{
+    if (nMicros < 0) {
+        // clock went backwards
+        nMicros = 0;
+    }
+    Shard& shard = shards[GetMetricsShard()];
+    shard.vBuckets[BucketIndex(nMicros)].fetch_add(1, std::memory_order_relaxed);
+    shard.nSum.fetch_add((uint64_t)nMicros, std::memory_order_relaxed);
+    int64_t nMax = shard.nMax.load(std::memory_order_relaxed);
+    while (nMicros > nMax && !shard.nMax.compare_exchange_weak(nMax, nMicros, std::memory_order_relaxed)) {}
+}
+
+CLatencyHistogram::Snapshot CLatencyHistogram::GetSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.vBuckets.assign(NUM_BUCKETS, 0);
+    for (const auto& shard : shards) {
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            snapshot.vBuckets[i] += shard.vBuckets[i].load(std::memory_order_relaxed);
+        }
+        snapshot.nSum += shard.nSum.load(std::memory_order_relaxed);
+        snapshot.nMax = std::max(snapshot.nMax, shard.nMax.load(std::memory_order_relaxed));
+    }
+    // the count is derived from the buckets, so that it matches them even while other threads record
+    for (uint64_t n : snapshot.vBuckets) {
+        snapshot.nCount += n;
+    }
+    return snapshot;
+}
+
+int64_t CLatencyHistogram::Snapshot::Quantile(double q) const
+{
+    if (nCount == 0) {
+        return 0;
+    }
+    uint64_t nRank = std::max<uint64_t>(1, (uint64_t)(q * nCount + 0.5));
+    uint64_t nSeen = 0;
+    for (size_t i = 0; i < vBuckets.size(); i++) {
+        nSeen += vBuckets[i];
+        if (nSeen >= nRank) {
+            return std::min(BucketUpperBound(i), nMax);
+        }
+    }
+    return nMax;
+}
+
+template <typename T>
+static T& GetOrCreate(std::map<std::string, std::unique_ptr<T> >& map, const std::string& strName)
+{
+    auto it = map.find(strName);
+    if (it == map.end()) {
+        it = map.emplace(strName, std::unique_ptr<T>(new T())).first;
+    }
+    return *it->second;
+}
+
+CMetricCounter& CMetricsRegistry::Counter(const std::string& strName)
+{
+    std::unique_lock<std::mutex> l(mutex);
+    return GetOrCreate(mapCounters, strName);
+}
+
+CMetricGauge& CMetricsRegistry::Gauge(const std::string& strName)
+{
+    std::unique_lock<std::mutex> l(mutex);
+    return GetOrCreate(mapGauges, strName);
+}
+
+CLatencyHistogram& CMetricsRegistry::Histogram(const std::string& strName)
+{
+    std::unique_lock<std::mutex> l(mutex);
+    return GetOrCreate(mapHistograms, strName);
+}
+
+std::map<std::string, uint64_t> CMetricsRegistry::GetCounters() const
+{
+    std::unique_lock<std::mutex> l(mutex);
+    std::map<std::string, uint64_t> ret;
+    for (const auto& p : mapCounters) {
+        ret.emplace(p.first, p.second->Get());
+    }
+    return ret;
+}
+
+std::map<std::string, int64_t> CMetricsRegistry::GetGauges() const
+{
+    std::unique_lock<std::mutex> l(mutex);
+    std::map<std::string, int64_t> ret;
+    for (const auto& p : mapGauges) {
+        ret.emplace(p.first, p.second->Get());
+    }
+    return ret;
+}
+
+std::map<std::string, CLatencyHistogram::Snapshot> CMetricsRegistry::GetHistograms() const
+{
+    std::vector<std::pair<std::string, const CLatencyHistogram*> > vHistograms;
+    {
+        std::unique_lock<std::mutex> l(mutex);
+        for (const auto& p : mapHistograms) {
+            vHistograms.emplace_back(p.first, p.second.get());
+        }
+    }
+    // summing up the shards is the expensive part, do it without blocking the creation of new metrics
+    std::map<std::string, CLatencyHistogram::Snapshot> ret;
+    for (const auto& p : vHistograms) {
+        ret.emplace(p.first, p.second->GetSnapshot());
+    }
+    return ret;
+}
+
+static std::string PrometheusName(const std::string& strPrefix, const std::string& strName)
+{
+    std::string ret = strPrefix + strName;
+    for (char& c : ret) {
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_')) {
+            c = '_';
+        }
+    }
+    return ret;
+}
+
+std::string CMetricsRegistry::ToPrometheus(const std::string& strPrefix) const
+{
+    static const double QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+
+    std::string ret;
+    for (const auto& p : GetCounters()) {
+        std::string strName = PrometheusName(strPrefix, p.first);
+        ret += strprintf("# TYPE %s counter\n%s %d\n", strName, strName, p.second);
+    }
+    for (const auto& p : GetGauges()) {
+        std::string strName = PrometheusName(strPrefix, p.first);
+        ret += strprintf("# TYPE %s gauge\n%s %d\n", strName, strName, p.second);
+    }
+    for (const auto& p : GetHistograms()) {
+        std::string strName = PrometheusName(strPrefix, p.first + "_us");
+        ret += strprintf("# TYPE %s summary\n", strName);
+        for (double q : QUANTILES) {
+            ret += strprintf("%s{quantile=\"%g\"} %d\n", strName, q, p.second.Quantile(q));
+        }
+        ret += strprintf("%s_sum %d\n%s_count %d\n", strName, p.second.nSum, strName, p.second.nCount);
+    }
+    return ret;
+}
+
+CMetricsRegistry& GetMetrics()
+{
+    // leaked on purpose, see the comment about LogPrintf() and global destructors in util.cpp
+    static CMetricsRegistry* registry = new CMetricsRegistry();
+    return *registry;
+}
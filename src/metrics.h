@@ -0,0 +1,134 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DASH_METRICS_H
+#define DASH_METRICS_H
+
+#include "utiltime.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Low-overhead counters, gauges and latency histograms for hot code paths.
+ *
+ * Counters and histograms are split into METRICS_NUM_SHARDS cache line aligned shards. Each thread updates the shard
+ * picked when it first touched any metric, so concurrent updates from different threads (usually) don't share cache
+ * lines and never take a lock. Shards are only summed up when a snapshot is taken.
+ *
+ * Metrics are created on first use and live until shutdown, so references returned by the registry stay valid and
+ * can be cached in function-local statics by callers which use fixed names.
+ */
+
+static const size_t METRICS_NUM_SHARDS = 8;
+
+/** Index of the shard used by the calling thread */
+size_t GetMetricsShard();
+
+class CMetricCounter
+{
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> nValue{0};
+    };
+    Shard shards[METRICS_NUM_SHARDS];
+
+public:
+    void Inc(uint64_t n = 1) { shards[GetMetricsShard()].nValue.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t Get() const;
+};
+
+class CMetricGauge
+{
+private:
+    std::atomic<int64_t> nValue{0};
+
+public:
+    void Set(int64_t n) { nValue.store(n, std::memory_order_relaxed); }
+    void Add(int64_t n) { nValue.fetch_add(n, std::memory_order_relaxed); }
+    int64_t Get() const { return nValue.load(std::memory_order_relaxed); }
+};
+
+/**
+ * Histogram of latencies in microseconds with HDR-style buckets: values below 8 get their own bucket, above that
+ * every power of two is split into 8 linear sub-buckets. Quantiles are accurate to 12.5% over the whole range.
+ * Latencies above 2^38us (about 3 days) are counted in the last bucket.
+ */
+class CLatencyHistogram
+{
+public:
+    static const int SUB_BUCKET_BITS = 3;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int MAX_EXPONENT = 38;
+    static const int NUM_BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    struct Snapshot {
+        uint64_t nCount{0};
+        uint64_t nSum{0};
+        int64_t nMax{0};
+        std::vector<uint64_t> vBuckets;
+
+        // Upper bound of the bucket the q-quantile falls into (0 <= q <= 1)
+        int64_t Quantile(double q) const;
+        double Mean() const { return nCount ? (double)nSum / nCount : 0; }
+    };
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> nSum{0};
+        std::atomic<int64_t> nMax{0};
+        std::atomic<uint64_t> vBuckets[NUM_BUCKETS];
+        Shard();
+    };
+    Shard shards[METRICS_NUM_SHARDS];
+
+public:
+    static int BucketIndex(int64_t nValue);
+    static int64_t BucketUpperBound(int idx);
+
+    void Record(int64_t nMicros);
+    Snapshot GetSnapshot() const;
+};
+
+/** Records the lifetime of the object into a histogram */
+class CScopedLatency
+{
+private:
+    CLatencyHistogram& histogram;
+    int64_t nStart;
+
+public:
+    explicit CScopedLatency(CLatencyHistogram& histogramIn) : histogram(histogramIn), nStart(GetTimeMicros()) {}
+    ~CScopedLatency() { histogram.Record(GetTimeMicros() - nStart); }
+};
+
+class CMetricsRegistry
+{
+private:
+    mutable std::mutex mutex;
+    std::map<std::string, std::unique_ptr<CMetricCounter> > mapCounters;
+    std::map<std::string, std::unique_ptr<CMetricGauge> > mapGauges;
+    std::map<std::string, std::unique_ptr<CLatencyHistogram> > mapHistograms;
+
+public:
+    CMetricCounter& Counter(const std::string& strName);
+    CMetricGauge& Gauge(const std::string& strName);
+    CLatencyHistogram& Histogram(const std::string& strName);
+
+    std::map<std::string, uint64_t> GetCounters() const;
+    std::map<std::string, int64_t> GetGauges() const;
+    std::map<std::string, CLatencyHistogram::Snapshot> GetHistograms() const;
+
+    /** All metrics in the Prometheus text exposition format, names are prefixed with strPrefix */
+    std::string ToPrometheus(const std::string& strPrefix) const;
+};
+
+/** The process-wide registry. Never destroyed, so metrics can be updated from global destructors */
+CMetricsRegistry& GetMetrics();
+
+#endif // DASH_METRICS_H
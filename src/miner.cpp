@@ -16,6 +16,7 @@
 #include "consensus/validation.h"
 #include "hash.h"
 #include "validation.h"
+#include "metrics.h"
 #include "net.h"
 #include "policy/policy.h"
 #include "pow.h"
@@ -295,6 +296,11 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     }
     int64_t nTime2 = GetTimeMicros();
 
+    static CLatencyHistogram& histogramPackages = GetMetrics().Histogram("createnewblock_packages");
+    static CLatencyHistogram& histogramValidity = GetMetrics().Histogram("createnewblock_validity");
+    histogramPackages.Record(nTime1 - nTimeStart);
+    histogramValidity.Record(nTime2 - nTime1);
+
     LogPrint("bench", "CreateNewBlock() packages: %.2fms (%d packages, %d updated descendants), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
 
     return std::move(pblocktemplate);
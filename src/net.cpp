@@ -19,6 +19,7 @@
 #include "crypto/common.h"
 #include "crypto/sha256.h"
 #include "hash.h"
+#include "metrics.h"
 #include "primitives/transaction.h"
 #include "netbase.h"
 #include "scheduler.h"
@@ -706,7 +707,7 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
         // get current incomplete message, or create a new one
         if (vRecvMsg.empty() ||
             vRecvMsg.back().complete())
-            vRecvMsg.push_back(CNetMessage(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION));
+            vRecvMsg.emplace_back(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION, recvBufferPool);
 
         CNetMessage& msg = vRecvMsg.back();
 
@@ -773,22 +774,90 @@ int CNode::GetSendVersion() const
 }
 
 
+CSerializeData CRecvBufferPool::Get(size_t nSize)
+{
+    static CMetricCounter& counterReused = GetMetrics().Counter("net_recvbuf_reused");
+    static CMetricCounter& counterAllocated = GetMetrics().Counter("net_recvbuf_allocated");
+
+    int nClass = MIN_CLASS_BITS;
+    while (nClass <= MAX_CLASS_BITS && ((size_t)1 << nClass) < nSize)
+        nClass++;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i = nClass; i <= MAX_CLASS_BITS; i++) {
+            std::vector<CSerializeData>& vClass = vFree[i - MIN_CLASS_BITS];
+            if (vClass.empty())
+                continue;
+            CSerializeData vch = std::move(vClass.back());
+            vClass.pop_back();
+            nRetained -= vch.capacity();
+            counterReused.Inc();
+            return vch;
+        }
+    }
+
+    counterAllocated.Inc();
+    CSerializeData vch;
+    vch.reserve(nClass <= MAX_CLASS_BITS ? ((size_t)1 << nClass) : nSize);
+    return vch;
+}
+
+void CRecvBufferPool::Put(CSerializeData&& vch)
+{
+    size_t nCapacity = vch.capacity();
+    if (nCapacity < ((size_t)1 << MIN_CLASS_BITS))
+        return;
+
+    // file the buffer under the largest class it can serve
+    int nClass = MIN_CLASS_BITS;
+    while (nClass < MAX_CLASS_BITS && ((size_t)1 << (nClass + 1)) <= nCapacity)
+        nClass++;
+
+    CSerializeData vchFree;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<CSerializeData>& vClass = vFree[nClass - MIN_CLASS_BITS];
+        if (vClass.size() < MAX_PER_CLASS && nRetained + nCapacity <= MAX_RETAINED) {
+            vch.clear();
+            vClass.push_back(std::move(vch));
+            nRetained += nCapacity;
+            return;
+        }
+        // no room, free it outside the lock
+        vchFree.swap(vch);
+    }
+}
+
+size_t CRecvBufferPool::GetRetainedBytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return nRetained;
+}
+
+
+CNetMessage::~CNetMessage()
+{
+    if (pool)
+        pool->Put(vRecv.ReleaseBuffer());
+}
+
 int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
 {
     // copy data to temporary parsing buffer
-    unsigned int nRemaining = 24 - nHdrPos;
+    unsigned int nRemaining = CMessageHeader::HEADER_SIZE - nHdrPos;
     unsigned int nCopy = std::min(nRemaining, nBytes);
 
     memcpy(&hdrbuf[nHdrPos], pch, nCopy);
     nHdrPos += nCopy;
 
     // if header incomplete, exit
-    if (nHdrPos < 24)
+    if (nHdrPos < CMessageHeader::HEADER_SIZE)
         return nCopy;
 
     // deserialize to CMessageHeader
     try {
-        hdrbuf >> hdr;
+        CSpanReader(vRecv.GetType(), vRecv.GetVersion(), hdrbuf, sizeof(hdrbuf)) >> hdr;
     }
     catch (const std::exception&) {
         return -1;
@@ -811,7 +880,10 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
 
     if (vRecv.size() < nDataPos + nCopy) {
         // Allocate up to 256 KiB ahead, but never more than the total message size.
-        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
+        size_t nSize = std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024);
+        if (nDataPos == 0 && pool)
+            vRecv = CDataStream(pool->Get(nSize), vRecv.GetType(), vRecv.GetVersion());
+        vRecv.resize(nSize);
     }
 
     hasher.Write((const unsigned char*)pch, nCopy);
@@ -1422,9 +1494,10 @@ void CConnman::WakeMessageHandler()
 {
     {
         std::lock_guard<std::mutex> lock(mutexMsgProc);
-        fMsgProcWake = true;
+        nMsgProcWake++;
     }
-    condMsgProc.notify_one();
+    // the thread handling the peer is not known here, wake all of them
+    condMsgProc.notify_all();
 }
 
 
@@ -2039,8 +2112,9 @@ bool CConnman::OpenMasternodeConnection(const CAddress &addrConnect) {
     return OpenNetworkConnection(addrConnect, false, NULL, NULL, false, false, false, true);
 }
 
-void CConnman::ThreadMessageHandler()
+void CConnman::ThreadMessageHandler(int nThread)
 {
+    uint64_t nLastWake = 0;
     while (!flagInterruptMsgProc)
     {
         std::vector<CNode*> vNodesCopy = CopyNodeVector();
@@ -2052,6 +2126,10 @@ void CConnman::ThreadMessageHandler()
             if (pnode->fDisconnect)
                 continue;
 
+            // every peer is handled by one thread only, which keeps its messages in order
+            if (pnode->GetId() % nMessageHandlerThreads != nThread)
+                continue;
+
             // Receive messages
             bool fMoreNodeWork = GetNodeSignals().ProcessMessages(pnode, *this, flagInterruptMsgProc);
             fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
@@ -2071,9 +2149,9 @@ void CConnman::ThreadMessageHandler()
 
         std::unique_lock<std::mutex> lock(mutexMsgProc);
         if (!fMoreWork) {
-            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this] { return fMsgProcWake; });
+            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [&] { return nMsgProcWake != nLastWake; });
         }
-        fMsgProcWake = false;
+        nLastWake = nMsgProcWake;
     }
 }
 
@@ -2270,6 +2348,8 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) :
     nMaxAddnode = 0;
     nBestHeight = 0;
     clientInterface = NULL;
+    nMessageHandlerThreads = DEFAULT_MSGHAND_THREADS;
+    nMsgProcWake = 0;
     flagInterruptMsgProc = false;
 }
 
@@ -2296,6 +2376,7 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     nReceiveFloodSize = connOptions.nReceiveFloodSize;
 
     nMaxOutboundLimit = connOptions.nMaxOutboundLimit;
+    nMessageHandlerThreads = std::max(1, std::min(connOptions.nMessageHandlerThreads, MAX_MSGHAND_THREADS));
     nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
 
     SetBestHeight(connOptions.nBestHeight);
@@ -2361,7 +2442,7 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
 
     {
         std::unique_lock<std::mutex> lock(mutexMsgProc);
-        fMsgProcWake = false;
+        nMsgProcWake = 0;
     }
 
     // Send and receive from sockets, accept connections
@@ -2382,11 +2463,14 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     // Initiate masternode connections
     threadOpenMasternodeConnections = std::thread(&TraceThread<std::function<void()> >, "mncon", std::function<void()>(std::bind(&CConnman::ThreadOpenMasternodeConnections, this)));
 
-    // Process messages
-    threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    // Process messages, peers are partitioned across the threads. Messages which need cs_main are still handled
+    // one at a time, see ProcessMessages
+    for (int i = 0; i < nMessageHandlerThreads; i++) {
+        threadMessageHandlers.emplace_back(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this, i)));
+    }
 
     // Dump network addresses
-    scheduler.scheduleEvery(boost::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL);
+    scheduler.scheduleEvery(boost::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL, "net");
 
     return true;
 }
@@ -2446,8 +2530,11 @@ void CConnman::Interrupt()
 
 void CConnman::Stop()
 {
-    if (threadMessageHandler.joinable())
-        threadMessageHandler.join();
+    for (auto& thread : threadMessageHandlers) {
+        if (thread.joinable())
+            thread.join();
+    }
+    threadMessageHandlers.clear();
     if (threadOpenMasternodeConnections.joinable())
         threadOpenMasternodeConnections.join();
     if (threadOpenConnections.joinable())
@@ -2823,7 +2910,8 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nLocalHostNonce(nLocalHostNonceIn),
     nLocalServices(nLocalServicesIn),
     nMyStartingHeight(nMyStartingHeightIn),
-    nSendVersion(0)
+    nSendVersion(0),
+    recvBufferPool(std::make_shared<CRecvBufferPool>())
 {
     nServices = NODE_NONE;
     nServicesExpected = NODE_NONE;
@@ -26,6 +26,7 @@
 #include <stdint.h>
 #include <thread>
 #include <memory>
+#include <mutex>
 #include <condition_variable>
 
 #ifndef WIN32
@@ -90,6 +91,9 @@ static const bool DEFAULT_BLOCKSONLY = false;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** Default and maximum for -msghandthreads, the number of threads peers are partitioned across for message handling */
+static const int DEFAULT_MSGHAND_THREADS = 1;
+static const int MAX_MSGHAND_THREADS = 16;
 
 static const ServiceFlags REQUIRED_SERVICES = NODE_NETWORK;
 
@@ -149,6 +153,7 @@ public:
         unsigned int nReceiveFloodSize = 0;
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
+        int nMessageHandlerThreads = DEFAULT_MSGHAND_THREADS;
     };
     CConnman(uint64_t seed0, uint64_t seed1);
     ~CConnman();
@@ -410,7 +415,7 @@ private:
     void ThreadOpenAddedConnections();
     void ProcessOneShot();
     void ThreadOpenConnections();
-    void ThreadMessageHandler();
+    void ThreadMessageHandler(int nThread);
     void AcceptConnection(const ListenSocket& hListenSocket);
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
@@ -506,8 +511,10 @@ private:
     /** SipHasher seeds for deterministic randomness */
     const uint64_t nSeed0, nSeed1;
 
-    /** flag for waking the message processor. */
-    bool fMsgProcWake;
+    /** incremented for waking the message processors, each thread remembers the value it has seen. */
+    uint64_t nMsgProcWake;
+    /** peers are handled by the thread with the number of their id modulo this */
+    int nMessageHandlerThreads;
 
     std::condition_variable condMsgProc;
     std::mutex mutexMsgProc;
@@ -520,7 +527,7 @@ private:
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
     std::thread threadOpenMasternodeConnections;
-    std::thread threadMessageHandler;
+    std::vector<std::thread> threadMessageHandlers;
 };
 extern std::unique_ptr<CConnman> g_connman;
 void Discover(boost::thread_group& threadGroup);
@@ -632,14 +639,40 @@ public:
 
 
 
+/**
+ * Recycles the receive buffers of one connection. Freed buffers are kept in power of two size classes,
+ * bounded per class and in total, so that a steady stream of small inv/tx messages does not go through
+ * the allocator. Buffers are taken by the socket handler and given back by the message handler.
+ */
+class CRecvBufferPool
+{
+public:
+    static const int MIN_CLASS_BITS = 10;  // 1 KiB
+    static const int MAX_CLASS_BITS = 18;  // 256 KiB, the read-ahead of CNetMessage::readData
+    static const size_t MAX_PER_CLASS = 4;
+    static const size_t MAX_RETAINED = 256 * 1024;
+
+    /** Returns an empty buffer with room for at least nSize bytes */
+    CSerializeData Get(size_t nSize);
+    /** Takes back a buffer, it is freed when there is no room for it in the pool */
+    void Put(CSerializeData&& vch);
+    size_t GetRetainedBytes() const;
+
+private:
+    mutable std::mutex mutex;
+    std::vector<CSerializeData> vFree[MAX_CLASS_BITS - MIN_CLASS_BITS + 1];
+    size_t nRetained = 0;
+};
+
 class CNetMessage {
 private:
     mutable CHash256 hasher;
     mutable uint256 data_hash;
+    std::shared_ptr<CRecvBufferPool> pool; // where the vRecv buffer is returned to, may be null
 public:
     bool in_data;                   // parsing header (false) or data (true)
 
-    CDataStream hdrbuf;             // partially received header
+    char hdrbuf[CMessageHeader::HEADER_SIZE]; // partially received header
     CMessageHeader hdr;             // complete header
     unsigned int nHdrPos;
 
@@ -648,14 +681,16 @@ public:
 
     int64_t nTime;                  // time (in microseconds) of message receipt.
 
-    CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
-        hdrbuf.resize(24);
+    CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn, std::shared_ptr<CRecvBufferPool> poolIn = nullptr) : pool(std::move(poolIn)), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
         in_data = false;
         nHdrPos = 0;
         nDataPos = 0;
         nTime = 0;
     }
 
+    CNetMessage(CNetMessage&&) = default;
+    ~CNetMessage();
+
     bool complete() const
     {
         if (!in_data)
@@ -667,7 +702,6 @@ public:
 
     void SetVersion(int nVersionIn)
     {
-        hdrbuf.SetVersion(nVersionIn);
         vRecv.SetVersion(nVersionIn);
     }
 
@@ -814,6 +848,7 @@ private:
     const int nMyStartingHeight;
     int nSendVersion;
     std::list<CNetMessage> vRecvMsg;  // Used only by SocketHandler thread
+    const std::shared_ptr<CRecvBufferPool> recvBufferPool;
 
     mutable CCriticalSection cs_addrName;
     std::string addrName;
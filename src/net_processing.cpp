@@ -15,6 +15,7 @@
 #include "init.h"
 #include "validation.h"
 #include "merkleblock.h"
+#include "metrics.h"
 #include "net.h"
 #include "netmessagemaker.h"
 #include "netbase.h"
@@ -77,6 +78,8 @@ void EraseOrphansFor(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
 static size_t vExtraTxnForCompactIt = 0;
 static std::vector<std::pair<uint256, CTransactionRef>> vExtraTxnForCompact GUARDED_BY(cs_main);
+static size_t vLockTxnForCompactIt = 0;
+static std::vector<std::pair<uint256, CTransactionRef>> vLockTxnForCompact GUARDED_BY(cs_main);
 
 static const uint64_t RANDOMIZER_ID_ADDRESS_RELAY = 0x3cac0035b5866b90ULL; // SHA256("main address relay")[0:8]
 
@@ -123,6 +126,7 @@ namespace {
         const CBlockIndex* pindex;                               //!< Optional.
         bool fValidatedHeaders;                                  //!< Whether this block has validated headers at the time of request.
         std::unique_ptr<PartiallyDownloadedBlock> partialBlock;  //!< Optional, used for CMPCTBLOCK downloads
+        int64_t nTimeCmpctBlock;                                 //!< Time (in microseconds) the CMPCTBLOCK was received, if any
     };
     std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> > mapBlocksInFlight;
 
@@ -140,6 +144,49 @@ namespace {
     MapRelay mapRelay;
     /** Expiration-time ordered list of (expire time, relay map entry) pairs, protected by cs_main). */
     std::deque<std::pair<int64_t, MapRelay::iterator>> vRelayExpiration;
+
+    /**
+     * With several message handler threads (-msghandthreads) everything which touches state shared between peers
+     * is handled by one thread at a time, in the order in which the threads arrive. With a plain mutex a thread
+     * releasing and re-acquiring it right away could starve the others. Only the commands accepted by
+     * IsConcurrentMessage() are handled outside of it.
+     */
+    class CValidationQueue
+    {
+    private:
+        std::mutex mutex;
+        std::condition_variable cond;
+        uint64_t nNextTicket = 0;
+        uint64_t nServing = 0;
+
+    public:
+        void Enter()
+        {
+            static CLatencyHistogram& histogramWait = GetMetrics().Histogram("msghand_queue_wait");
+            CScopedLatency latency(histogramWait);
+            std::unique_lock<std::mutex> lock(mutex);
+            uint64_t nTicket = nNextTicket++;
+            cond.wait(lock, [&] { return nServing == nTicket; });
+        }
+
+        void Leave()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                nServing++;
+            }
+            cond.notify_all();
+        }
+    };
+    CValidationQueue validationQueue;
+
+    /** RAII turn in the validation queue, not reentrant */
+    class CValidationQueueTurn
+    {
+    public:
+        CValidationQueueTurn() { validationQueue.Enter(); }
+        ~CValidationQueueTurn() { validationQueue.Leave(); }
+    };
 } // anon namespace
 
 //////////////////////////////////////////////////////////////////////////////
@@ -610,6 +657,28 @@ void AddToCompactExtraTransactions(const CTransactionRef& tx)
     vExtraTxnForCompactIt = (vExtraTxnForCompactIt + 1) % max_extra_txn;
 }
 
+// InstantSend lock requests and PrivateSend dstx transactions are likely to be mined soon, keep them
+// around for compact block reconstruction even if the mempool rejects or later evicts them.
+// Returns false if the transaction was not kept (lock pool disabled or transaction too large)
+bool AddToCompactLockTransactions(const CTransactionRef& tx)
+{
+    size_t max_lock_txn = GetArg("-blockreconstructionlocktxn", DEFAULT_BLOCK_RECONSTRUCTION_LOCK_TXN);
+    if (max_lock_txn <= 0 || RecursiveDynamicUsage(*tx) > MAX_BLOCK_RECONSTRUCTION_LOCK_TX_USAGE)
+        return false;
+    if (!vLockTxnForCompact.size())
+        vLockTxnForCompact.resize(max_lock_txn);
+    vLockTxnForCompact[vLockTxnForCompactIt] = std::make_pair(tx->GetHash(), tx);
+    vLockTxnForCompactIt = (vLockTxnForCompactIt + 1) % max_lock_txn;
+    return true;
+}
+
+// Rejected lock requests and dstx which don't fit into the lock pool are kept in the extra pool like other rejects
+void AddRejectedToCompactLockTransactions(const CTransactionRef& tx)
+{
+    if (!AddToCompactLockTransactions(tx) && RecursiveDynamicUsage(*tx) < 100000)
+        AddToCompactExtraTransactions(tx);
+}
+
 bool AddOrphanTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     const uint256& hash = tx->GetHash();
@@ -2114,11 +2183,13 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 LogPrintf("DSTX -- Masternode transaction accepted, txid=%s, peer=%d\n",
                         tx.GetHash().ToString(), pfrom->id);
                 CPrivateSend::AddDSTX(dstx);
+                AddToCompactLockTransactions(ptx);
             } else if (strCommand == NetMsgType::TXLOCKREQUEST || fCanAutoLock) {
                 LogPrintf("TXLOCKREQUEST -- Transaction Lock Request accepted, txid=%s, peer=%d\n",
                         tx.GetHash().ToString(), pfrom->id);
                 instantsend.AcceptLockRequest(txLockRequest);
                 instantsend.Vote(tx.GetHash(), connman);
+                AddToCompactLockTransactions(ptx);
             }
 
             mempool.check(pcoinsTip);
@@ -2224,7 +2295,10 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             if (!state.CorruptionPossible()) {
                 assert(recentRejects);
                 recentRejects->insert(tx.GetHash());
-                if (RecursiveDynamicUsage(*ptx) < 100000) {
+                // rejected lock requests are kept for compact blocks below
+                if (strCommand == NetMsgType::DSTX) {
+                    AddRejectedToCompactLockTransactions(ptx);
+                } else if (strCommand != NetMsgType::TXLOCKREQUEST && RecursiveDynamicUsage(*ptx) < 100000) {
                     AddToCompactExtraTransactions(ptx);
                 }
             }
@@ -2237,6 +2311,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 // It's the first time we failed for this tx lock request,
                 // this should switch AlreadyHave to "true".
                 instantsend.RejectLockRequest(txLockRequest);
+                AddRejectedToCompactLockTransactions(ptx);
                 // this lets other nodes to create lock request candidate i.e.
                 // this allows multiple conflicting lock requests to compete for votes
                 connman.RelayTransaction(tx);
@@ -2370,7 +2445,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 }
 
                 PartiallyDownloadedBlock& partialBlock = *(*queuedBlockIt)->partialBlock;
-                ReadStatus status = partialBlock.InitData(cmpctblock, vExtraTxnForCompact);
+                ReadStatus status = partialBlock.InitData(cmpctblock, vExtraTxnForCompact, vLockTxnForCompact);
                 if (status == READ_STATUS_INVALID) {
                     MarkBlockAsReceived(pindex->GetBlockHash()); // Reset in-flight state in case of whitelist
                     Misbehaving(pfrom->GetId(), 100);
@@ -2378,12 +2453,15 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                     return true;
                 } else if (status == READ_STATUS_FAILED) {
                     // Duplicate txindexes, the block is now in-flight, so just request it
+                    GetMetrics().Counter("cmpctblock_failed").Inc();
                     std::vector<CInv> vInv(1);
                     vInv[0] = CInv(MSG_BLOCK, cmpctblock.header.GetHash());
                     connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::GETDATA, vInv));
                     return true;
                 }
 
+                (*queuedBlockIt)->nTimeCmpctBlock = nTimeReceived;
+
                 BlockTransactionsRequest req;
                 for (size_t i = 0; i < cmpctblock.BlockTxCount(); i++) {
                     if (!partialBlock.IsTxAvailable(i))
@@ -2406,7 +2484,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 // Optimistically try to reconstruct anyway since we might be
                 // able to without any round trips.
                 PartiallyDownloadedBlock tempBlock(&mempool);
-                ReadStatus status = tempBlock.InitData(cmpctblock, vExtraTxnForCompact);
+                ReadStatus status = tempBlock.InitData(cmpctblock, vExtraTxnForCompact, vLockTxnForCompact);
                 if (status != READ_STATUS_OK) {
                     // TODO: don't ignore failures
                     return true;
@@ -2415,6 +2493,8 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 status = tempBlock.FillBlock(*pblock, dummy);
                 if (status == READ_STATUS_OK) {
                     fBlockReconstructed = true;
+                    GetMetrics().Counter("cmpctblock_reconstructed").Inc();
+                    GetMetrics().Histogram("cmpctblock_reconstruct").Record(GetTimeMicros() - nTimeReceived);
                 }
             }
         } else {
@@ -2484,6 +2564,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             }
 
             PartiallyDownloadedBlock& partialBlock = *it->second.second->partialBlock;
+            int64_t nTimeCmpctBlock = it->second.second->nTimeCmpctBlock;
             ReadStatus status = partialBlock.FillBlock(*pblock, resp.txn);
             if (status == READ_STATUS_INVALID) {
                 MarkBlockAsReceived(resp.blockhash); // Reset in-flight state in case of whitelist
@@ -2492,6 +2573,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 return true;
             } else if (status == READ_STATUS_FAILED) {
                 // Might have collided, fall back to getdata now :(
+                GetMetrics().Counter("cmpctblock_failed").Inc();
                 std::vector<CInv> invs;
                 invs.push_back(CInv(MSG_BLOCK, resp.blockhash));
                 connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::GETDATA, invs));
@@ -2515,6 +2597,9 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 // updated, reject messages go out, etc.
                 MarkBlockAsReceived(resp.blockhash); // it is now an empty pointer
                 fBlockRead = true;
+                // the block either needed no round trip or waited for this BLOCKTXN
+                GetMetrics().Counter(resp.txn.empty() ? "cmpctblock_reconstructed" : "cmpctblock_reconstructed_getblocktxn").Inc();
+                GetMetrics().Histogram("cmpctblock_reconstruct").Record(GetTimeMicros() - nTimeCmpctBlock);
                 // mapBlockSource is only used for sending reject messages and DoS scores,
                 // so the race between here and cs_main in ProcessNewBlock is fine.
                 // BIP 152 permits peers to relay compact blocks after validating
@@ -3023,6 +3108,49 @@ static bool SendRejectsAndCheckIfBanned(CNode* pnode, CConnman& connman)
     return false;
 }
 
+/**
+ * Commands whose handling only touches the sending peer, which is always handled by the same thread, and
+ * subsystems with their own locks. These are handled concurrently by the message handler threads.
+ * The PrivateSend client relies on its messages not being listed here, see CPrivateSendClientManager::ProcessMessage.
+ */
+static bool IsConcurrentMessage(const std::string& strCommand)
+{
+    static const std::set<std::string> setConcurrent = {
+        NetMsgType::PING,
+        NetMsgType::PONG,
+        NetMsgType::MEMPOOL,
+        NetMsgType::FILTERLOAD,
+        NetMsgType::FILTERADD,
+        NetMsgType::FILTERCLEAR,
+        NetMsgType::REJECT,
+        NetMsgType::NOTFOUND,
+        NetMsgType::SPORK,
+        NetMsgType::GETSPORKS,
+        NetMsgType::MASTERNODEPAYMENTVOTE,
+        NetMsgType::MASTERNODEPAYMENTSYNC,
+        NetMsgType::MNGOVERNANCESYNC,
+        NetMsgType::MNGOVERNANCEOBJECT,
+        NetMsgType::MNGOVERNANCEOBJECTVOTE,
+    };
+    return setConcurrent.count(strCommand) != 0;
+}
+
+/** ProcessMessage latency histogram for strCommand, all unknown commands share one */
+static CLatencyHistogram& GetMessageLatencyHistogram(const std::string& strCommand)
+{
+    static const std::map<std::string, CLatencyHistogram*> mapHistograms = [] {
+        std::map<std::string, CLatencyHistogram*> mapRet;
+        for (const std::string& msg : getAllNetMessageTypes()) {
+            mapRet.emplace(msg, &GetMetrics().Histogram("msg_" + msg));
+        }
+        return mapRet;
+    }();
+    static CLatencyHistogram& histogramOther = GetMetrics().Histogram("msg_other");
+
+    auto it = mapHistograms.find(strCommand);
+    return it != mapHistograms.end() ? *it->second : histogramOther;
+}
+
 bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
 {
     const CChainParams& chainparams = Params();
@@ -3036,8 +3164,10 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
     //
     bool fMoreWork = false;
 
-    if (!pfrom->vRecvGetData.empty())
+    if (!pfrom->vRecvGetData.empty()) {
+        CValidationQueueTurn turn;
         ProcessGetData(pfrom, chainparams.GetConsensus(), connman, interruptMsgProc);
+    }
 
     if (pfrom->fDisconnect)
         return false;
@@ -3049,6 +3179,11 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
         if (pfrom->fPauseSend)
             return false;
 
+        // Leave the messages in vProcessMsg, where receive flood control applies to them, while too many of the
+        // peer's masternode messages wait for their signature checks
+        if (mnodeman.HasTooManyPendingSigChecks(pfrom->id))
+            return false;
+
         std::list<CNetMessage> msgs;
         {
             LOCK(pfrom->cs_vProcessMsg);
@@ -3094,11 +3229,22 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
             return fMoreWork;
         }
 
+        // Blocks and transactions queue notifications for asynchronous listeners, wait here while they are
+        // behind, cs_main is not held yet
+        LimitValidationInterfaceQueue();
+
         // Process message
         bool fRet = false;
         try
         {
-            fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc);
+            if (IsConcurrentMessage(strCommand)) {
+                CScopedLatency latency(GetMessageLatencyHistogram(strCommand));
+                fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc);
+            } else {
+                CValidationQueueTurn turn;
+                CScopedLatency latency(GetMessageLatencyHistogram(strCommand));
+                fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc);
+            }
             if (interruptMsgProc)
                 return false;
             if (!pfrom->vRecvGetData.empty())
@@ -3163,6 +3309,11 @@ public:
 bool SendMessages(CNode* pto, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
 {
     const Consensus::Params& consensusParams = Params().GetConsensus();
+    CValidationQueueTurn turn;
+
+    // process masternode broadcasts/pings whose signatures were verified in the meantime
+    mnodeman.ProcessPendingSigChecks(connman);
+
     {
         // Don't send anything until the version handshake is complete
         if (!pto->fSuccessfullyConnected || pto->fDisconnect)
@@ -23,6 +23,10 @@ static constexpr int64_t HEADERS_DOWNLOAD_TIMEOUT_PER_HEADER = 1000; // 1ms/head
 
 /** Default number of orphan+recently-replaced txn to keep around for block reconstruction */
 static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 100;
+/** Default number of recent InstantSend lock request and PrivateSend dstx txn to keep around for block reconstruction */
+static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_LOCK_TXN = 500;
+/** Larger lock request and dstx txn are not kept in the lock pool, rejected ones go to the extra pool instead */
+static const size_t MAX_BLOCK_RECONSTRUCTION_LOCK_TX_USAGE = 10000;
 
 /** Register with a network node to receive its signals */
 void RegisterNodeSignals(CNodeSignals& nodeSignals);
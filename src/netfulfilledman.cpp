@@ -14,6 +14,7 @@ void CNetFulfilledRequestManager::AddFulfilledRequest(const CService& addr, cons
     LOCK(cs_mapFulfilledRequests);
     CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
     mapFulfilledRequests[addrSquashed][strRequest] = GetTime() + Params().FulfilledRequestExpireTime();
+    LogEntry(addrSquashed);
 }
 
 bool CNetFulfilledRequestManager::HasFulfilledRequest(const CService& addr, const std::string& strRequest)
@@ -33,8 +34,20 @@ void CNetFulfilledRequestManager::RemoveFulfilledRequest(const CService& addr, c
     CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
     fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addrSquashed);
 
+    if (it != mapFulfilledRequests.end() && it->second.erase(strRequest)) {
+        LogEntry(addrSquashed);
+    }
+}
+
+void CNetFulfilledRequestManager::LogEntry(const CService& addr)
+{
+    if (!log) return;
+
+    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addr);
     if (it != mapFulfilledRequests.end()) {
-        it->second.erase(strRequest);
+        log->Write(addr, it->second);
+    } else {
+        log->Erase(addr);
     }
 }
 
@@ -46,26 +59,79 @@ void CNetFulfilledRequestManager::CheckAndRemove()
     fulfilledreqmap_t::iterator it = mapFulfilledRequests.begin();
 
     while(it != mapFulfilledRequests.end()) {
+        bool fChanged = false;
         fulfilledreqmapentry_t::iterator it_entry = it->second.begin();
         while(it_entry != it->second.end()) {
             if(now > it_entry->second) {
                 it->second.erase(it_entry++);
+                fChanged = true;
             } else {
                 ++it_entry;
             }
         }
         if(it->second.size() == 0) {
+            if (log) log->Erase(it->first);
             mapFulfilledRequests.erase(it++);
         } else {
+            if (log && fChanged) log->Write(it->first, it->second);
             ++it;
         }
     }
+
+    if (log) {
+        if (log->NeedsCompaction(mapFulfilledRequests.size())) {
+            log->Compact(mapFulfilledRequests);
+        } else {
+            log->Flush();
+        }
+    }
 }
 
 void CNetFulfilledRequestManager::Clear()
 {
     LOCK(cs_mapFulfilledRequests);
     mapFulfilledRequests.clear();
+    if (log) {
+        log->Compact(mapFulfilledRequests);
+    }
+}
+
+bool CNetFulfilledRequestManager::OpenLog(const std::string& strFilename)
+{
+    LOCK(cs_mapFulfilledRequests);
+
+    log.reset(new CFlatDBLog<CService, fulfilledreqmapentry_t>(strFilename, "magicFulfilledLog"));
+    if (!log->Exists()) {
+        // first start with the log, keep what was loaded from the old cache file
+        if (!log->Open([](CService&&, fulfilledreqmapentry_t&&) {}, [](CService&&) {}) || !log->Compact(mapFulfilledRequests)) {
+            log.reset();
+            return false;
+        }
+    } else {
+        mapFulfilledRequests.clear();
+        bool fOk = log->Open(
+            [this](CService&& addr, fulfilledreqmapentry_t&& entry) { mapFulfilledRequests[addr] = std::move(entry); },
+            [this](CService&& addr) { mapFulfilledRequests.erase(addr); });
+        if (!fOk) {
+            log.reset();
+            return false;
+        }
+    }
+    LogPrintf("     %s\n", ToString());
+
+    CheckAndRemove();
+    return true;
+}
+
+void CNetFulfilledRequestManager::CloseLog()
+{
+    LOCK(cs_mapFulfilledRequests);
+
+    if (!log) return;
+    if (log->NeedsCompaction(mapFulfilledRequests.size())) {
+        log->Compact(mapFulfilledRequests);
+    }
+    log.reset();
 }
 
 std::string CNetFulfilledRequestManager::ToString() const
@@ -5,10 +5,13 @@
 #ifndef NETFULFILLEDMAN_H
 #define NETFULFILLEDMAN_H
 
+#include "flat-database.h"
 #include "netaddress.h"
 #include "serialize.h"
 #include "sync.h"
 
+#include <memory>
+
 class CNetFulfilledRequestManager;
 extern CNetFulfilledRequestManager netfulfilledman;
 
@@ -24,7 +27,11 @@ private:
     fulfilledreqmap_t mapFulfilledRequests;
     CCriticalSection cs_mapFulfilledRequests;
 
+    // changes are appended to this log (if opened) instead of dumping the whole map on shutdown
+    std::unique_ptr<CFlatDBLog<CService, fulfilledreqmapentry_t> > log;
+
     void RemoveFulfilledRequest(const CService& addr, const std::string& strRequest);
+    void LogEntry(const CService& addr);
 
 public:
     CNetFulfilledRequestManager() {}
@@ -43,6 +50,10 @@ public:
     void CheckAndRemove();
     void Clear();
 
+    // Replays the log into the current requests (or creates it from them if it doesn't exist yet) and keeps it open
+    bool OpenLog(const std::string& strFilename);
+    void CloseLog();
+
     std::string ToString() const;
 
     void DoMaintenance();
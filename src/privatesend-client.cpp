@@ -27,6 +27,16 @@ void CPrivateSendClientManager::ProcessMessage(CNode* pfrom, const std::string&
     if (fLiteMode) return; // ignore all Sibcoin related functionality
     if (!masternodeSync.IsBlockchainSynced()) return;
 
+    // This is called for every extension message, including the ones which net_processing handles outside of the
+    // validation queue. The PrivateSend messages are always handled inside of it, so ignore all others before
+    // touching the pool below.
+    if (strCommand != NetMsgType::DSQUEUE &&
+        strCommand != NetMsgType::DSSTATUSUPDATE &&
+        strCommand != NetMsgType::DSFINALTX &&
+        strCommand != NetMsgType::DSCOMPLETE) {
+        return;
+    }
+
     if (!CheckDiskSpace()) {
         ResetPool();
         fEnablePrivateSend = false;
@@ -0,0 +1,114 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DASH_RINGBUFFER_H
+#define DASH_RINGBUFFER_H
+
+#include <assert.h>
+#include <atomic>
+#include <memory>
+
+/**
+ * Bounded lock-free multi-producer/multi-consumer queue.
+ *
+ * Every cell carries a sequence number which tells producers and consumers whether the cell is free for the current
+ * lap of the ring or holds a value. A push or pop only needs a single CAS on the shared enqueue/dequeue position and
+ * never waits for other threads, so pushing from many threads doesn't serialize them on a mutex. If the ring is full,
+ * TryPush fails right away and leaves it to the caller to decide what to do with the value.
+ *
+ * The capacity is rounded up to the next power of two.
+ */
+template<typename T>
+class CRingBuffer
+{
+private:
+    struct Cell {
+        std::atomic<size_t> nSeq;
+        T value;
+    };
+
+    const size_t nMask;
+    std::unique_ptr<Cell[]> cells;
+
+    // positions are kept on separate cache lines so that producers and consumers don't invalidate each other
+    alignas(64) std::atomic<size_t> nEnqueuePos{0};
+    alignas(64) std::atomic<size_t> nDequeuePos{0};
+
+    static size_t RoundUpPow2(size_t n)
+    {
+        size_t r = 2;
+        while (r < n) {
+            r <<= 1;
+        }
+        return r;
+    }
+
+public:
+    explicit CRingBuffer(size_t nCapacity) :
+        nMask(RoundUpPow2(nCapacity) - 1),
+        cells(new Cell[nMask + 1])
+    {
+        for (size_t i = 0; i <= nMask; i++) {
+            cells[i].nSeq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    CRingBuffer(const CRingBuffer&) = delete;
+    CRingBuffer& operator=(const CRingBuffer&) = delete;
+
+    size_t Capacity() const { return nMask + 1; }
+
+    // Moves value into the ring. Returns false (and leaves value untouched) if the ring is full
+    bool TryPush(T&& value)
+    {
+        size_t nPos = nEnqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[nPos & nMask];
+            size_t nSeq = cell.nSeq.load(std::memory_order_acquire);
+            intptr_t nDiff = (intptr_t)nSeq - (intptr_t)nPos;
+            if (nDiff == 0) {
+                if (nEnqueuePos.compare_exchange_weak(nPos, nPos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.nSeq.store(nPos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (nDiff < 0) {
+                // the consumers haven't freed this cell from the previous lap yet
+                return false;
+            } else {
+                nPos = nEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Moves the oldest value out of the ring. Returns false if the ring is empty
+    bool TryPop(T& value)
+    {
+        size_t nPos = nDequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[nPos & nMask];
+            size_t nSeq = cell.nSeq.load(std::memory_order_acquire);
+            intptr_t nDiff = (intptr_t)nSeq - (intptr_t)(nPos + 1);
+            if (nDiff == 0) {
+                if (nDequeuePos.compare_exchange_weak(nPos, nPos + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+                    cell.nSeq.store(nPos + nMask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (nDiff < 0) {
+                return false;
+            } else {
+                nPos = nDequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Only a snapshot when other threads push or pop concurrently
+    bool Empty() const
+    {
+        return nEnqueuePos.load(std::memory_order_acquire) == nDequeuePos.load(std::memory_order_acquire);
+    }
+};
+
+#endif // DASH_RINGBUFFER_H
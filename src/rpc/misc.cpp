@@ -8,6 +8,7 @@
 #include "base58.h"
 #include "clientversion.h"
 #include "init.h"
+#include "metrics.h"
 #include "net.h"
 #include "netbase.h"
 #include "rpc/server.h"
@@ -1119,6 +1120,85 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
     return obj;
 }
 
+UniValue getmetrics(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getmetrics ( \"prefix\" )\n"
+            "Returns counters, gauges and latency histograms collected since startup.\n"
+            "Latencies are in microseconds. Histograms are kept per P2P message (msg_<command>),\n"
+            "RPC method (rpc_<method>), block connection stage (connectblock_*, connecttip_*),\n"
+            "block template creation (createnewblock_*), mempool acceptance and LevelDB access.\n"
+            "Compact block reconstruction outcomes and transaction sources are counted as cmpctblock_*.\n"
+            "\nArguments:\n"
+            "1. \"prefix\"    (string, optional) Only return metrics whose name starts with prefix\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"counters\": {               (json object) Monotonic counters\n"
+            "    \"name\": n, ...\n"
+            "  },\n"
+            "  \"gauges\": {                 (json object) Current values\n"
+            "    \"name\": n, ...\n"
+            "  },\n"
+            "  \"histograms\": {             (json object) Latency histograms\n"
+            "    \"name\": {\n"
+            "      \"count\": n,             (numeric) Number of samples\n"
+            "      \"mean\": n,              (numeric) Mean latency\n"
+            "      \"p50\": n,               (numeric) Median latency\n"
+            "      \"p90\": n,               (numeric) 90th percentile\n"
+            "      \"p99\": n,               (numeric) 99th percentile\n"
+            "      \"p999\": n,              (numeric) 99.9th percentile\n"
+            "      \"max\": n                (numeric) Highest latency seen\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmetrics", "")
+            + HelpExampleCli("getmetrics", "\"msg_\"")
+            + HelpExampleRpc("getmetrics", "\"rpc_\"")
+        );
+
+    std::string strPrefix;
+    if (request.params.size() > 0)
+        strPrefix = request.params[0].get_str();
+    auto matches = [&strPrefix](const std::string& strName) {
+        return strName.compare(0, strPrefix.size(), strPrefix) == 0;
+    };
+
+    const CMetricsRegistry& metrics = GetMetrics();
+    UniValue counters(UniValue::VOBJ);
+    for (const auto& p : metrics.GetCounters()) {
+        if (matches(p.first))
+            counters.push_back(Pair(p.first, p.second));
+    }
+    UniValue gauges(UniValue::VOBJ);
+    for (const auto& p : metrics.GetGauges()) {
+        if (matches(p.first))
+            gauges.push_back(Pair(p.first, p.second));
+    }
+    UniValue histograms(UniValue::VOBJ);
+    for (const auto& p : metrics.GetHistograms()) {
+        // metrics which never fired are left out, e.g. messages we never received
+        if (!matches(p.first) || p.second.nCount == 0)
+            continue;
+        UniValue histogram(UniValue::VOBJ);
+        histogram.push_back(Pair("count", p.second.nCount));
+        histogram.push_back(Pair("mean", p.second.Mean()));
+        histogram.push_back(Pair("p50", p.second.Quantile(0.5)));
+        histogram.push_back(Pair("p90", p.second.Quantile(0.9)));
+        histogram.push_back(Pair("p99", p.second.Quantile(0.99)));
+        histogram.push_back(Pair("p999", p.second.Quantile(0.999)));
+        histogram.push_back(Pair("max", p.second.nMax));
+        histograms.push_back(Pair(p.first, histogram));
+    }
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("counters", counters));
+    obj.push_back(Pair("gauges", gauges));
+    obj.push_back(Pair("histograms", histograms));
+    return obj;
+}
+
 UniValue echo(const JSONRPCRequest& request)
 {
     if (request.fHelp)
@@ -1138,6 +1218,7 @@ static const CRPCCommand commands[] =
     { "control",            "debug",                  &debug,                  true,  {} },
     { "control",            "getinfo",                &getinfo,                true,  {} }, /* uses wallet if enabled */
     { "control",            "getmemoryinfo",          &getmemoryinfo,          true,  {} },
+    { "control",            "getmetrics",             &getmetrics,             true,  {"prefix"} },
     { "util",               "validateaddress",        &validateaddress,        true,  {"address"} }, /* uses wallet if enabled */
     { "util",               "createmultisig",         &createmultisig,         true,  {"nrequired","keys"} },
     { "util",               "verifymessage",          &verifymessage,          true,  {"address","signature","message"} },
@@ -25,6 +25,7 @@
 #include "evo/simplifiedmns.h"
 
 #include "bls/bls.h"
+#include "bls/bls_batchverifier.h"
 
 #ifdef ENABLE_WALLET
 extern UniValue signrawtransaction(const JSONRPCRequest& request);
@@ -1159,6 +1160,65 @@ UniValue bls_generate(const JSONRPCRequest& request)
     return ret;
 }
 
+void bls_stats_help()
+{
+    throw std::runtime_error(
+            "bls stats\n"
+            "\nReturns statistics about batched BLS signature verification and BLS caches.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"batches\": n,              (numeric) Number of verified batches\n"
+            "  \"sigs\": n,                 (numeric) Number of verified signatures\n"
+            "  \"invalidsigs\": n,          (numeric) Number of invalid signatures\n"
+            "  \"aggregatedchecks\": n,     (numeric) Number of aggregated verifications, including bisection steps\n"
+            "  \"avgbatchsize\": x.xxx,     (numeric) Average number of signatures per batch\n"
+            "  \"maxbatchsize\": n,         (numeric) Largest batch seen so far\n"
+            "  \"avgbatchtime\": x.xxx,     (numeric) Average verification time per batch in milliseconds\n"
+            "  \"pubkeycache\": {           (json object) Cache of parsed public keys\n"
+            "    \"hits\": n,               (numeric) Number of cache hits\n"
+            "    \"misses\": n,             (numeric) Number of cache misses\n"
+            "  },\n"
+            "  \"sigcache\": {              (json object) Cache of successfully verified signatures\n"
+            "    \"hits\": n,               (numeric) Number of cache hits\n"
+            "    \"misses\": n,             (numeric) Number of cache misses\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("bls stats", "")
+    );
+}
+
+UniValue bls_stats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1) {
+        bls_stats_help();
+    }
+
+    uint64_t nBatches = blsSigVerifyStats.nBatches;
+    uint64_t nSigs = blsSigVerifyStats.nSigs;
+    uint64_t nTotalTimeMicros = blsSigVerifyStats.nTotalTimeMicros;
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("batches", nBatches));
+    ret.push_back(Pair("sigs", nSigs));
+    ret.push_back(Pair("invalidsigs", (uint64_t)blsSigVerifyStats.nInvalidSigs));
+    ret.push_back(Pair("aggregatedchecks", (uint64_t)blsSigVerifyStats.nAggregatedChecks));
+    ret.push_back(Pair("avgbatchsize", nBatches ? (double)nSigs / nBatches : 0.0));
+    ret.push_back(Pair("maxbatchsize", (uint64_t)blsSigVerifyStats.nMaxBatchSize));
+    ret.push_back(Pair("avgbatchtime", nBatches ? (double)nTotalTimeMicros / nBatches / 1000 : 0.0));
+
+    UniValue pubKeyCacheObj(UniValue::VOBJ);
+    pubKeyCacheObj.push_back(Pair("hits", blsPublicKeyCache.GetHits()));
+    pubKeyCacheObj.push_back(Pair("misses", blsPublicKeyCache.GetMisses()));
+    ret.push_back(Pair("pubkeycache", pubKeyCacheObj));
+
+    UniValue sigCacheObj(UniValue::VOBJ);
+    sigCacheObj.push_back(Pair("hits", blsVerifiedSigsCache.GetHits()));
+    sigCacheObj.push_back(Pair("misses", blsVerifiedSigsCache.GetMisses()));
+    ret.push_back(Pair("sigcache", sigCacheObj));
+    return ret;
+}
+
 [[ noreturn ]] void bls_help()
 {
     throw std::runtime_error(
@@ -1169,6 +1229,7 @@ UniValue bls_generate(const JSONRPCRequest& request)
             "1. \"command\"        (string, required) The command to execute\n"
             "\nAvailable commands:\n"
             "  generate          - Create a BLS secret/public key pair\n"
+            "  stats             - Show BLS signature verification and cache statistics\n"
             );
 }
 
@@ -1185,6 +1246,8 @@ UniValue _bls(const JSONRPCRequest& request)
 
     if (command == "generate") {
         return bls_generate(request);
+    } else if (command == "stats") {
+        return bls_stats(request);
     } else {
         bls_help();
     }
@@ -9,6 +9,7 @@
 
 #include "base58.h"
 #include "init.h"
+#include "metrics.h"
 #include "random.h"
 #include "sync.h"
 #include "ui_interface.h"
@@ -546,6 +547,7 @@ UniValue CRPCTable::execute(const JSONRPCRequest &request) const
 
     g_rpcSignals.PreCommand(*pcmd);
 
+    CScopedLatency latency(GetMetrics().Histogram("rpc_" + pcmd->name));
     try
     {
         // Execute, convert arguments to array if necessary
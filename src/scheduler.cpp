@@ -4,13 +4,33 @@
 
 #include "scheduler.h"
 
+#include "metrics.h"
 #include "reverselock.h"
 
 #include <assert.h>
 #include <boost/bind.hpp>
 #include <utility>
 
-CScheduler::CScheduler() : nThreadsServicingQueue(0), stopRequested(false), stopWhenEmpty(false)
+// The timer wheel ticks once per millisecond. Due times are rounded up and the current time is rounded down, so that
+// tasks never run before their time.
+static int64_t ToTick(const boost::chrono::system_clock::time_point& t)
+{
+    int64_t nMicros = boost::chrono::duration_cast<boost::chrono::microseconds>(t.time_since_epoch()).count();
+    return nMicros / 1000 + (nMicros % 1000 > 0 ? 1 : 0);
+}
+
+static int64_t ToElapsedTick(const boost::chrono::system_clock::time_point& t)
+{
+    int64_t nMicros = boost::chrono::duration_cast<boost::chrono::microseconds>(t.time_since_epoch()).count();
+    return nMicros / 1000 - (nMicros % 1000 < 0 ? 1 : 0);
+}
+
+static boost::chrono::system_clock::time_point FromTick(int64_t nTick)
+{
+    return boost::chrono::system_clock::time_point(boost::chrono::milliseconds(nTick));
+}
+
+CScheduler::CScheduler() : timerWheel(ToElapsedTick(boost::chrono::system_clock::now())), nActiveQueues(0), nThreadsServicingQueue(0), stopRequested(false), stopWhenEmpty(false)
 {
 }
 
@@ -27,6 +47,54 @@ static boost::system_time toPosixTime(const boost::chrono::system_clock::time_po
 }
 #endif
 
+CScheduler::SerialQueue& CScheduler::GetQueue(const std::string& strQueue)
+{
+    const std::string& strName = strQueue.empty() ? "default" : strQueue;
+    SerialQueue& queue = mapQueues[strName];
+    if (queue.histogramDelay == nullptr) {
+        queue.histogramDelay = &GetMetrics().Histogram("scheduler_delay_" + strName);
+        queue.histogramRun = &GetMetrics().Histogram("scheduler_run_" + strName);
+    }
+    return queue;
+}
+
+void CScheduler::MakeDue(Task&& task)
+{
+    SerialQueue& queue = *task.queue;
+    if (queue.fActive) {
+        queue.pending.emplace_back(std::move(task));
+    } else {
+        queue.fActive = true;
+        nActiveQueues++;
+        readyTasks.emplace_back(std::move(task));
+    }
+}
+
+void CScheduler::AdvanceTimerWheel()
+{
+    std::vector<std::pair<int64_t, Task> > vExpired;
+    timerWheel.Advance(ToElapsedTick(boost::chrono::system_clock::now()), vExpired);
+    for (auto& expired : vExpired) {
+        MakeDue(std::move(expired.second));
+    }
+}
+
+void CScheduler::FinishTask(SerialQueue& queue)
+{
+    if (!queue.pending.empty()) {
+        readyTasks.emplace_back(std::move(queue.pending.front()));
+        queue.pending.pop_front();
+        newTaskScheduled.notify_one();
+        return;
+    }
+    queue.fActive = false;
+    nActiveQueues--;
+    if (stopWhenEmpty && nActiveQueues == 0) {
+        // threads waiting to drain may be done now
+        newTaskScheduled.notify_all();
+    }
+}
+
 void CScheduler::serviceQueue()
 {
     boost::unique_lock<boost::mutex> lock(newTaskMutex);
@@ -37,43 +105,48 @@ void CScheduler::serviceQueue()
     // is called.
     while (!shouldStop()) {
         try {
-            while (!shouldStop() && taskQueue.empty()) {
-                // Wait until there is something to do.
-                newTaskScheduled.wait(lock);
-            }
-
-            // Wait until either there is a new task, or until
-            // the time of the first item on the queue:
+            AdvanceTimerWheel();
+            while (!shouldStop() && readyTasks.empty()) {
+                if (timerWheel.Empty()) {
+                    // Wait until there is something to do.
+                    newTaskScheduled.wait(lock);
+                } else {
+                    // Wait until either there is a new task, or until
+                    // the next tick of the timer wheel which has work:
 
 // wait_until needs boost 1.50 or later; older versions have timed_wait:
 #if BOOST_VERSION < 105000
-            while (!shouldStop() && !taskQueue.empty() &&
-                   newTaskScheduled.timed_wait(lock, toPosixTime(taskQueue.begin()->first))) {
-                // Keep waiting until timeout
-            }
+                    newTaskScheduled.timed_wait(lock, toPosixTime(FromTick(timerWheel.NextTick())));
 #else
-            // Some boost versions have a conflicting overload of wait_until that returns void.
-            // Explicitly use a template here to avoid hitting that overload.
-            while (!shouldStop() && !taskQueue.empty()) {
-                boost::chrono::system_clock::time_point timeToWaitFor = taskQueue.begin()->first;
-                if (newTaskScheduled.wait_until<>(lock, timeToWaitFor) == boost::cv_status::timeout)
-                    break; // Exit loop after timeout, it means we reached the time of the event
-            }
+                    // Some boost versions have a conflicting overload of wait_until that returns void.
+                    // Explicitly use a template here to avoid hitting that overload.
+                    newTaskScheduled.wait_until<>(lock, FromTick(timerWheel.NextTick()));
 #endif
-            // If there are multiple threads, the queue can empty while we're waiting (another
-            // thread may service the task we were waiting on).
-            if (shouldStop() || taskQueue.empty())
+                }
+                AdvanceTimerWheel();
+            }
+            // If there are multiple threads, another thread may have taken
+            // the task while we were waiting.
+            if (shouldStop() || readyTasks.empty())
                 continue;
 
-            Function f = taskQueue.begin()->second;
-            taskQueue.erase(taskQueue.begin());
+            Task task = std::move(readyTasks.front());
+            readyTasks.pop_front();
+            SerialQueue& queue = *task.queue;
 
-            {
+            boost::chrono::system_clock::time_point tStart = boost::chrono::system_clock::now();
+            queue.histogramDelay->Record(boost::chrono::duration_cast<boost::chrono::microseconds>(tStart - task.t).count());
+            try {
                 // Unlock before calling f, so it can reschedule itself or another task
                 // without deadlocking:
                 reverse_lock<boost::unique_lock<boost::mutex> > rlock(lock);
-                f();
+                task.f();
+            } catch (...) {
+                FinishTask(queue);
+                throw;
             }
+            queue.histogramRun->Record(boost::chrono::duration_cast<boost::chrono::microseconds>(boost::chrono::system_clock::now() - tStart).count());
+            FinishTask(queue);
         } catch (...) {
             --nThreadsServicingQueue;
             throw;
@@ -95,39 +168,51 @@ void CScheduler::stop(bool drain)
     newTaskScheduled.notify_all();
 }
 
-void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t)
+void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t, const std::string& strQueue)
 {
     {
         boost::unique_lock<boost::mutex> lock(newTaskMutex);
-        taskQueue.insert(std::make_pair(t, f));
+        Task task{f, t, &GetQueue(strQueue)};
+        timerWheel.Insert(ToTick(t), std::move(task));
     }
+    // wake up a thread to recompute its timeout
     newTaskScheduled.notify_one();
 }
 
-void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaSeconds)
+void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaSeconds, const std::string& strQueue)
 {
-    schedule(f, boost::chrono::system_clock::now() + boost::chrono::seconds(deltaSeconds));
+    schedule(f, boost::chrono::system_clock::now() + boost::chrono::seconds(deltaSeconds), strQueue);
 }
 
-static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaSeconds)
+static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaSeconds, const std::string& strQueue)
 {
     f();
-    s->scheduleFromNow(boost::bind(&Repeat, s, f, deltaSeconds), deltaSeconds);
+    s->scheduleFromNow(boost::bind(&Repeat, s, f, deltaSeconds, strQueue), deltaSeconds, strQueue);
 }
 
-void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaSeconds)
+void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaSeconds, const std::string& strQueue)
 {
-    scheduleFromNow(boost::bind(&Repeat, this, f, deltaSeconds), deltaSeconds);
+    scheduleFromNow(boost::bind(&Repeat, this, f, deltaSeconds, strQueue), deltaSeconds, strQueue);
 }
 
 size_t CScheduler::getQueueInfo(boost::chrono::system_clock::time_point &first,
                              boost::chrono::system_clock::time_point &last) const
 {
     boost::unique_lock<boost::mutex> lock(newTaskMutex);
-    size_t result = taskQueue.size();
-    if (!taskQueue.empty()) {
-        first = taskQueue.begin()->first;
-        last = taskQueue.rbegin()->first;
+    size_t result = 0;
+    auto visit = [&](const Task& task) {
+        if (result == 0 || task.t < first)
+            first = task.t;
+        if (result == 0 || task.t > last)
+            last = task.t;
+        result++;
+    };
+    timerWheel.ForEach([&](int64_t, const Task& task) { visit(task); });
+    for (const Task& task : readyTasks)
+        visit(task);
+    for (const auto& queue : mapQueues) {
+        for (const Task& task : queue.second.pending)
+            visit(task);
     }
     return result;
 }
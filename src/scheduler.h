@@ -13,7 +13,18 @@
 #include <boost/function.hpp>
 #include <boost/chrono/chrono.hpp>
 #include <boost/thread.hpp>
+#include <deque>
 #include <map>
+#include <string>
+
+#include "timerwheel.h"
+
+class CLatencyHistogram;
+
+/** Default number of threads servicing the scheduler in the node */
+static const int DEFAULT_SCHEDULER_THREADS = 3;
+/** Maximum number of scheduler threads */
+static const int MAX_SCHEDULER_THREADS = 16;
 
 //
 // Simple class for background tasks that should be run
@@ -32,6 +43,16 @@
 // delete t;
 // delete s; // Must be done after thread is interrupted/joined.
 //
+// Every task belongs to a named serial queue; tasks of the same queue never
+// run concurrently and start in the order they became due, tasks of different
+// queues may run in parallel when more than one thread services the scheduler.
+// Tasks scheduled without a queue name all go to the "default" queue.
+//
+// Pending tasks are kept in a timer wheel with a resolution of one millisecond.
+// The delay between the time a task was due and the time it started, and the
+// time it ran, are recorded per queue in the "scheduler_delay_<queue>" and
+// "scheduler_run_<queue>" metrics.
+//
 
 class CScheduler
 {
@@ -41,22 +62,22 @@ public:
 
     typedef boost::function<void(void)> Function;
 
-    // Call func at/after time t
-    void schedule(Function f, boost::chrono::system_clock::time_point t);
+    // Call func at/after time t on serial queue strQueue
+    void schedule(Function f, boost::chrono::system_clock::time_point t, const std::string& strQueue = "");
 
     // Convenience method: call f once deltaSeconds from now
-    void scheduleFromNow(Function f, int64_t deltaSeconds);
+    void scheduleFromNow(Function f, int64_t deltaSeconds, const std::string& strQueue = "");
 
     // Another convenience method: call f approximately
     // every deltaSeconds forever, starting deltaSeconds from now.
     // To be more precise: every time f is finished, it
     // is rescheduled to run deltaSeconds later. If you
     // need more accurate scheduling, don't use this method.
-    void scheduleEvery(Function f, int64_t deltaSeconds);
+    void scheduleEvery(Function f, int64_t deltaSeconds, const std::string& strQueue = "");
 
     // To keep things as simple as possible, there is no unschedule.
 
-    // Services the queue 'forever'. Should be run in a thread,
+    // Services the queue 'forever'. Should be run in one or more threads,
     // and interrupted using boost::interrupt_thread
     void serviceQueue();
 
@@ -71,13 +92,40 @@ public:
                         boost::chrono::system_clock::time_point &last) const;
 
 private:
-    std::multimap<boost::chrono::system_clock::time_point, Function> taskQueue;
+    struct SerialQueue;
+
+    struct Task {
+        Function f;
+        boost::chrono::system_clock::time_point t;
+        SerialQueue* queue;
+    };
+
+    struct SerialQueue {
+        // a task of this queue is ready or running
+        bool fActive{false};
+        // due tasks waiting for the active one to finish
+        std::deque<Task> pending;
+        CLatencyHistogram* histogramDelay{nullptr};
+        CLatencyHistogram* histogramRun{nullptr};
+    };
+
+    CTimerWheel<Task> timerWheel;
+    // due tasks which can be started right away, at most one per serial queue
+    std::deque<Task> readyTasks;
+    std::map<std::string, SerialQueue> mapQueues;
+    int nActiveQueues;
     boost::condition_variable newTaskScheduled;
     mutable boost::mutex newTaskMutex;
     int nThreadsServicingQueue;
     bool stopRequested;
     bool stopWhenEmpty;
-    bool shouldStop() { return stopRequested || (stopWhenEmpty && taskQueue.empty()); }
+    bool shouldStop() { return stopRequested || (stopWhenEmpty && timerWheel.Empty() && nActiveQueues == 0); }
+
+    SerialQueue& GetQueue(const std::string& strQueue);
+    // moves tasks which are due now from the timer wheel to their serial queues
+    void AdvanceTimerWheel();
+    void MakeDue(Task&& task);
+    void FinishTask(SerialQueue& queue);
 };
 
 #endif
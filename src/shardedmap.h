@@ -0,0 +1,167 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef SHARDEDMAP_H_
+#define SHARDEDMAP_H_
+
+#include "serialize.h"
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * Hash map split into NUM_SHARDS independently locked unordered maps.
+ *
+ * A key always goes to the same shard (selected by Hasher), so concurrent lookups and inserts of different keys
+ * rarely contend on the same mutex. The shard mutexes are leaf locks, they are never held while calling out of this
+ * class (except for the functors passed to Update/EraseIf, which must not take other locks). Lookups on an empty map
+ * don't take any lock at all.
+ *
+ * Serialized in the same format as std::map<K, V>, so it can replace such a map without breaking existing files.
+ */
+template<typename K, typename V, typename Hasher, size_t NUM_SHARDS = 16>
+class CShardedMap
+{
+private:
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<K, V, Hasher> map;
+    };
+
+    Hasher hasher;
+    std::array<Shard, NUM_SHARDS> shards;
+    std::atomic<size_t> nSize{0};
+
+    Shard& GetShard(const K& key) { return shards[hasher(key) % NUM_SHARDS]; }
+    const Shard& GetShard(const K& key) const { return shards[hasher(key) % NUM_SHARDS]; }
+
+public:
+    CShardedMap() {}
+
+    CShardedMap(const CShardedMap&) = delete;
+    CShardedMap& operator=(const CShardedMap&) = delete;
+
+    // Returns false (and leaves the existing value alone) if the key is already present
+    bool Insert(const K& key, const V& value)
+    {
+        Shard& shard = GetShard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (!shard.map.emplace(key, value).second) {
+            return false;
+        }
+        nSize++;
+        return true;
+    }
+
+    bool Get(const K& key, V& valueRet) const
+    {
+        if (nSize == 0) {
+            return false;
+        }
+        const Shard& shard = GetShard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.map.find(key);
+        if (it == shard.map.end()) {
+            return false;
+        }
+        valueRet = it->second;
+        return true;
+    }
+
+    bool HasKey(const K& key) const
+    {
+        if (nSize == 0) {
+            return false;
+        }
+        const Shard& shard = GetShard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.map.count(key) != 0;
+    }
+
+    // Calls f(V&) on the value stored for key, returns false if there is none
+    template<typename F>
+    bool Update(const K& key, F&& f)
+    {
+        Shard& shard = GetShard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.map.find(key);
+        if (it == shard.map.end()) {
+            return false;
+        }
+        f(it->second);
+        return true;
+    }
+
+    bool Erase(const K& key)
+    {
+        Shard& shard = GetShard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (!shard.map.erase(key)) {
+            return false;
+        }
+        nSize--;
+        return true;
+    }
+
+    // Removes all entries for which f(const K&, const V&) returns true, one shard at a time
+    template<typename F>
+    void EraseIf(F&& f)
+    {
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (auto it = shard.map.begin(); it != shard.map.end(); ) {
+                if (f(it->first, it->second)) {
+                    it = shard.map.erase(it);
+                    nSize--;
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    void Clear()
+    {
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            nSize -= shard.map.size();
+            shard.map.clear();
+        }
+    }
+
+    size_t Size() const { return nSize; }
+
+    // Ordered copy of all entries. Not a consistent snapshot if the map is modified concurrently
+    std::map<K, V> GetMap() const
+    {
+        std::map<K, V> mapRet;
+        for (const auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            mapRet.insert(shard.map.begin(), shard.map.end());
+        }
+        return mapRet;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << GetMap();
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        std::map<K, V> mapTmp;
+        s >> mapTmp;
+        Clear();
+        for (const auto& pair : mapTmp) {
+            Insert(pair.first, pair.second);
+        }
+    }
+};
+
+#endif /* SHARDEDMAP_H_ */
@@ -95,6 +95,83 @@ private:
     size_t nPos;
 };
 
+/** Minimal stream for reading from an existing byte range in place, without copying it into a CDataStream first.
+ *  The referenced bytes must outlive the reader.
+ */
+class CSpanReader
+{
+ public:
+
+/*
+ * @param[in]  nTypeIn Serialization Type
+ * @param[in]  nVersionIn Serialization Version (including any flags)
+ * @param[in]  pchIn  Start of the referenced bytes
+ * @param[in]  nSizeIn  Number of referenced bytes
+ * @param[in]  nPosIn Starting position, reads begin at pchIn + nPosIn
+*/
+    CSpanReader(int nTypeIn, int nVersionIn, const char* pchIn, size_t nSizeIn, size_t nPosIn = 0) : nType(nTypeIn), nVersion(nVersionIn), pch(pchIn), nSize(nSizeIn), nPos(nPosIn)
+    {
+        if (nPos > nSize)
+            throw std::ios_base::failure("CSpanReader(...): starting position past the end of data");
+    }
+/*
+ * (other params same as above)
+ * @param[in]  args  A list of items to deserialize starting at nPos.
+*/
+    template <typename... Args>
+    CSpanReader(int nTypeIn, int nVersionIn, const char* pchIn, size_t nSizeIn, size_t nPosIn, Args&&... args) : CSpanReader(nTypeIn, nVersionIn, pchIn, nSizeIn, nPosIn)
+    {
+        ::UnserializeMany(*this, std::forward<Args>(args)...);
+    }
+    void read(char* pchOut, size_t nRead)
+    {
+        if (nRead > nSize - nPos)
+            throw std::ios_base::failure("CSpanReader::read(): end of data");
+        memcpy(pchOut, pch + nPos, nRead);
+        nPos += nRead;
+    }
+    void ignore(size_t nSkip)
+    {
+        if (nSkip > nSize - nPos)
+            throw std::ios_base::failure("CSpanReader::ignore(): end of data");
+        nPos += nSkip;
+    }
+    template<typename T>
+    CSpanReader& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+    int GetVersion() const
+    {
+        return nVersion;
+    }
+    int GetType() const
+    {
+        return nType;
+    }
+    // Unread bytes, valid as long as the referenced range is
+    const char* data() const
+    {
+        return pch + nPos;
+    }
+    size_t size() const
+    {
+        return nSize - nPos;
+    }
+    bool empty() const
+    {
+        return nPos == nSize;
+    }
+private:
+    const int nType;
+    const int nVersion;
+    const char* pch;
+    const size_t nSize;
+    size_t nPos;
+};
+
 /** Double ended buffer combining vector and stream-like interfaces.
  *
  * >> and << read and write unformatted data using the above serialization templates.
@@ -141,6 +218,11 @@ public:
         Init(nTypeIn, nVersionIn);
     }
 
+    CDataStream(vector_type&& vchIn, int nTypeIn, int nVersionIn) : vch(std::move(vchIn))
+    {
+        Init(nTypeIn, nVersionIn);
+    }
+
     CDataStream(const std::vector<char>& vchIn, int nTypeIn, int nVersionIn) : vch(vchIn.begin(), vchIn.end())
     {
         Init(nTypeIn, nVersionIn);
@@ -198,6 +280,8 @@ public:
     const_reference operator[](size_type pos) const  { return vch[pos + nReadPos]; }
     reference operator[](size_type pos)              { return vch[pos + nReadPos]; }
     void clear()                                     { vch.clear(); nReadPos = 0; }
+    // Hands the underlying buffer (and its capacity) to the caller, leaving the stream empty
+    vector_type ReleaseBuffer()                      { vector_type ret; ret.swap(vch); nReadPos = 0; return ret; }
     iterator insert(iterator it, const char& x=char()) { return vch.insert(it, x); }
     void insert(iterator it, size_type n, const char& x) { vch.insert(it, n, x); }
     value_type* data()                               { return vch.data() + nReadPos; }
@@ -314,6 +314,75 @@ BOOST_AUTO_TEST_CASE(EmptyBlockRoundTripTest)
     }
 }
 
+BOOST_AUTO_TEST_CASE(LockPoolRoundTripTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+    CBlock block(BuildBlockTestCase());
+
+    pool.addUnchecked(block.vtx[2]->GetHash(), entry.FromTx(*block.vtx[2]));
+
+    // vtx[1] was only seen as a lock request that never made it into (or was evicted from) the
+    // mempool, vtx[2] is both in the mempool and the extra pool. Empty ring buffer slots are skipped.
+    ExtraTxnList extra(3), lock(3);
+    extra[1] = std::make_pair(block.vtx[2]->GetHash(), block.vtx[2]);
+    lock[2] = std::make_pair(block.vtx[1]->GetHash(), block.vtx[1]);
+
+    CBlockHeaderAndShortTxIDs shortIDs(block);
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << shortIDs;
+    CBlockHeaderAndShortTxIDs shortIDs2;
+    stream >> shortIDs2;
+
+    {
+        PartiallyDownloadedBlock partialBlock(&pool);
+        BOOST_CHECK(partialBlock.InitData(shortIDs2, extra) == READ_STATUS_OK);
+        BOOST_CHECK(!partialBlock.IsTxAvailable(1));
+        BOOST_CHECK( partialBlock.IsTxAvailable(2));
+    }
+
+    PartiallyDownloadedBlock partialBlock(&pool);
+    BOOST_CHECK(partialBlock.InitData(shortIDs2, extra, lock) == READ_STATUS_OK);
+    BOOST_CHECK( partialBlock.IsTxAvailable(0));
+    BOOST_CHECK( partialBlock.IsTxAvailable(1));
+    BOOST_CHECK( partialBlock.IsTxAvailable(2));
+
+    CBlock block2;
+    bool mutated;
+    BOOST_CHECK(partialBlock.FillBlock(block2, {}) == READ_STATUS_OK);
+    BOOST_CHECK_EQUAL(block.GetHash().ToString(), block2.GetHash().ToString());
+    BOOST_CHECK_EQUAL(block.hashMerkleRoot.ToString(), BlockMerkleRoot(block2, &mutated).ToString());
+    BOOST_CHECK(!mutated);
+}
+
+BOOST_AUTO_TEST_CASE(ShortTxIDTableTest)
+{
+    FastRandomContext rng(true);
+    std::vector<uint64_t> ids;
+    for (size_t i = 0; i < 16000; i++)
+        ids.push_back((uint64_t(rng.rand32()) << 16 ^ rng.rand32()) & 0xffffffffffffL);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    ShortTxIDTable table(ids.size());
+    for (size_t i = 0; i < ids.size(); i++)
+        BOOST_CHECK(table.Insert(ids[i], i));
+    BOOST_CHECK_EQUAL(table.size(), ids.size());
+    // duplicates are rejected
+    BOOST_CHECK(!table.Insert(ids[0], 0));
+    BOOST_CHECK_EQUAL(table.size(), ids.size());
+
+    for (size_t i = 0; i < ids.size(); i++)
+        BOOST_CHECK_EQUAL(table.Find(ids[i]), (int)i);
+    // anything outside the 48-bit range is never present
+    BOOST_CHECK_EQUAL(table.Find(0xffffffffffffffffULL), -1);
+    BOOST_CHECK_EQUAL(table.Find(0x1000000000000ULL), -1);
+
+    // an empty table answers lookups too
+    ShortTxIDTable empty(0);
+    BOOST_CHECK_EQUAL(empty.Find(ids[0]), -1);
+}
+
 BOOST_AUTO_TEST_CASE(TransactionsRequestSerializationTest) {
     BlockTransactionsRequest req1;
     req1.blockhash = GetRandHash();
@@ -400,4 +400,52 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChainDIP3Setup)
     }
     BOOST_ASSERT(foundRevived);
 }
+
+BOOST_FIXTURE_TEST_CASE(dip3_scores_cache, BasicTestingSetup)
+{
+    CDeterministicMNList mnList(uint256(), 1);
+    for (size_t i = 0; i < 100; i++) {
+        auto dmn = std::make_shared<CDeterministicMN>();
+        dmn->proTxHash = GetRandHash();
+        dmn->collateralOutpoint = COutPoint(GetRandHash(), 0);
+        dmn->nOperatorReward = 0;
+        auto state = std::make_shared<CDeterministicMNState>();
+        state->keyIDOwner = CKeyID(uint160(std::vector<unsigned char>(dmn->proTxHash.begin(), dmn->proTxHash.begin() + 20)));
+        // leave a few MNs unconfirmed, they must not get a score
+        if (i % 10 != 0) {
+            state->UpdateConfirmedHash(dmn->proTxHash, GetRandHash());
+        }
+        dmn->pdmnState = state;
+        mnList.AddMN(dmn);
+    }
+
+    uint256 modifier = GetRandHash();
+
+    // requesting the top entries first must not affect the full result
+    auto quorum = mnList.CalculateQuorum(10, modifier);
+    auto scores = mnList.CalculateScores(modifier);
+    BOOST_CHECK_EQUAL(quorum.size(), 10);
+    BOOST_CHECK_EQUAL(scores.size(), 90);
+    for (size_t i = 0; i < quorum.size(); i++) {
+        BOOST_CHECK(quorum[i] == scores[i].second);
+    }
+    for (size_t i = 1; i < scores.size(); i++) {
+        BOOST_CHECK(scores[i].first < scores[i - 1].first);
+    }
+
+    // cached results must be identical
+    auto scores2 = mnList.CalculateScores(modifier);
+    BOOST_CHECK(scores == scores2);
+
+    // modifying a copy must not affect the cached scores of the original list
+    auto mnList2 = mnList;
+    auto newState = std::make_shared<CDeterministicMNState>(*scores[0].second->pdmnState);
+    newState->BanIfNotBanned(1);
+    mnList2.UpdateMN(scores[0].second->proTxHash, newState);
+
+    auto scores3 = mnList2.CalculateScores(modifier);
+    BOOST_CHECK_EQUAL(scores3.size(), 89);
+    BOOST_CHECK(scores3[0].second->proTxHash == scores[1].second->proTxHash);
+    BOOST_CHECK(mnList.CalculateScores(modifier) == scores);
+}
 BOOST_AUTO_TEST_SUITE_END()
@@ -3,8 +3,11 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "test/test_sibcoin.h"
+#include "test/test_random.h"
 
 #include "bls/bls.h"
+#include "consensus/merkle.h"
+#include "evo/deterministicmns.h"
 #include "evo/simplifiedmns.h"
 #include "netbase.h"
 
@@ -70,4 +73,75 @@ BOOST_AUTO_TEST_CASE(simplifiedmns_merkleroots)
 
     BOOST_CHECK(expectedMerkleRoot == calculatedMerkleRoot);
 }
+
+BOOST_AUTO_TEST_CASE(simplifiedmns_cached_entry_hashes)
+{
+    CDeterministicMNList dmnList(uint256(), 1);
+    for (size_t i = 0; i < 15; i++) {
+        auto dmn = std::make_shared<CDeterministicMN>();
+        dmn->proTxHash.SetHex(strprintf("%064x", i));
+        dmn->collateralOutpoint = COutPoint(dmn->proTxHash, 0);
+        dmn->nOperatorReward = 0;
+        auto state = std::make_shared<CDeterministicMNState>();
+        state->keyIDOwner.SetHex(strprintf("%040x", i));
+        state->UpdateConfirmedHash(dmn->proTxHash, dmn->proTxHash);
+        dmn->pdmnState = state;
+        dmnList.AddMN(dmn);
+    }
+
+    auto checkMerkleRoot = [](const CDeterministicMNList& l) {
+        CSimplifiedMNList sml(l);
+        // build the same list from plain entries, which forces all entries to be hashed again
+        CSimplifiedMNList sml2(sml.mnList);
+        BOOST_CHECK(sml.CalcMerkleRoot() == sml2.CalcMerkleRoot());
+        return sml.CalcMerkleRoot();
+    };
+
+    uint256 merkleRoot1 = checkMerkleRoot(dmnList);
+    BOOST_CHECK(checkMerkleRoot(dmnList) == merkleRoot1);
+
+    // changing a single MN must change the merkle root, even though all other entry hashes are cached
+    auto dmnList2 = dmnList;
+    auto dmn = dmnList2.GetMN(uint256S(strprintf("%064x", 3)));
+    auto newState = std::make_shared<CDeterministicMNState>(*dmn->pdmnState);
+    newState->BanIfNotBanned(1);
+    dmnList2.UpdateMN(dmn->proTxHash, newState);
+
+    uint256 merkleRoot2 = checkMerkleRoot(dmnList2);
+    BOOST_CHECK(merkleRoot1 != merkleRoot2);
+    BOOST_CHECK(checkMerkleRoot(dmnList) == merkleRoot1);
+
+    auto diff = dmnList.BuildSimplifiedDiff(dmnList2);
+    BOOST_CHECK_EQUAL(diff.mnList.size(), 1);
+    BOOST_CHECK(diff.mnList[0].proRegTxHash == dmn->proTxHash);
+    BOOST_CHECK(diff.deletedMNs.empty());
+}
+
+BOOST_AUTO_TEST_CASE(simplifiedmns_merkle_cache)
+{
+    // the cached levels must never change the result, whatever happens to the leaves between two calls
+    CSimplifiedMNListMerkleCache cache;
+    std::vector<uint256> leaves;
+    for (int i = 0; i < 2000; i++) {
+        int op = insecure_rand() % 5;
+        if (op == 0 || leaves.empty()) {
+            leaves.insert(leaves.begin() + insecure_rand() % (leaves.size() + 1), GetRandHash());
+        } else if (op == 1) {
+            leaves.erase(leaves.begin() + insecure_rand() % leaves.size());
+        } else if (op == 2) {
+            leaves[insecure_rand() % leaves.size()] = GetRandHash();
+        } else if (op == 3) {
+            // duplicated last leaf, must be reported as mutated
+            leaves.push_back(leaves.back());
+        } else if (leaves.size() > 100) {
+            leaves.resize(insecure_rand() % 20);
+        }
+
+        bool mutated1 = false, mutated2 = false;
+        uint256 root1 = ComputeMerkleRoot(leaves, &mutated1);
+        uint256 root2 = cache.CalcMerkleRoot(leaves, &mutated2);
+        BOOST_CHECK(root1 == root2);
+        BOOST_CHECK_EQUAL(mutated1, mutated2);
+    }
+}
 BOOST_AUTO_TEST_SUITE_END()
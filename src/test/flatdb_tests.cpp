@@ -0,0 +1,171 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "flat-database.h"
+
+#include "test/test_sibcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(flatdb_tests, TestingSetup)
+
+struct CTestCache
+{
+    std::map<uint32_t, std::string> mapEntries;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(mapEntries);
+    }
+
+    void CheckAndRemove() {}
+    void Clear() { mapEntries.clear(); }
+    std::string ToString() const { return strprintf("Entries: %d", mapEntries.size()); }
+};
+
+typedef CFlatDBLog<uint32_t, std::string> CTestLog;
+
+static std::map<uint32_t, std::string> ReplayLog(CTestLog& log, bool& fOk)
+{
+    std::map<uint32_t, std::string> mapRet;
+    fOk = log.Open(
+        [&](uint32_t&& k, std::string&& v) { mapRet[k] = v; },
+        [&](uint32_t&& k) { mapRet.erase(k); });
+    return mapRet;
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_roundtrip)
+{
+    CTestCache cache;
+    for (uint32_t i = 0; i < 1000; i++) {
+        cache.mapEntries.emplace(i, std::string(i % 50, 'x'));
+    }
+
+    CFlatDB<CTestCache> flatdb("test.dat", "magicTestCache");
+    BOOST_CHECK(flatdb.Dump(cache));
+
+    CTestCache cache2;
+    BOOST_CHECK(flatdb.Load(cache2));
+    BOOST_CHECK(cache.mapEntries == cache2.mapEntries);
+
+    // snapshot mode writes the same format
+    cache.mapEntries.erase(5);
+    BOOST_CHECK(flatdb.DumpSnapshot(cache));
+    CTestCache cache3;
+    BOOST_CHECK(flatdb.Load(cache3));
+    BOOST_CHECK(cache.mapEntries == cache3.mapEntries);
+    BOOST_CHECK(!boost::filesystem::exists(GetDataDir() / "test.dat.new"));
+
+    // a corrupted file is detected by the checksum and must not be loaded
+    {
+        FILE* file = fopen((GetDataDir() / "test.dat").string().c_str(), "r+b");
+        fseek(file, 100, SEEK_SET);
+        fputc('z', file);
+        fclose(file);
+    }
+    CTestCache cache4;
+    BOOST_CHECK(!flatdb.Load(cache4));
+    BOOST_CHECK(cache4.mapEntries.empty());
+
+    // Dump refuses to replace a corrupted file, DumpSnapshot doesn't check it
+    BOOST_CHECK(!flatdb.Dump(cache));
+    BOOST_CHECK(flatdb.DumpSnapshot(cache));
+
+    // a different cache type must not be loaded
+    BOOST_CHECK(flatdb.Load(cache4));
+    CFlatDB<CTestCache> flatdbOther("test.dat", "magicOtherCache");
+    BOOST_CHECK(!flatdbOther.Load(cache4));
+}
+
+BOOST_AUTO_TEST_CASE(flatdblog_replay)
+{
+    bool fOk;
+    {
+        CTestLog log("test.log", "magicTestLog");
+        BOOST_CHECK(!log.Exists());
+        BOOST_CHECK(ReplayLog(log, fOk).empty());
+        BOOST_CHECK(fOk);
+        BOOST_CHECK(log.Exists());
+
+        BOOST_CHECK(log.Write(1, "a"));
+        BOOST_CHECK(log.Write(2, "b"));
+        BOOST_CHECK(log.Write(1, "c"));
+        BOOST_CHECK(log.Erase(2));
+        BOOST_CHECK(log.Write(3, "d"));
+    }
+
+    CTestLog log("test.log", "magicTestLog");
+    std::map<uint32_t, std::string> mapExpected = {{1, "c"}, {3, "d"}};
+    BOOST_CHECK(ReplayLog(log, fOk) == mapExpected);
+    BOOST_CHECK(fOk);
+    BOOST_CHECK_EQUAL(log.GetRecordCount(), 5U);
+    log.Close();
+
+    CTestLog logOther("test.log", "magicOtherLog");
+    ReplayLog(logOther, fOk);
+    BOOST_CHECK(!fOk);
+}
+
+BOOST_AUTO_TEST_CASE(flatdblog_incomplete_record)
+{
+    bool fOk;
+    boost::filesystem::path path = GetDataDir() / "test_incomplete.log";
+    {
+        CTestLog log("test_incomplete.log", "magicTestLog");
+        ReplayLog(log, fOk);
+        BOOST_CHECK(log.Write(1, "a"));
+        BOOST_CHECK(log.Write(2, "b"));
+    }
+
+    // simulate a crash in the middle of appending the last record
+    boost::filesystem::resize_file(path, boost::filesystem::file_size(path) - 2);
+
+    {
+        CTestLog log("test_incomplete.log", "magicTestLog");
+        std::map<uint32_t, std::string> mapExpected = {{1, "a"}};
+        BOOST_CHECK(ReplayLog(log, fOk) == mapExpected);
+        BOOST_CHECK(fOk);
+
+        // appending continues after the last complete record
+        BOOST_CHECK(log.Write(3, "c"));
+    }
+
+    CTestLog log("test_incomplete.log", "magicTestLog");
+    std::map<uint32_t, std::string> mapExpected = {{1, "a"}, {3, "c"}};
+    BOOST_CHECK(ReplayLog(log, fOk) == mapExpected);
+    BOOST_CHECK(fOk);
+}
+
+BOOST_AUTO_TEST_CASE(flatdblog_compaction)
+{
+    bool fOk;
+    std::map<uint32_t, std::string> mapLive;
+    {
+        CTestLog log("test_compact.log", "magicTestLog");
+        ReplayLog(log, fOk);
+        for (uint32_t i = 0; i < 5000; i++) {
+            mapLive[i % 10] = strprintf("%d", i);
+            BOOST_CHECK(log.Write(i % 10, mapLive[i % 10]));
+        }
+        BOOST_CHECK(log.NeedsCompaction(mapLive.size()));
+        uint64_t nSizeBefore = boost::filesystem::file_size(GetDataDir() / "test_compact.log");
+
+        BOOST_CHECK(log.Compact(mapLive));
+        BOOST_CHECK(!log.NeedsCompaction(mapLive.size()));
+        BOOST_CHECK(boost::filesystem::file_size(GetDataDir() / "test_compact.log") < nSizeBefore);
+
+        // the compacted log is still appendable
+        mapLive.erase(0);
+        BOOST_CHECK(log.Erase(0));
+    }
+
+    CTestLog log("test_compact.log", "magicTestLog");
+    BOOST_CHECK(ReplayLog(log, fOk) == mapLive);
+    BOOST_CHECK(fOk);
+    BOOST_CHECK_EQUAL(log.GetRecordCount(), 11U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,119 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-db.h"
+#include "governance-object.h"
+#include "random.h"
+#include "streams.h"
+
+#include "test/test_sibcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_object_tests, BasicTestingSetup)
+
+// Serializes an object in disk format with the given current votes. The tallies are rebuilt when it's read back
+static CGovernanceObject CreateObjectWithVotes(const std::map<COutPoint, vote_rec_t>& mapVotes)
+{
+    CDataStream ds(SER_DISK, CLIENT_VERSION);
+    ds << uint256() << 1 << int64_t(0) << uint256() << std::vector<unsigned char>();
+    ds << int(GOVERNANCE_OBJECT_PROPOSAL) << COutPoint() << std::vector<unsigned char>();
+    ds << int64_t(0) << false << mapVotes << CGovernanceObjectVoteFile();
+
+    CGovernanceObject obj;
+    ds >> obj;
+    return obj;
+}
+
+BOOST_AUTO_TEST_CASE(governance_vote_tallies)
+{
+    fCheckGovernanceVoteTallies = true;
+
+    std::map<COutPoint, vote_rec_t> mapVotes;
+    for (int i = 0; i < 10; i++) {
+        vote_rec_t& rec = mapVotes[COutPoint(GetRandHash(), 0)];
+        rec.mapInstances[VOTE_SIGNAL_FUNDING] = vote_instance_t(i < 6 ? VOTE_OUTCOME_YES : VOTE_OUTCOME_NO, 1, 1);
+        if (i < 3) {
+            rec.mapInstances[VOTE_SIGNAL_DELETE] = vote_instance_t(VOTE_OUTCOME_ABSTAIN, 1, 1);
+        }
+        if (i == 0) {
+            // not tallied, but must not break anything
+            rec.mapInstances[VOTE_SIGNAL_VALID] = vote_instance_t(VOTE_OUTCOME_NONE, 1, 1);
+            rec.mapInstances[MAX_SUPPORTED_VOTE_SIGNAL + 1] = vote_instance_t(VOTE_OUTCOME_YES, 1, 1);
+        }
+    }
+
+    CGovernanceObject obj = CreateObjectWithVotes(mapVotes);
+    BOOST_CHECK_EQUAL(obj.GetYesCount(VOTE_SIGNAL_FUNDING), 6);
+    BOOST_CHECK_EQUAL(obj.GetNoCount(VOTE_SIGNAL_FUNDING), 4);
+    BOOST_CHECK_EQUAL(obj.GetAbstainCount(VOTE_SIGNAL_FUNDING), 0);
+    BOOST_CHECK_EQUAL(obj.GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING), 2);
+    BOOST_CHECK_EQUAL(obj.GetAbsoluteNoCount(VOTE_SIGNAL_FUNDING), -2);
+    BOOST_CHECK_EQUAL(obj.GetAbstainCount(VOTE_SIGNAL_DELETE), 3);
+    BOOST_CHECK_EQUAL(obj.GetYesCount(VOTE_SIGNAL_VALID), 0);
+    BOOST_CHECK_EQUAL(obj.CountMatchingVotes(VOTE_SIGNAL_VALID, VOTE_OUTCOME_NONE), 1);
+
+    // tallies are copied along with the votes
+    CGovernanceObject objCopy(obj);
+    BOOST_CHECK_EQUAL(objCopy.GetYesCount(VOTE_SIGNAL_FUNDING), 6);
+    BOOST_CHECK_EQUAL(objCopy.GetAbstainCount(VOTE_SIGNAL_DELETE), 3);
+
+    fCheckGovernanceVoteTallies = false;
+}
+
+BOOST_AUTO_TEST_CASE(governance_db_lazy_votes)
+{
+    std::map<COutPoint, vote_rec_t> mapVotes;
+    COutPoint mnOutpoint(GetRandHash(), 0);
+    mapVotes[mnOutpoint].mapInstances[VOTE_SIGNAL_FUNDING] = vote_instance_t(VOTE_OUTCOME_YES, 1, 1);
+    CGovernanceObject obj = CreateObjectWithVotes(mapVotes);
+    uint256 nHash = obj.GetHash();
+
+    CGovernanceVote vote(mnOutpoint, nHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES);
+    vote.SetTime(1);
+
+    CGovernanceDB db(1 << 20, true);
+    BOOST_CHECK(db.VerifyVersion());
+    BOOST_CHECK(db.WriteVersion());
+
+    CDBBatch batch = db.CreateBatch();
+    db.WriteObject(batch, obj);
+    db.WriteCurrentVotes(batch, nHash, mnOutpoint, mapVotes[mnOutpoint]);
+    db.WriteVote(batch, vote);
+    // current votes of an unknown object must be skipped while loading
+    db.WriteCurrentVotes(batch, GetRandHash(), mnOutpoint, mapVotes[mnOutpoint]);
+    BOOST_CHECK(db.WriteBatch(batch));
+
+    std::vector<CGovernanceObject> loaded;
+    BOOST_CHECK(db.LoadObjects([&](CGovernanceObject&& o) { loaded.emplace_back(o); }));
+    BOOST_REQUIRE_EQUAL(loaded.size(), 1);
+    BOOST_CHECK(loaded[0].GetHash() == nHash);
+    BOOST_CHECK_EQUAL(loaded[0].GetYesCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK(!loaded[0].AreVotesLoaded());
+
+    // votes are only read when the vote file is accessed
+    governanceDb = &db;
+    BOOST_CHECK(loaded[0].GetVoteFile().HasVote(vote.GetHash()));
+    BOOST_CHECK(loaded[0].AreVotesLoaded());
+    governanceDb = nullptr;
+
+    int nVotes = 0;
+    db.ForEachVoteHash([&](const uint256& nParentHash, const uint256& nVoteHash) {
+        BOOST_CHECK(nParentHash == nHash && nVoteHash == vote.GetHash());
+        nVotes++;
+    });
+    BOOST_CHECK_EQUAL(nVotes, 1);
+
+    batch.Clear();
+    db.EraseObject(batch, nHash);
+    BOOST_CHECK(db.WriteBatch(batch));
+    loaded.clear();
+    BOOST_CHECK(db.LoadObjects([&](CGovernanceObject&& o) { loaded.emplace_back(o); }));
+    BOOST_CHECK(loaded.empty());
+    CGovernanceObjectVoteFile fileVotes;
+    BOOST_CHECK(db.LoadVotes(nHash, fileVotes));
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,127 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "logwriter.h"
+#include "ringbuffer.h"
+
+#include "test/test_sibcoin.h"
+
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(logwriter_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(ringbuffer_basics)
+{
+    CRingBuffer<int> ring(3);
+    BOOST_CHECK_EQUAL(ring.Capacity(), 4U);
+    BOOST_CHECK(ring.Empty());
+
+    int n;
+    BOOST_CHECK(!ring.TryPop(n));
+    for (int i = 0; i < 4; i++) {
+        BOOST_CHECK(ring.TryPush(int(i)));
+    }
+    // full
+    BOOST_CHECK(!ring.TryPush(4));
+
+    // wraps around and keeps FIFO order
+    for (int round = 0; round < 10; round++) {
+        BOOST_CHECK(ring.TryPop(n));
+        BOOST_CHECK_EQUAL(n, round);
+        BOOST_CHECK(ring.TryPush(round + 4));
+    }
+    for (int i = 10; i < 14; i++) {
+        BOOST_CHECK(ring.TryPop(n));
+        BOOST_CHECK_EQUAL(n, i);
+    }
+    BOOST_CHECK(ring.Empty());
+}
+
+BOOST_AUTO_TEST_CASE(ringbuffer_concurrency)
+{
+    CRingBuffer<int> ring(1024);
+    std::atomic<bool> fDone{false};
+    std::vector<int> vPopped;
+    std::thread consumer([&] {
+        int n;
+        while (true) {
+            if (ring.TryPop(n)) {
+                vPopped.push_back(n);
+            } else if (fDone) {
+                if (ring.Empty()) break;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; t++) {
+        producers.emplace_back([&ring, t] {
+            for (int i = 0; i < 10000; i++) {
+                while (!ring.TryPush(t * 10000 + i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& p : producers) {
+        p.join();
+    }
+    fDone = true;
+    consumer.join();
+
+    // every value arrives exactly once and values of one producer stay in order
+    BOOST_CHECK_EQUAL(vPopped.size(), 40000U);
+    std::vector<int> vLast(4, -1);
+    bool fOrdered = true;
+    for (int n : vPopped) {
+        int t = n / 10000;
+        if (n % 10000 != vLast[t] + 1) fOrdered = false;
+        vLast[t] = n % 10000;
+    }
+    BOOST_CHECK(fOrdered);
+}
+
+BOOST_AUTO_TEST_CASE(logwriter_write_and_drop)
+{
+    std::mutex mutex;
+    std::string strWritten;
+    int nFlushes = 0;
+    auto write = [&](const std::string& str) {
+        std::unique_lock<std::mutex> l(mutex);
+        strWritten += str;
+    };
+    auto flush = [&]() {
+        std::unique_lock<std::mutex> l(mutex);
+        nFlushes++;
+    };
+
+    CAsyncLogWriter writer(4);
+    // not started yet, callers must write themselves
+    std::string str = "a\n";
+    BOOST_CHECK(!writer.Push(std::move(str)));
+
+    writer.Start(write, flush, 0);
+    for (int i = 0; i < 1000; i++) {
+        BOOST_CHECK(writer.Push(strprintf("line %d\n", i)));
+    }
+    writer.Stop();
+    BOOST_CHECK(nFlushes > 0);
+
+    // everything pushed is either written or counted as dropped, and drops are reported in the log
+    size_t nWritten = 0;
+    for (size_t pos = strWritten.find("line "); pos != std::string::npos; pos = strWritten.find("line ", pos + 1)) {
+        nWritten++;
+    }
+    BOOST_CHECK_EQUAL(nWritten + writer.GetDroppedCount(), 1000U);
+    BOOST_CHECK_EQUAL(strWritten.find("log buffer full") != std::string::npos, writer.GetDroppedCount() > 0);
+
+    str = "b\n";
+    BOOST_CHECK(!writer.Push(std::move(str)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
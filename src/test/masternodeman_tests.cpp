@@ -0,0 +1,100 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "masternodeman.h"
+#include "netbase.h"
+#include "script/standard.h"
+#include "streams.h"
+
+#include "test/test_sibcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternodeman_tests, TestingSetup)
+
+static CMasternode CreateMasternode(const std::string& strAddr, uint32_t n, const CKey& keyCollateral, const CKey& keyOperator)
+{
+    return CMasternode(LookupNumeric(strAddr.c_str(), Params().GetDefaultPort()), COutPoint(uint256S("01"), n),
+                       keyCollateral.GetPubKey(), keyOperator.GetPubKey(), PROTOCOL_VERSION);
+}
+
+BOOST_AUTO_TEST_CASE(masternodeman_indexes)
+{
+    CKey keyCollateral1, keyCollateral2, keyOperator1, keyOperator2;
+    keyCollateral1.MakeNewKey(true);
+    keyCollateral2.MakeNewKey(true);
+    keyOperator1.MakeNewKey(true);
+    keyOperator2.MakeNewKey(true);
+    CScript payee1 = GetScriptForDestination(keyCollateral1.GetPubKey().GetID());
+    CScript payee2 = GetScriptForDestination(keyCollateral2.GetPubKey().GetID());
+
+    CMasternodeMan mnman;
+    CMasternode mn1 = CreateMasternode("1.1.1.1", 2, keyCollateral1, keyOperator1);
+    CMasternode mn2 = CreateMasternode("1.1.1.1", 1, keyCollateral2, keyOperator1);
+    CMasternode mn3 = CreateMasternode("2.2.2.2", 3, keyCollateral2, keyOperator2);
+    BOOST_CHECK(mnman.Add(mn1));
+    BOOST_CHECK(mnman.Add(mn2));
+    BOOST_CHECK(mnman.Add(mn3));
+    BOOST_CHECK(!mnman.Add(mn3));
+
+    // lookups return the first matching entry by outpoint, same as scanning the map did
+    masternode_info_t mnInfo;
+    BOOST_CHECK(mnman.GetMasternodeInfo(keyOperator1.GetPubKey().GetID(), mnInfo));
+    BOOST_CHECK(mnInfo.outpoint == mn2.outpoint);
+    BOOST_CHECK(mnman.GetMasternodeInfo(keyOperator2.GetPubKey().GetID(), mnInfo));
+    BOOST_CHECK(mnInfo.outpoint == mn3.outpoint);
+    BOOST_CHECK(mnman.GetMasternodeInfo(payee1, mnInfo));
+    BOOST_CHECK(mnInfo.outpoint == mn1.outpoint);
+    BOOST_CHECK(mnman.GetMasternodeInfo(payee2, mnInfo));
+    BOOST_CHECK(mnInfo.outpoint == mn2.outpoint);
+
+    CKey keyUnknown;
+    keyUnknown.MakeNewKey(true);
+    BOOST_CHECK(!mnman.GetMasternodeInfo(keyUnknown.GetPubKey().GetID(), mnInfo));
+
+    // indexes are rebuilt when loading from disk
+    CDataStream ds(SER_DISK, CLIENT_VERSION);
+    ds << mnman;
+    CMasternodeMan mnman2;
+    ds >> mnman2;
+    BOOST_CHECK_EQUAL(mnman2.size(), 3);
+    BOOST_CHECK(mnman2.GetMasternodeInfo(keyOperator2.GetPubKey().GetID(), mnInfo));
+    BOOST_CHECK(mnInfo.outpoint == mn3.outpoint);
+    BOOST_CHECK(mnman2.GetMasternodeInfo(payee1, mnInfo));
+    BOOST_CHECK(mnInfo.outpoint == mn1.outpoint);
+
+    mnman2.Clear();
+    BOOST_CHECK(!mnman2.GetMasternodeInfo(keyOperator2.GetPubKey().GetID(), mnInfo));
+    BOOST_CHECK(!mnman2.GetMasternodeInfo(payee1, mnInfo));
+}
+
+BOOST_AUTO_TEST_CASE(masternode_sigcheck_cache)
+{
+    CKey keyCollateral, keyOperator;
+    keyCollateral.MakeNewKey(true);
+    keyOperator.MakeNewKey(true);
+
+    CMasternodeBroadcast mnb(CreateMasternode("1.1.1.1", 1, keyCollateral, keyOperator));
+    BOOST_CHECK(mnb.Sign(keyCollateral));
+
+    // results are cached, but never reused for a different signature or signed data
+    int nDos;
+    for (int i = 0; i < 2; i++) {
+        BOOST_CHECK(mnb.CheckSignature(nDos));
+        BOOST_CHECK_EQUAL(nDos, 0);
+
+        CMasternodeBroadcast mnbBadSig = mnb;
+        mnbBadSig.vchSig[10] ^= 1;
+        BOOST_CHECK(!mnbBadSig.CheckSignature(nDos));
+        BOOST_CHECK_EQUAL(nDos, 100);
+
+        CMasternodeBroadcast mnbChanged = mnb;
+        mnbChanged.sigTime++;
+        BOOST_CHECK(!mnbChanged.CheckSignature(nDos));
+        BOOST_CHECK_EQUAL(nDos, 100);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,96 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "metrics.h"
+
+#include "test/test_sibcoin.h"
+
+#include <limits>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(metrics_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(histogram_buckets)
+{
+    // every value falls into a bucket whose upper bound is at most 12.5% above it
+    int nLastIdx = 0;
+    for (int64_t n = 0; n < 100000; n++) {
+        int idx = CLatencyHistogram::BucketIndex(n);
+        BOOST_CHECK(idx == nLastIdx || idx == nLastIdx + 1);
+        nLastIdx = idx;
+        int64_t nUpper = CLatencyHistogram::BucketUpperBound(idx);
+        BOOST_CHECK(nUpper >= n);
+        BOOST_CHECK(nUpper <= n + n / 8);
+    }
+    BOOST_CHECK_EQUAL(CLatencyHistogram::BucketIndex(-5), 0);
+    BOOST_CHECK_EQUAL(CLatencyHistogram::BucketIndex(std::numeric_limits<int64_t>::max()), CLatencyHistogram::NUM_BUCKETS - 1);
+    BOOST_CHECK_EQUAL(CLatencyHistogram::BucketIndex((int64_t(1) << 39) - 1), CLatencyHistogram::NUM_BUCKETS - 1);
+}
+
+BOOST_AUTO_TEST_CASE(histogram_quantiles)
+{
+    CLatencyHistogram histogram;
+    BOOST_CHECK_EQUAL(histogram.GetSnapshot().Quantile(0.5), 0);
+
+    for (int64_t n = 1; n <= 1000; n++) {
+        histogram.Record(n);
+    }
+    CLatencyHistogram::Snapshot snapshot = histogram.GetSnapshot();
+    BOOST_CHECK_EQUAL(snapshot.nCount, 1000U);
+    BOOST_CHECK_EQUAL(snapshot.nSum, 500500U);
+    BOOST_CHECK_EQUAL(snapshot.nMax, 1000);
+    BOOST_CHECK_CLOSE(snapshot.Mean(), 500.5, 0.001);
+
+    int64_t nMedian = snapshot.Quantile(0.5);
+    BOOST_CHECK(nMedian >= 500 && nMedian <= 500 * 9 / 8);
+    int64_t nP99 = snapshot.Quantile(0.99);
+    BOOST_CHECK(nP99 >= 990 && nP99 <= 1000);
+    BOOST_CHECK_EQUAL(snapshot.Quantile(1), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(metrics_concurrency)
+{
+    CMetricCounter counter;
+    CLatencyHistogram histogram;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 16; t++) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 10000; i++) {
+                counter.Inc();
+                histogram.Record(i);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    BOOST_CHECK_EQUAL(counter.Get(), 160000U);
+    BOOST_CHECK_EQUAL(histogram.GetSnapshot().nCount, 160000U);
+    BOOST_CHECK_EQUAL(histogram.GetSnapshot().nMax, 9999);
+}
+
+BOOST_AUTO_TEST_CASE(metrics_registry)
+{
+    CMetricsRegistry registry;
+    registry.Counter("a.counter").Inc(3);
+    registry.Gauge("gauge").Set(-7);
+    registry.Histogram("latency").Record(10);
+    // same name returns the same metric
+    BOOST_CHECK_EQUAL(&registry.Counter("a.counter"), &registry.Counter("a.counter"));
+    registry.Counter("a.counter").Inc();
+
+    BOOST_CHECK_EQUAL(registry.GetCounters().at("a.counter"), 4U);
+    BOOST_CHECK_EQUAL(registry.GetGauges().at("gauge"), -7);
+    BOOST_CHECK_EQUAL(registry.GetHistograms().at("latency").nCount, 1U);
+
+    std::string strText = registry.ToPrometheus("test_");
+    BOOST_CHECK(strText.find("# TYPE test_a_counter counter\ntest_a_counter 4\n") != std::string::npos);
+    BOOST_CHECK(strText.find("test_gauge -7\n") != std::string::npos);
+    BOOST_CHECK(strText.find("test_latency_us{quantile=\"0.5\"} 10\n") != std::string::npos);
+    BOOST_CHECK(strText.find("test_latency_us_count 1\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -172,4 +172,75 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+BOOST_AUTO_TEST_CASE(recv_buffer_pool)
+{
+    CRecvBufferPool pool;
+
+    // small requests are rounded up to the smallest class
+    CSerializeData vch = pool.Get(10);
+    BOOST_CHECK(vch.empty());
+    BOOST_CHECK_EQUAL(vch.capacity(), 1024U);
+    vch.resize(10);
+    const char* pch = vch.data();
+    pool.Put(std::move(vch));
+    BOOST_CHECK_EQUAL(pool.GetRetainedBytes(), 1024U);
+
+    // and handed out again, empty
+    vch = pool.Get(1000);
+    BOOST_CHECK(vch.data() == pch);
+    BOOST_CHECK(vch.empty());
+    BOOST_CHECK_EQUAL(pool.GetRetainedBytes(), 0U);
+    pool.Put(std::move(vch));
+
+    // a larger request is not served from a smaller class
+    vch = pool.Get(5000);
+    BOOST_CHECK(vch.data() != pch);
+    BOOST_CHECK_EQUAL(vch.capacity(), 8192U);
+    pool.Put(std::move(vch));
+    BOOST_CHECK_EQUAL(pool.GetRetainedBytes(), 1024U + 8192U);
+
+    // buffers above the largest class are never kept
+    vch = pool.Get(2 * CRecvBufferPool::MAX_RETAINED);
+    BOOST_CHECK(vch.capacity() >= 2 * CRecvBufferPool::MAX_RETAINED);
+    pool.Put(std::move(vch));
+    BOOST_CHECK_EQUAL(pool.GetRetainedBytes(), 1024U + 8192U);
+
+    // every class is bounded
+    std::vector<CSerializeData> vBuffers;
+    for (size_t i = 0; i < 2 * CRecvBufferPool::MAX_PER_CLASS; i++)
+        vBuffers.push_back(pool.Get(3000));
+    for (CSerializeData& vchBuffer : vBuffers)
+        pool.Put(std::move(vchBuffer));
+    BOOST_CHECK_EQUAL(pool.GetRetainedBytes(), 1024U + 8192U + CRecvBufferPool::MAX_PER_CLASS * 4096U);
+}
+
+BOOST_AUTO_TEST_CASE(cnetmessage_recycles_buffer)
+{
+    std::shared_ptr<CRecvBufferPool> pool = std::make_shared<CRecvBufferPool>();
+    CDataStream ssMsg(SER_NETWORK, PROTOCOL_VERSION);
+    CMessageHeader hdr(Params().MessageStart(), "ping", 2000);
+    ssMsg << hdr;
+    ssMsg.resize(ssMsg.size() + 2000, 7);
+
+    const char* pchBuffer = NULL;
+    for (int i = 0; i < 2; i++) {
+        CNetMessage msg(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION, pool);
+        // header split across two reads
+        BOOST_CHECK_EQUAL(msg.readHeader(&ssMsg[0], 10), 10);
+        BOOST_CHECK_EQUAL(msg.readHeader(&ssMsg[10], ssMsg.size() - 10), (int)CMessageHeader::HEADER_SIZE - 10);
+        BOOST_CHECK(msg.in_data);
+        BOOST_CHECK_EQUAL(msg.hdr.GetCommand(), "ping");
+        BOOST_CHECK_EQUAL(msg.readData(&ssMsg[CMessageHeader::HEADER_SIZE], 2000), 2000);
+        BOOST_CHECK(msg.complete());
+        BOOST_CHECK_EQUAL(msg.vRecv.size(), 2000U);
+        BOOST_CHECK_EQUAL(msg.vRecv[1999], 7);
+        // the second message gets the buffer of the first one
+        if (i == 0)
+            pchBuffer = &msg.vRecv[0];
+        else
+            BOOST_CHECK(&msg.vRecv[0] == pchBuffer);
+    }
+    BOOST_CHECK_EQUAL(pool->GetRetainedBytes(), 2048U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 
 #include "random.h"
 #include "scheduler.h"
+#include "timerwheel.h"
 
 #include "test/test_sibcoin.h"
 
@@ -13,6 +14,9 @@
 #include <boost/thread.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <atomic>
+#include <map>
+
 BOOST_AUTO_TEST_SUITE(scheduler_tests)
 
 static void microTask(CScheduler& s, boost::mutex& mutex, int& counter, int delta, boost::chrono::system_clock::time_point rescheduleTime)
@@ -114,4 +118,106 @@ BOOST_AUTO_TEST_CASE(manythreads)
     BOOST_CHECK_EQUAL(counterSum, 200);
 }
 
+BOOST_AUTO_TEST_CASE(timerwheel)
+{
+    // compare against a multimap with due times spread over all levels and the overflow
+    boost::random::mt19937 rng(42);
+    boost::random::uniform_int_distribution<int64_t> randomRange(0, 3);
+    boost::random::uniform_int_distribution<int64_t> randomDelay(0, int64_t(1) << 30);
+    int64_t nNow = 123456789;
+    CTimerWheel<int> wheel(nNow);
+    std::multimap<int64_t, int> expected;
+    for (int i = 0; i < 20000; i++) {
+        int64_t nRange = int64_t(1) << (8 * randomRange(rng) + 8);
+        if (i % 3 != 2) {
+            // some entries are already due when inserted
+            int64_t nDue = nNow + randomDelay(rng) % nRange - 5;
+            wheel.Insert(nDue, i);
+            expected.emplace(nDue, i);
+            continue;
+        }
+        nNow += randomDelay(rng) % nRange;
+        std::vector<std::pair<int64_t, int> > vExpired;
+        wheel.Advance(nNow, vExpired);
+        std::multimap<int64_t, int> got;
+        for (const auto& entry : vExpired) {
+            BOOST_CHECK(entry.first <= nNow);
+            got.emplace(entry.first, entry.second);
+        }
+        std::multimap<int64_t, int> due(expected.begin(), expected.upper_bound(nNow));
+        expected.erase(expected.begin(), expected.upper_bound(nNow));
+        BOOST_CHECK(std::equal(got.begin(), got.end(), due.begin()) && got.size() == due.size());
+        BOOST_CHECK_EQUAL(wheel.Size(), expected.size());
+        if (!expected.empty()) {
+            BOOST_CHECK(wheel.NextTick() > nNow);
+            BOOST_CHECK(wheel.NextTick() <= expected.begin()->first);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(serialqueues)
+{
+    // tasks of one serial queue never overlap, different queues run concurrently
+    CScheduler scheduler;
+    std::atomic<int> running[2];
+    std::atomic<int> maxRunning[2];
+    std::atomic<int> counter[2];
+    for (int i = 0; i < 2; i++) {
+        running[i] = 0;
+        maxRunning[i] = 0;
+        counter[i] = 0;
+    }
+    std::atomic<int> runningTotal{0};
+    std::atomic<int> maxRunningTotal{0};
+    std::atomic<int> early{0};
+    std::atomic<bool> queue1Started{false};
+    std::atomic<bool> overlapped{false};
+
+    boost::chrono::system_clock::time_point now = boost::chrono::system_clock::now();
+    for (int i = 0; i < 200; i++) {
+        int q = i % 2;
+        boost::chrono::system_clock::time_point t = now + boost::chrono::microseconds(i * 10);
+        CScheduler::Function f = [&, q, i, t] {
+            if (boost::chrono::system_clock::now() < t)
+                ++early;
+            int n = ++running[q];
+            if (n > maxRunning[q])
+                maxRunning[q] = n;
+            n = ++runningTotal;
+            if (n > maxRunningTotal)
+                maxRunningTotal = n;
+            if (q == 1) {
+                queue1Started = true;
+            } else if (i == 0) {
+                // the first task of queue0 only finishes on its own once a task of queue1 ran alongside it
+                for (int j = 0; j < 10000 && !queue1Started; j++)
+                    MicroSleep(1000);
+                overlapped = queue1Started.load();
+            }
+            MicroSleep(100);
+            --runningTotal;
+            --running[q];
+            ++counter[q];
+        };
+        scheduler.schedule(f, t, q == 0 ? "queue0" : "queue1");
+    }
+
+    boost::thread_group threads;
+    for (int i = 0; i < 4; i++)
+        threads.create_thread(boost::bind(&CScheduler::serviceQueue, &scheduler));
+    scheduler.stop(true);
+    threads.join_all();
+
+    BOOST_CHECK_EQUAL(counter[0], 100);
+    BOOST_CHECK_EQUAL(counter[1], 100);
+    BOOST_CHECK_EQUAL(maxRunning[0], 1);
+    BOOST_CHECK_EQUAL(maxRunning[1], 1);
+    BOOST_CHECK(maxRunningTotal <= 2);
+    BOOST_CHECK(overlapped);
+    BOOST_CHECK_EQUAL(early, 0);
+
+    boost::chrono::system_clock::time_point first, last;
+    BOOST_CHECK_EQUAL(scheduler.getQueueInfo(first, last), 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,108 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arith_uint256.h"
+#include "shardedmap.h"
+#include "streams.h"
+#include "txmempool.h"
+
+#include "test/test_sibcoin.h"
+
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(shardedmap_tests, BasicTestingSetup)
+
+typedef CShardedMap<uint256, int, SaltedTxidHasher> CTestMap;
+
+static uint256 Key(int n)
+{
+    return ArithToUint256(arith_uint256(n));
+}
+
+BOOST_AUTO_TEST_CASE(shardedmap_basics)
+{
+    CTestMap map;
+    int nValue;
+    BOOST_CHECK(!map.HasKey(Key(1)));
+    BOOST_CHECK(!map.Get(Key(1), nValue));
+
+    for (int i = 0; i < 100; i++) {
+        BOOST_CHECK(map.Insert(Key(i), i));
+    }
+    BOOST_CHECK_EQUAL(map.Size(), 100U);
+
+    // existing values are not overwritten
+    BOOST_CHECK(!map.Insert(Key(5), 500));
+    BOOST_CHECK(map.Get(Key(5), nValue));
+    BOOST_CHECK_EQUAL(nValue, 5);
+
+    BOOST_CHECK(map.Update(Key(5), [](int& n) { n = 500; }));
+    BOOST_CHECK(map.Get(Key(5), nValue));
+    BOOST_CHECK_EQUAL(nValue, 500);
+    BOOST_CHECK(!map.Update(Key(1000), [](int& n) { n = 0; }));
+
+    BOOST_CHECK(map.Erase(Key(5)));
+    BOOST_CHECK(!map.Erase(Key(5)));
+    BOOST_CHECK(!map.HasKey(Key(5)));
+    BOOST_CHECK_EQUAL(map.Size(), 99U);
+
+    map.EraseIf([](const uint256& key, int n) { return n % 2 == 0; });
+    BOOST_CHECK_EQUAL(map.Size(), 49U);
+    BOOST_CHECK(map.HasKey(Key(7)));
+    BOOST_CHECK(!map.HasKey(Key(8)));
+
+    map.Clear();
+    BOOST_CHECK_EQUAL(map.Size(), 0U);
+    BOOST_CHECK(!map.HasKey(Key(7)));
+}
+
+BOOST_AUTO_TEST_CASE(shardedmap_serialization)
+{
+    CTestMap map;
+    std::map<uint256, int> mapExpected;
+    for (int i = 0; i < 100; i++) {
+        map.Insert(Key(i), i);
+        mapExpected.emplace(Key(i), i);
+    }
+
+    // same format as std::map
+    CDataStream ds1(SER_DISK, CLIENT_VERSION), ds2(SER_DISK, CLIENT_VERSION);
+    ds1 << map;
+    ds2 << mapExpected;
+    BOOST_CHECK(ds1.str() == ds2.str());
+
+    CTestMap map2;
+    map2.Insert(Key(1000), 0);
+    ds1 >> map2;
+    BOOST_CHECK(map2.GetMap() == mapExpected);
+    BOOST_CHECK_EQUAL(map2.Size(), 100U);
+}
+
+BOOST_AUTO_TEST_CASE(shardedmap_concurrency)
+{
+    CTestMap map;
+    std::atomic<int> nInserted{0};
+    std::atomic<bool> fMismatch{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&] {
+            // all threads race for the same keys, each key must only be inserted once
+            for (int i = 0; i < 10000; i++) {
+                if (map.Insert(Key(i), i)) nInserted++;
+                int nValue;
+                if (!map.Get(Key(i), nValue) || nValue != i) fMismatch = true;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    BOOST_CHECK(!fMismatch);
+    BOOST_CHECK_EQUAL(nInserted, 10000);
+    BOOST_CHECK_EQUAL(map.Size(), 10000U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -72,6 +72,44 @@ BOOST_AUTO_TEST_CASE(streams_vector_writer)
     vch.clear();
 }
 
+BOOST_AUTO_TEST_CASE(streams_span_reader)
+{
+    const char bytes[] = { 1, 2, 3, 4, 5, 6 };
+    unsigned char a;
+    unsigned char b;
+    uint16_t c;
+
+    CSpanReader(SER_NETWORK, INIT_PROTO_VERSION, bytes, sizeof(bytes), 0, a, b);
+    BOOST_CHECK_EQUAL(a, 1);
+    BOOST_CHECK_EQUAL(b, 2);
+
+    CSpanReader reader(SER_NETWORK, INIT_PROTO_VERSION, bytes, sizeof(bytes), 2);
+    BOOST_CHECK_EQUAL(reader.size(), 4U);
+    BOOST_CHECK(reader.data() == bytes + 2);
+    reader >> c;
+    BOOST_CHECK_EQUAL(c, 0x0403);
+    reader.ignore(1);
+    reader >> a;
+    BOOST_CHECK_EQUAL(a, 6);
+    BOOST_CHECK(reader.empty());
+
+    // reading past the end throws and leaves the position alone
+    BOOST_CHECK_THROW(reader >> a, std::ios_base::failure);
+    BOOST_CHECK_THROW(CSpanReader(SER_NETWORK, INIT_PROTO_VERSION, bytes, sizeof(bytes), 5, c), std::ios_base::failure);
+    BOOST_CHECK_THROW(CSpanReader(SER_NETWORK, INIT_PROTO_VERSION, bytes, sizeof(bytes), 7), std::ios_base::failure);
+
+    // the same bytes handed over to a CDataStream without a copy
+    CSerializeData vch(bytes, bytes + sizeof(bytes));
+    const char* pch = vch.data();
+    CDataStream ss(std::move(vch), SER_NETWORK, INIT_PROTO_VERSION);
+    BOOST_CHECK(&ss[0] == pch);
+    ss >> a;
+    CSerializeData vchReleased = ss.ReleaseBuffer();
+    BOOST_CHECK(vchReleased.data() == pch);
+    BOOST_CHECK_EQUAL(vchReleased.size(), sizeof(bytes));
+    BOOST_CHECK(ss.empty());
+}
+
 BOOST_AUTO_TEST_CASE(streams_serializedata_xor)
 {
     std::vector<char> in;
@@ -0,0 +1,89 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "primitives/transaction.h"
+#include "scheduler.h"
+#include "validationinterface.h"
+
+#include "test/test_sibcoin.h"
+
+#include <atomic>
+#include <thread>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(validationinterface_tests, BasicTestingSetup)
+
+class CTestListener : public CValidationInterface
+{
+public:
+    std::thread::id callerId{std::this_thread::get_id()};
+    std::vector<uint256> vHashes;
+    std::atomic<int> nOtherThread{0};
+
+protected:
+    void SyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock) override
+    {
+        vHashes.push_back(tx.GetHash());
+        if (std::this_thread::get_id() != callerId)
+            nOtherThread++;
+    }
+};
+
+static std::vector<uint256> NotifyTransactions(int nCount)
+{
+    std::vector<uint256> vHashes;
+    for (int i = 0; i < nCount; i++) {
+        CMutableTransaction mtx;
+        mtx.nLockTime = i;
+        CTransaction tx(mtx);
+        vHashes.push_back(tx.GetHash());
+        GetMainSignals().SyncTransaction(tx, NULL, CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK);
+    }
+    return vHashes;
+}
+
+BOOST_AUTO_TEST_CASE(async_delivery)
+{
+    CScheduler scheduler;
+    boost::thread_group threads;
+    for (int i = 0; i < 2; i++)
+        threads.create_thread(boost::bind(&CScheduler::serviceQueue, &scheduler));
+    GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
+
+    CTestListener listener;
+    RegisterValidationInterface(&listener, "test");
+    std::vector<uint256> vHashes = NotifyTransactions(500);
+    SyncWithValidationInterfaceQueue();
+    // everything was delivered in order, from the scheduler threads
+    BOOST_CHECK(listener.vHashes == vHashes);
+    BOOST_CHECK_EQUAL(listener.nOtherThread, 500);
+    LimitValidationInterfaceQueue();
+
+    // notifications still queued are delivered before unregistering returns
+    NotifyTransactions(100);
+    UnregisterValidationInterface(&listener);
+    BOOST_CHECK_EQUAL(listener.vHashes.size(), 600U);
+    NotifyTransactions(1);
+    BOOST_CHECK_EQUAL(listener.vHashes.size(), 600U);
+
+    GetMainSignals().UnregisterBackgroundSignalScheduler();
+    scheduler.stop(true);
+    threads.join_all();
+}
+
+BOOST_AUTO_TEST_CASE(sync_fallback)
+{
+    // without a background scheduler asynchronous listeners are notified right away
+    CTestListener listener;
+    RegisterValidationInterface(&listener, "test");
+    std::vector<uint256> vHashes = NotifyTransactions(10);
+    BOOST_CHECK(listener.vHashes == vHashes);
+    BOOST_CHECK_EQUAL(listener.nOtherThread, 0);
+    SyncWithValidationInterfaceQueue();
+    UnregisterValidationInterface(&listener);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,136 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "workstealingpool.h"
+
+#include "test/test_sibcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(workstealingpool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(workstealingpool_push)
+{
+    CWorkStealingPool pool;
+    pool.Start(4, "test-pool");
+    BOOST_CHECK_EQUAL(pool.Size(), 4);
+
+    // boost test macros are not thread safe, so only the results are checked here
+    std::atomic<bool> badThreadId{false};
+    std::vector<std::future<int> > futures;
+    for (int i = 0; i < 1000; i++) {
+        futures.emplace_back(pool.Push([&badThreadId](int threadId, int v) {
+            if (threadId < 0 || threadId >= 4) {
+                badThreadId = true;
+            }
+            return v * 2;
+        }, i));
+    }
+    for (int i = 0; i < 1000; i++) {
+        BOOST_CHECK_EQUAL(futures[i].get(), i * 2);
+    }
+    BOOST_CHECK(!badThreadId);
+
+    pool.Stop(true);
+    BOOST_CHECK_EQUAL(pool.GetExecutedTaskCount(), 1000);
+    BOOST_CHECK_EQUAL(pool.GetPendingTaskCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(workstealingpool_nested)
+{
+    // tasks pushing other tasks from inside the pool (fan-out/fan-in as done by CBLSWorker)
+    CWorkStealingPool pool;
+    pool.Start(4, "test-pool");
+
+    std::atomic<int> sum{0};
+    std::vector<std::future<void> > outer;
+    for (int i = 0; i < 10; i++) {
+        outer.emplace_back(pool.Push([&pool, &sum](int threadId) {
+            for (int j = 0; j < 100; j++) {
+                pool.Push([&sum](int threadId2) {
+                    sum++;
+                });
+            }
+        }));
+    }
+    for (auto& f : outer) {
+        f.get();
+    }
+
+    // waits for all remaining queued tasks
+    pool.Stop(true);
+    BOOST_CHECK_EQUAL(sum, 1000);
+    BOOST_CHECK_EQUAL(pool.GetExecutedTaskCount(), 1010);
+}
+
+BOOST_AUTO_TEST_CASE(workstealingpool_continuation)
+{
+    CWorkStealingPool pool;
+    pool.Start(2, "test-pool");
+
+    auto f = pool.PushThen([](int threadId) {
+        return 21;
+    }, [](int threadId, int v) {
+        return std::to_string(v * 2);
+    });
+    BOOST_CHECK_EQUAL(f.get(), "42");
+
+    auto f2 = pool.PushThen([](int threadId) -> int {
+        throw std::runtime_error("failed");
+    }, [](int threadId, int v) {
+        return v;
+    });
+    BOOST_CHECK_THROW(f2.get(), std::runtime_error);
+
+    std::atomic<bool> called{false};
+    auto f3 = pool.PushThen([](int threadId) {
+        return true;
+    }, [&called](int threadId, bool v) {
+        called = v;
+    });
+    f3.get();
+    BOOST_CHECK(called);
+
+    // first task without a result, the continuation only gets the thread index
+    std::atomic<int> value{0};
+    auto f4 = pool.PushThen([&value](int threadId) {
+        value = 21;
+    }, [&value](int threadId) {
+        return value * 2;
+    });
+    BOOST_CHECK_EQUAL(f4.get(), 42);
+
+    pool.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(workstealingpool_clear_queue)
+{
+    CWorkStealingPool pool;
+    pool.Start(1, "test-pool");
+
+    // block the only worker until all other tasks are queued
+    auto started = std::make_shared<std::promise<void> >();
+    std::promise<void> unblock;
+    std::shared_future<void> unblockFuture = unblock.get_future().share();
+    auto blocker = pool.Push([started, unblockFuture](int threadId) {
+        started->set_value();
+        unblockFuture.wait();
+    });
+    started->get_future().wait();
+
+    std::atomic<int> executed{0};
+    for (int i = 0; i < 100; i++) {
+        pool.Push([&executed](int threadId) {
+            executed++;
+        });
+    }
+    pool.ClearQueue();
+    unblock.set_value();
+    blocker.get();
+
+    pool.Stop(true);
+    BOOST_CHECK_EQUAL(executed, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
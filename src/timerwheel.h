@@ -0,0 +1,183 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DASH_TIMERWHEEL_H
+#define DASH_TIMERWHEEL_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <vector>
+
+/**
+ * Hierarchical timer wheel.
+ *
+ * Time is measured in integer ticks. Level 0 has one slot per tick for the current block of 2^SLOT_BITS ticks,
+ * every higher level has one slot per block of the level below. An entry goes to the lowest level on which its due
+ * tick shares the block with the current tick, and is moved one level down ("cascaded") when the wheel reaches the
+ * start of its slot. Entries beyond the top level are kept in an overflow list which is re-sorted once per top level
+ * block. Inserting is O(1). Advancing skips over ticks without entries or cascades, and otherwise costs O(1) per
+ * entry moved.
+ *
+ * Entries are returned by the first Advance() which reaches their tick, never earlier.
+ * Not thread-safe, callers need to synchronize.
+ */
+template<typename T>
+class CTimerWheel
+{
+public:
+    static const int SLOT_BITS = 8;
+    static const int NUM_SLOTS = 1 << SLOT_BITS;
+    static const int NUM_LEVELS = 3;
+
+private:
+    typedef std::pair<int64_t, T> Entry;
+    typedef std::vector<Entry> Slot;
+
+    std::array<std::array<Slot, NUM_SLOTS>, NUM_LEVELS> levels;
+    std::vector<Entry> vOverflow;
+    // entries which were already due when inserted
+    std::vector<Entry> vDue;
+    int64_t nCurrentTick;
+    size_t nSize{0};
+
+    static size_t SlotIndex(int64_t nTick, int nLevel)
+    {
+        return (size_t)(((uint64_t)nTick >> (SLOT_BITS * nLevel)) & (NUM_SLOTS - 1));
+    }
+
+    static bool SameBlock(int64_t a, int64_t b, int nLevel)
+    {
+        return ((uint64_t)a >> (SLOT_BITS * (nLevel + 1))) == ((uint64_t)b >> (SLOT_BITS * (nLevel + 1)));
+    }
+
+    void Place(Entry&& entry)
+    {
+        if (entry.first <= nCurrentTick) {
+            vDue.emplace_back(std::move(entry));
+            return;
+        }
+        for (int nLevel = 0; nLevel < NUM_LEVELS; nLevel++) {
+            if (SameBlock(entry.first, nCurrentTick, nLevel)) {
+                levels[nLevel][SlotIndex(entry.first, nLevel)].emplace_back(std::move(entry));
+                return;
+            }
+        }
+        vOverflow.emplace_back(std::move(entry));
+    }
+
+    void Cascade(Slot& slot)
+    {
+        Slot vEntries;
+        vEntries.swap(slot);
+        for (auto& entry : vEntries) {
+            Place(std::move(entry));
+        }
+    }
+
+public:
+    explicit CTimerWheel(int64_t nStartTick) : nCurrentTick(nStartTick) {}
+
+    int64_t GetCurrentTick() const { return nCurrentTick; }
+    size_t Size() const { return nSize; }
+    bool Empty() const { return nSize == 0; }
+
+    void Insert(int64_t nDueTick, T value)
+    {
+        Place(Entry(nDueTick, std::move(value)));
+        nSize++;
+    }
+
+    // Advances the wheel to nNowTick and appends all entries due up to then to vExpired, as (due tick, value) pairs.
+    // Entries due on different ticks are appended in the order of their ticks
+    void Advance(int64_t nNowTick, std::vector<std::pair<int64_t, T> >& vExpired)
+    {
+        for (auto& entry : vDue) {
+            vExpired.emplace_back(std::move(entry));
+        }
+        nSize -= vDue.size();
+        vDue.clear();
+
+        while (nCurrentTick < nNowTick && nSize != 0) {
+            // nothing happens before the next tick with entries or a cascade, skip over empty ticks
+            int64_t nNext = NextTick();
+            if (nNext > nNowTick) {
+                break;
+            }
+            nCurrentTick = std::max(nCurrentTick + 1, nNext);
+            // cascade from the top, so that entries moving down more than one level are handled in one tick
+            if (SlotIndex(nCurrentTick, 0) == 0) {
+                if (SlotIndex(nCurrentTick, 1) == 0) {
+                    if (SlotIndex(nCurrentTick, 2) == 0) {
+                        std::vector<Entry> vEntries;
+                        vEntries.swap(vOverflow);
+                        for (auto& entry : vEntries) {
+                            Place(std::move(entry));
+                        }
+                    }
+                    Cascade(levels[2][SlotIndex(nCurrentTick, 2)]);
+                }
+                Cascade(levels[1][SlotIndex(nCurrentTick, 1)]);
+            }
+            Slot& slot = levels[0][SlotIndex(nCurrentTick, 0)];
+            for (auto& entry : slot) {
+                vExpired.emplace_back(std::move(entry));
+            }
+            nSize -= slot.size();
+            slot.clear();
+            // entries cascaded into vDue above were due exactly now
+            for (auto& entry : vDue) {
+                vExpired.emplace_back(std::move(entry));
+            }
+            nSize -= vDue.size();
+            vDue.clear();
+        }
+        if (nCurrentTick < nNowTick) {
+            // nothing left, just jump ahead
+            nCurrentTick = nNowTick;
+        }
+    }
+
+    // Lower bound of the tick at which Advance() returns the next entry. Only valid if the wheel is not empty
+    int64_t NextTick() const
+    {
+        if (!vDue.empty()) {
+            return nCurrentTick;
+        }
+        for (int nLevel = 0; nLevel < NUM_LEVELS; nLevel++) {
+            size_t nIdx = SlotIndex(nCurrentTick, nLevel);
+            int64_t nBlockStart = (int64_t)(((uint64_t)nCurrentTick >> (SLOT_BITS * (nLevel + 1))) << (SLOT_BITS * (nLevel + 1)));
+            for (size_t i = nIdx + 1; i < NUM_SLOTS; i++) {
+                if (!levels[nLevel][i].empty()) {
+                    // entries on level 0 are due on the slot's tick, higher levels are cascaded at the slot's start
+                    return nBlockStart + ((int64_t)i << (SLOT_BITS * nLevel));
+                }
+            }
+        }
+        // the overflow is re-sorted at the start of the next top level block
+        return (int64_t)((((uint64_t)nCurrentTick >> (SLOT_BITS * NUM_LEVELS)) + 1) << (SLOT_BITS * NUM_LEVELS));
+    }
+
+    // Calls f(dueTick, value) for every entry
+    template<typename F>
+    void ForEach(F f) const
+    {
+        for (const auto& level : levels) {
+            for (const auto& slot : level) {
+                for (const auto& entry : slot) {
+                    f(entry.first, entry.second);
+                }
+            }
+        }
+        for (const auto& entry : vOverflow) {
+            f(entry.first, entry.second);
+        }
+        for (const auto& entry : vDue) {
+            f(entry.first, entry.second);
+        }
+    }
+};
+
+#endif // DASH_TIMERWHEEL_H
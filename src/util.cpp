@@ -14,6 +14,7 @@
 #include "support/allocators/secure.h"
 #include "chainparamsbase.h"
 #include "ctpl.h"
+#include "logwriter.h"
 #include "random.h"
 #include "serialize.h"
 #include "sync.h"
@@ -138,6 +139,7 @@ bool fLogTimeMicros = DEFAULT_LOGTIMEMICROS;
 bool fLogThreadNames = DEFAULT_LOGTHREADNAMES;
 bool fLogIPs = DEFAULT_LOGIPS;
 std::atomic<bool> fReopenDebugLog(false);
+int64_t nLogRateLimit = DEFAULT_LOGRATELIMIT;
 CTranslationInterface translationInterface;
 
 /** Init OpenSSL library multithreading support */
@@ -216,6 +218,12 @@ static boost::once_flag debugPrintInitFlag = BOOST_ONCE_INIT;
 static FILE* fileout = NULL;
 static boost::mutex* mutexDebugLog = NULL;
 static std::list<std::string>* vMsgsBeforeOpenLog;
+/** Read by LogPrintStr without holding mutexDebugLog. Only set once it was started, and never deleted */
+static std::atomic<CAsyncLogWriter*> asyncLogWriter{NULL};
+static bool fDebugLogBuffered = false;
+
+/** stdio buffer size for debug.log while the async writer is running */
+static const size_t DEBUG_LOG_BUFFER_SIZE = 1 << 16;
 
 static int FileWriteStr(const std::string &str, FILE *fp)
 {
@@ -229,6 +237,21 @@ static void DebugPrintInit()
     vMsgsBeforeOpenLog = new std::list<std::string>;
 }
 
+/** Reopen the log file if requested. Must be called with mutexDebugLog held */
+static void ReopenDebugLogIfRequested()
+{
+    if (fReopenDebugLog) {
+        fReopenDebugLog = false;
+        boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
+        if (freopen(pathDebug.string().c_str(),"a",fileout) != NULL) {
+            if (fDebugLogBuffered)
+                setvbuf(fileout, NULL, _IOFBF, DEBUG_LOG_BUFFER_SIZE);
+            else
+                setbuf(fileout, NULL); // unbuffered
+        }
+    }
+}
+
 void OpenDebugLog()
 {
     boost::call_once(&DebugPrintInit, debugPrintInitFlag);
@@ -371,6 +394,13 @@ int LogPrintStr(const std::string &str)
     }
     else if (fPrintToDebugLog)
     {
+        CAsyncLogWriter* writer = asyncLogWriter.load();
+        if (writer != NULL) {
+            ret = strTimestamped.length();
+            if (writer->Push(std::move(strTimestamped)))
+                return ret;
+        }
+
         boost::call_once(&DebugPrintInit, debugPrintInitFlag);
         boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
 
@@ -383,12 +413,7 @@ int LogPrintStr(const std::string &str)
         else
         {
             // reopen the log file, if requested
-            if (fReopenDebugLog) {
-                fReopenDebugLog = false;
-                boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
-                if (freopen(pathDebug.string().c_str(),"a",fileout) != NULL)
-                    setbuf(fileout, NULL); // unbuffered
-            }
+            ReopenDebugLogIfRequested();
 
             ret = FileWriteStr(strTimestamped, fileout);
         }
@@ -396,6 +421,96 @@ int LogPrintStr(const std::string &str)
     return ret;
 }
 
+void StartAsyncDebugLog(size_t nBufferSize, int64_t nFlushIntervalMs)
+{
+    if (fPrintToConsole || !fPrintToDebugLog)
+        return;
+
+    boost::call_once(&DebugPrintInit, debugPrintInitFlag);
+    boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+    if (fileout == NULL || asyncLogWriter.load() != NULL)
+        return;
+    // lines are written in batches by the writer thread, let stdio buffer them until the next flush
+    setvbuf(fileout, NULL, _IOFBF, DEBUG_LOG_BUFFER_SIZE);
+    fDebugLogBuffered = true;
+
+    // the writer thread holds mutexDebugLog while writing, so that it never interleaves with lines
+    // written directly, e.g. by other threads while the writer is being stopped
+    CAsyncLogWriter* writer = new CAsyncLogWriter(nBufferSize);
+    writer->Start([](const std::string& str) {
+        boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+        ReopenDebugLogIfRequested();
+        FileWriteStr(str, fileout);
+    }, []() {
+        boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+        fflush(fileout);
+    }, nFlushIntervalMs);
+    asyncLogWriter.store(writer);
+}
+
+void StopAsyncDebugLog()
+{
+    CAsyncLogWriter* writer = asyncLogWriter.load();
+    if (writer == NULL)
+        return;
+
+    writer->Stop();
+    boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+    setbuf(fileout, NULL); // unbuffered
+    fDebugLogBuffered = false;
+}
+
+uint64_t GetDroppedLogCount()
+{
+    CAsyncLogWriter* writer = asyncLogWriter.load();
+    return writer ? writer->GetDroppedCount() : 0;
+}
+
+struct CLogRateLimitState
+{
+    int64_t nWindowStart{0};
+    int64_t nCount{0};
+    int64_t nSuppressed{0};
+};
+
+static boost::once_flag logRateLimitInitFlag = BOOST_ONCE_INIT;
+static boost::mutex* mutexLogRateLimit = NULL;
+static std::map<std::string, CLogRateLimitState>* mapLogRateLimit = NULL;
+
+static void LogRateLimitInit()
+{
+    mutexLogRateLimit = new boost::mutex();
+    mapLogRateLimit = new std::map<std::string, CLogRateLimitState>();
+}
+
+bool LogRateLimitAccept(const char* category)
+{
+    if (nLogRateLimit <= 0 || category == NULL)
+        return true;
+
+    boost::call_once(&LogRateLimitInit, logRateLimitInitFlag);
+    int64_t nSuppressed = 0;
+    {
+        boost::mutex::scoped_lock scoped_lock(*mutexLogRateLimit);
+        CLogRateLimitState& state = (*mapLogRateLimit)[category];
+        int64_t nNow = GetTimeMillis();
+        if (nNow - state.nWindowStart >= 1000) {
+            nSuppressed = state.nSuppressed;
+            state.nWindowStart = nNow;
+            state.nCount = 0;
+            state.nSuppressed = 0;
+        }
+        if (state.nCount >= nLogRateLimit) {
+            state.nSuppressed++;
+            return false;
+        }
+        state.nCount++;
+    }
+    if (nSuppressed > 0)
+        LogPrintStr(strprintf("Suppressed %d messages in category %s (-logratelimit=%d)\n", nSuppressed, category, nLogRateLimit));
+    return true;
+}
+
 /** Interpret string as boolean, for argument parsing */
 static bool InterpretBool(const std::string& strValue)
 {
@@ -53,6 +53,12 @@ static const bool DEFAULT_LOGTIMEMICROS  = false;
 static const bool DEFAULT_LOGIPS         = false;
 static const bool DEFAULT_LOGTIMESTAMPS  = true;
 static const bool DEFAULT_LOGTHREADNAMES = false;
+static const bool DEFAULT_LOGASYNC       = false;
+/** Number of lines the async log writer can queue before it starts dropping them */
+static const size_t DEFAULT_LOGBUFFERSIZE = 65536;
+static const int64_t DEFAULT_LOGFLUSHINTERVAL = 100;
+/** Max debug messages per category and second, 0 = unlimited */
+static const int64_t DEFAULT_LOGRATELIMIT = 0;
 
 /** Signals for translation. */
 class CTranslationInterface
@@ -73,6 +79,7 @@ extern bool fLogTimeMicros;
 extern bool fLogThreadNames;
 extern bool fLogIPs;
 extern std::atomic<bool> fReopenDebugLog;
+extern int64_t nLogRateLimit;
 extern CTranslationInterface translationInterface;
 
 extern const char * const BITCOIN_CONF_FILENAME;
@@ -93,6 +100,8 @@ bool SetupNetworking();
 
 /** Return true if log accepts specified category */
 bool LogAcceptCategory(const char* category);
+/** Return false if category exceeded -logratelimit in the current second */
+bool LogRateLimitAccept(const char* category);
 /** Send a string to the log output */
 int LogPrintStr(const std::string &str);
 
@@ -110,7 +119,7 @@ std::string SafeStringFormat(const std::string& fmt, const Args&... args)
 }
 
 #define LogPrint(category, ...) do { \
-    if (LogAcceptCategory((category))) { \
+    if (LogAcceptCategory((category)) && LogRateLimitAccept((category))) { \
         LogPrintStr(SafeStringFormat(__VA_ARGS__)); \
     } \
 } while(0)
@@ -149,6 +158,12 @@ void ReadConfigFile(const std::string& confPath);
 boost::filesystem::path GetSpecialFolderPath(int nFolder, bool fCreate = true);
 #endif
 void OpenDebugLog();
+/** Write debug.log from a background thread, see CAsyncLogWriter */
+void StartAsyncDebugLog(size_t nBufferSize, int64_t nFlushIntervalMs);
+/** Stop the background writer, everything logged so far is written and flushed */
+void StopAsyncDebugLog();
+/** Number of log lines dropped because the async log buffer was full */
+uint64_t GetDroppedLogCount();
 void ShrinkDebugFile();
 void runCommand(const std::string& strCommand);
 
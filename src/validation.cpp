@@ -18,6 +18,7 @@
 #include "consensus/validation.h"
 #include "hash.h"
 #include "init.h"
+#include "metrics.h"
 #include "policy/policy.h"
 #include "pow.h"
 #include "primitives/block.h"
@@ -929,8 +930,18 @@ bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const
                         bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit, 
                         const CAmount nAbsurdFee, bool fDryRun)
 {
+    static CLatencyHistogram& histogramAccept = GetMetrics().Histogram("mempool_accept");
+    static CMetricCounter& counterRejected = GetMetrics().Counter("mempool_rejected");
+    static CMetricGauge& gaugeMempoolTx = GetMetrics().Gauge("mempool_tx");
+
     std::vector<COutPoint> coins_to_uncache;
+    int64_t nStart = GetTimeMicros();
     bool res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, nAcceptTime, fOverrideMempoolLimit, nAbsurdFee, coins_to_uncache, fDryRun);
+    histogramAccept.Record(GetTimeMicros() - nStart);
+    if (!res)
+        counterRejected.Inc();
+    else if (!fDryRun)
+        gaugeMempoolTx.Set(pool.size());
     if (!res || fDryRun) {
         if(!res) LogPrint("mempool", "%s: %s %s (%s)\n", __func__, tx->GetHash().ToString(), state.GetRejectReason(), state.GetDebugMessage());
         BOOST_FOREACH(const COutPoint& hashTx, coins_to_uncache)
@@ -1950,6 +1961,14 @@ static int64_t nTimeIndex = 0;
 static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
 
+static CLatencyHistogram& histogramCheck = GetMetrics().Histogram("connectblock_checks");
+static CLatencyHistogram& histogramForks = GetMetrics().Histogram("connectblock_forks");
+static CLatencyHistogram& histogramConnect = GetMetrics().Histogram("connectblock_connect");
+static CLatencyHistogram& histogramVerify = GetMetrics().Histogram("connectblock_verify");
+static CLatencyHistogram& histogramPayeeAndSpecial = GetMetrics().Histogram("connectblock_payee_special");
+static CLatencyHistogram& histogramIndex = GetMetrics().Histogram("connectblock_index");
+static CLatencyHistogram& histogramCallbacks = GetMetrics().Histogram("connectblock_callbacks");
+
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
@@ -2013,6 +2032,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     }
 
     int64_t nTime1 = GetTimeMicros(); nTimeCheck += nTime1 - nTimeStart;
+    histogramCheck.Record(nTime1 - nTimeStart);
     LogPrint("bench", "    - Sanity checks: %.2fms [%.2fs]\n", 0.001 * (nTime1 - nTimeStart), nTimeCheck * 0.000001);
 
     // Do not allow blocks that contain transactions which 'overwrite' older transactions,
@@ -2091,6 +2111,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     }
 
     int64_t nTime2 = GetTimeMicros(); nTimeForks += nTime2 - nTime1;
+    histogramForks.Record(nTime2 - nTime1);
     LogPrint("bench", "    - Fork checks: %.2fms [%.2fs]\n", 0.001 * (nTime2 - nTime1), nTimeForks * 0.000001);
 
     CBlockUndo blockundo;
@@ -2245,11 +2266,13 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
     }
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
+    histogramConnect.Record(nTime3 - nTime2);
     LogPrint("bench", "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]\n", (unsigned)block.vtx.size(), 0.001 * (nTime3 - nTime2), 0.001 * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * 0.000001);
 
     if (!control.Wait())
         return state.DoS(100, false);
     int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
+    histogramVerify.Record(nTime4 - nTime2);
     LogPrint("bench", "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime4 - nTime2), nInputs <= 1 ? 0 : 0.001 * (nTime4 - nTime2) / (nInputs-1), nTimeVerify * 0.000001);
 
     if (!ProcessSpecialTxsInBlock(block, pindex, state)) {
@@ -2304,6 +2327,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
                                 REJECT_INVALID, "bad-cb-payee");
     }
     int64_t nTime5 = GetTimeMicros(); nTimePayeeAndSpecial += nTime5 - nTime4;
+    histogramPayeeAndSpecial.Record(nTime5 - nTime4);
     LogPrint("bench", "    - Payee and special txes: %.2fms [%.2fs]\n", 0.001 * (nTime5 - nTime4), nTimePayeeAndSpecial * 0.000001);
 
     // END SIBCOIN
@@ -2364,6 +2388,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     }
 
     int64_t nTime6 = GetTimeMicros(); nTimeIndex += nTime6 - nTime5;
+    histogramIndex.Record(nTime6 - nTime5);
     LogPrint("bench", "    - Index writing: %.2fms [%.2fs]\n", 0.001 * (nTime6 - nTime5), nTimeIndex * 0.000001);
 
     // Watch for changes to the previous coinbase transaction.
@@ -2374,6 +2399,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     evoDb->WriteBestBlock(pindex->GetBlockHash());
 
     int64_t nTime7 = GetTimeMicros(); nTimeCallbacks += nTime7 - nTime6;
+    histogramCallbacks.Record(nTime7 - nTime6);
     LogPrint("bench", "    - Callbacks: %.2fms [%.2fs]\n", 0.001 * (nTime7 - nTime6), nTimeCallbacks * 0.000001);
 
     return true;
@@ -2624,6 +2650,14 @@ static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
 static int64_t nTimePostConnect = 0;
 
+static CLatencyHistogram& histogramReadFromDisk = GetMetrics().Histogram("connecttip_read");
+static CLatencyHistogram& histogramConnectTotal = GetMetrics().Histogram("connecttip_connect");
+static CLatencyHistogram& histogramFlush = GetMetrics().Histogram("connecttip_flush");
+static CLatencyHistogram& histogramChainState = GetMetrics().Histogram("connecttip_chainstate");
+static CLatencyHistogram& histogramPostConnect = GetMetrics().Histogram("connecttip_postprocess");
+static CLatencyHistogram& histogramTotal = GetMetrics().Histogram("connecttip_total");
+static CMetricGauge& gaugeChainHeight = GetMetrics().Gauge("chain_height");
+
 /**
  * Used to track blocks whose transactions were applied to the UTXO state as a
  * part of a single ActivateBestChainStep call.
@@ -2656,6 +2690,7 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     const CBlock& blockConnecting = *connectTrace.blocksConnected.back().second;
     // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
+    histogramReadFromDisk.Record(nTime2 - nTime1);
     int64_t nTime3;
     LogPrint("bench", "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
     {
@@ -2670,17 +2705,20 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
             return error("ConnectTip(): ConnectBlock %s failed", pindexNew->GetBlockHash().ToString());
         }
         nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
+        histogramConnectTotal.Record(nTime3 - nTime2);
         LogPrint("bench", "  - Connect total: %.2fms [%.2fs]\n", (nTime3 - nTime2) * 0.001, nTimeConnectTotal * 0.000001);
         bool flushed = view.Flush();
         assert(flushed);
         dbTx->Commit();
     }
     int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
+    histogramFlush.Record(nTime4 - nTime3);
     LogPrint("bench", "  - Flush: %.2fms [%.2fs]\n", (nTime4 - nTime3) * 0.001, nTimeFlush * 0.000001);
     // Write the chain state to disk, if necessary.
     if (!FlushStateToDisk(state, FLUSH_STATE_IF_NEEDED))
         return false;
     int64_t nTime5 = GetTimeMicros(); nTimeChainState += nTime5 - nTime4;
+    histogramChainState.Record(nTime5 - nTime4);
     LogPrint("bench", "  - Writing chainstate: %.2fms [%.2fs]\n", (nTime5 - nTime4) * 0.001, nTimeChainState * 0.000001);
     // Remove conflicting transactions from the mempool.;
     mempool.removeForBlock(blockConnecting.vtx, pindexNew->nHeight);
@@ -2688,6 +2726,9 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     UpdateTip(pindexNew, chainparams);
 
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
+    histogramPostConnect.Record(nTime6 - nTime5);
+    histogramTotal.Record(nTime6 - nTime1);
+    gaugeChainHeight.Set(pindexNew->nHeight);
     LogPrint("bench", "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimePostConnect * 0.000001);
     LogPrint("bench", "- Connect block: %.2fms [%.2fs]\n", (nTime6 - nTime1) * 0.001, nTimeTotal * 0.000001);
     return true;
@@ -2911,7 +2952,7 @@ static void NotifyHeaderTip() {
  * or an activated best chain. pblock is either NULL or a pointer to a block
  * that is already loaded (to avoid loading it again from disk).
  */
-bool ActivateBestChain(CValidationState &state, const CChainParams& chainparams, std::shared_ptr<const CBlock> pblock) {
+bool ActivateBestChain(CValidationState &state, const CChainParams& chainparams, std::shared_ptr<const CBlock> pblock, bool fLimitNotifications) {
     // Note that while we're often called here from ProcessNewBlock, this is
     // far from a guarantee. Things in the P2P/RPC will often end up calling
     // us in the middle of ProcessNewBlock - do not assume pblock is set
@@ -2924,6 +2965,11 @@ bool ActivateBestChain(CValidationState &state, const CChainParams& chainparams,
         if (ShutdownRequested())
             break;
 
+        if (fLimitNotifications) {
+            // don't let slow listeners fall behind by more than the queue limit
+            LimitValidationInterfaceQueue();
+        }
+
         const CBlockIndex *pindexFork;
         ConnectTrace connectTrace;
         bool fInitialDownload;
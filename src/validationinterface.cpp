@@ -5,6 +5,22 @@
 
 #include "validationinterface.h"
 
+#include "governance-object.h"
+#include "governance-vote.h"
+#include "primitives/block.h"
+#include "primitives/transaction.h"
+#include "scheduler.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
 static CMainSignals g_signals;
 
 CMainSignals& GetMainSignals()
@@ -12,26 +28,208 @@ CMainSignals& GetMainSignals()
     return g_signals;
 }
 
-void RegisterValidationInterface(CValidationInterface* pwalletIn) {
+namespace {
+
+/**
+ * Notifications queued for one asynchronous listener. They are delivered in order by whichever thread holds
+ * csDeliver, usually a scheduler thread servicing the listener's serial queue.
+ */
+class CNotificationQueue : public std::enable_shared_from_this<CNotificationQueue>
+{
+private:
+    const std::string strQueue;
+    std::mutex cs;
+    std::deque<std::function<void()> > callbacks;
+    // a task delivering the queue is scheduled
+    bool fScheduled{false};
+    // held while delivering, recursive because a listener may cause another notification while handling one
+    std::recursive_mutex csDeliver;
+
+public:
+    explicit CNotificationQueue(const std::string& strQueueIn) : strQueue(strQueueIn) {}
+
+    void Add(std::function<void()> f);
+    // Delivers queued notifications until none are left. Without fWait, returns right away if another thread is
+    // delivering, that thread then also delivers everything queued before it finishes
+    void Drain(bool fWait);
+};
+
+std::atomic<CScheduler*> backgroundScheduler{nullptr};
+
+std::atomic<size_t> nQueuedNotifications{0};
+boost::mutex csQueueLimit;
+boost::condition_variable condQueueLimit;
+
+struct CAsyncListener {
+    std::shared_ptr<CNotificationQueue> queue;
+    std::vector<boost::signals2::connection> connections;
+};
+
+std::mutex csAsyncListeners;
+std::map<CValidationInterface*, CAsyncListener> mapAsyncListeners;
+
+void NotificationDelivered()
+{
+    if (--nQueuedNotifications == MAX_VALIDATION_INTERFACE_QUEUE) {
+        boost::unique_lock<boost::mutex> lock(csQueueLimit);
+        condQueueLimit.notify_all();
+    }
+}
+
+void CNotificationQueue::Add(std::function<void()> f)
+{
+    nQueuedNotifications++;
+    CScheduler* scheduler = backgroundScheduler;
+    bool fSchedule = false;
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        callbacks.emplace_back(std::move(f));
+        if (scheduler != nullptr && !fScheduled) {
+            fScheduled = fSchedule = true;
+        }
+    }
+    if (scheduler == nullptr) {
+        Drain(false);
+    } else if (fSchedule) {
+        std::shared_ptr<CNotificationQueue> self = shared_from_this();
+        scheduler->schedule([self] {
+            {
+                std::lock_guard<std::mutex> lock(self->cs);
+                self->fScheduled = false;
+            }
+            self->Drain(false);
+        }, boost::chrono::system_clock::now(), strQueue);
+    }
+}
+
+void CNotificationQueue::Drain(bool fWait)
+{
+    while (true) {
+        {
+            std::unique_lock<std::recursive_mutex> lockDeliver(csDeliver, std::defer_lock);
+            if (fWait) {
+                lockDeliver.lock();
+            } else if (!lockDeliver.try_lock()) {
+                return;
+            }
+            while (true) {
+                std::function<void()> f;
+                {
+                    std::lock_guard<std::mutex> lock(cs);
+                    if (callbacks.empty())
+                        break;
+                    f = std::move(callbacks.front());
+                    callbacks.pop_front();
+                }
+                f();
+                NotificationDelivered();
+            }
+        }
+        // another thread may have failed to take csDeliver after we found the queue empty
+        std::lock_guard<std::mutex> lock(cs);
+        if (callbacks.empty())
+            return;
+    }
+}
+
+std::vector<std::shared_ptr<CNotificationQueue> > GetNotificationQueues()
+{
+    std::lock_guard<std::mutex> lock(csAsyncListeners);
+    std::vector<std::shared_ptr<CNotificationQueue> > vQueues;
+    for (const auto& listener : mapAsyncListeners) {
+        vQueues.push_back(listener.second.queue);
+    }
+    return vQueues;
+}
+
+} // namespace
+
+static void UnregisterAsyncValidationInterface(CValidationInterface* pwalletIn)
+{
+    CAsyncListener listener;
+    {
+        std::lock_guard<std::mutex> lock(csAsyncListeners);
+        auto it = mapAsyncListeners.find(pwalletIn);
+        if (it == mapAsyncListeners.end())
+            return;
+        listener = std::move(it->second);
+        mapAsyncListeners.erase(it);
+    }
+    for (auto& connection : listener.connections) {
+        connection.disconnect();
+    }
+    // nothing may reference the listener anymore once we return
+    listener.queue->Drain(true);
+}
+
+void RegisterValidationInterface(CValidationInterface* pwalletIn, const std::string& strAsyncQueue) {
     g_signals.AcceptedBlockHeader.connect(boost::bind(&CValidationInterface::AcceptedBlockHeader, pwalletIn, _1));
-    g_signals.NotifyHeaderTip.connect(boost::bind(&CValidationInterface::NotifyHeaderTip, pwalletIn, _1, _2));
-    g_signals.UpdatedBlockTip.connect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1, _2, _3));
-    g_signals.SyncTransaction.connect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2, _3));
-    g_signals.NotifyTransactionLock.connect(boost::bind(&CValidationInterface::NotifyTransactionLock, pwalletIn, _1));
     g_signals.UpdatedTransaction.connect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
-    g_signals.SetBestChain.connect(boost::bind(&CValidationInterface::SetBestChain, pwalletIn, _1));
     g_signals.Inventory.connect(boost::bind(&CValidationInterface::Inventory, pwalletIn, _1));
     g_signals.Broadcast.connect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1, _2));
     g_signals.BlockChecked.connect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
     g_signals.ScriptForMining.connect(boost::bind(&CValidationInterface::GetScriptForMining, pwalletIn, _1));
     g_signals.BlockFound.connect(boost::bind(&CValidationInterface::ResetRequestCount, pwalletIn, _1));
     g_signals.NewPoWValidBlock.connect(boost::bind(&CValidationInterface::NewPoWValidBlock, pwalletIn, _1, _2));
+    if (!strAsyncQueue.empty()) {
+        // arguments are copied, the originals don't outlive the signal
+        std::shared_ptr<CNotificationQueue> queue = std::make_shared<CNotificationQueue>("notify_" + strAsyncQueue);
+        CAsyncListener listener;
+        listener.queue = queue;
+        boost::function<void (const CBlockIndex *, bool)> notifyHeaderTip = boost::bind(&CValidationInterface::NotifyHeaderTip, pwalletIn, _1, _2);
+        listener.connections.push_back(g_signals.NotifyHeaderTip.connect([queue, notifyHeaderTip](const CBlockIndex *pindexNew, bool fInitialDownload) {
+            queue->Add([notifyHeaderTip, pindexNew, fInitialDownload] { notifyHeaderTip(pindexNew, fInitialDownload); });
+        }));
+        boost::function<void (const CBlockIndex *, const CBlockIndex *, bool)> updatedBlockTip = boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1, _2, _3);
+        listener.connections.push_back(g_signals.UpdatedBlockTip.connect([queue, updatedBlockTip](const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) {
+            queue->Add([updatedBlockTip, pindexNew, pindexFork, fInitialDownload] { updatedBlockTip(pindexNew, pindexFork, fInitialDownload); });
+        }));
+        boost::function<void (const CTransaction &, const CBlockIndex *, int)> syncTransaction = boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2, _3);
+        listener.connections.push_back(g_signals.SyncTransaction.connect([queue, syncTransaction](const CTransaction &tx, const CBlockIndex *pindex, int posInBlock) {
+            CTransactionRef ptx = MakeTransactionRef(tx);
+            queue->Add([syncTransaction, ptx, pindex, posInBlock] { syncTransaction(*ptx, pindex, posInBlock); });
+        }));
+        boost::function<void (const CTransaction &)> notifyTransactionLock = boost::bind(&CValidationInterface::NotifyTransactionLock, pwalletIn, _1);
+        listener.connections.push_back(g_signals.NotifyTransactionLock.connect([queue, notifyTransactionLock](const CTransaction &tx) {
+            CTransactionRef ptx = MakeTransactionRef(tx);
+            queue->Add([notifyTransactionLock, ptx] { notifyTransactionLock(*ptx); });
+        }));
+        boost::function<void (const CBlockLocator &)> setBestChain = boost::bind(&CValidationInterface::SetBestChain, pwalletIn, _1);
+        listener.connections.push_back(g_signals.SetBestChain.connect([queue, setBestChain](const CBlockLocator &locator) {
+            queue->Add([setBestChain, locator] { setBestChain(locator); });
+        }));
+        boost::function<void (const CGovernanceObject &)> notifyGovernanceObject = boost::bind(&CValidationInterface::NotifyGovernanceObject, pwalletIn, _1);
+        listener.connections.push_back(g_signals.NotifyGovernanceObject.connect([queue, notifyGovernanceObject](const CGovernanceObject &object) {
+            std::shared_ptr<const CGovernanceObject> pobject = std::make_shared<const CGovernanceObject>(object);
+            queue->Add([notifyGovernanceObject, pobject] { notifyGovernanceObject(*pobject); });
+        }));
+        boost::function<void (const CGovernanceVote &)> notifyGovernanceVote = boost::bind(&CValidationInterface::NotifyGovernanceVote, pwalletIn, _1);
+        listener.connections.push_back(g_signals.NotifyGovernanceVote.connect([queue, notifyGovernanceVote](const CGovernanceVote &vote) {
+            queue->Add([notifyGovernanceVote, vote] { notifyGovernanceVote(vote); });
+        }));
+        boost::function<void (const CTransaction &, const CTransaction &)> notifyDoubleSpend = boost::bind(&CValidationInterface::NotifyInstantSendDoubleSpendAttempt, pwalletIn, _1, _2);
+        listener.connections.push_back(g_signals.NotifyInstantSendDoubleSpendAttempt.connect([queue, notifyDoubleSpend](const CTransaction &currentTx, const CTransaction &previousTx) {
+            CTransactionRef pcurrentTx = MakeTransactionRef(currentTx);
+            CTransactionRef ppreviousTx = MakeTransactionRef(previousTx);
+            queue->Add([notifyDoubleSpend, pcurrentTx, ppreviousTx] { notifyDoubleSpend(*pcurrentTx, *ppreviousTx); });
+        }));
+
+        std::lock_guard<std::mutex> lock(csAsyncListeners);
+        mapAsyncListeners[pwalletIn] = std::move(listener);
+        return;
+    }
+    g_signals.NotifyHeaderTip.connect(boost::bind(&CValidationInterface::NotifyHeaderTip, pwalletIn, _1, _2));
+    g_signals.UpdatedBlockTip.connect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1, _2, _3));
+    g_signals.SyncTransaction.connect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2, _3));
+    g_signals.NotifyTransactionLock.connect(boost::bind(&CValidationInterface::NotifyTransactionLock, pwalletIn, _1));
+    g_signals.SetBestChain.connect(boost::bind(&CValidationInterface::SetBestChain, pwalletIn, _1));
     g_signals.NotifyGovernanceObject.connect(boost::bind(&CValidationInterface::NotifyGovernanceObject, pwalletIn, _1));
     g_signals.NotifyGovernanceVote.connect(boost::bind(&CValidationInterface::NotifyGovernanceVote, pwalletIn, _1));
     g_signals.NotifyInstantSendDoubleSpendAttempt.connect(boost::bind(&CValidationInterface::NotifyInstantSendDoubleSpendAttempt, pwalletIn, _1, _2));
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
+    UnregisterAsyncValidationInterface(pwalletIn);
     g_signals.BlockFound.disconnect(boost::bind(&CValidationInterface::ResetRequestCount, pwalletIn, _1));
     g_signals.ScriptForMining.disconnect(boost::bind(&CValidationInterface::GetScriptForMining, pwalletIn, _1));
     g_signals.BlockChecked.disconnect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
@@ -67,4 +265,55 @@ void UnregisterAllValidationInterfaces() {
     g_signals.NotifyGovernanceObject.disconnect_all_slots();
     g_signals.NotifyGovernanceVote.disconnect_all_slots();
     g_signals.NotifyInstantSendDoubleSpendAttempt.disconnect_all_slots();
+
+    std::map<CValidationInterface*, CAsyncListener> mapListeners;
+    {
+        std::lock_guard<std::mutex> lock(csAsyncListeners);
+        mapListeners.swap(mapAsyncListeners);
+    }
+    for (auto& listener : mapListeners) {
+        listener.second.queue->Drain(true);
+    }
+}
+
+void SyncWithValidationInterfaceQueue()
+{
+    std::vector<std::future<void> > vFutures;
+    for (const auto& queue : GetNotificationQueues()) {
+        std::shared_ptr<std::promise<void> > promise = std::make_shared<std::promise<void> >();
+        vFutures.push_back(promise->get_future());
+        queue->Add([promise] { promise->set_value(); });
+    }
+    for (auto& future : vFutures) {
+        future.wait();
+    }
+}
+
+void LimitValidationInterfaceQueue()
+{
+    if (nQueuedNotifications <= MAX_VALIDATION_INTERFACE_QUEUE)
+        return;
+    boost::unique_lock<boost::mutex> lock(csQueueLimit);
+    while (nQueuedNotifications > MAX_VALIDATION_INTERFACE_QUEUE && backgroundScheduler != nullptr) {
+        condQueueLimit.wait(lock);
+    }
+}
+
+void CMainSignals::RegisterBackgroundSignalScheduler(CScheduler& scheduler)
+{
+    backgroundScheduler = &scheduler;
+}
+
+void CMainSignals::UnregisterBackgroundSignalScheduler()
+{
+    backgroundScheduler = nullptr;
+    boost::unique_lock<boost::mutex> lock(csQueueLimit);
+    condQueueLimit.notify_all();
+}
+
+void CMainSignals::FlushBackgroundCallbacks()
+{
+    for (const auto& queue : GetNotificationQueues()) {
+        queue->Drain(true);
+    }
 }
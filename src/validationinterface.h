@@ -9,12 +9,14 @@
 #include <boost/signals2/signal.hpp>
 #include <boost/shared_ptr.hpp>
 #include <memory>
+#include <string>
 
 class CBlock;
 class CBlockIndex;
 struct CBlockLocator;
 class CConnman;
 class CReserveScript;
+class CScheduler;
 class CTransaction;
 class CValidationInterface;
 class CValidationState;
@@ -24,12 +26,30 @@ class uint256;
 
 // These functions dispatch to one or all registered wallets
 
-/** Register a wallet to receive updates from core */
-void RegisterValidationInterface(CValidationInterface* pwalletIn);
-/** Unregister a wallet from core */
+/** Maximum number of notifications queued for asynchronous listeners before validation waits for them */
+static const size_t MAX_VALIDATION_INTERFACE_QUEUE = 10000;
+
+/**
+ * Register a wallet to receive updates from core.
+ *
+ * With a non-empty strAsyncQueue, notifications which neither return anything nor have to be handled before
+ * validation continues (NotifyHeaderTip, UpdatedBlockTip, SyncTransaction, NotifyTransactionLock, SetBestChain and
+ * the governance and InstantSend notifications) are queued and delivered in order on the serial queue
+ * "notify_<strAsyncQueue>" of the background scheduler, so slow listeners don't hold up block connection.
+ * Without a background scheduler they are delivered synchronously.
+ */
+void RegisterValidationInterface(CValidationInterface* pwalletIn, const std::string& strAsyncQueue = "");
+/** Unregister a wallet from core. Notifications still queued for it are delivered before this returns */
 void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
 void UnregisterAllValidationInterfaces();
+/** Wait until all notifications queued so far have been delivered. Must not be called with cs_main held */
+void SyncWithValidationInterfaceQueue();
+/**
+ * Wait while more than MAX_VALIDATION_INTERFACE_QUEUE notifications are queued, to keep asynchronous listeners from
+ * falling behind without bound. Must not be called with cs_main held
+ */
+void LimitValidationInterfaceQueue();
 
 class CValidationInterface {
 protected:
@@ -49,7 +69,7 @@ protected:
     virtual void GetScriptForMining(boost::shared_ptr<CReserveScript>&) {}
     virtual void ResetRequestCount(const uint256 &hash) {}
     virtual void NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& block) {}
-    friend void ::RegisterValidationInterface(CValidationInterface*);
+    friend void ::RegisterValidationInterface(CValidationInterface*, const std::string&);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
 };
@@ -98,6 +118,13 @@ struct CMainSignals {
      * Notifies listeners that a block which builds directly on our current tip
      * has been received and connected to the headers tree, though not validated yet */
     boost::signals2::signal<void (const CBlockIndex *, const std::shared_ptr<const CBlock>&)> NewPoWValidBlock;
+
+    /** Deliver the notifications of asynchronous listeners on the given scheduler */
+    void RegisterBackgroundSignalScheduler(CScheduler& scheduler);
+    /** Deliver the notifications of asynchronous listeners synchronously from now on, wakes up threads waiting in LimitValidationInterfaceQueue */
+    void UnregisterBackgroundSignalScheduler();
+    /** Deliver all queued notifications from the calling thread, used on shutdown after the scheduler threads stopped */
+    void FlushBackgroundCallbacks();
 };
 
 CMainSignals& GetMainSignals();
@@ -0,0 +1,128 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "wallet/coinselection.h"
+
+#include "random.h"
+#include "wallet/wallet.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <functional>
+
+bool SelectCoinsBnB(const std::vector<CAmount>& vValue, const std::vector<CAmount>& vWaste, const CAmount& nTarget,
+                    const CAmount& nMaxExcess, std::vector<char>& vfBest, CAmount& nBest)
+{
+    const size_t nSize = vValue.size();
+    assert(vWaste.size() == nSize);
+    if (nSize == 0) {
+        return false;
+    }
+
+    // every solution has at least one input and no negative excess, so it can't be better than this
+    const CAmount nMinWaste = *std::min_element(vWaste.begin(), vWaste.end());
+
+    // vSuffix[i] = total value of coins i..nSize-1, to prune branches which can't reach the target anymore
+    std::vector<CAmount> vSuffix(nSize + 1, 0);
+    for (size_t i = nSize; i-- > 0; ) {
+        vSuffix[i] = vSuffix[i + 1] + vValue[i];
+    }
+
+    // first coin at or after nPos with a value of at most nMax
+    auto findFitting = [&](size_t nPos, CAmount nMax) {
+        return (size_t)(std::lower_bound(vValue.begin() + nPos, vValue.end(), nMax, std::greater<CAmount>()) - vValue.begin());
+    };
+    // first coin after nPos with a smaller value, excluding a coin and then including one with the same value just
+    // leads to the same sums again, with no less waste
+    auto findNextValue = [&](size_t nPos) {
+        return (size_t)(std::upper_bound(vValue.begin() + nPos, vValue.end(), vValue[nPos], std::greater<CAmount>()) - vValue.begin());
+    };
+
+    std::vector<size_t> vSelected;
+    std::vector<size_t> vBestSelected;
+    bool fFound = false;
+    CAmount nCurrent = 0;
+    CAmount nCurrentWaste = 0;
+    CAmount nBestWaste = 0;
+    size_t nNext = 0;
+
+    for (size_t nTries = 0; nTries < BNB_MAX_TRIES; nTries++) {
+        // the waste of the inputs alone already exceeds the best solution, more inputs won't help
+        bool fTooWasteful = fFound && nCurrentWaste > nBestWaste;
+        if (!fTooWasteful && nNext < nSize && nCurrent + vSuffix[nNext] >= nTarget) {
+            size_t i = findFitting(nNext, nTarget + nMaxExcess - nCurrent);
+            if (i < nSize && nCurrent + vSuffix[i] >= nTarget) {
+                vSelected.push_back(i);
+                nCurrent += vValue[i];
+                nCurrentWaste += vWaste[i];
+                nNext = i + 1;
+                if (nCurrent < nTarget) {
+                    continue;
+                }
+                // adding more coins can only make it worse, so record the solution and backtrack right away
+                CAmount nWaste = nCurrent - nTarget + nCurrentWaste;
+                if (!fFound || nWaste < nBestWaste || (nWaste == nBestWaste && vSelected.size() < vBestSelected.size())) {
+                    fFound = true;
+                    nBest = nCurrent;
+                    nBestWaste = nWaste;
+                    vBestSelected = vSelected;
+                }
+                if (nBestWaste == nMinWaste && vBestSelected.size() == 1) {
+                    break;
+                }
+            }
+        }
+
+        // backtrack: drop the last selected coin and continue with the next smaller one
+        if (vSelected.empty()) {
+            break;
+        }
+        size_t i = vSelected.back();
+        vSelected.pop_back();
+        nCurrent -= vValue[i];
+        nCurrentWaste -= vWaste[i];
+        nNext = findNextValue(i);
+    }
+
+    if (!fFound) {
+        return false;
+    }
+    vfBest.assign(nSize, false);
+    for (size_t i : vBestSelected) {
+        vfBest[i] = true;
+    }
+    return true;
+}
+
+CCoinSelectionIndex::CCoinSelectionIndex(const std::vector<COutput>& vCoins,
+                                         const std::set<std::pair<const CWalletTx*, unsigned int> >& setExclude)
+{
+    vEntries.reserve(vCoins.size());
+    for (const auto& output : vCoins) {
+        if (!output.fSpendable || setExclude.count(std::make_pair(output.tx, (unsigned int)output.i))) {
+            continue;
+        }
+        vEntries.push_back({output.tx->tx->vout[output.i].nValue, &output});
+    }
+
+    // shuffle first so that equal values end up in random order, the coin we pick among them shouldn't be predictable
+    random_shuffle(vEntries.begin(), vEntries.end(), GetRandInt);
+    std::stable_sort(vEntries.begin(), vEntries.end(), [](const Entry& a, const Entry& b) {
+        return a.nValue > b.nValue;
+    });
+}
+
+size_t CCoinSelectionIndex::FindFirstNotAbove(const CAmount& nValue) const
+{
+    return std::lower_bound(vEntries.begin(), vEntries.end(), nValue, [](const Entry& entry, const CAmount& n) {
+        return entry.nValue > n;
+    }) - vEntries.begin();
+}
+
+size_t CCoinSelectionIndex::FindFirstBelow(const CAmount& nValue) const
+{
+    return std::upper_bound(vEntries.begin(), vEntries.end(), nValue, [](const CAmount& n, const Entry& entry) {
+        return n > entry.nValue;
+    }) - vEntries.begin();
+}
@@ -0,0 +1,79 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_WALLET_COINSELECTION_H
+#define BITCOIN_WALLET_COINSELECTION_H
+
+#include "amount.h"
+
+#include <set>
+#include <utility>
+#include <vector>
+
+class COutput;
+class CWalletTx;
+
+/** Maximum number of search steps SelectCoinsBnB takes before settling for the best solution found so far */
+static const size_t BNB_MAX_TRIES = 100000;
+/** Size of a signed P2PKH input with a compressed key, used to estimate the fee for spending a coin */
+static const unsigned int SIGNED_P2PKH_INPUT_SIZE = 148;
+
+/**
+ * Branch and bound search for a subset of vValue that adds up to at least nTarget and at most nTarget + nMaxExcess,
+ * i.e. that doesn't need a change output. The values are effective values, the coin values minus the fees for
+ * spending them, so the excess is what goes to the fee on top of what the inputs cost. vValue must be sorted by
+ * descending value, equal values by ascending waste. Coins that would overshoot are skipped with a binary search
+ * instead of being tried one by one, so the search stays cheap for huge wallets.
+ *
+ * The solution with the least waste wins: its excess plus vWaste of every input, which is what spending the input
+ * now costs more than spending it at a low feerate later would. vWaste must not be negative. Ties go to the solution
+ * with fewer inputs. nBest is set to the sum of the effective values of the solution.
+ */
+bool SelectCoinsBnB(const std::vector<CAmount>& vValue, const std::vector<CAmount>& vWaste, const CAmount& nTarget,
+                    const CAmount& nMaxExcess, std::vector<char>& vfBest, CAmount& nBest);
+
+/** How SelectCoinsMinConf searches for a set of coins that doesn't need a change output */
+struct CCoinSelectionParams
+{
+    // the selection may exceed the target by this much on top of the fees, no search is done if negative
+    CAmount nMaxExcess;
+    // fee for spending a coin, subtracted from its value during the search
+    CAmount nInputFee;
+    // part of nInputFee that spending the coin at the lowest feerate the wallet pays would save
+    CAmount nInputWaste;
+    // fee for the rest of the transaction which the target doesn't include yet
+    CAmount nNoInputsFee;
+
+    CCoinSelectionParams() : nMaxExcess(-1), nInputFee(0), nInputWaste(0), nNoInputsFee(0) {}
+};
+
+/**
+ * Spendable coins sorted by descending value, in random order among equal values.
+ *
+ * Built once per SelectCoins call, so the confirmation/ancestor relaxing passes of SelectCoinsMinConf don't have to
+ * copy, shuffle and sort all coins again, and can find exact matches and the boundary between smaller and larger
+ * coins with a binary search.
+ */
+class CCoinSelectionIndex
+{
+public:
+    struct Entry {
+        CAmount nValue;
+        const COutput* pout;
+    };
+
+    explicit CCoinSelectionIndex(const std::vector<COutput>& vCoins,
+                                 const std::set<std::pair<const CWalletTx*, unsigned int> >& setExclude = {});
+
+    const std::vector<Entry>& GetEntries() const { return vEntries; }
+    // position of the first coin with a value of at most nValue
+    size_t FindFirstNotAbove(const CAmount& nValue) const;
+    // position of the first coin with a value below nValue
+    size_t FindFirstBelow(const CAmount& nValue) const;
+
+private:
+    std::vector<Entry> vEntries;
+};
+
+#endif // BITCOIN_WALLET_COINSELECTION_H
@@ -55,6 +55,7 @@ CDBEnv::CDBEnv() : dbenv(NULL)
 
 CDBEnv::~CDBEnv()
 {
+    writeQueue.Stop();
     EnvShutdown();
     delete dbenv;
     dbenv = NULL;
@@ -349,6 +350,7 @@ bool CDBEnv::RemoveDb(const std::string& strFile)
 
 bool CDB::Rewrite(const std::string& strFile, const char* pszSkip)
 {
+    bitdb.writeQueue.Commit(strFile);
     while (true) {
         {
             LOCK(bitdb.cs_db);
@@ -433,6 +435,12 @@ bool CDB::Rewrite(const std::string& strFile, const char* pszSkip)
 
 void CDBEnv::Flush(bool fShutdown)
 {
+    if (fShutdown) {
+        writeQueue.Stop();
+    } else {
+        writeQueue.Commit();
+    }
+
     int64_t nStart = GetTimeMillis();
     // Flush log data to the actual data file on all files that are not in use
     LogPrint("db", "CDBEnv::Flush: Flush(%s)%s\n", fShutdown ? "true" : "false", fDbEnvInit ? "" : " database not started");
@@ -470,3 +478,174 @@ void CDBEnv::Flush(bool fShutdown)
         }
     }
 }
+
+/** Writes the raw records queued by CDBWriteQueue in one transaction */
+class CDBBatchWriter : public CDB
+{
+public:
+    explicit CDBBatchWriter(const std::string& strFilename) : CDB(strFilename, "r+") {}
+
+    bool WriteBatch(const std::map<std::string, std::string>& mapRecords)
+    {
+        if (!TxnBegin())
+            return false;
+        for (const auto& record : mapRecords) {
+            Dbt datKey((void*)record.first.data(), record.first.size());
+            Dbt datValue((void*)record.second.data(), record.second.size());
+            if (pdb->put(activeTxn, &datKey, &datValue, 0) != 0) {
+                TxnAbort();
+                return false;
+            }
+        }
+        return TxnCommit();
+    }
+};
+
+void CDBWriteQueue::Start(int64_t nDelayMillis)
+{
+    if (nDelayMillis <= 0 || thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fStopping = false;
+    }
+    nDelay = nDelayMillis;
+    thread = std::thread(&TraceThread<std::function<void()> >, "dbwriter", std::function<void()>(std::bind(&CDBWriteQueue::Thread, this)));
+    LogPrintf("CDBWriteQueue: committing wallet transactions every %dms\n", nDelayMillis);
+}
+
+void CDBWriteQueue::Stop()
+{
+    // no more queueing from now on, then write what's left
+    nDelay = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fStopping = true;
+    }
+    cond.notify_all();
+    if (thread.joinable())
+        thread.join();
+    Commit();
+}
+
+void CDBWriteQueue::Push(const std::string& strFile, const CDataStream& ssKey, const CDataStream& ssValue)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (nQueued == 0)
+            nFirstQueuedTime = GetTimeMillis();
+        auto ret = mapQueued[strFile].emplace(std::string(ssKey.begin(), ssKey.end()), std::string(ssValue.begin(), ssValue.end()));
+        if (ret.second) {
+            nQueued++;
+        } else {
+            ret.first->second.assign(ssValue.begin(), ssValue.end());
+        }
+    }
+    cond.notify_one();
+}
+
+bool CDBWriteQueue::Commit(const std::string& strFile)
+{
+    std::lock_guard<std::mutex> commitLock(commitMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (strFile.empty()) {
+            mapInFlight.swap(mapQueued);
+        } else {
+            auto it = mapQueued.find(strFile);
+            if (it == mapQueued.end())
+                return true;
+            mapInFlight[strFile].swap(it->second);
+            mapQueued.erase(it);
+        }
+        for (const auto& pair : mapInFlight) {
+            nQueued -= pair.second.size();
+        }
+    }
+
+    bool fSuccess = true;
+    for (const auto& pair : mapInFlight) {
+        int64_t nStart = GetTimeMillis();
+        bool fWritten = false;
+        try {
+            CDBBatchWriter writer(pair.first);
+            fWritten = writer.WriteBatch(pair.second);
+        } catch (const std::exception& e) {
+            LogPrintf("CDBWriteQueue::%s -- %s\n", __func__, e.what());
+        }
+        if (!fWritten) {
+            LogPrintf("CDBWriteQueue::%s -- failed to write %d records to %s, will retry\n", __func__, pair.second.size(), pair.first);
+            Requeue(pair.first, pair.second);
+            fSuccess = false;
+            continue;
+        }
+        LogPrint("db", "CDBWriteQueue::%s -- wrote %d records to %s in %dms\n", __func__, pair.second.size(), pair.first, GetTimeMillis() - nStart);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        mapInFlight.clear();
+        setSuperseded.clear();
+    }
+    fFailed = !fSuccess;
+    return fSuccess;
+}
+
+void CDBWriteQueue::Requeue(const std::string& strFile, const RecordMap& mapRecords)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (nQueued == 0)
+        nFirstQueuedTime = GetTimeMillis();
+    RecordMap& mapFile = mapQueued[strFile];
+    for (const auto& record : mapRecords) {
+        if (setSuperseded.count(std::make_pair(strFile, record.first)))
+            continue;
+        // a newer value queued meanwhile stays
+        if (mapFile.emplace(record.first, record.second).second)
+            nQueued++;
+    }
+    if (mapFile.empty())
+        mapQueued.erase(strFile);
+}
+
+bool CDBWriteQueue::Discard(const std::string& strFile, const CDataStream& ssKey)
+{
+    std::string strKey(ssKey.begin(), ssKey.end());
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = mapQueued.find(strFile);
+    if (it != mapQueued.end() && it->second.erase(strKey)) {
+        nQueued--;
+        if (it->second.empty())
+            mapQueued.erase(it);
+    }
+    auto itFlight = mapInFlight.find(strFile);
+    if (itFlight == mapInFlight.end() || !itFlight->second.count(strKey))
+        return false;
+    setSuperseded.emplace(strFile, strKey);
+    return true;
+}
+
+size_t CDBWriteQueue::GetQueuedCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return nQueued;
+}
+
+void CDBWriteQueue::Thread()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!fStopping) {
+        cond.wait(lock, [this] { return fStopping || nQueued > 0; });
+        // give the burst the rest of the durability window of its first record to complete
+        int64_t nWait = nFirstQueuedTime + nDelay - GetTimeMillis();
+        if (nWait > 0) {
+            cond.wait_for(lock, std::chrono::milliseconds(nWait), [this] { return fStopping; });
+        }
+        if (fStopping)
+            break;
+        lock.unlock();
+        Commit();
+        lock.lock();
+    }
+}
@@ -12,8 +12,13 @@
 #include "sync.h"
 #include "version.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <map>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <boost/filesystem/path.hpp>
@@ -22,6 +27,64 @@
 
 static const unsigned int DEFAULT_WALLET_DBLOGSIZE = 100;
 static const bool DEFAULT_WALLET_PRIVDB = true;
+static const int64_t DEFAULT_WALLET_COMMIT_DELAY = 0;
+
+/**
+ * Write-behind queue for records which are only read back when the wallet is loaded.
+ *
+ * Once started with a durability window of nDelayMillis, CDB::WriteDeferred only serializes the record into this queue
+ * and a background thread commits everything queued within the window in a single BDB transaction, followed by a
+ * single log checkpoint (group commit). A crash loses at most the last window of queued records. Readers of such
+ * records and writers of records that must not become durable before them (e.g. the best block locator) call
+ * Commit() first; commits happen in queue order, so nothing written afterwards can hit the disk earlier.
+ * A direct write or erase of a queued key drops the queued record (Discard), so it can't overwrite the newer value.
+ *
+ * Records of a batch that fails to write are queued again, unless the key was queued or written anew meanwhile,
+ * and retried after another window. Until a commit succeeds again, HasFailed() is true and CDB::WriteDeferred
+ * writes synchronously, so the failure reaches its callers.
+ */
+class CDBWriteQueue
+{
+private:
+    typedef std::map<std::string, std::string> RecordMap;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    // held while a batch is taken from the queue and written, so Commit() also waits for a batch in flight
+    std::mutex commitMutex;
+    std::thread thread;
+    std::atomic<int64_t> nDelay{0};
+    bool fStopping{false};
+    int64_t nFirstQueuedTime{0};
+    // file -> serialized key -> serialized value, a later write of the same key replaces the queued one
+    std::map<std::string, RecordMap> mapQueued;
+    size_t nQueued{0};
+    // the batch Commit() is writing, and the keys of it that were written directly meanwhile
+    std::map<std::string, RecordMap> mapInFlight;
+    std::set<std::pair<std::string, std::string> > setSuperseded;
+    std::atomic<bool> fFailed{false};
+
+    void Thread();
+    void Requeue(const std::string& strFile, const RecordMap& mapRecords);
+
+public:
+    ~CDBWriteQueue() { Stop(); }
+
+    void Start(int64_t nDelayMillis);
+    // commits everything that is still queued
+    void Stop();
+    bool IsEnabled() const { return nDelay > 0; }
+
+    void Push(const std::string& strFile, const CDataStream& ssKey, const CDataStream& ssValue);
+    // commit the records queued for strFile (all files if empty) now
+    bool Commit(const std::string& strFile = "");
+    // drop the record queued for the key, returns true if a batch holding it is being written right now
+    bool Discard(const std::string& strFile, const CDataStream& ssKey);
+    // wait until the batch being written (if any) is done
+    void WaitForCommit() { std::lock_guard<std::mutex> commitLock(commitMutex); }
+    bool HasFailed() const { return fFailed; }
+    size_t GetQueuedCount();
+};
 
 class CDBEnv
 {
@@ -39,6 +102,7 @@ public:
     DbEnv *dbenv;
     std::map<std::string, int> mapFileUseCount;
     std::map<std::string, Db*> mapDb;
+    CDBWriteQueue writeQueue;
 
     CDBEnv();
     ~CDBEnv();
@@ -109,6 +173,15 @@ private:
     CDB(const CDB&);
     void operator=(const CDB&);
 
+    // A value queued by WriteDeferred earlier must not overwrite the one about to be written directly. Outside of a
+    // transaction a batch already holding the key is waited for. Transactions are not started while records of the
+    // file are in flight (see CWalletDB::TxnBegin), waiting there could deadlock on the locks the transaction holds.
+    void DiscardQueued(const CDataStream& ssKey)
+    {
+        if (bitdb.writeQueue.IsEnabled() && bitdb.writeQueue.Discard(strFile, ssKey) && !activeTxn)
+            bitdb.writeQueue.WaitForCommit();
+    }
+
 protected:
     template <typename K, typename T>
     bool Read(const K& key, T& value)
@@ -158,6 +231,7 @@ protected:
         ssKey.reserve(1000);
         ssKey << key;
         Dbt datKey(ssKey.data(), ssKey.size());
+        DiscardQueued(ssKey);
 
         // Value
         CDataStream ssValue(SER_DISK, CLIENT_VERSION);
@@ -174,6 +248,28 @@ protected:
         return (ret == 0);
     }
 
+    // Like Write, but only queues the record if bitdb.writeQueue is enabled and no transaction is active
+    template <typename K, typename T>
+    bool WriteDeferred(const K& key, const T& value)
+    {
+        if (!pdb || activeTxn || !bitdb.writeQueue.IsEnabled())
+            return Write(key, value);
+        if (fReadOnly)
+            assert(!"Write called on database in read-only mode");
+
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.reserve(1000);
+        ssKey << key;
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue.reserve(10000);
+        ssValue << value;
+        bitdb.writeQueue.Push(strFile, ssKey, ssValue);
+        // while commits fail, write through so the caller learns about it
+        if (bitdb.writeQueue.HasFailed())
+            return bitdb.writeQueue.Commit(strFile);
+        return true;
+    }
+
     template <typename K>
     bool Erase(const K& key)
     {
@@ -187,6 +283,7 @@ protected:
         ssKey.reserve(1000);
         ssKey << key;
         Dbt datKey(ssKey.data(), ssKey.size());
+        DiscardQueued(ssKey);
 
         // Erase
         int ret = pdb->del(activeTxn, &datKey, 0);
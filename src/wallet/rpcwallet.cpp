@@ -48,6 +48,8 @@ bool EnsureWalletIsAvailable(bool avoidException)
         else
             return false;
     }
+    // The wallet is notified asynchronously, make sure it has seen everything validated before this call
+    SyncWithValidationInterfaceQueue();
     return true;
 }
 
@@ -2423,6 +2425,7 @@ UniValue getwalletinfo(const JSONRPCRequest& request)
             "  \"keypoolsize\": xxxx,        (numeric) how many new keys are pre-generated (only counts external keys)\n"
             "  \"keypoolsize_hd_internal\": xxxx, (numeric) how many new keys are pre-generated for internal use (used for change outputs, only appears if the wallet is using this feature, otherwise external keys are used)\n"
             "  \"keys_left\": xxxx,          (numeric) how many new keys are left since last automatic backup\n"
+            "  \"loadtime\": xxxx,           (numeric) how long it took to load the wallet at startup, in milliseconds\n"
             "  \"unlocked_until\": ttt,      (numeric) the timestamp in seconds since epoch (midnight Jan 1 1970 GMT) that the wallet is unlocked for transfers, or 0 if the wallet is locked\n"
             "  \"paytxfee\": x.xxxx,         (numeric) the transaction fee configuration, set in " + CURRENCY_UNIT + "/kB\n"
             "  \"hdchainid\": \"<hash>\",      (string) the ID of the HD chain\n"
@@ -2459,6 +2462,7 @@ UniValue getwalletinfo(const JSONRPCRequest& request)
         obj.push_back(Pair("keypoolsize_hd_internal",   (int64_t)(pwalletMain->KeypoolCountInternalKeys())));
     }
     obj.push_back(Pair("keys_left",     pwalletMain->nKeysLeftSinceAutoBackup));
+    obj.push_back(Pair("loadtime",      pwalletMain->nLoadWalletTime));
     if (pwalletMain->IsCrypted())
         obj.push_back(Pair("unlocked_until", nWalletUnlockTime));
     obj.push_back(Pair("paytxfee",      ValueFromAmount(payTxFee.GetFeePerK())));
@@ -2484,6 +2488,37 @@ UniValue getwalletinfo(const JSONRPCRequest& request)
     return obj;
 }
 
+UniValue getrescaninfo(const JSONRPCRequest& request)
+{
+    if (!EnsureWalletIsAvailable(request.fHelp))
+        return NullUniValue;
+
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getrescaninfo\n"
+            "Returns the progress of a running wallet rescan. Doesn't wait for the rescan to finish.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"scanning\": true|false,      (boolean) whether the wallet is being rescanned right now\n"
+            "  \"duration\": xxxx,            (numeric) elapsed seconds since the rescan started (only if scanning)\n"
+            "  \"progress\": x.xxx,           (numeric) rescan progress, from 0 to 1 (only if scanning)\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getrescaninfo", "")
+            + HelpExampleRpc("getrescaninfo", "")
+        );
+
+    // no locks here, a rescan holds cs_main and cs_wallet until it's done
+    UniValue obj(UniValue::VOBJ);
+    bool fScanning = pwalletMain->IsScanning();
+    obj.push_back(Pair("scanning", fScanning));
+    if (fScanning) {
+        obj.push_back(Pair("duration", pwalletMain->ScanningDuration() / 1000));
+        obj.push_back(Pair("progress", pwalletMain->ScanningProgress()));
+    }
+    return obj;
+}
+
 UniValue keepass(const JSONRPCRequest& request)
 {
     if (!EnsureWalletIsAvailable(request.fHelp))
@@ -2897,6 +2932,7 @@ static const CRPCCommand commands[] =
     { "wallet",             "getrawchangeaddress",      &getrawchangeaddress,      true,   {} },
     { "wallet",             "getreceivedbyaccount",     &getreceivedbyaccount,     false,  {"account","minconf","addlocked"} },
     { "wallet",             "getreceivedbyaddress",     &getreceivedbyaddress,     false,  {"address","minconf","addlocked"} },
+    { "wallet",             "getrescaninfo",            &getrescaninfo,            true,   {} },
     { "wallet",             "gettransaction",           &gettransaction,           false,  {"txid","include_watchonly"} },
     { "wallet",             "getunconfirmedbalance",    &getunconfirmedbalance,    false,  {} },
     { "wallet",             "getwalletinfo",            &getwalletinfo,            false,  {} },
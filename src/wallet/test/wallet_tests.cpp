@@ -4,6 +4,7 @@
 
 #include "wallet/wallet.h"
 
+#include <algorithm>
 #include <set>
 #include <stdint.h>
 #include <utility>
@@ -361,6 +362,68 @@ BOOST_AUTO_TEST_CASE(ApproximateBestSubset)
     empty_wallet();
 }
 
+BOOST_AUTO_TEST_CASE(bnb_search_test)
+{
+    std::vector<char> vfBest;
+    CAmount nBest;
+    auto noWaste = [](size_t nCount) { return std::vector<CAmount>(nCount, 0); };
+
+    // 9+5 and 9+3+2 both match, the one with fewer inputs wins
+    std::vector<CAmount> vValue = {10, 9, 5, 3, 2};
+    BOOST_CHECK(SelectCoinsBnB(vValue, noWaste(5), 14, 0, vfBest, nBest));
+    BOOST_CHECK_EQUAL(nBest, 14);
+    BOOST_CHECK(vfBest == std::vector<char>({false, true, true, false, false}));
+
+    // no exact match, the least excess wins
+    BOOST_CHECK(!SelectCoinsBnB(vValue, noWaste(5), 25, 0, vfBest, nBest));
+    BOOST_CHECK(SelectCoinsBnB(vValue, noWaste(5), 25, 5, vfBest, nBest));
+    BOOST_CHECK_EQUAL(nBest, 26);
+    BOOST_CHECK(vfBest == std::vector<char>({true, true, true, false, true}));
+    BOOST_CHECK(SelectCoinsBnB({10, 9}, noWaste(2), 11, 8, vfBest, nBest));
+    BOOST_CHECK_EQUAL(nBest, 19);
+    BOOST_CHECK(!SelectCoinsBnB({10, 9}, noWaste(2), 11, 7, vfBest, nBest));
+    BOOST_CHECK(!SelectCoinsBnB(vValue, noWaste(5), 100, 10, vfBest, nBest));
+    BOOST_CHECK(!SelectCoinsBnB({}, {}, 1, 0, vfBest, nBest));
+
+    // an exact match with two inputs wastes more than a single input with an excess of 1 when inputs are expensive
+    BOOST_CHECK(SelectCoinsBnB({12, 6, 5}, noWaste(3), 11, 1, vfBest, nBest));
+    BOOST_CHECK(vfBest == std::vector<char>({false, true, true}));
+    BOOST_CHECK(SelectCoinsBnB({12, 6, 5}, {2, 2, 2}, 11, 1, vfBest, nBest));
+    BOOST_CHECK_EQUAL(nBest, 12);
+    BOOST_CHECK(vfBest == std::vector<char>({true, false, false}));
+
+    // lots of identical coins don't blow up the search
+    BOOST_CHECK(!SelectCoinsBnB(std::vector<CAmount>(100000, 3), noWaste(100000), 299999, 0, vfBest, nBest));
+    BOOST_CHECK(SelectCoinsBnB(std::vector<CAmount>(100000, 3), std::vector<CAmount>(100000, 1), 3000, 0, vfBest, nBest));
+    BOOST_CHECK_EQUAL(std::count(vfBest.begin(), vfBest.end(), true), 1000);
+
+    // through the wallet: 10+5+1 is the only exact match, 20 would be the lowest larger coin
+    CoinSet setCoinsRet;
+    CAmount nValueRet;
+    bool fBnBUsed = false;
+    LOCK(wallet.cs_wallet);
+    empty_wallet();
+    for (CAmount nValue : {1, 2, 5, 10, 20, 40})
+        add_coin(nValue * CENT);
+    CCoinSelectionParams params;
+    params.nMaxExcess = 0;
+    BOOST_CHECK(wallet.SelectCoinsMinConf(16 * CENT, 1, 6, 0, CCoinSelectionIndex(vCoins), setCoinsRet, nValueRet, ALL_COINS, false, params, &fBnBUsed));
+    BOOST_CHECK(fBnBUsed);
+    BOOST_CHECK_EQUAL(nValueRet, 16 * CENT);
+    BOOST_CHECK_EQUAL(setCoinsRet.size(), 3U);
+
+    // the coins have to pay for their inputs and the rest of the transaction too: effective values are 9.5, 4.5, 1.5
+    // and 0.5 and 15.5 are needed, 10+5+2 is the only match
+    params.nMaxExcess = CENT / 2 - 1;
+    params.nInputFee = CENT / 2;
+    params.nNoInputsFee = CENT / 2;
+    BOOST_CHECK(wallet.SelectCoinsMinConf(15 * CENT, 1, 6, 0, CCoinSelectionIndex(vCoins), setCoinsRet, nValueRet, ALL_COINS, false, params, &fBnBUsed));
+    BOOST_CHECK(fBnBUsed);
+    BOOST_CHECK_EQUAL(nValueRet, 17 * CENT);
+    BOOST_CHECK_EQUAL(setCoinsRet.size(), 3U);
+    empty_wallet();
+}
+
 BOOST_FIXTURE_TEST_CASE(rescan, TestChain100Setup)
 {
     LOCK(cs_main);
@@ -428,6 +491,223 @@ BOOST_FIXTURE_TEST_CASE(rescan, TestChain100Setup)
     }
 }
 
+BOOST_AUTO_TEST_CASE(wallet_scan_filter)
+{
+    CWallet wallet;
+    LOCK(wallet.cs_wallet);
+
+    CKey key, keyWatched, keyOther;
+    key.MakeNewKey(true);
+    keyWatched.MakeNewKey(true);
+    keyOther.MakeNewKey(true);
+    BOOST_CHECK(wallet.AddKeyPubKey(key, key.GetPubKey()));
+    CScript scriptRedeem = GetScriptForMultisig(1, {key.GetPubKey(), keyOther.GetPubKey()});
+    BOOST_CHECK(wallet.AddCScript(scriptRedeem));
+    CScript scriptWatched = GetScriptForDestination(keyWatched.GetPubKey().GetID());
+    BOOST_CHECK(wallet.AddWatchOnly(scriptWatched, 0));
+
+    CWalletScanFilter filter = wallet.CreateScanFilter();
+    BOOST_CHECK(filter.IsRelevant(GetScriptForDestination(key.GetPubKey().GetID())));
+    BOOST_CHECK(filter.IsRelevant(GetScriptForRawPubKey(key.GetPubKey())));
+    BOOST_CHECK(filter.IsRelevant(GetScriptForDestination(CScriptID(scriptRedeem))));
+    BOOST_CHECK(filter.IsRelevant(scriptWatched));
+    // false positive, IsMine requires all keys of a bare multisig
+    BOOST_CHECK(filter.IsRelevant(scriptRedeem));
+
+    BOOST_CHECK(!filter.IsRelevant(GetScriptForDestination(keyOther.GetPubKey().GetID())));
+    BOOST_CHECK(!filter.IsRelevant(GetScriptForRawPubKey(keyWatched.GetPubKey())));
+    BOOST_CHECK(!filter.IsRelevant(CScript() << OP_RETURN));
+
+    // keys added later are only found by a new filter
+    CKey keyNew;
+    keyNew.MakeNewKey(true);
+    BOOST_CHECK(wallet.AddKeyPubKey(keyNew, keyNew.GetPubKey()));
+    BOOST_CHECK(!filter.IsRelevant(GetScriptForDestination(keyNew.GetPubKey().GetID())));
+    BOOST_CHECK(wallet.CreateScanFilter().IsRelevant(GetScriptForDestination(keyNew.GetPubKey().GetID())));
+}
+
+BOOST_AUTO_TEST_CASE(wallet_privatesend_rounds)
+{
+    CPrivateSend::InitStandardDenominations();
+    CAmount nDenom = CPrivateSend::GetSmallestDenomination();
+
+    CWallet wallet;
+    LOCK(wallet.cs_wallet);
+
+    CKey key, keyOther;
+    key.MakeNewKey(true);
+    keyOther.MakeNewKey(true);
+    BOOST_CHECK(wallet.AddKeyPubKey(key, key.GetPubKey()));
+    CScript scriptMine = GetScriptForDestination(key.GetPubKey().GetID());
+    CScript scriptOther = GetScriptForDestination(keyOther.GetPubKey().GetID());
+
+    CMutableTransaction txA, txB, txC, txD;
+    txA.vin.emplace_back(COutPoint(GetRandHash(), 0));
+    txA.vout.emplace_back(nDenom, scriptMine);
+    txB.vin.emplace_back(COutPoint(txA.GetHash(), 0));
+    txB.vin.emplace_back(COutPoint(GetRandHash(), 0));
+    txB.vout.emplace_back(nDenom, scriptMine);
+    txB.vout.emplace_back(nDenom, scriptOther);
+    txC.vin.emplace_back(COutPoint(txB.GetHash(), 0));
+    txC.vout.emplace_back(nDenom, scriptMine);
+    txC.vout.emplace_back(nDenom + 1, scriptMine);
+    txD.vin.emplace_back(COutPoint(GetRandHash(), 0));
+    txD.vout.emplace_back(CPrivateSend::GetCollateralAmount(), scriptMine);
+
+    // children before parents, the bulk calculation must not depend on the order of mapWallet
+    for (const auto& tx : {txC, txB, txD, txA}) {
+        wallet.LoadToWallet(CWalletTx(&wallet, MakeTransactionRef(tx)));
+    }
+    wallet.CalculatePrivateSendRounds();
+
+    BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(txA.GetHash(), 0)), 0);
+    BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(txB.GetHash(), 0)), 1);
+    // denominated, but next to a non-denominated output
+    BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(txC.GetHash(), 0)), 0);
+    BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(txC.GetHash(), 1)), -2);
+    BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(txD.GetHash(), 0)), -3);
+    BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(txD.GetHash(), 1)), -4);
+    BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(GetRandHash(), 0)), -1);
+
+    // a tx spending B:0 with only denominated outputs gets one more round
+    CMutableTransaction txE;
+    txE.vin.emplace_back(COutPoint(txB.GetHash(), 0));
+    txE.vout.emplace_back(nDenom, scriptMine);
+    wallet.LoadToWallet(CWalletTx(&wallet, MakeTransactionRef(txE)));
+    BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(txE.GetHash(), 0)), 2);
+}
+
+BOOST_AUTO_TEST_CASE(wallet_deferred_writes)
+{
+    // long window, commits below only happen because readers ask for them
+    bitdb.writeQueue.Start(60 * 1000);
+
+    CMutableTransaction tx;
+    tx.nLockTime = 1234;
+    CWalletTx wtx(pwalletMain, MakeTransactionRef(tx));
+    {
+        CWalletDB walletdb(pwalletMain->strWalletFile);
+        BOOST_CHECK(walletdb.WriteTx(wtx));
+        // a rewrite of the same record replaces the queued one
+        BOOST_CHECK(walletdb.WriteTx(wtx));
+        BOOST_CHECK(walletdb.WriteOrderPosNext(1));
+    }
+    BOOST_CHECK_EQUAL(bitdb.writeQueue.GetQueuedCount(), 2U);
+
+    std::vector<uint256> vTxHash;
+    std::vector<CWalletTx> vWtx;
+    BOOST_CHECK(CWalletDB(pwalletMain->strWalletFile).FindWalletTx(pwalletMain, vTxHash, vWtx) == DB_LOAD_OK);
+    BOOST_CHECK_EQUAL(bitdb.writeQueue.GetQueuedCount(), 0U);
+    BOOST_CHECK(std::find(vTxHash.begin(), vTxHash.end(), wtx.GetHash()) != vTxHash.end());
+
+    // a transaction first commits what is queued, so the older value can't land on top of it later
+    {
+        CWalletDB walletdb(pwalletMain->strWalletFile);
+        BOOST_CHECK(walletdb.WriteOrderPosNext(5));
+        BOOST_CHECK_EQUAL(bitdb.writeQueue.GetQueuedCount(), 1U);
+        BOOST_CHECK(walletdb.TxnBegin());
+        BOOST_CHECK_EQUAL(bitdb.writeQueue.GetQueuedCount(), 0U);
+        BOOST_CHECK(walletdb.WriteOrderPosNext(7));
+        BOOST_CHECK(walletdb.TxnCommit());
+        BOOST_CHECK_EQUAL(bitdb.writeQueue.GetQueuedCount(), 0U);
+    }
+
+    // a batch that can't be written stays queued and the failure is reported
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION), ssValue(SER_DISK, CLIENT_VERSION), ssNewer(SER_DISK, CLIENT_VERSION);
+    ssKey << std::string("orderposnext");
+    ssValue << (int64_t)1;
+    ssNewer << (int64_t)2;
+    bitdb.writeQueue.Push("nonexistent.dat", ssKey, ssValue);
+    BOOST_CHECK(!bitdb.writeQueue.Commit("nonexistent.dat"));
+    BOOST_CHECK(bitdb.writeQueue.HasFailed());
+    BOOST_CHECK_EQUAL(bitdb.writeQueue.GetQueuedCount(), 1U);
+    bitdb.writeQueue.Push("nonexistent.dat", ssKey, ssNewer);
+    BOOST_CHECK_EQUAL(bitdb.writeQueue.GetQueuedCount(), 1U);
+    // and a direct write of the key drops it
+    BOOST_CHECK(!bitdb.writeQueue.Discard("nonexistent.dat", ssKey));
+    BOOST_CHECK_EQUAL(bitdb.writeQueue.GetQueuedCount(), 0U);
+    BOOST_CHECK(bitdb.writeQueue.Commit());
+    BOOST_CHECK(!bitdb.writeQueue.HasFailed());
+
+    // after stopping everything is written right away again
+    bitdb.writeQueue.Stop();
+    BOOST_CHECK(CWalletDB(pwalletMain->strWalletFile).WriteOrderPosNext(2));
+    BOOST_CHECK_EQUAL(bitdb.writeQueue.GetQueuedCount(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(wallet_parallel_load)
+{
+    std::vector<CKey> vKeys;
+    std::vector<uint256> vTxHash;
+    {
+        CWalletDB walletdb(pwalletMain->strWalletFile);
+        for (int i = 0; i < 200; i++) {
+            CKey key;
+            key.MakeNewKey(true);
+            BOOST_CHECK(walletdb.WriteKey(key.GetPubKey(), key.GetPrivKey(), CKeyMetadata(GetTime())));
+            vKeys.push_back(key);
+
+            CMutableTransaction tx;
+            tx.nLockTime = i;
+            CWalletTx wtx(pwalletMain, MakeTransactionRef(tx));
+            BOOST_CHECK(walletdb.WriteTx(wtx));
+            vTxHash.push_back(wtx.GetHash());
+        }
+    }
+
+    // records decoded by the workers end up in the wallet just like the ones read directly
+    CWallet wallet(pwalletMain->strWalletFile);
+    bool fFirstRun;
+    BOOST_CHECK(wallet.LoadWallet(fFirstRun) == DB_LOAD_OK);
+    BOOST_CHECK(wallet.nLoadWalletTime >= 0);
+    LOCK(wallet.cs_wallet);
+    for (const CKey& key : vKeys) {
+        CKey keyLoaded;
+        BOOST_CHECK(wallet.GetKey(key.GetPubKey().GetID(), keyLoaded));
+        BOOST_CHECK(keyLoaded == key);
+    }
+    for (const uint256& hash : vTxHash) {
+        BOOST_CHECK(wallet.mapWallet.count(hash));
+    }
+}
+
+// Verify that coins spent by an abandoned transaction are listed and counted again.
+// Balances and coin listing only look at wallet transactions with outputs in setWalletUTXO.
+BOOST_FIXTURE_TEST_CASE(wallet_utxo_index, TestChain100Setup)
+{
+    LOCK(cs_main);
+
+    // Mature the coinbase of the first block
+    CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+
+    CWallet wallet;
+    LOCK(wallet.cs_wallet);
+    wallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
+    wallet.ScanForWalletTransactions(chainActive.Genesis());
+
+    const CAmount nCoinbaseValue = coinbaseTxns[0].vout[0].nValue;
+    std::vector<COutput> vCoins;
+    wallet.AvailableCoins(vCoins);
+    BOOST_CHECK_EQUAL(vCoins.size(), 1);
+    BOOST_CHECK_EQUAL(wallet.GetBalance(), nCoinbaseValue);
+
+    CKey keyDest;
+    keyDest.MakeNewKey(true);
+    CMutableTransaction spend;
+    spend.vin.emplace_back(COutPoint(coinbaseTxns[0].GetHash(), 0));
+    spend.vout.emplace_back(nCoinbaseValue - 1000, GetScriptForRawPubKey(keyDest.GetPubKey()));
+    CWalletTx wtxSpend(&wallet, MakeTransactionRef(spend));
+    BOOST_CHECK(wallet.AddToWallet(wtxSpend));
+
+    wallet.AvailableCoins(vCoins);
+    BOOST_CHECK(vCoins.empty());
+
+    BOOST_CHECK(wallet.AbandonTransaction(wtxSpend.GetHash()));
+    wallet.AvailableCoins(vCoins);
+    BOOST_CHECK_EQUAL(vCoins.size(), 1);
+    BOOST_CHECK_EQUAL(wallet.GetBalance(), nCoinbaseValue);
+}
+
 // Verify importwallet RPC starts rescan at earliest block with timestamp
 // greater or equal than key birthday. Previously there was a bug where
 // importwallet RPC would start the scan at the latest block with timestamp less
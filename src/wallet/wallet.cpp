@@ -34,6 +34,7 @@
 #include "keepass.h"
 #include "privatesend-client.h"
 #include "spork.h"
+#include "workstealingpool.h"
 
 #include "evo/providertx.h"
 
@@ -72,15 +73,6 @@ const uint256 CMerkleTx::ABANDON_HASH(uint256S("00000000000000000000000000000000
  * @{
  */
 
-struct CompareValueOnly
-{
-    bool operator()(const std::pair<CAmount, std::pair<const CWalletTx*, unsigned int> >& t1,
-                    const std::pair<CAmount, std::pair<const CWalletTx*, unsigned int> >& t2) const
-    {
-        return t1.first < t2.first;
-    }
-};
-
 std::string COutput::ToString() const
 {
     return strprintf("COutput(%s, %d, %d) [%s]", tx->GetHash().ToString(), i, nDepth, FormatMoney(tx->tx->vout[i].nValue));
@@ -758,6 +750,38 @@ void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
     SyncMetaData(range);
 }
 
+void CWallet::AddInputsToWalletUTXO(const CWalletTx& wtx)
+{
+    AssertLockHeld(cs_wallet);
+
+    for (const auto& txin : wtx.tx->vin) {
+        std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(txin.prevout.hash);
+        if (it == mapWallet.end() || txin.prevout.n >= it->second.tx->vout.size()) continue;
+        if (IsMine(it->second.tx->vout[txin.prevout.n]) && !IsSpent(txin.prevout.hash, txin.prevout.n)) {
+            setWalletUTXO.insert(txin.prevout);
+        }
+    }
+}
+
+std::vector<const CWalletTx*> CWallet::GetWalletTxesWithUTXO() const
+{
+    AssertLockHeld(cs_wallet);
+
+    std::vector<const CWalletTx*> vecRet;
+    const uint256* pprevHash = nullptr;
+    for (const auto& outpoint : setWalletUTXO) {
+        // setWalletUTXO is ordered by txid, so all outputs of a tx are next to each other
+        if (pprevHash && *pprevHash == outpoint.hash) continue;
+        pprevHash = &outpoint.hash;
+
+        std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash);
+        if (it != mapWallet.end()) {
+            vecRet.push_back(&it->second);
+        }
+    }
+    return vecRet;
+}
+
 
 void CWallet::AddToSpends(const uint256& wtxid)
 {
@@ -1078,7 +1102,8 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
 {
     LOCK(cs_wallet);
 
-    CWalletDB walletdb(strWalletFile, "r+", fFlushOnClose);
+    // with deferred writes nothing is written through walletdb here, so don't checkpoint the log for nothing
+    CWalletDB walletdb(strWalletFile, "r+", fFlushOnClose && !bitdb.writeQueue.IsEnabled());
 
     uint256 hash = wtxIn.GetHash();
 
@@ -1139,6 +1164,14 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
         }
         AddToSpends(hash);
 
+        // wallet txs spending this one were added first, their cached rounds didn't see these outputs as ours
+        if (!mapOutpointRoundsCache.empty()) {
+            TxSpends::const_iterator it = mapTxSpends.lower_bound(COutPoint(hash, 0));
+            if (it != mapTxSpends.end() && it->first.hash == hash) {
+                mapOutpointRoundsCache.clear();
+            }
+        }
+
         for(unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
             if (IsMine(wtx.tx->vout[i]) && !IsSpent(hash, i)) {
                 setWalletUTXO.insert(COutPoint(hash, i));
@@ -1152,6 +1185,12 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
     bool fUpdated = false;
     if (!fInsertedNew)
     {
+        // outputs might have become ours since the tx was added (e.g. key imported and rescanned)
+        for (unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
+            if (IsMine(wtx.tx->vout[i]) && !IsSpent(hash, i)) {
+                setWalletUTXO.insert(COutPoint(hash, i));
+            }
+        }
         // Merge
         if (!wtxIn.hashUnset() && wtxIn.hashBlock != wtx.hashBlock)
         {
@@ -1307,6 +1346,7 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             wtx.nIndex = -1;
             wtx.setAbandoned();
             wtx.MarkDirty();
+            AddInputsToWalletUTXO(wtx);
             walletdb.WriteTx(wtx);
             NotifyTransactionChanged(this, wtx.GetHash(), CT_UPDATED);
             // Iterate over all its outputs, and mark transactions in the wallet that spend them abandoned too
@@ -1372,6 +1412,7 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
             wtx.nIndex = -1;
             wtx.hashBlock = hashBlock;
             wtx.MarkDirty();
+            AddInputsToWalletUTXO(wtx);
             walletdb.WriteTx(wtx);
             // Iterate over all its outputs, and mark transactions in the wallet that spend them conflicted too
             TxSpends::const_iterator iter = mapTxSpends.lower_bound(COutPoint(now, 0));
@@ -1449,86 +1490,130 @@ CAmount CWallet::GetDebit(const CTxIn &txin, const isminefilter& filter) const
     return 0;
 }
 
+// Rounds of output nout of wtx, getInputRounds(prevout) has to return the rounds of our inputs
+template<typename GetInputRounds>
+static int CalculateOutpointPrivateSendRounds(const CWallet* pwallet, const CWalletTx& wtx, unsigned int nout, GetInputRounds&& getInputRounds)
+{
+    if (CPrivateSend::IsCollateralAmount(wtx.tx->vout[nout].nValue)) {
+        return -3;
+    }
+
+    //make sure the final output is non-denominate
+    if (!CPrivateSend::IsDenominatedAmount(wtx.tx->vout[nout].nValue)) { //NOT DENOM
+        return -2;
+    }
+
+    for (const auto& out : wtx.tx->vout) {
+        // this one is denominated but there is another non-denominated output found in the same tx
+        if (!CPrivateSend::IsDenominatedAmount(out.nValue)) {
+            return 0;
+        }
+    }
+
+    int nShortest = -10; // an initial value, should be no way to get this by calculations
+    bool fDenomFound = false;
+    // only denoms here so let's look up
+    for (const auto& txinNext : wtx.tx->vin) {
+        if (pwallet->IsMine(txinNext)) {
+            int n = getInputRounds(txinNext.prevout);
+            // denom found, find the shortest chain or initially assign nShortest with the first found value
+            if(n >= 0 && (n < nShortest || nShortest == -10)) {
+                nShortest = n;
+                fDenomFound = true;
+            }
+        }
+    }
+    return fDenomFound
+            ? (nShortest >= MAX_PRIVATESEND_ROUNDS - 1 ? MAX_PRIVATESEND_ROUNDS : nShortest + 1) // good, we a +1 to the shortest one but only MAX_PRIVATESEND_ROUNDS rounds max allowed
+            : 0;            // too bad, we are the fist one in that chain
+}
+
 // Recursively determine the rounds of a given input (How deep is the PrivateSend chain for a given input)
 int CWallet::GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRounds) const
 {
-    static std::map<uint256, CMutableTransaction> mDenomWtxes;
+    LOCK(cs_wallet);
 
     if(nRounds >= MAX_PRIVATESEND_ROUNDS) {
         // there can only be MAX_PRIVATESEND_ROUNDS rounds max
         return MAX_PRIVATESEND_ROUNDS - 1;
     }
 
-    uint256 hash = outpoint.hash;
-    unsigned int nout = outpoint.n;
+    const CWalletTx* wtx = GetWalletTx(outpoint.hash);
+    if (wtx == NULL) {
+        return nRounds - 1;
+    }
 
-    const CWalletTx* wtx = GetWalletTx(hash);
-    if(wtx != NULL)
-    {
-        std::map<uint256, CMutableTransaction>::const_iterator mdwi = mDenomWtxes.find(hash);
-        if (mdwi == mDenomWtxes.end()) {
-            // not known yet, let's add it
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds INSERTING %s\n", hash.ToString());
-            mDenomWtxes[hash] = CMutableTransaction(*wtx);
-        } else if(mDenomWtxes[hash].vout[nout].nRounds != -10) {
-            // found and it's not an initial value, just return it
-            return mDenomWtxes[hash].vout[nout].nRounds;
-        }
+    std::map<COutPoint, int>::const_iterator it = mapOutpointRoundsCache.find(outpoint);
+    if (it != mapOutpointRoundsCache.end()) {
+        // found, just return it
+        return it->second;
+    }
 
+    // bounds check
+    if (outpoint.n >= wtx->tx->vout.size()) {
+        // should never actually hit this
+        LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", outpoint.hash.ToString(), outpoint.n, -4);
+        return -4;
+    }
 
-        // bounds check
-        if (nout >= wtx->tx->vout.size()) {
-            // should never actually hit this
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, -4);
-            return -4;
-        }
+    int nRoundsRet = CalculateOutpointPrivateSendRounds(this, *wtx, outpoint.n, [&](const COutPoint& prevout) {
+        return GetRealOutpointPrivateSendRounds(prevout, nRounds + 1);
+    });
+    mapOutpointRoundsCache.emplace(outpoint, nRoundsRet);
+    LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", outpoint.hash.ToString(), outpoint.n, nRoundsRet);
+    return nRoundsRet;
+}
 
-        if (CPrivateSend::IsCollateralAmount(wtx->tx->vout[nout].nValue)) {
-            mDenomWtxes[hash].vout[nout].nRounds = -3;
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
-        }
+void CWallet::CalculatePrivateSendRounds()
+{
+    LOCK(cs_wallet);
 
-        //make sure the final output is non-denominate
-        if (!CPrivateSend::IsDenominatedAmount(wtx->tx->vout[nout].nValue)) { //NOT DENOM
-            mDenomWtxes[hash].vout[nout].nRounds = -2;
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
-        }
+    int64_t nStart = GetTimeMillis();
+    mapOutpointRoundsCache.clear();
 
-        bool fAllDenoms = true;
-        for (const auto& out : wtx->tx->vout) {
-            fAllDenoms = fAllDenoms && CPrivateSend::IsDenominatedAmount(out.nValue);
+    // Kahn's algorithm: a tx is ready once all of its in-wallet parents were processed, so the rounds of our inputs
+    // are always cached already and no recursion is needed, no matter how long the chains in the wallet are.
+    std::map<uint256, int> mapParentsLeft;
+    std::vector<const CWalletTx*> vReady;
+    for (const auto& pair : mapWallet) {
+        int nParents = 0;
+        for (const auto& txin : pair.second.tx->vin) {
+            std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(txin.prevout.hash);
+            if (mi != mapWallet.end() && txin.prevout.n < mi->second.tx->vout.size()) {
+                nParents++;
+            }
+        }
+        if (nParents == 0) {
+            vReady.push_back(&pair.second);
+        } else {
+            mapParentsLeft.emplace(pair.first, nParents);
         }
+    }
 
-        // this one is denominated but there is another non-denominated output found in the same tx
-        if (!fAllDenoms) {
-            mDenomWtxes[hash].vout[nout].nRounds = 0;
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
-        }
-
-        int nShortest = -10; // an initial value, should be no way to get this by calculations
-        bool fDenomFound = false;
-        // only denoms here so let's look up
-        for (const auto& txinNext : wtx->tx->vin) {
-            if (IsMine(txinNext)) {
-                int n = GetRealOutpointPrivateSendRounds(txinNext.prevout, nRounds + 1);
-                // denom found, find the shortest chain or initially assign nShortest with the first found value
-                if(n >= 0 && (n < nShortest || nShortest == -10)) {
-                    nShortest = n;
-                    fDenomFound = true;
+    while (!vReady.empty()) {
+        const CWalletTx* pwtx = vReady.back();
+        vReady.pop_back();
+        const uint256 hash = pwtx->GetHash();
+
+        for (unsigned int i = 0; i < pwtx->tx->vout.size(); i++) {
+            if (IsMine(pwtx->tx->vout[i])) {
+                mapOutpointRoundsCache.emplace(COutPoint(hash, i), CalculateOutpointPrivateSendRounds(this, *pwtx, i, [&](const COutPoint& prevout) {
+                    return GetRealOutpointPrivateSendRounds(prevout);
+                }));
+            }
+
+            std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range = mapTxSpends.equal_range(COutPoint(hash, i));
+            for (TxSpends::const_iterator it = range.first; it != range.second; ++it) {
+                std::map<uint256, int>::iterator mi = mapParentsLeft.find(it->second);
+                if (mi != mapParentsLeft.end() && --mi->second == 0) {
+                    vReady.push_back(&mapWallet.at(it->second));
+                    mapParentsLeft.erase(mi);
                 }
             }
         }
-        mDenomWtxes[hash].vout[nout].nRounds = fDenomFound
-                ? (nShortest >= MAX_PRIVATESEND_ROUNDS - 1 ? MAX_PRIVATESEND_ROUNDS : nShortest + 1) // good, we a +1 to the shortest one but only MAX_PRIVATESEND_ROUNDS rounds max allowed
-                : 0;            // too bad, we are the fist one in that chain
-        LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-        return mDenomWtxes[hash].vout[nout].nRounds;
     }
 
-    return nRounds - 1;
+    LogPrint("privatesend", "CWallet::%s -- %d outputs in %dms\n", __func__, mapOutpointRoundsCache.size(), GetTimeMillis() - nStart);
 }
 
 // respect current settings
@@ -1900,14 +1985,81 @@ void CWalletTx::GetAccountAmounts(const std::string& strAccount, CAmount& nRecei
     }
 }
 
+bool CWalletScanFilter::IsRelevant(const CScript& scriptPubKey) const
+{
+    // mirrors IsMine(const CKeyStore&, const CScript&)
+    if (setWatchOnly.count(scriptPubKey)) return true;
+
+    std::vector<std::vector<unsigned char> > vSolutions;
+    txnouttype whichType;
+    if (!Solver(scriptPubKey, whichType, vSolutions)) return false;
+
+    switch (whichType) {
+    case TX_PUBKEY:
+        return setKeyIDs.count(CPubKey(vSolutions[0]).GetID()) != 0;
+    case TX_PUBKEYHASH:
+        return setKeyIDs.count(uint160(vSolutions[0])) != 0;
+    case TX_SCRIPTHASH:
+        return setScriptIDs.count(uint160(vSolutions[0])) != 0;
+    case TX_MULTISIG:
+        for (size_t i = 1; i + 1 < vSolutions.size(); i++) {
+            if (setKeyIDs.count(CPubKey(vSolutions[i]).GetID())) return true;
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+bool CWalletScanFilter::IsRelevant(const CTransaction& tx) const
+{
+    for (const auto& txout : tx.vout) {
+        if (IsRelevant(txout.scriptPubKey)) return true;
+    }
+    return false;
+}
+
+CWalletScanFilter CWallet::CreateScanFilter() const
+{
+    AssertLockHeld(cs_wallet); // mapHdPubKeys
+
+    CWalletScanFilter filter;
+    LOCK(cs_KeyStore);
+    std::set<CKeyID> setKeys;
+    GetKeys(setKeys);
+    for (const auto& keyID : setKeys) {
+        filter.AddKeyID(keyID);
+    }
+    for (const auto& pair : mapHdPubKeys) {
+        filter.AddKeyID(pair.first);
+    }
+    for (const auto& pair : mapScripts) {
+        filter.AddScriptID(pair.first);
+    }
+    for (const auto& script : setWatchOnly) {
+        filter.AddWatchOnly(script);
+    }
+    return filter;
+}
+
+namespace {
+struct ScannedBlock {
+    std::shared_ptr<CBlock> block; // null if reading failed
+    std::vector<char> vfMatch; // per tx, true if an output might be ours
+};
+}
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
  *
+ * Blocks are read and matched against the wallet's keys/scripts ahead of time
+ * by a few worker threads, only transactions which might be ours (or spend ours)
+ * are then added to the wallet here, in block order.
+ *
  * Returns pointer to the first block in the last contiguous range that was
  * successfully scanned.
- *
  */
 CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
 {
@@ -1924,22 +2076,84 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool f
         while (pindex && nTimeFirstKey && (pindex->GetBlockTime() < (nTimeFirstKey - 7200)))
             pindex = chainActive.Next(pindex);
 
+        // keys might have been imported, which changes which inputs are ours
+        mapOutpointRoundsCache.clear();
+
+        fScanningWallet = true;
+        nScanningStartTime = GetTimeMillis();
+        dScanningProgress = 0;
+
         ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
         double dProgressStart = GuessVerificationProgress(chainParams.TxData(), pindex);
         double dProgressTip = GuessVerificationProgress(chainParams.TxData(), chainActive.Tip());
-        while (pindex)
+
+        // Workers only see the block index entries, which can't change while we hold cs_main
+        const CWalletScanFilter filter = CreateScanFilter();
+        const int nThreads = std::max(1, std::min(GetNumCores(), MAX_RESCAN_THREADS));
+        CWorkStealingPool workerPool;
+        workerPool.Start(nThreads, "rescan");
+
+        std::deque<std::pair<CBlockIndex*, std::future<ScannedBlock> > > dequeScanning;
+        CBlockIndex* pindexNextRead = pindex;
+        auto readAhead = [&]() {
+            while (pindexNextRead && dequeScanning.size() < (size_t)(nThreads * RESCAN_BLOCKS_AHEAD)) {
+                const CBlockIndex* pindexRead = pindexNextRead;
+                auto future = workerPool.PushThen([pindexRead, &chainParams](int) {
+                    auto block = std::make_shared<CBlock>();
+                    if (!ReadBlockFromDisk(*block, pindexRead, chainParams.GetConsensus())) {
+                        block.reset();
+                    }
+                    return block;
+                }, [&filter](int, const std::shared_ptr<CBlock>& block) {
+                    ScannedBlock scanned;
+                    scanned.block = block;
+                    if (block) {
+                        scanned.vfMatch.reserve(block->vtx.size());
+                        for (const auto& tx : block->vtx) {
+                            scanned.vfMatch.push_back(filter.IsRelevant(*tx));
+                        }
+                    }
+                    return scanned;
+                });
+                dequeScanning.emplace_back(pindexNextRead, std::move(future));
+                pindexNextRead = chainActive.Next(pindexNextRead);
+            }
+        };
+
+        // Outputs are matched by the workers already, inputs have to be checked here as they can spend
+        // outputs found earlier in this scan
+        auto fInvolvesWallet = [&](const CTransaction& tx) {
+            if (mapWallet.count(tx.GetHash())) return true;
+            for (const auto& txin : tx.vin) {
+                if (mapWallet.count(txin.prevout.hash) || mapTxSpends.count(txin.prevout)) return true;
+            }
+            return false;
+        };
+
+        readAhead();
+        while (!dequeScanning.empty())
         {
+            pindex = dequeScanning.front().first;
+            ScannedBlock scanned = dequeScanning.front().second.get();
+            dequeScanning.pop_front();
+            readAhead();
+
+            if (dProgressTip - dProgressStart > 0.0) {
+                dScanningProgress = (GuessVerificationProgress(chainParams.TxData(), pindex) - dProgressStart) / (dProgressTip - dProgressStart);
+            }
             if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((GuessVerificationProgress(chainParams.TxData(), pindex) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)(dScanningProgress * 100))));
             if (GetTime() >= nNow + 60) {
                 nNow = GetTime();
                 LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
             }
 
-            CBlock block;
-            if (ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            if (scanned.block) {
+                const CBlock& block = *scanned.block;
                 for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    AddToWalletIfInvolvingMe(*block.vtx[posInBlock], pindex, posInBlock, fUpdate);
+                    if (scanned.vfMatch[posInBlock] || fInvolvesWallet(*block.vtx[posInBlock])) {
+                        AddToWalletIfInvolvingMe(*block.vtx[posInBlock], pindex, posInBlock, fUpdate);
+                    }
                 }
                 if (!ret) {
                     ret = pindex;
@@ -1947,9 +2161,10 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool f
             } else {
                 ret = nullptr;
             }
-            pindex = chainActive.Next(pindex);
         }
+        workerPool.Stop(true);
         ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
+        fScanningWallet = false;
     }
     return ret;
 }
@@ -2380,9 +2595,8 @@ CAmount CWallet::GetBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetWalletTxesWithUTXO())
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableCredit();
         }
@@ -2421,16 +2635,9 @@ CAmount CWallet::GetAnonymizedBalance() const
 
     LOCK2(cs_main, cs_wallet);
 
-    std::set<uint256> setWalletTxesCounted;
-    for (const auto& outpoint : setWalletUTXO) {
-
-        if (setWalletTxesCounted.find(outpoint.hash) != setWalletTxesCounted.end()) continue;
-        setWalletTxesCounted.insert(outpoint.hash);
-
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash); it != mapWallet.end() && it->first == outpoint.hash; ++it) {
-            if (it->second.IsTrusted())
-                nTotal += it->second.GetAnonymizedCredit();
-        }
+    for (const CWalletTx* pcoin : GetWalletTxesWithUTXO()) {
+        if (pcoin->IsTrusted())
+            nTotal += pcoin->GetAnonymizedCredit();
     }
 
     return nTotal;
@@ -2511,10 +2718,8 @@ CAmount CWallet::GetDenominatedBalance(bool unconfirmed) const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetWalletTxesWithUTXO())
         {
-            const CWalletTx* pcoin = &(*it).second;
-
             nTotal += pcoin->GetDenominatedCredit(unconfirmed);
         }
     }
@@ -2527,9 +2732,8 @@ CAmount CWallet::GetUnconfirmedBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetWalletTxesWithUTXO())
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && !pcoin->IsLockedByInstantSend() && pcoin->InMempool())
                 nTotal += pcoin->GetAvailableCredit();
         }
@@ -2542,9 +2746,8 @@ CAmount CWallet::GetImmatureBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetWalletTxesWithUTXO())
         {
-            const CWalletTx* pcoin = &(*it).second;
             nTotal += pcoin->GetImmatureCredit();
         }
     }
@@ -2556,9 +2759,8 @@ CAmount CWallet::GetWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetWalletTxesWithUTXO())
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
@@ -2572,9 +2774,8 @@ CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetWalletTxesWithUTXO())
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && !pcoin->IsLockedByInstantSend() && pcoin->InMempool())
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
@@ -2587,9 +2788,8 @@ CAmount CWallet::GetImmatureWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetWalletTxesWithUTXO())
         {
-            const CWalletTx* pcoin = &(*it).second;
             nTotal += pcoin->GetImmatureWatchOnlyCredit();
         }
     }
@@ -2604,10 +2804,9 @@ void CWallet::AvailableCoins(std::vector<COutput>& vCoins, bool fOnlyConfirmed,
         LOCK2(cs_main, cs_wallet);
         int nInstantSendConfirmationsRequired = Params().GetConsensus().nInstantSendConfirmationsRequired;
 
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetWalletTxesWithUTXO())
         {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
+            const uint256& wtxid = pcoin->GetHash();
 
             if (!CheckFinalTx(*pcoin))
                 continue;
@@ -2646,9 +2845,9 @@ void CWallet::AvailableCoins(std::vector<COutput>& vCoins, bool fOnlyConfirmed,
 
                 isminetype mine = IsMine(pcoin->tx->vout[i]);
                 if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-                    (!IsLockedCoin((*it).first, i) || nCoinType == ONLY_MNCOLLATERAL) &&
+                    (!IsLockedCoin(wtxid, i) || nCoinType == ONLY_MNCOLLATERAL) &&
                     (pcoin->tx->vout[i].nValue > 0 || fIncludeZeroValue) &&
-                    (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint((*it).first, i))))
+                    (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint(wtxid, i))))
                         vCoins.push_back(COutput(pcoin, i, nDepth,
                                                  ((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
                                                   (coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
@@ -2658,7 +2857,7 @@ void CWallet::AvailableCoins(std::vector<COutput>& vCoins, bool fOnlyConfirmed,
     }
 }
 
-static void ApproximateBestSubset(std::vector<std::pair<CAmount, std::pair<const CWalletTx*,unsigned int> > >vValue, const CAmount& nTotalLower, const CAmount& nTargetValue,
+static void ApproximateBestSubset(const std::vector<std::pair<CAmount, std::pair<const CWalletTx*,unsigned int> > >& vValue, const CAmount& nTotalLower, const CAmount& nTargetValue,
                                   std::vector<char>& vfBest, CAmount& nBest, bool fUseInstantSend = false, int iterations = 1000)
 {
     std::vector<char> vfIncluded;
@@ -2716,27 +2915,19 @@ struct CompareByPriority
     }
 };
 
-// move denoms down
-bool less_then_denom (const COutput& out1, const COutput& out2)
+bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const int nConfMine, const int nConfTheirs, const uint64_t nMaxAncestors, const std::vector<COutput>& vCoins,
+                                 std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, AvailableCoinsType nCoinType, bool fUseInstantSend) const
 {
-    const CWalletTx *pcoin1 = out1.tx;
-    const CWalletTx *pcoin2 = out2.tx;
-
-    bool found1 = false;
-    bool found2 = false;
-    for (const auto& d : CPrivateSend::GetStandardDenominations()) // loop through predefined denoms
-    {
-        if(pcoin1->tx->vout[out1.i].nValue == d) found1 = true;
-        if(pcoin2->tx->vout[out2.i].nValue == d) found2 = true;
-    }
-    return (!found1 && found2);
+    return SelectCoinsMinConf(nTargetValue, nConfMine, nConfTheirs, nMaxAncestors, CCoinSelectionIndex(vCoins), setCoinsRet, nValueRet, nCoinType, fUseInstantSend);
 }
 
-bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const int nConfMine, const int nConfTheirs, const uint64_t nMaxAncestors, std::vector<COutput> vCoins,
-                                 std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, AvailableCoinsType nCoinType, bool fUseInstantSend) const
+bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const int nConfMine, const int nConfTheirs, const uint64_t nMaxAncestors, const CCoinSelectionIndex& coins,
+                                 std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, AvailableCoinsType nCoinType, bool fUseInstantSend, const CCoinSelectionParams& params, bool* pfBnBUsed) const
 {
     setCoinsRet.clear();
     nValueRet = 0;
+    if (pfBnBUsed)
+        *pfBnBUsed = false;
 
     // List of values less than target
     std::pair<CAmount, std::pair<const CWalletTx*,unsigned int> > coinLowestLarger;
@@ -2747,71 +2938,71 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const int nConfMin
     std::vector<std::pair<CAmount, std::pair<const CWalletTx*,unsigned int> > > vValue;
     CAmount nTotalLower = 0;
 
-    random_shuffle(vCoins.begin(), vCoins.end(), GetRandInt);
-
     int tryDenomStart = 0;
     CAmount nMinChange = MIN_CHANGE;
 
     if (nCoinType == ONLY_DENOMINATED) {
-        // larger denoms first
-        std::sort(vCoins.rbegin(), vCoins.rend(), CompareByPriority());
         // we actually want denoms only, so let's skip "non-denom only" step
         tryDenomStart = 1;
         // no change is allowed
         nMinChange = 0;
-    } else {
-        // move denoms down on the list
-        // try not to use denominated coins when not needed, save denoms for privatesend
-        std::sort(vCoins.begin(), vCoins.end(), less_then_denom);
     }
 
-    // try to find nondenom first to prevent unneeded spending of mixed coins
-    for (unsigned int tryDenom = tryDenomStart; tryDenom < 2; tryDenom++)
-    {
-        LogPrint("selectcoins", "tryDenom: %d\n", tryDenom);
-        vValue.clear();
-        nTotalLower = 0;
-        BOOST_FOREACH(const COutput &output, vCoins)
-        {
-            if (!output.fSpendable)
-                continue;
+    const std::vector<CCoinSelectionIndex::Entry>& vEntries = coins.GetEntries();
+    // coins before nLowerStart are too large for the subset sum below, larger coins come first
+    const size_t nLowerStart = coins.FindFirstBelow(nTargetValue + nMinChange);
 
-            const CWalletTx *pcoin = output.tx;
+    auto fnIsEligible = [&](const COutput& output, unsigned int tryDenom) {
+        const CWalletTx *pcoin = output.tx;
 
-//            if (fDebug) LogPrint("selectcoins", "value %s confirms %d\n", FormatMoney(pcoin->vout[output.i].nValue), output.nDepth);
-            if (output.nDepth < (pcoin->IsFromMe(ISMINE_ALL) ? nConfMine : nConfTheirs))
-                continue;
+        if (output.nDepth < (pcoin->IsFromMe(ISMINE_ALL) ? nConfMine : nConfTheirs))
+            return false;
 
-            if (!mempool.TransactionWithinChainLimit(pcoin->GetHash(), nMaxAncestors))
-                continue;
+        if (!mempool.TransactionWithinChainLimit(pcoin->GetHash(), nMaxAncestors))
+            return false;
 
-            int i = output.i;
-            CAmount n = pcoin->tx->vout[i].nValue;
-            if (tryDenom == 0 && CPrivateSend::IsDenominatedAmount(n)) continue; // we don't want denom values on first run
+        if (tryDenom == 0 && CPrivateSend::IsDenominatedAmount(pcoin->tx->vout[output.i].nValue)) return false; // we don't want denom values on first run
 
-            if (nCoinType == ONLY_DENOMINATED) {
-                // Make sure it's actually anonymized
-                COutPoint outpoint = COutPoint(pcoin->GetHash(), i);
-                int nRounds = GetRealOutpointPrivateSendRounds(outpoint);
-                if (nRounds < privateSendClient.nPrivateSendRounds) continue;
-            }
+        if (nCoinType == ONLY_DENOMINATED) {
+            // Make sure it's actually anonymized
+            COutPoint outpoint = COutPoint(pcoin->GetHash(), output.i);
+            int nRounds = GetRealOutpointPrivateSendRounds(outpoint);
+            if (nRounds < privateSendClient.nPrivateSendRounds) return false;
+        }
+        return true;
+    };
 
-            std::pair<CAmount, std::pair<const CWalletTx*,unsigned int> > coin = std::make_pair(n, std::make_pair(pcoin, i));
+    // try to find nondenom first to prevent unneeded spending of mixed coins
+    for (unsigned int tryDenom = tryDenomStart; tryDenom < 2; tryDenom++)
+    {
+        LogPrint("selectcoins", "tryDenom: %d\n", tryDenom);
+        vValue.clear();
+        nTotalLower = 0;
 
-            if (n == nTargetValue)
-            {
-                setCoinsRet.insert(coin.second);
-                nValueRet += coin.first;
+        for (size_t i = coins.FindFirstNotAbove(nTargetValue); i < vEntries.size() && vEntries[i].nValue == nTargetValue; i++) {
+            const COutput& output = *vEntries[i].pout;
+            if (fnIsEligible(output, tryDenom)) {
+                setCoinsRet.insert(std::make_pair(output.tx, output.i));
+                nValueRet += nTargetValue;
                 return true;
             }
-            else if (n < nTargetValue + nMinChange)
-            {
-                vValue.push_back(coin);
-                nTotalLower += n;
+        }
+
+        // the lowest larger coin is the last eligible one before nLowerStart
+        for (size_t i = nLowerStart; i-- > 0 && vEntries[i].nValue < coinLowestLarger.first; ) {
+            const COutput& output = *vEntries[i].pout;
+            if (vEntries[i].nValue != nTargetValue && fnIsEligible(output, tryDenom)) {
+                coinLowestLarger = std::make_pair(vEntries[i].nValue, std::make_pair(output.tx, (unsigned int)output.i));
+                break;
             }
-            else if (n < coinLowestLarger.first)
-            {
-                coinLowestLarger = coin;
+        }
+
+        // already sorted by descending value
+        for (size_t i = nLowerStart; i < vEntries.size(); i++) {
+            const COutput& output = *vEntries[i].pout;
+            if (vEntries[i].nValue != nTargetValue && fnIsEligible(output, tryDenom)) {
+                vValue.push_back(std::make_pair(vEntries[i].nValue, std::make_pair(output.tx, (unsigned int)output.i)));
+                nTotalLower += vEntries[i].nValue;
             }
         }
 
@@ -2848,9 +3039,54 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const int nConfMin
 
     }
 
+    // Look for a set of coins which doesn't need change first. The fee for each input is the same, so the effective
+    // values keep the descending order of vValue.
+    if (params.nMaxExcess >= 0)
+    {
+        std::vector<CAmount> vEffective;
+        std::vector<CAmount> vWaste;
+        std::vector<size_t> vPos;
+        vEffective.reserve(vValue.size());
+        vWaste.reserve(vValue.size());
+        vPos.reserve(vValue.size());
+        for (size_t i = 0; i < vValue.size(); i++) {
+            // coins which don't even pay for being spent can't help
+            if (vValue[i].first > params.nInputFee) {
+                vEffective.push_back(vValue[i].first - params.nInputFee);
+                vWaste.push_back(params.nInputWaste);
+                vPos.push_back(i);
+            }
+        }
+        std::vector<char> vfBest;
+        CAmount nBest;
+        if (SelectCoinsBnB(vEffective, vWaste, nTargetValue + params.nNoInputsFee, params.nMaxExcess, vfBest, nBest))
+        {
+            CAmount nBestValue = 0;
+            for (size_t i = 0; i < vPos.size(); i++) {
+                if (vfBest[i])
+                    nBestValue += vValue[vPos[i]].first;
+            }
+            // InstantSend limits the total value of the inputs, which the search doesn't know about
+            if (!(coinLowestLarger.second.first && coinLowestLarger.first <= nBestValue) &&
+                (!fUseInstantSend || nBestValue <= sporkManager.GetSporkValue(SPORK_5_INSTANTSEND_MAX_VALUE)*COIN))
+            {
+                for (size_t i = 0; i < vPos.size(); i++)
+                {
+                    if (vfBest[i])
+                    {
+                        setCoinsRet.insert(vValue[vPos[i]].second);
+                        nValueRet += vValue[vPos[i]].first;
+                    }
+                }
+                if (pfBnBUsed)
+                    *pfBnBUsed = true;
+                LogPrint("selectcoins", "CWallet::SelectCoinsMinConf branch and bound: %d coins - total %s, effective %s\n", setCoinsRet.size(), FormatMoney(nValueRet), FormatMoney(nBest));
+                return nCoinType == ONLY_DENOMINATED ? (nValueRet - nTargetValue <= maxTxFee) : true;
+            }
+        }
+    }
+
     // Solve subset sum by stochastic approximation
-    std::sort(vValue.begin(), vValue.end(), CompareValueOnly());
-    std::reverse(vValue.begin(), vValue.end());
     std::vector<char> vfBest;
     CAmount nBest;
 
@@ -2885,16 +3121,17 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const int nConfMin
     return nCoinType == ONLY_DENOMINATED ? (nValueRet - nTargetValue <= maxTxFee) : true;
 }
 
-bool CWallet::SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, const CCoinControl* coinControl, AvailableCoinsType nCoinType, bool fUseInstantSend) const
+bool CWallet::SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, const CCoinControl* coinControl, AvailableCoinsType nCoinType, bool fUseInstantSend, const CCoinSelectionParams& params, bool* pfBnBUsed) const
 {
-    // Note: this function should never be used for "always free" tx types like dstx
+    if (pfBnBUsed)
+        *pfBnBUsed = false;
 
-    std::vector<COutput> vCoins(vAvailableCoins);
+    // Note: this function should never be used for "always free" tx types like dstx
 
     // coin control -> return all selected outputs (we want all selected to go into the transaction for sure)
     if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs)
     {
-        BOOST_FOREACH(const COutput& out, vCoins)
+        BOOST_FOREACH(const COutput& out, vAvailableCoins)
         {
             if(!out.fSpendable)
                 continue;
@@ -2945,26 +3182,24 @@ bool CWallet::SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAm
             return false; // TODO: Allow non-wallet inputs
     }
 
-    // remove preset inputs from vCoins
-    for (std::vector<COutput>::iterator it = vCoins.begin(); it != vCoins.end() && coinControl && coinControl->HasSelected();)
-    {
-        if (setPresetCoins.count(std::make_pair(it->tx, it->i)))
-            it = vCoins.erase(it);
-        else
-            ++it;
-    }
+    // sort the remaining coins once for all the passes below
+    CCoinSelectionIndex coins(vAvailableCoins, setPresetCoins);
+
+    // the preset inputs have to be paid for as well
+    CCoinSelectionParams paramsMinConf = params;
+    paramsMinConf.nNoInputsFee += setPresetCoins.size() * params.nInputFee;
 
     size_t nMaxChainLength = std::min(GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT), GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT));
     bool fRejectLongChains = GetBoolArg("-walletrejectlongchains", DEFAULT_WALLET_REJECT_LONG_CHAINS);
 
     bool res = nTargetValue <= nValueFromPresetInputs ||
-        SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 1, 6, 0, vCoins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend) ||
-        SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 1, 1, 0, vCoins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend) ||
-        (bSpendZeroConfChange && SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 0, 1, 2, vCoins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend)) ||
-        (bSpendZeroConfChange && SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 0, 1, std::min((size_t)4, nMaxChainLength/3), vCoins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend)) ||
-        (bSpendZeroConfChange && SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 0, 1, nMaxChainLength/2, vCoins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend)) ||
-        (bSpendZeroConfChange && SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 0, 1, nMaxChainLength, vCoins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend)) ||
-        (bSpendZeroConfChange && !fRejectLongChains && SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 0, 1, std::numeric_limits<uint64_t>::max(), vCoins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend));
+        SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 1, 6, 0, coins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend, paramsMinConf, pfBnBUsed) ||
+        SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 1, 1, 0, coins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend, paramsMinConf, pfBnBUsed) ||
+        (bSpendZeroConfChange && SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 0, 1, 2, coins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend, paramsMinConf, pfBnBUsed)) ||
+        (bSpendZeroConfChange && SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 0, 1, std::min((size_t)4, nMaxChainLength/3), coins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend, paramsMinConf, pfBnBUsed)) ||
+        (bSpendZeroConfChange && SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 0, 1, nMaxChainLength/2, coins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend, paramsMinConf, pfBnBUsed)) ||
+        (bSpendZeroConfChange && SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 0, 1, nMaxChainLength, coins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend, paramsMinConf, pfBnBUsed)) ||
+        (bSpendZeroConfChange && !fRejectLongChains && SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 0, 1, std::numeric_limits<uint64_t>::max(), coins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend, paramsMinConf, pfBnBUsed));
 
     // because SelectCoinsMinConf clears the setCoinsRet, we now add the possible inputs to the coinset
     setCoinsRet.insert(setPresetCoins.begin(), setPresetCoins.end());
@@ -3107,16 +3342,9 @@ bool CWallet::SelectCoinsGroupedByAddresses(std::vector<CompactTallyItem>& vecTa
 
     // Tally
     std::map<CTxDestination, CompactTallyItem> mapTally;
-    std::set<uint256> setWalletTxesCounted;
-    for (const auto& outpoint : setWalletUTXO) {
-
-        if (setWalletTxesCounted.find(outpoint.hash) != setWalletTxesCounted.end()) continue;
-        setWalletTxesCounted.insert(outpoint.hash);
-
-        std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash);
-        if (it == mapWallet.end()) continue;
-
-        const CWalletTx& wtx = (*it).second;
+    for (const CWalletTx* pcoin : GetWalletTxesWithUTXO()) {
+        const CWalletTx& wtx = *pcoin;
+        const uint256& txHash = wtx.GetHash();
 
         if(wtx.IsCoinBase() && wtx.GetBlocksToMaturity() > 0) continue;
         if(fSkipUnconfirmed && !wtx.IsTrusted()) continue;
@@ -3131,7 +3359,7 @@ bool CWallet::SelectCoinsGroupedByAddresses(std::vector<CompactTallyItem>& vecTa
             auto itTallyItem = mapTally.find(txdest);
             if (nMaxOupointsPerAddress != -1 && itTallyItem != mapTally.end() && itTallyItem->second.vecOutPoints.size() >= nMaxOupointsPerAddress) continue;
 
-            if(IsSpent(outpoint.hash, i) || IsLockedCoin(outpoint.hash, i)) continue;
+            if(IsSpent(txHash, i) || IsLockedCoin(txHash, i)) continue;
 
             if(fSkipDenominated && CPrivateSend::IsDenominatedAmount(wtx.tx->vout[i].nValue)) continue;
 
@@ -3143,7 +3371,7 @@ bool CWallet::SelectCoinsGroupedByAddresses(std::vector<CompactTallyItem>& vecTa
                 // otherwise they will just lead to higher fee / lower priority
                 if(wtx.tx->vout[i].nValue <= nSmallestDenom/10) continue;
                 // ignore anonymized
-                if(GetCappedOutpointPrivateSendRounds(COutPoint(outpoint.hash, i)) >= privateSendClient.nPrivateSendRounds) continue;
+                if(GetCappedOutpointPrivateSendRounds(COutPoint(txHash, i)) >= privateSendClient.nPrivateSendRounds) continue;
             }
 
             if (itTallyItem == mapTally.end()) {
@@ -3151,7 +3379,7 @@ bool CWallet::SelectCoinsGroupedByAddresses(std::vector<CompactTallyItem>& vecTa
                 itTallyItem->second.txdest = txdest;
             }
             itTallyItem->second.nAmount += wtx.tx->vout[i].nValue;
-            itTallyItem->second.vecOutPoints.emplace_back(outpoint.hash, i);
+            itTallyItem->second.vecOutPoints.emplace_back(txHash, i);
         }
     }
 
@@ -3304,9 +3532,8 @@ int CWallet::CountInputsWithAmount(CAmount nInputAmount)
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetWalletTxesWithUTXO())
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (pcoin->IsTrusted()){
                 int nDepth = pcoin->GetDepthInMainChain();
 
@@ -3496,6 +3723,27 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend, CWalletT
             AvailableCoins(vAvailableCoins, true, coinControl, false, nCoinType, fUseInstantSend);
             int nInstantSendConfirmationsRequired = Params().GetConsensus().nInstantSendConfirmationsRequired;
 
+            // Coin selection may overshoot by this much to avoid change: PrivateSend never creates change and pays up
+            // to maxTxFee anyway, otherwise change below the dust threshold would go to the fee. Dust change is
+            // raised instead when the fee is subtracted from the amount, so the exact search isn't used there.
+            CCoinSelectionParams coinSelectionParams;
+            CFeeRate bnbFeeRate;
+            // rounded up, so that the fees for the parts of the transaction add up to at least the fee for all of it
+            auto fnGetFee = [](const CFeeRate& feeRate, size_t nBytes) {
+                return (feeRate.GetFeePerK() * (CAmount)nBytes + 999) / 1000;
+            };
+            if (nCoinType == ONLY_DENOMINATED) {
+                coinSelectionParams.nMaxExcess = maxTxFee;
+            } else if (nSubtractFeeFromAmount == 0) {
+                coinSelectionParams.nMaxExcess = CTxOut(0, GetScriptForDestination(CKeyID())).GetDustThreshold(dustRelayFee) - 1;
+                // the search selects coins on their values minus the fees for spending them, spending an input now
+                // wastes what it costs above the lowest feerate the wallet pays
+                int nConfirmTarget = (coinControl && coinControl->nConfirmTarget > 0) ? coinControl->nConfirmTarget : nTxConfirmTarget;
+                bnbFeeRate = (coinControl && coinControl->fOverrideFeeRate) ? coinControl->nFeeRate : CFeeRate(GetMinimumFee(1000, nConfirmTarget, mempool));
+                coinSelectionParams.nInputFee = fnGetFee(bnbFeeRate, SIGNED_P2PKH_INPUT_SIZE);
+                coinSelectionParams.nInputWaste = std::max(CAmount(0), coinSelectionParams.nInputFee - fnGetFee(CFeeRate(GetRequiredFee(1000)), SIGNED_P2PKH_INPUT_SIZE));
+            }
+
             nFeeRet = 0;
             if(nFeePay > 0) nFeeRet = nFeePay;
             // Start with no fee and loop until there is enough fee
@@ -3543,10 +3791,19 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend, CWalletT
                     txNew.vout.push_back(txout);
                 }
 
+                if (coinSelectionParams.nInputFee > 0) {
+                    // the part of the fee for everything but the inputs which nFeeRet doesn't cover yet
+                    size_t nNoInputsBytes = ::GetSerializeSize(txNew, SER_NETWORK, PROTOCOL_VERSION);
+                    if (nExtraPayloadSize != 0)
+                        nNoInputsBytes += GetSizeOfCompactSize(nExtraPayloadSize) + nExtraPayloadSize;
+                    coinSelectionParams.nNoInputsFee = std::max(CAmount(0), fnGetFee(bnbFeeRate, nNoInputsBytes) - nFeeRet);
+                }
+
                 // Choose coins to use
                 CAmount nValueIn = 0;
+                bool fBnBUsed = false;
                 setCoins.clear();
-                if (!SelectCoins(vAvailableCoins, nValueToSelect, setCoins, nValueIn, coinControl, nCoinType, fUseInstantSend))
+                if (!SelectCoins(vAvailableCoins, nValueToSelect, setCoins, nValueIn, coinControl, nCoinType, fUseInstantSend, coinSelectionParams, &fBnBUsed))
                 {
                     if (nCoinType == ONLY_NONDENOMINATED) {
                         strFailReason = _("Unable to locate enough PrivateSend non-denominated funds for this transaction.");
@@ -3594,6 +3851,11 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend, CWalletT
                         wtxNew.mapValue["DS"] = "1";
                         // recheck skipped denominations during next mixing
                         privateSendClient.ClearSkippedDenominations();
+                    } else if (fBnBUsed) {
+                        // the coins were selected to pay for their own inputs, the rest is below the dust threshold
+                        nChangePosInOut = -1;
+                        nFeeRet += nChange;
+                        reservekey.ReturnKey();
                     } else {
 
                         // Fill a vout to ourself
@@ -3968,6 +4230,7 @@ DBErrors CWallet::LoadWallet(bool& fFirstRunRet)
     if (!fFileBacked)
         return DB_LOAD_OK;
     fFirstRunRet = false;
+    int64_t nStart = GetTimeMillis();
     DBErrors nLoadWalletRet = CWalletDB(strWalletFile,"cr+").LoadWallet(this);
     if (nLoadWalletRet == DB_NEED_REWRITE)
     {
@@ -3992,7 +4255,9 @@ DBErrors CWallet::LoadWallet(bool& fFirstRunRet)
                 }
             }
         }
+        CalculatePrivateSendRounds();
     }
+    nLoadWalletTime = GetTimeMillis() - nStart;
 
     if (nLoadWalletRet != DB_LOAD_OK)
         return nLoadWalletRet;
@@ -4040,6 +4305,8 @@ DBErrors CWallet::ZapSelectTx(std::vector<uint256>& vHashIn, std::vector<uint256
     if (nZapSelectTxRet != DB_LOAD_OK)
         return nZapSelectTxRet;
 
+    CalculatePrivateSendRounds();
+
     MarkDirty();
 
     return DB_LOAD_OK;
@@ -4068,6 +4335,11 @@ DBErrors CWallet::ZapWalletTx(std::vector<CWalletTx>& vWtx)
     if (nZapWalletTxRet != DB_LOAD_OK)
         return nZapWalletTxRet;
 
+    {
+        LOCK(cs_wallet);
+        mapOutpointRoundsCache.clear();
+    }
+
     return DB_LOAD_OK;
 }
 
@@ -4843,6 +5115,7 @@ std::string CWallet::GetWalletHelpString(bool showDebug)
 
         strUsage += HelpMessageOpt("-dblogsize=<n>", strprintf("Flush wallet database activity from memory to disk log every <n> megabytes (default: %u)", DEFAULT_WALLET_DBLOGSIZE));
         strUsage += HelpMessageOpt("-flushwallet", strprintf("Run a thread to flush wallet periodically (default: %u)", DEFAULT_FLUSHWALLET));
+        strUsage += HelpMessageOpt("-walletcommitdelay=<n>", strprintf("Write wallet transactions in batches committed at most <n> milliseconds after they were added, a crash may lose the last <n> ms of them, confirmed ones are found again by the startup rescan (0 = write immediately, default: %u)", DEFAULT_WALLET_COMMIT_DELAY));
         strUsage += HelpMessageOpt("-privdb", strprintf("Sets the DB_PRIVATE flag in the wallet db environment (default: %u)", DEFAULT_WALLET_PRIVDB));
         strUsage += HelpMessageOpt("-walletrejectlongchains", strprintf(_("Wallet will not create transactions that violate mempool chain limits (default: %u)"), DEFAULT_WALLET_REJECT_LONG_CHAINS));
     }
@@ -4982,7 +5255,7 @@ CWallet* CWallet::CreateWalletFromFile(const std::string walletFile)
 
     LogPrintf(" wallet      %15dms\n", GetTimeMillis() - nStart);
 
-    RegisterValidationInterface(walletInstance);
+    RegisterValidationInterface(walletInstance, "wallet");
 
     CBlockIndex *pindexRescan = chainActive.Tip();
     if (GetBoolArg("-rescan", false))
@@ -5090,6 +5363,9 @@ void CWallet::postInitProcess(boost::thread_group& threadGroup)
     if (!CWallet::fFlushThreadRunning.exchange(true)) {
         threadGroup.create_thread(ThreadFlushWalletDB);
     }
+
+    // Commit wallet transactions in batches
+    bitdb.writeQueue.Start(GetArg("-walletcommitdelay", DEFAULT_WALLET_COMMIT_DELAY));
 }
 
 bool CWallet::ParameterInteraction()
@@ -5216,6 +5492,7 @@ bool CWallet::BackupWallet(const std::string& strDest)
 {
     if (!fFileBacked)
         return false;
+    bitdb.writeQueue.Commit(strWalletFile);
     while (true)
     {
         {
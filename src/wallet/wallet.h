@@ -16,6 +16,7 @@
 #include "utilstrencodings.h"
 #include "validationinterface.h"
 #include "script/ismine.h"
+#include "wallet/coinselection.h"
 #include "wallet/crypter.h"
 #include "wallet/walletdb.h"
 #include "wallet/rpcwallet.h"
@@ -71,6 +72,10 @@ static const unsigned int DEFAULT_TX_CONFIRM_TARGET = 6;
 static const unsigned int MAX_FREE_TRANSACTION_CREATE_SIZE = 1000;
 static const bool DEFAULT_WALLETBROADCAST = true;
 static const bool DEFAULT_DISABLE_WALLET = false;
+//! Maximum number of threads reading and matching blocks during a rescan
+static const int MAX_RESCAN_THREADS = 4;
+//! Number of blocks per rescan thread which are read ahead of the block being added to the wallet
+static const int RESCAN_BLOCKS_AHEAD = 8;
 
 extern const char * DEFAULT_WALLET_DAT;
 
@@ -513,6 +518,28 @@ public:
 
 
 
+/**
+ * Everything IsMine() matches output scripts against (key IDs, P2SH script IDs and watch-only scripts), copied out
+ * of the wallet so blocks can be matched against it on other threads while rescanning. Might report outputs which are
+ * not ours in the end (e.g. multisig with only some of the keys), but never misses one which is.
+ */
+class CWalletScanFilter
+{
+private:
+    std::set<uint160> setKeyIDs;
+    std::set<uint160> setScriptIDs;
+    std::set<CScript> setWatchOnly;
+
+public:
+    void AddKeyID(const CKeyID& keyID) { setKeyIDs.insert(keyID); }
+    void AddScriptID(const CScriptID& scriptID) { setScriptIDs.insert(scriptID); }
+    void AddWatchOnly(const CScript& script) { setWatchOnly.insert(script); }
+
+    bool IsRelevant(const CScript& scriptPubKey) const;
+    //! True if any of the outputs of tx might be ours
+    bool IsRelevant(const CTransaction& tx) const;
+};
+
 /** Private key that includes an expiration date in case it never gets used. */
 class CWalletKey
 {
@@ -635,9 +662,11 @@ private:
     /**
      * Select a set of coins such that nValueRet >= nTargetValue and at least
      * all coins from coinControl are selected; Never select unconfirmed coins
-     * if they are not ours
+     * if they are not ours. A set of coins that needs no change output is
+     * searched first according to params, *pfBnBUsed is set if one is
+     * returned, see SelectCoinsMinConf
      */
-    bool SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, const CCoinControl *coinControl = NULL, AvailableCoinsType nCoinType=ALL_COINS, bool fUseInstantSend = true) const;
+    bool SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, const CCoinControl *coinControl = NULL, AvailableCoinsType nCoinType=ALL_COINS, bool fUseInstantSend = true, const CCoinSelectionParams& params = CCoinSelectionParams(), bool* pfBnBUsed = NULL) const;
 
     CWalletDB *pwalletdbEncryption;
 
@@ -656,6 +685,10 @@ private:
     mutable bool fAnonymizableTallyCachedNonDenom;
     mutable std::vector<CompactTallyItem> vecAnonymizableTallyCachedNonDenom;
 
+    std::atomic<bool> fScanningWallet{false};
+    std::atomic<int64_t> nScanningStartTime{0};
+    std::atomic<double> dScanningProgress{0};
+
     /**
      * Used to keep track of spent outpoints, and
      * detect and report conflicts (double-spends or
@@ -666,7 +699,24 @@ private:
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    /**
+     * Outputs which are ours and not known to be spent. This is a superset of the spendable coins (IsSpent still
+     * has to be checked, e.g. for spends that are only in the mempool), which lets balance calculations and coin
+     * listing skip the (usually vast majority of) wallet transactions that are spent completely.
+     */
     std::set<COutPoint> setWalletUTXO;
+    /* Put outputs spent by wtx back into setWalletUTXO if they are unspent again (wtx abandoned or conflicted) */
+    void AddInputsToWalletUTXO(const CWalletTx& wtx);
+    /* Wallet transactions with at least one output in setWalletUTXO, in mapWallet order */
+    std::vector<const CWalletTx*> GetWalletTxesWithUTXO() const;
+
+    /**
+     * PrivateSend rounds of our outputs, as returned by GetRealOutpointPrivateSendRounds. Rounds only depend on the
+     * wallet transaction graph and on which inputs are ours, not on the chain, so entries stay valid across reorgs.
+     * The cache is reset whenever that might change: a wallet tx arrives after its in-wallet spenders, transactions
+     * are zapped or the chain is rescanned (e.g. after importing keys).
+     */
+    mutable std::map<COutPoint, int> mapOutpointRoundsCache;
 
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, const uint256& hashTx);
@@ -765,6 +815,7 @@ public:
         fAnonymizableTallyCachedNonDenom = false;
         vecAnonymizableTallyCached.clear();
         vecAnonymizableTallyCachedNonDenom.clear();
+        nLoadWalletTime = 0;
     }
 
     std::map<uint256, CWalletTx> mapWallet;
@@ -785,6 +836,9 @@ public:
 
     int64_t nKeysLeftSinceAutoBackup;
 
+    //! time in milliseconds it took to load the wallet from disk
+    int64_t nLoadWalletTime;
+
     std::map<CKeyID, CHDPubKey> mapHdPubKeys; //<! memory map of HD extended pubkeys
 
     const CWalletTx* GetWalletTx(const uint256& hash) const;
@@ -803,7 +857,16 @@ public:
      * completion the coin set and corresponding actual target value is
      * assembled
      */
-    bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, uint64_t nMaxAncestors, std::vector<COutput> vCoins, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, AvailableCoinsType nCoinType=ALL_COINS, bool fUseInstantSend = false) const;
+    bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, uint64_t nMaxAncestors, const std::vector<COutput>& vCoins, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, AvailableCoinsType nCoinType=ALL_COINS, bool fUseInstantSend = false) const;
+    /**
+     * Same on pre-sorted coins. If params.nMaxExcess is not negative, a
+     * branch and bound search on the values of the coins minus the fees for
+     * spending them runs before the stochastic one. It looks for a set of
+     * coins that pays for the target, its own inputs and params.nNoInputsFee
+     * with at most params.nMaxExcess left over, so no change is needed.
+     * *pfBnBUsed is set if its result is returned
+     */
+    bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, uint64_t nMaxAncestors, const CCoinSelectionIndex& coins, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, AvailableCoinsType nCoinType=ALL_COINS, bool fUseInstantSend = false, const CCoinSelectionParams& params = CCoinSelectionParams(), bool* pfBnBUsed = NULL) const;
 
     // Coin selection
     bool SelectPSInOutPairsByDenominations(int nDenom, CAmount nValueMin, CAmount nValueMax, std::vector< std::pair<CTxDSIn, CTxOut> >& vecPSInOutPairsRet);
@@ -824,6 +887,8 @@ public:
     int GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRounds = 0) const;
     // respect current settings
     int GetCappedOutpointPrivateSendRounds(const COutPoint& outpoint) const;
+    // (re)calculate the PrivateSend rounds of all our outputs in one pass, parents before children
+    void CalculatePrivateSendRounds();
 
     bool IsDenominated(const COutPoint& outpoint) const;
 
@@ -905,6 +970,12 @@ public:
     void SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock) override;
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlockIndex* pIndex, int posInBlock, bool fUpdate);
     CBlockIndex* ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
+    //! Only to be called with cs_wallet held, the filter gets outdated when keys/scripts are added
+    CWalletScanFilter CreateScanFilter() const;
+    //! Can be called without any locks, e.g. to report progress while a rescan holds cs_main/cs_wallet
+    bool IsScanning() const { return fScanningWallet; }
+    int64_t ScanningDuration() const { return fScanningWallet ? GetTimeMillis() - nScanningStartTime : 0; }
+    double ScanningProgress() const { return fScanningWallet ? (double)dScanningProgress : 0; }
     void ReacceptWalletTransactions();
     void ResendWalletTransactions(int64_t nBestBlockTime, CConnman* connman) override;
     std::vector<uint256> ResendWalletTransactionsBefore(int64_t nTime, CConnman* connman);
@@ -15,8 +15,10 @@
 #include "util.h"
 #include "utiltime.h"
 #include "wallet/wallet.h"
+#include "workstealingpool.h"
 
 #include <atomic>
+#include <future>
 
 #include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
@@ -59,12 +61,13 @@ bool CWalletDB::ErasePurpose(const std::string& strPurpose)
 bool CWalletDB::WriteTx(const CWalletTx& wtx)
 {
     nWalletDBUpdateCounter++;
-    return Write(std::make_pair(std::string("tx"), wtx.GetHash()), wtx);
+    return WriteDeferred(std::make_pair(std::string("tx"), wtx.GetHash()), wtx);
 }
 
 bool CWalletDB::EraseTx(uint256 hash)
 {
     nWalletDBUpdateCounter++;
+    CommitQueuedWrites();
     return Erase(std::make_pair(std::string("tx"), hash));
 }
 
@@ -137,6 +140,9 @@ bool CWalletDB::EraseWatchOnly(const CScript &dest)
 bool CWalletDB::WriteBestBlock(const CBlockLocator& locator)
 {
     nWalletDBUpdateCounter++;
+    // transactions up to this block must be on disk before it is, or a crash would skip them on the next start
+    if (!CommitQueuedWrites())
+        return false;
     Write(std::string("bestblock"), CBlockLocator()); // Write empty block locator so versions that require a merkle branch automatically rescan
     return Write(std::string("bestblock_nomerkle"), locator);
 }
@@ -150,7 +156,7 @@ bool CWalletDB::ReadBestBlock(CBlockLocator& locator)
 bool CWalletDB::WriteOrderPosNext(int64_t nOrderPosNext)
 {
     nWalletDBUpdateCounter++;
-    return Write(std::string("orderposnext"), nOrderPosNext);
+    return WriteDeferred(std::string("orderposnext"), nOrderPosNext);
 }
 
 bool CWalletDB::WriteDefaultKey(const CPubKey& vchPubKey)
@@ -276,6 +282,119 @@ public:
     }
 };
 
+static bool DecodeTx(CDataStream& ssKey, CDataStream& ssValue, uint256& hash, CWalletTx& wtx, bool& fUpgraded, std::string& strErr)
+{
+    ssKey >> hash;
+    ssValue >> wtx;
+    CValidationState state;
+    if (!(CheckTransaction(wtx, state) && (wtx.GetHash() == hash) && state.IsValid()))
+        return false;
+
+    fUpgraded = false;
+    // Undo serialize changes in 31600
+    if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
+    {
+        if (!ssValue.empty())
+        {
+            char fTmp;
+            char fUnused;
+            ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
+            strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
+                               wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = fTmp;
+        }
+        else
+        {
+            strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = 0;
+        }
+        fUpgraded = true;
+    }
+    return true;
+}
+
+static void LoadDecodedTx(CWallet* pwallet, const uint256& hash, const CWalletTx& wtx, bool fUpgraded, CWalletScanState& wss)
+{
+    if (fUpgraded)
+        wss.vWalletUpgrade.push_back(hash);
+
+    if (wtx.nOrderPos == -1)
+        wss.fAnyUnordered = true;
+
+    pwallet->LoadToWallet(wtx);
+}
+
+static bool DecodeKey(const std::string& strType, CDataStream& ssKey, CDataStream& ssValue, CPubKey& vchPubKey, CKey& key, std::string& strErr)
+{
+    ssKey >> vchPubKey;
+    if (!vchPubKey.IsValid())
+    {
+        strErr = "Error reading wallet database: CPubKey corrupt";
+        return false;
+    }
+    CPrivKey pkey;
+    uint256 hash;
+
+    if (strType == "key")
+    {
+        ssValue >> pkey;
+    } else {
+        CWalletKey wkey;
+        ssValue >> wkey;
+        pkey = wkey.vchPrivKey;
+    }
+
+    // Old wallets store keys as "key" [pubkey] => [privkey]
+    // ... which was slow for wallets with lots of keys, because the public key is re-derived from the private key
+    // using EC operations as a checksum.
+    // Newer wallets store keys as "key"[pubkey] => [privkey][hash(pubkey,privkey)], which is much faster while
+    // remaining backwards-compatible.
+    try
+    {
+        ssValue >> hash;
+    }
+    catch (...) {}
+
+    bool fSkipCheck = false;
+
+    if (!hash.IsNull())
+    {
+        // hash pubkey/privkey to accelerate wallet load
+        std::vector<unsigned char> vchKey;
+        vchKey.reserve(vchPubKey.size() + pkey.size());
+        vchKey.insert(vchKey.end(), vchPubKey.begin(), vchPubKey.end());
+        vchKey.insert(vchKey.end(), pkey.begin(), pkey.end());
+
+        if (Hash(vchKey.begin(), vchKey.end()) != hash)
+        {
+            strErr = "Error reading wallet database: CPubKey/CPrivKey corrupt";
+            return false;
+        }
+
+        fSkipCheck = true;
+    }
+
+    if (!key.Load(pkey, vchPubKey, fSkipCheck))
+    {
+        strErr = "Error reading wallet database: CPrivKey corrupt";
+        return false;
+    }
+    return true;
+}
+
+static bool LoadDecodedKey(CWallet* pwallet, const std::string& strType, const CPubKey& vchPubKey, const CKey& key, CWalletScanState& wss, std::string& strErr)
+{
+    if (strType == "key")
+        wss.nKeys++;
+
+    if (!pwallet->LoadKey(key, vchPubKey))
+    {
+        strErr = "Error reading wallet database: LoadKey failed";
+        return false;
+    }
+    return true;
+}
+
 bool
 ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
              CWalletScanState &wss, std::string& strType, std::string& strErr)
@@ -300,37 +419,11 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
         else if (strType == "tx")
         {
             uint256 hash;
-            ssKey >> hash;
             CWalletTx wtx;
-            ssValue >> wtx;
-            CValidationState state;
-            if (!(CheckTransaction(wtx, state) && (wtx.GetHash() == hash) && state.IsValid()))
+            bool fUpgraded;
+            if (!DecodeTx(ssKey, ssValue, hash, wtx, fUpgraded, strErr))
                 return false;
-
-            // Undo serialize changes in 31600
-            if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
-            {
-                if (!ssValue.empty())
-                {
-                    char fTmp;
-                    char fUnused;
-                    ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
-                    strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
-                                       wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = fTmp;
-                }
-                else
-                {
-                    strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = 0;
-                }
-                wss.vWalletUpgrade.push_back(hash);
-            }
-
-            if (wtx.nOrderPos == -1)
-                wss.fAnyUnordered = true;
-
-            pwallet->LoadToWallet(wtx);
+            LoadDecodedTx(pwallet, hash, wtx, fUpgraded, wss);
         }
         else if (strType == "acentry")
         {
@@ -362,66 +455,11 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
         else if (strType == "key" || strType == "wkey")
         {
             CPubKey vchPubKey;
-            ssKey >> vchPubKey;
-            if (!vchPubKey.IsValid())
-            {
-                strErr = "Error reading wallet database: CPubKey corrupt";
-                return false;
-            }
             CKey key;
-            CPrivKey pkey;
-            uint256 hash;
-
-            if (strType == "key")
-            {
-                wss.nKeys++;
-                ssValue >> pkey;
-            } else {
-                CWalletKey wkey;
-                ssValue >> wkey;
-                pkey = wkey.vchPrivKey;
-            }
-
-            // Old wallets store keys as "key" [pubkey] => [privkey]
-            // ... which was slow for wallets with lots of keys, because the public key is re-derived from the private key
-            // using EC operations as a checksum.
-            // Newer wallets store keys as "key"[pubkey] => [privkey][hash(pubkey,privkey)], which is much faster while
-            // remaining backwards-compatible.
-            try
-            {
-                ssValue >> hash;
-            }
-            catch (...) {}
-
-            bool fSkipCheck = false;
-
-            if (!hash.IsNull())
-            {
-                // hash pubkey/privkey to accelerate wallet load
-                std::vector<unsigned char> vchKey;
-                vchKey.reserve(vchPubKey.size() + pkey.size());
-                vchKey.insert(vchKey.end(), vchPubKey.begin(), vchPubKey.end());
-                vchKey.insert(vchKey.end(), pkey.begin(), pkey.end());
-
-                if (Hash(vchKey.begin(), vchKey.end()) != hash)
-                {
-                    strErr = "Error reading wallet database: CPubKey/CPrivKey corrupt";
-                    return false;
-                }
-
-                fSkipCheck = true;
-            }
-
-            if (!key.Load(pkey, vchPubKey, fSkipCheck))
-            {
-                strErr = "Error reading wallet database: CPrivKey corrupt";
+            if (!DecodeKey(strType, ssKey, ssValue, vchPubKey, key, strErr))
                 return false;
-            }
-            if (!pwallet->LoadKey(key, vchPubKey))
-            {
-                strErr = "Error reading wallet database: LoadKey failed";
+            if (!LoadDecodedKey(pwallet, strType, vchPubKey, key, wss, strErr))
                 return false;
-            }
         }
         else if (strType == "mkey")
         {
@@ -579,6 +617,56 @@ static bool IsKeyType(std::string strType)
             strType == "hdchain" || strType == "chdchain");
 }
 
+/** Number of records read from the cursor before they are handed to the decoding workers */
+static const size_t WALLET_LOAD_BATCH_SIZE = 10000;
+/** Minimum number of records decoded by a single worker task */
+static const size_t WALLET_LOAD_CHUNK_SIZE = 100;
+
+/** A raw wallet record and, for transactions and keys, its decoded form */
+struct CWalletRecord
+{
+    CDataStream ssKey{SER_DISK, CLIENT_VERSION};
+    CDataStream ssValue{SER_DISK, CLIENT_VERSION};
+    std::string strType;
+    std::string strErr;
+    bool fDecoded{false};
+    bool fValid{false};
+
+    uint256 hash;
+    CWalletTx wtx;
+    bool fUpgraded{false};
+
+    CPubKey vchPubKey;
+    CKey key;
+};
+
+/**
+ * Decodes and verifies "tx", "key" and "wkey" records, which make up the bulk of a wallet and
+ * don't touch any wallet state. All other records are left for ReadKeyValue.
+ * Thread-safe, called from the wallet load workers.
+ */
+static void DecodeWalletRecord(CWalletRecord& rec)
+{
+    try {
+        std::string strType;
+        size_t nKeySize = rec.ssKey.size();
+        rec.ssKey >> strType;
+        if (strType != "tx" && strType != "key" && strType != "wkey") {
+            rec.ssKey.Rewind(nKeySize - rec.ssKey.size());
+            return;
+        }
+        rec.strType = strType;
+        rec.fDecoded = true;
+        if (strType == "tx")
+            rec.fValid = DecodeTx(rec.ssKey, rec.ssValue, rec.hash, rec.wtx, rec.fUpgraded, rec.strErr);
+        else
+            rec.fValid = DecodeKey(strType, rec.ssKey, rec.ssValue, rec.vchPubKey, rec.key, rec.strErr);
+    } catch (...) {
+        rec.fDecoded = true;
+        rec.fValid = false;
+    }
+}
+
 DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
 {
     pwallet->vchDefaultKey = CPubKey();
@@ -586,6 +674,7 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
     bool fNoncriticalErrors = false;
     DBErrors result = DB_LOAD_OK;
 
+    CommitQueuedWrites();
     LOCK(pwallet->cs_wallet);
     try {
         int nMinVersion = 0;
@@ -604,41 +693,96 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
             return DB_CORRUPT;
         }
 
-        while (true)
+        int64_t nStart = GetTimeMillis();
+        size_t nRecords = 0;
+        int nThreads = std::max(GetNumCores(), 1);
+
+        // Records are read in batches with a single cursor. While one batch is decoded by the workers,
+        // the next one is read from disk, and decoded batches are merged into the wallet in cursor order.
+        std::vector<CWalletRecord> vBatchDecoding, vBatchReading;
+        std::vector<std::future<void> > vDecoding;
+        CWorkStealingPool workerPool;
+        workerPool.Start(nThreads, "walletload");
+
+        auto readBatch = [&](std::vector<CWalletRecord>& vBatch) {
+            vBatch.clear();
+            while (vBatch.size() < WALLET_LOAD_BATCH_SIZE) {
+                vBatch.emplace_back();
+                CWalletRecord& rec = vBatch.back();
+                int ret = ReadAtCursor(pcursor, rec.ssKey, rec.ssValue);
+                if (ret == DB_NOTFOUND) {
+                    vBatch.pop_back();
+                    return true;
+                } else if (ret != 0) {
+                    LogPrintf("Error reading next record from wallet database\n");
+                    return false;
+                }
+            }
+            return true;
+        };
+        auto decodeBatch = [&](std::vector<CWalletRecord>& vBatch) {
+            size_t nChunkSize = std::max(WALLET_LOAD_CHUNK_SIZE, vBatch.size() / nThreads + 1);
+            for (size_t nBegin = 0; nBegin < vBatch.size(); nBegin += nChunkSize) {
+                size_t nEnd = std::min(nBegin + nChunkSize, vBatch.size());
+                vDecoding.emplace_back(workerPool.Push([&vBatch, nBegin, nEnd](int) {
+                    for (size_t i = nBegin; i < nEnd; i++) {
+                        DecodeWalletRecord(vBatch[i]);
+                    }
+                }));
+            }
+        };
+
+        if (!readBatch(vBatchDecoding))
+            return DB_CORRUPT;
+        while (!vBatchDecoding.empty())
         {
-            // Read next record
-            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-            int ret = ReadAtCursor(pcursor, ssKey, ssValue);
-            if (ret == DB_NOTFOUND)
-                break;
-            else if (ret != 0)
-            {
-                LogPrintf("Error reading next record from wallet database\n");
+            decodeBatch(vBatchDecoding);
+            if (!readBatch(vBatchReading))
                 return DB_CORRUPT;
+            for (auto& f : vDecoding) {
+                f.get();
             }
+            vDecoding.clear();
 
-            // Try to be tolerant of single corrupt records:
-            std::string strType, strErr;
-            if (!ReadKeyValue(pwallet, ssKey, ssValue, wss, strType, strErr))
+            for (CWalletRecord& rec : vBatchDecoding)
             {
-                // losing keys is considered a catastrophic error, anything else
-                // we assume the user can live with:
-                if (IsKeyType(strType))
-                    result = DB_CORRUPT;
-                else
+                // Try to be tolerant of single corrupt records:
+                std::string strType, strErr;
+                bool fLoaded;
+                if (rec.fDecoded) {
+                    strType = rec.strType;
+                    strErr = rec.strErr;
+                    fLoaded = rec.fValid;
+                    if (fLoaded && strType == "tx")
+                        LoadDecodedTx(pwallet, rec.hash, rec.wtx, rec.fUpgraded, wss);
+                    else if (fLoaded)
+                        fLoaded = LoadDecodedKey(pwallet, strType, rec.vchPubKey, rec.key, wss, strErr);
+                } else {
+                    fLoaded = ReadKeyValue(pwallet, rec.ssKey, rec.ssValue, wss, strType, strErr);
+                }
+                if (!fLoaded)
                 {
-                    // Leave other errors alone, if we try to fix them we might make things worse.
-                    fNoncriticalErrors = true; // ... but do warn the user there is something wrong.
-                    if (strType == "tx")
-                        // Rescan if there is a bad transaction record:
-                        SoftSetBoolArg("-rescan", true);
+                    // losing keys is considered a catastrophic error, anything else
+                    // we assume the user can live with:
+                    if (IsKeyType(strType))
+                        result = DB_CORRUPT;
+                    else
+                    {
+                        // Leave other errors alone, if we try to fix them we might make things worse.
+                        fNoncriticalErrors = true; // ... but do warn the user there is something wrong.
+                        if (strType == "tx")
+                            // Rescan if there is a bad transaction record:
+                            SoftSetBoolArg("-rescan", true);
+                    }
                 }
+                if (!strErr.empty())
+                    LogPrintf("%s\n", strErr);
             }
-            if (!strErr.empty())
-                LogPrintf("%s\n", strErr);
+            nRecords += vBatchDecoding.size();
+            std::swap(vBatchDecoding, vBatchReading);
         }
         pcursor->close();
+        LogPrint("db", "%s: loaded %u records in %dms using %d threads\n", __func__, nRecords, GetTimeMillis() - nStart, nThreads);
 
         // Store initial external keypool size since we mostly use external keys in mixing
         pwallet->nKeysLeftSinceAutoBackup = pwallet->KeypoolCountExternalKeys();
@@ -696,6 +840,7 @@ DBErrors CWalletDB::FindWalletTx(CWallet* pwallet, std::vector<uint256>& vTxHash
     bool fNoncriticalErrors = false;
     DBErrors result = DB_LOAD_OK;
 
+    CommitQueuedWrites();
     try {
         LOCK(pwallet->cs_wallet);
         int nMinVersion = 0;
@@ -81,6 +81,9 @@ public:
     {
     }
 
+    // nothing queued earlier may be written concurrently with, or on top of, the transaction
+    bool TxnBegin() { return CommitQueuedWrites() && CDB::TxnBegin(); }
+
     bool WriteName(const std::string& strAddress, const std::string& strName);
     bool EraseName(const std::string& strAddress);
 
@@ -144,6 +147,9 @@ public:
 private:
     CWalletDB(const CWalletDB&);
     void operator=(const CWalletDB&);
+
+    // write the records WriteDeferred queued for this file, unless a transaction is active
+    bool CommitQueuedWrites() { return activeTxn || bitdb.writeQueue.Commit(strFile); }
 };
 
 void ThreadFlushWalletDB();
@@ -0,0 +1,154 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "workstealingpool.h"
+
+#include "tinyformat.h"
+#include "util.h"
+
+#include <assert.h>
+
+// Set in every worker thread so that pushes from inside a worker end up in its own deque
+static thread_local const CWorkStealingPool* currentPool = nullptr;
+static thread_local size_t currentWorkerIdx = 0;
+
+CWorkStealingPool::~CWorkStealingPool()
+{
+    Stop(false);
+}
+
+void CWorkStealingPool::Start(int nThreads, const std::string& threadName)
+{
+    assert(threads.empty() && nThreads > 0);
+
+    fStopping = false;
+    nPendingTasks = 0;
+    queues.clear();
+    for (int i = 0; i < nThreads; i++) {
+        queues.emplace_back(new WorkerQueue());
+    }
+    threads.reserve(nThreads);
+    for (int i = 0; i < nThreads; i++) {
+        threads.emplace_back(&CWorkStealingPool::WorkerThread, this, (size_t)i, threadName);
+    }
+}
+
+void CWorkStealingPool::Stop(bool fWait)
+{
+    if (threads.empty()) {
+        return;
+    }
+    if (!fWait) {
+        ClearQueue();
+    }
+    {
+        std::unique_lock<std::mutex> l(idleMutex);
+        fStopping = true;
+    }
+    idleCond.notify_all();
+    for (auto& t : threads) {
+        t.join();
+    }
+    // queues are kept alive until the next Start() as other threads might still push to them. Such tasks are never
+    // executed, same as with ctpl::thread_pool
+    threads.clear();
+}
+
+void CWorkStealingPool::ClearQueue()
+{
+    for (auto& q : queues) {
+        std::unique_lock<std::mutex> l(q->mutex);
+        nPendingTasks -= q->tasks.size();
+        q->tasks.clear();
+    }
+}
+
+void CWorkStealingPool::PushTask(Task&& task)
+{
+    assert(!queues.empty());
+
+    size_t idx;
+    if (currentPool == this) {
+        idx = currentWorkerIdx;
+    } else {
+        idx = nNextQueue++ % queues.size();
+    }
+
+    // incremented before the task becomes visible, so that it never underflows when the task gets popped right away
+    nPendingTasks++;
+    {
+        std::unique_lock<std::mutex> l(queues[idx]->mutex);
+        queues[idx]->tasks.emplace_back(std::move(task));
+    }
+
+    // only touch the idle mutex when a worker might be sleeping. Workers re-check nPendingTasks while holding
+    // idleMutex, so taking it here ensures the notification can't get lost
+    if (nIdleWorkers != 0) {
+        {
+            std::unique_lock<std::mutex> l(idleMutex);
+        }
+        idleCond.notify_one();
+    }
+}
+
+bool CWorkStealingPool::PopTask(size_t queueIdx, Task& taskRet)
+{
+    // own deque first, newest task first (likely still hot in the cache)
+    {
+        auto& q = *queues[queueIdx];
+        std::unique_lock<std::mutex> l(q.mutex);
+        if (!q.tasks.empty()) {
+            taskRet = std::move(q.tasks.back());
+            q.tasks.pop_back();
+            nPendingTasks--;
+            return true;
+        }
+    }
+
+    // steal the oldest task from one of the other workers
+    for (size_t i = 1; i < queues.size(); i++) {
+        auto& q = *queues[(queueIdx + i) % queues.size()];
+        std::unique_lock<std::mutex> l(q.mutex, std::try_to_lock);
+        if (!l.owns_lock() || q.tasks.empty()) {
+            continue;
+        }
+        taskRet = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        nPendingTasks--;
+        nTasksStolen++;
+        return true;
+    }
+    return false;
+}
+
+void CWorkStealingPool::WorkerThread(size_t idx, const std::string& threadName)
+{
+    RenameThread(strprintf("%s-%d", threadName, idx).c_str());
+
+    currentPool = this;
+    currentWorkerIdx = idx;
+
+    while (true) {
+        Task task;
+        if (PopTask(idx, task)) {
+            task((int)idx);
+            nTasksExecuted++;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> l(idleMutex);
+        if (nPendingTasks != 0) {
+            // a try_lock in PopTask might have failed or a push is in progress, retry
+            continue;
+        }
+        if (fStopping) {
+            break;
+        }
+        nIdleWorkers++;
+        idleCond.wait(l, [this]() { return nPendingTasks != 0 || fStopping; });
+        nIdleWorkers--;
+    }
+
+    currentPool = nullptr;
+}
@@ -0,0 +1,164 @@
+// Copyright (c) 2018 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DASH_WORKSTEALINGPOOL_H
+#define DASH_WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Thread pool with one task deque per worker thread.
+ *
+ * Tasks pushed from inside a worker go to the back of that worker's own deque and are taken from there again (LIFO),
+ * which keeps fan-out/fan-in style jobs (e.g. BLS aggregation trees) local to one thread. Tasks pushed from other
+ * threads are distributed round robin. Idle workers steal from the front of the other workers' deques, so there is no
+ * single queue/lock all workers contend on.
+ *
+ * Functors are called with the index of the worker thread as first argument, same as with ctpl::thread_pool.
+ */
+class CWorkStealingPool
+{
+private:
+    typedef std::function<void(int)> Task;
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue> > queues;
+    std::vector<std::thread> threads;
+
+    // protects waking up/sleeping of idle workers
+    std::mutex idleMutex;
+    std::condition_variable idleCond;
+    std::atomic<size_t> nPendingTasks{0};
+    std::atomic<int> nIdleWorkers{0};
+    std::atomic<bool> fStopping{false};
+    std::atomic<size_t> nNextQueue{0};
+
+    std::atomic<uint64_t> nTasksExecuted{0};
+    std::atomic<uint64_t> nTasksStolen{0};
+
+public:
+    CWorkStealingPool() {}
+    ~CWorkStealingPool();
+
+    CWorkStealingPool(const CWorkStealingPool&) = delete;
+    CWorkStealingPool& operator=(const CWorkStealingPool&) = delete;
+
+    // Starts nThreads workers named "<threadName>-<idx>". Must only be called once (or again after Stop)
+    void Start(int nThreads, const std::string& threadName);
+    // Stops all workers. If fWait is true, all queued tasks are executed before, otherwise they are discarded
+    void Stop(bool fWait = false);
+    // Discards all tasks which did not start yet
+    void ClearQueue();
+
+    int Size() const { return (int)threads.size(); }
+    size_t GetPendingTaskCount() const { return nPendingTasks; }
+    uint64_t GetExecutedTaskCount() const { return nTasksExecuted; }
+    uint64_t GetStolenTaskCount() const { return nTasksStolen; }
+
+    template <typename F, typename... Rest>
+    auto Push(F&& f, Rest&&... rest) -> std::future<decltype(f(0, rest...))>
+    {
+        auto pck = std::make_shared<std::packaged_task<decltype(f(0, rest...))(int)> >(
+            std::bind(std::forward<F>(f), std::placeholders::_1, std::forward<Rest>(rest)...));
+        auto future = pck->get_future();
+        PushTask([pck](int threadId) {
+            (*pck)(threadId);
+        });
+        return future;
+    }
+
+    // Runs f and then, on the same worker if it does not get stolen, passes its result to c. The returned future
+    // holds the result of c. Other tasks are not blocked while f runs. If f returns void, c is only called with the
+    // index of the worker thread.
+    template <typename F, typename C>
+    auto PushThen(F&& f, C&& c) -> typename std::enable_if<!std::is_void<decltype(f(0))>::value, std::future<decltype(c(0, f(0)))> >::type
+    {
+        typedef decltype(f(0)) FirstResult;
+        typedef decltype(c(0, f(0))) Result;
+
+        auto promise = std::make_shared<std::promise<Result> >();
+        auto future = promise->get_future();
+        auto cont = std::make_shared<typename std::decay<C>::type>(std::forward<C>(c));
+        auto first = std::make_shared<typename std::decay<F>::type>(std::forward<F>(f));
+
+        PushTask([this, first, cont, promise](int threadId) {
+            std::shared_ptr<FirstResult> r;
+            try {
+                r = std::make_shared<FirstResult>((*first)(threadId));
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+                return;
+            }
+            PushTask([r, cont, promise](int threadId2) {
+                try {
+                    SetPromiseValue(*promise, [&]() { return (*cont)(threadId2, *r); });
+                } catch (...) {
+                    promise->set_exception(std::current_exception());
+                }
+            });
+        });
+        return future;
+    }
+
+    template <typename F, typename C>
+    auto PushThen(F&& f, C&& c) -> typename std::enable_if<std::is_void<decltype(f(0))>::value, std::future<decltype(c(0))> >::type
+    {
+        typedef decltype(c(0)) Result;
+
+        auto promise = std::make_shared<std::promise<Result> >();
+        auto future = promise->get_future();
+        auto cont = std::make_shared<typename std::decay<C>::type>(std::forward<C>(c));
+        auto first = std::make_shared<typename std::decay<F>::type>(std::forward<F>(f));
+
+        PushTask([this, first, cont, promise](int threadId) {
+            try {
+                (*first)(threadId);
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+                return;
+            }
+            PushTask([cont, promise](int threadId2) {
+                try {
+                    SetPromiseValue(*promise, [&]() { return (*cont)(threadId2); });
+                } catch (...) {
+                    promise->set_exception(std::current_exception());
+                }
+            });
+        });
+        return future;
+    }
+
+private:
+    void PushTask(Task&& task);
+    bool PopTask(size_t queueIdx, Task& taskRet);
+    void WorkerThread(size_t idx, const std::string& threadName);
+
+    template <typename T, typename F>
+    static void SetPromiseValue(std::promise<T>& p, F&& f)
+    {
+        p.set_value(f());
+    }
+    template <typename F>
+    static void SetPromiseValue(std::promise<void>& p, F&& f)
+    {
+        f();
+        p.set_value();
+    }
+};
+
+#endif //DASH_WORKSTEALINGPOOL_H